@@ -0,0 +1,306 @@
+#include "AssetRegistry.h"
+#include "WICTextureLoader.h" // From DirectX Tool Kit
+#include "DDSTextureLoader.h" // For loading skyboxes (cube maps)
+
+#include <fstream>
+#include <cctype>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Constructor
+//
+// jobs - Job system the file loading and decoding runs on
+// --------------------------------------------------------
+AssetRegistry::AssetRegistry(ID3D11Device* device, ID3D11DeviceContext* context, JobSystem* jobs)
+{
+	this->device = device;
+	this->context = context;
+	this->jobs = jobs;
+	pendingCount = 0;
+}
+
+// --------------------------------------------------------
+// Destructor - Lets in-flight loads finish, then frees
+// every asset, whether or not it was released
+// --------------------------------------------------------
+AssetRegistry::~AssetRegistry()
+{
+	jobs->Wait(&loadJobs);
+
+	for (auto& a : assets) Destroy(a.second);
+	assets.clear();
+}
+
+// --------------------------------------------------------
+// Turns a path into a registry key: lower case, forward
+// slashes, and no "." or ".." segments
+// --------------------------------------------------------
+std::string AssetRegistry::NormalizePath(const char* path)
+{
+	std::vector<std::string> segments;
+	std::string segment;
+	for (const char* c = path; ; c++)
+	{
+		if (*c == '/' || *c == '\\' || *c == 0)
+		{
+			if (segment == "..")
+			{
+				if (!segments.empty() && segments.back() != "..") segments.pop_back();
+				else segments.push_back(segment);
+			}
+			else if (!segment.empty() && segment != ".")
+			{
+				segments.push_back(segment);
+			}
+
+			segment.clear();
+			if (*c == 0) break;
+			continue;
+		}
+
+		segment += (char)tolower((unsigned char)*c);
+	}
+
+	std::string normalized;
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (i > 0) normalized += '/';
+		normalized += segments[i];
+	}
+	return normalized;
+}
+
+Asset* AssetRegistry::LoadMesh(const char* path, AssetCallback onLoaded, bool keepGeometry)
+{
+	return Load(path, ASSET_MESH, onLoaded, keepGeometry);
+}
+
+Asset* AssetRegistry::LoadTexture(const char* path, AssetCallback onLoaded)
+{
+	return Load(path, ASSET_TEXTURE, onLoaded);
+}
+
+Asset* AssetRegistry::LoadTextureDDS(const char* path, AssetCallback onLoaded)
+{
+	return Load(path, ASSET_TEXTURE_DDS, onLoaded);
+}
+
+// --------------------------------------------------------
+// Finds an existing asset for this path or queues a new load
+// --------------------------------------------------------
+Asset* AssetRegistry::Load(const char* path, AssetType type, AssetCallback onLoaded, bool keepGeometry)
+{
+	std::string key = NormalizePath(path);
+
+	// Already known?  Share it.
+	auto existing = assets.find(key);
+	if (existing != assets.end())
+	{
+		Asset* asset = existing->second;
+		asset->RefCount++;
+
+		// Kept once it arrives if still loading.  If it has already
+		// been freed, read it again - the caller is counting on it.
+		if (keepGeometry && asset->Type == ASSET_MESH)
+		{
+			if (asset->State == ASSET_READY && asset->Vertices.empty())
+				Mesh::LoadObj(asset->Path.c_str(), asset->Vertices, asset->Indices);
+			asset->KeepGeometry = true;
+		}
+
+		if (onLoaded)
+		{
+			if (asset->State == ASSET_LOADING) asset->Callbacks.push_back(onLoaded);
+			else onLoaded(asset);
+		}
+		return asset;
+	}
+
+	// Brand new asset
+	Asset* asset = new Asset();
+	asset->Path = key;
+	asset->Type = type;
+	asset->State = ASSET_LOADING;
+	asset->RefCount = 1;
+	asset->KeepGeometry = keepGeometry;
+	asset->MeshData = 0;
+	asset->TextureSRV = 0;
+	if (onLoaded) asset->Callbacks.push_back(onLoaded);
+
+	assets.insert(std::pair<std::string, Asset*>(key, asset));
+	pendingCount++;
+
+	// Do the file work on the job system, then hand the
+	// asset back to the owning thread
+	jobs->Run([this, asset]()
+	{
+		LoadOnWorker(asset);
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			completedQueue.push_back(asset);
+		}
+		workCompleted.notify_all();
+	}, &loadJobs);
+
+	return asset;
+}
+
+void AssetRegistry::AddRef(Asset* asset)
+{
+	asset->RefCount++;
+}
+
+// --------------------------------------------------------
+// Drops a reference, freeing the asset once nothing uses it.
+// Assets still in flight are freed when their load finishes.
+// --------------------------------------------------------
+void AssetRegistry::Release(Asset* asset)
+{
+	if (--asset->RefCount > 0 || asset->State == ASSET_LOADING)
+		return;
+
+	assets.erase(asset->Path);
+	Destroy(asset);
+}
+
+// --------------------------------------------------------
+// Reads (and for meshes, parses) an asset's file.  Runs as a
+// job, so nothing here touches the device or context.
+// --------------------------------------------------------
+void AssetRegistry::LoadOnWorker(Asset* asset)
+{
+	if (asset->Type == ASSET_MESH)
+	{
+		// The OBJ loader already knows about the debug folder
+		Mesh::LoadObj(asset->Path.c_str(), asset->Vertices, asset->Indices);
+		return;
+	}
+
+	// Textures are just read into memory, checking the debug folder too
+	std::ifstream file(asset->Path, std::ios::binary);
+	if (!file.is_open())
+		file.open("debug/" + asset->Path, std::ios::binary);
+	if (!file.is_open())
+		return;
+
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	if (size <= 0)
+		return;
+
+	asset->FileBytes.resize((size_t)size);
+	file.read((char*)&asset->FileBytes[0], size);
+}
+
+// --------------------------------------------------------
+// Turns a worker's results into GPU resources, then frees
+// the CPU-side copies.  Owning thread only.
+// --------------------------------------------------------
+void AssetRegistry::CreateGPUResources(Asset* asset)
+{
+	HRESULT hr = E_FAIL;
+
+	switch (asset->Type)
+	{
+	case ASSET_MESH:
+		if (!asset->Vertices.empty())
+		{
+			asset->MeshData = new Mesh(
+				&asset->Vertices[0], (int)asset->Vertices.size(),
+				&asset->Indices[0], (int)asset->Indices.size(),
+				device);
+			hr = S_OK;
+		}
+		break;
+
+	case ASSET_TEXTURE:
+		if (!asset->FileBytes.empty())
+			hr = CreateWICTextureFromMemory(device, context, &asset->FileBytes[0], asset->FileBytes.size(), 0, &asset->TextureSRV);
+		break;
+
+	case ASSET_TEXTURE_DDS:
+		if (!asset->FileBytes.empty())
+			hr = CreateDDSTextureFromMemory(device, &asset->FileBytes[0], asset->FileBytes.size(), 0, &asset->TextureSRV);
+		break;
+	}
+
+	asset->State = SUCCEEDED(hr) ? ASSET_READY : ASSET_FAILED;
+
+	// Release the memory, not just the contents
+	std::vector<unsigned char>().swap(asset->FileBytes);
+	if (!asset->KeepGeometry)
+		ReleaseGeometry(asset);
+}
+
+// --------------------------------------------------------
+// Frees a mesh's CPU-side copy, once whoever asked for it
+// to be kept is done with it
+// --------------------------------------------------------
+void AssetRegistry::ReleaseGeometry(Asset* asset)
+{
+	std::vector<Vertex>().swap(asset->Vertices);
+	std::vector<unsigned int>().swap(asset->Indices);
+	asset->KeepGeometry = false;
+}
+
+// --------------------------------------------------------
+// Creates GPU resources for everything the workers have
+// finished, all in one batch, then fires callbacks
+// --------------------------------------------------------
+void AssetRegistry::ProcessCompletedLoads()
+{
+	std::deque<Asset*> completed;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		completed.swap(completedQueue);
+	}
+
+	for (auto& asset : completed)
+	{
+		CreateGPUResources(asset);
+		pendingCount--;
+
+		// Everyone let go while it was loading
+		if (asset->RefCount <= 0)
+		{
+			assets.erase(asset->Path);
+			Destroy(asset);
+			continue;
+		}
+
+		std::vector<AssetCallback> callbacks;
+		callbacks.swap(asset->Callbacks);
+		for (auto& cb : callbacks) cb(asset);
+	}
+}
+
+// --------------------------------------------------------
+// Processes loads as they finish until none are left, so
+// total time is that of the slowest load rather than the sum
+// --------------------------------------------------------
+void AssetRegistry::WaitForAll()
+{
+	while (pendingCount > 0)
+	{
+		ProcessCompletedLoads();
+		if (pendingCount == 0)
+			break;
+
+		// Help out with the loading, or sleep once it's all in progress
+		if (!jobs->TryRunJob())
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			workCompleted.wait(lock, [this] { return !completedQueue.empty(); });
+		}
+	}
+}
+
+void AssetRegistry::Destroy(Asset* asset)
+{
+	delete asset->MeshData;
+	if (asset->TextureSRV) asset->TextureSRV->Release();
+	delete asset;
+}
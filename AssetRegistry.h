@@ -0,0 +1,114 @@
+#pragma once
+
+#include <d3d11.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "Mesh.h"
+#include "JobSystem.h"
+
+enum AssetType
+{
+	ASSET_MESH,			// Wavefront OBJ
+	ASSET_TEXTURE,		// Anything WIC can decode (jpg, png, tiff, ...)
+	ASSET_TEXTURE_DDS	// DDS textures, including cube maps
+};
+
+enum AssetState
+{
+	ASSET_LOADING,
+	ASSET_READY,
+	ASSET_FAILED
+};
+
+struct Asset;
+typedef std::function<void(Asset*)> AssetCallback;
+
+// --------------------------------------------------------
+// A single shared asset.  Only the owning thread should
+// touch the ref count and GPU resources.
+// --------------------------------------------------------
+struct Asset
+{
+	std::string Path;		// Normalized path, also the registry key
+	AssetType Type;
+	AssetState State;
+	int RefCount;
+	bool KeepGeometry;		// Meshes: hold on to Vertices/Indices once loaded
+
+	// GPU resources, valid once State is ASSET_READY
+	Mesh* MeshData;
+	ID3D11ShaderResourceView* TextureSRV;
+
+	// CPU-side results handed from a worker to the owning thread.
+	// Freed once the GPU resources exist, unless KeepGeometry is set.
+	std::vector<unsigned char> FileBytes;
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+
+	// Called on the owning thread once the asset finishes loading
+	std::vector<AssetCallback> Callbacks;
+};
+
+// --------------------------------------------------------
+// Loads meshes and textures once per path and shares them
+//
+// File reads and decoding run as jobs on the JobSystem.
+// GPU resources are created in batches on the thread that owns
+// the registry, inside ProcessCompletedLoads() or WaitForAll().
+// --------------------------------------------------------
+class AssetRegistry
+{
+public:
+	AssetRegistry(ID3D11Device* device, ID3D11DeviceContext* context, JobSystem* jobs);
+	~AssetRegistry();
+
+	// Start (or share) a load, adding a reference to the returned asset.
+	// keepGeometry leaves a CPU copy of the mesh data in the asset
+	// (for static batching) until ReleaseGeometry() is called.  A
+	// mesh whose copy was already freed reads its file again, on
+	// this thread, so Vertices is only empty if the load failed.
+	Asset* LoadMesh(const char* path, AssetCallback onLoaded = AssetCallback(), bool keepGeometry = false);
+	Asset* LoadTexture(const char* path, AssetCallback onLoaded = AssetCallback());
+	Asset* LoadTextureDDS(const char* path, AssetCallback onLoaded = AssetCallback());
+
+	// Reference counting, owning thread only
+	void AddRef(Asset* asset);
+	void Release(Asset* asset);
+	void ReleaseGeometry(Asset* asset);
+
+	// Creates GPU resources for finished loads and fires their callbacks
+	void ProcessCompletedLoads();
+
+	// Blocks until every pending load is finished and processed
+	void WaitForAll();
+
+	unsigned int GetPendingCount() { return pendingCount; }
+
+	static std::string NormalizePath(const char* path);
+
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	std::unordered_map<std::string, Asset*> assets;
+	unsigned int pendingCount;	// Loads not yet processed on the owning thread
+
+	// Loads run as jobs, handing finished assets back here
+	JobSystem* jobs;
+	JobCounter loadJobs;
+	std::deque<Asset*> completedQueue;
+	std::mutex queueMutex;
+	std::condition_variable workCompleted;
+
+	Asset* Load(const char* path, AssetType type, AssetCallback onLoaded, bool keepGeometry = false);
+	void LoadOnWorker(Asset* asset);
+	void CreateGPUResources(Asset* asset);
+	void Destroy(Asset* asset);
+};
+
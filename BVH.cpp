@@ -0,0 +1,502 @@
+#include "BVH.h"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+
+static const unsigned int NoNode = 0xFFFFFFFF;
+
+// Half the surface area of a box, which is all the SAH needs
+static float HalfArea(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	float x = max.x - min.x;
+	float y = max.y - min.y;
+	float z = max.z - min.z;
+	return x * y + y * z + z * x;
+}
+
+static void Grow(XMFLOAT3& min, XMFLOAT3& max, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	// Written as selects so they compile to minss/maxss rather than branches
+	min.x = boxMin.x < min.x ? boxMin.x : min.x;
+	min.y = boxMin.y < min.y ? boxMin.y : min.y;
+	min.z = boxMin.z < min.z ? boxMin.z : min.z;
+	max.x = boxMax.x > max.x ? boxMax.x : max.x;
+	max.y = boxMax.y > max.y ? boxMax.y : max.y;
+	max.z = boxMax.z > max.z ? boxMax.z : max.z;
+}
+
+// --------------------------------------------------------
+// Tests a box against a frustum: 0 if outside, 1 if it
+// crosses a plane, 2 if entirely inside
+// --------------------------------------------------------
+static int TestBox(const Frustum& frustum, const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	float cx = (min.x + max.x) * 0.5f, ex = (max.x - min.x) * 0.5f;
+	float cy = (min.y + max.y) * 0.5f, ey = (max.y - min.y) * 0.5f;
+	float cz = (min.z + max.z) * 0.5f, ez = (max.z - min.z) * 0.5f;
+
+	int result = 2;
+	for (unsigned int p = 0; p < frustum.PlaneCount; p++)
+	{
+		const XMFLOAT4& plane = frustum.Planes[p];
+		float dist = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		float radius = fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+
+		if (dist + radius < 0) return 0;
+		if (dist - radius < 0) result = 1;
+	}
+	return result;
+}
+
+BVH::BVH()
+{
+	maxId = 0;
+}
+
+BVH::~BVH()
+{
+}
+
+void BVH::Clear()
+{
+	nodes.clear();
+	parents.clear();
+	itemMins.clear();
+	itemMaxs.clear();
+	itemIds.clear();
+	itemLeaves.clear();
+	idToItem.clear();
+	dirtyLeaves.clear();
+	maxId = 0;
+}
+
+void BVH::AddItem(unsigned int id, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	itemMins.push_back(XMFLOAT3(center.x - extents.x, center.y - extents.y, center.z - extents.z));
+	itemMaxs.push_back(XMFLOAT3(center.x + extents.x, center.y + extents.y, center.z + extents.z));
+	itemIds.push_back(id);
+	if (id > maxId) maxId = id;
+}
+
+// --------------------------------------------------------
+// Builds the tree over every added item, reordering the
+// items so each leaf's are next to each other
+// --------------------------------------------------------
+void BVH::Build()
+{
+	nodes.clear();
+	parents.clear();
+	dirtyLeaves.clear();
+	idToItem.clear();
+
+	unsigned int count = (unsigned int)itemIds.size();
+	if (count == 0)
+		return;
+
+	nodes.reserve(count * 2);
+	parents.reserve(count * 2);
+	BuildNode(0, count, NoNode);
+
+	// Remember where everything ended up, for SetBounds()
+	itemLeaves.assign(count, 0);
+	for (unsigned int n = 0; n < nodes.size(); n++)
+	{
+		if (nodes[n].Items == 0)
+			continue;
+
+		unsigned int first = nodes[n].Items >> 4;
+		unsigned int end = first + (nodes[n].Items & 15);
+		for (unsigned int i = first; i < end; i++)
+			itemLeaves[i] = n;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+		idToItem[itemIds[i]] = i;
+}
+
+// --------------------------------------------------------
+// Recursively builds the subtree for items [start, end),
+// choosing each split with a 16-bin surface area heuristic
+// --------------------------------------------------------
+unsigned int BVH::BuildNode(unsigned int start, unsigned int end, unsigned int parent)
+{
+	unsigned int node = (unsigned int)nodes.size();
+	nodes.push_back(BVHNode());
+	parents.push_back(parent);
+
+	// Bounds of the items, and of their centers
+	XMFLOAT3 boxMin(FLT_MAX, FLT_MAX, FLT_MAX), boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 cmin = boxMin, cmax = boxMax;
+	for (unsigned int i = start; i < end; i++)
+	{
+		Grow(boxMin, boxMax, itemMins[i], itemMaxs[i]);
+		XMFLOAT3 c(
+			(itemMins[i].x + itemMaxs[i].x) * 0.5f,
+			(itemMins[i].y + itemMaxs[i].y) * 0.5f,
+			(itemMins[i].z + itemMaxs[i].z) * 0.5f);
+		Grow(cmin, cmax, c, c);
+	}
+	nodes[node].Min = boxMin;
+	nodes[node].Max = boxMax;
+
+	unsigned int count = end - start;
+	if (count == 1)
+	{
+		MakeLeaf(node, start, end);
+		return node;
+	}
+
+	// Try every bin boundary on every axis.  Small nodes use
+	// fewer bins, since they outnumber the big ones by far.
+	unsigned int bins = count < BinCount ? count : BinCount;
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	unsigned int bestBin = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float lo = (&cmin.x)[axis];
+		float hi = (&cmax.x)[axis];
+		if (hi - lo < 1e-6f)
+			continue;
+
+		float scale = bins / (hi - lo);
+		XMFLOAT3 binMin[BinCount], binMax[BinCount];
+		unsigned int binCount[BinCount] = {};
+		for (unsigned int b = 0; b < bins; b++)
+		{
+			binMin[b] = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			binMax[b] = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		}
+
+		for (unsigned int i = start; i < end; i++)
+		{
+			float c = ((&itemMins[i].x)[axis] + (&itemMaxs[i].x)[axis]) * 0.5f;
+			unsigned int b = (unsigned int)((c - lo) * scale);
+			if (b >= bins) b = bins - 1;
+
+			binCount[b]++;
+			Grow(binMin[b], binMax[b], itemMins[i], itemMaxs[i]);
+		}
+
+		// Sweep from the left, remembering area * count for each split...
+		float leftCost[BinCount - 1];
+		unsigned int leftCount[BinCount - 1];
+		XMFLOAT3 lmin(FLT_MAX, FLT_MAX, FLT_MAX), lmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		unsigned int running = 0;
+		for (unsigned int b = 0; b < bins - 1; b++)
+		{
+			running += binCount[b];
+			if (binCount[b]) Grow(lmin, lmax, binMin[b], binMax[b]);
+			leftCount[b] = running;
+			leftCost[b] = running ? HalfArea(lmin, lmax) * running : 0;
+		}
+
+		// ...then from the right, adding the two halves together
+		XMFLOAT3 rmin(FLT_MAX, FLT_MAX, FLT_MAX), rmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		running = 0;
+		for (unsigned int b = bins - 1; b > 0; b--)
+		{
+			running += binCount[b];
+			if (binCount[b]) Grow(rmin, rmax, binMin[b], binMax[b]);
+			if (running == 0 || leftCount[b - 1] == 0)
+				continue;
+
+			float cost = leftCost[b - 1] + HalfArea(rmin, rmax) * running;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b - 1;
+			}
+		}
+	}
+
+	// Splitting costs one extra box test, so only split when the
+	// children are expected to be cheaper than testing every item
+	float parentArea = HalfArea(boxMin, boxMax);
+	bool canSplit = bestAxis >= 0;
+	if (count <= MaxLeafItems && (!canSplit || parentArea <= 0 || 1.0f + bestCost / parentArea >= count))
+	{
+		MakeLeaf(node, start, end);
+		return node;
+	}
+
+	// Partition the items around the chosen bin boundary
+	unsigned int mid = start + count / 2;
+	if (canSplit)
+	{
+		float lo = (&cmin.x)[bestAxis];
+		float scale = bins / ((&cmax.x)[bestAxis] - lo);
+		unsigned int i = start, j = end;
+		while (i < j)
+		{
+			float c = ((&itemMins[i].x)[bestAxis] + (&itemMaxs[i].x)[bestAxis]) * 0.5f;
+			unsigned int b = (unsigned int)((c - lo) * scale);
+			if (b >= bins) b = bins - 1;
+
+			if (b <= bestBin)
+			{
+				i++;
+				continue;
+			}
+
+			j--;
+			std::swap(itemMins[i], itemMins[j]);
+			std::swap(itemMaxs[i], itemMaxs[j]);
+			std::swap(itemIds[i], itemIds[j]);
+		}
+
+		if (i > start && i < end)
+			mid = i;
+	}
+
+	// Left child is always the very next node
+	BuildNode(start, mid, node);
+	BuildNode(mid, end, node);
+	nodes[node].Skip = (unsigned int)nodes.size();
+	nodes[node].Items = 0;
+	return node;
+}
+
+void BVH::MakeLeaf(unsigned int node, unsigned int start, unsigned int end)
+{
+	nodes[node].Skip = node + 1;
+	nodes[node].Items = (start << 4) | (end - start);
+}
+
+bool BVH::SetBounds(unsigned int id, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	auto found = idToItem.find(id);
+	if (found == idToItem.end())
+		return false;
+
+	unsigned int i = found->second;
+	itemMins[i] = XMFLOAT3(center.x - extents.x, center.y - extents.y, center.z - extents.z);
+	itemMaxs[i] = XMFLOAT3(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+	dirtyLeaves.push_back(itemLeaves[i]);
+	return true;
+}
+
+bool BVH::GetBounds(unsigned int id, XMFLOAT3& center, XMFLOAT3& extents)
+{
+	auto found = idToItem.find(id);
+	if (found == idToItem.end())
+		return false;
+
+	const XMFLOAT3& boxMin = itemMins[found->second];
+	const XMFLOAT3& boxMax = itemMaxs[found->second];
+	center = XMFLOAT3((boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f);
+	extents = XMFLOAT3((boxMax.x - boxMin.x) * 0.5f, (boxMax.y - boxMin.y) * 0.5f, (boxMax.z - boxMin.z) * 0.5f);
+	return true;
+}
+
+// --------------------------------------------------------
+// Refits node boxes around moved items.  A few moved items
+// walk up from their leaves, stopping as soon as a box stays
+// the same.  Lots of them get one backwards sweep instead,
+// which reaches every child before its parent.
+// --------------------------------------------------------
+void BVH::Refit()
+{
+	if (dirtyLeaves.empty())
+		return;
+
+	if (dirtyLeaves.size() * 8 > nodes.size())
+	{
+		for (unsigned int n = (unsigned int)nodes.size(); n-- > 0; )
+			RefitNode(n);
+	}
+	else
+	{
+		for (auto& leaf : dirtyLeaves)
+		{
+			for (unsigned int n = leaf; n != NoNode && RefitNode(n); n = parents[n]);
+		}
+	}
+
+	dirtyLeaves.clear();
+}
+
+// Recomputes one node's box from its items or children,
+// returning true if it changed
+bool BVH::RefitNode(unsigned int node)
+{
+	BVHNode& n = nodes[node];
+	XMFLOAT3 boxMin(FLT_MAX, FLT_MAX, FLT_MAX), boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	if (n.Items)
+	{
+		unsigned int first = n.Items >> 4;
+		unsigned int end = first + (n.Items & 15);
+		for (unsigned int i = first; i < end; i++)
+			Grow(boxMin, boxMax, itemMins[i], itemMaxs[i]);
+	}
+	else
+	{
+		const BVHNode& left = nodes[node + 1];
+		const BVHNode& right = nodes[left.Skip];
+		Grow(boxMin, boxMax, left.Min, left.Max);
+		Grow(boxMin, boxMax, right.Min, right.Max);
+	}
+
+	bool changed =
+		boxMin.x != n.Min.x || boxMin.y != n.Min.y || boxMin.z != n.Min.z ||
+		boxMax.x != n.Max.x || boxMax.y != n.Max.y || boxMax.z != n.Max.z;
+	n.Min = boxMin;
+	n.Max = boxMax;
+	return changed;
+}
+
+// --------------------------------------------------------
+// Walks the nodes in order.  Subtrees outside the frustum are
+// skipped, and subtrees fully inside are accepted without any
+// more tests since their items are one contiguous range.
+// --------------------------------------------------------
+void BVH::Cull(const Frustum& frustum, CullResult& result)
+{
+	if (nodes.empty())
+		return;
+	if (result.Flags.size() <= maxId)
+		result.Flags.resize(maxId + 1, 0);
+
+	unsigned int count = (unsigned int)nodes.size();
+	unsigned int i = 0;
+	while (i < count)
+	{
+		const BVHNode& n = nodes[i];
+		int side = TestBox(frustum, n.Min, n.Max);
+		if (side == 0)
+		{
+			i = n.Skip;
+			continue;
+		}
+
+		unsigned int first, end;
+		if (side == 2)
+		{
+			// From the leftmost leaf to the last node of the subtree,
+			// which is always a leaf in depth-first order
+			unsigned int leftmost = i;
+			while (nodes[leftmost].Items == 0) leftmost++;
+			const BVHNode& last = nodes[n.Skip - 1];
+			first = nodes[leftmost].Items >> 4;
+			end = (last.Items >> 4) + (last.Items & 15);
+
+			for (unsigned int item = first; item < end; item++)
+			{
+				result.Visible.push_back(itemIds[item]);
+				result.Flags[itemIds[item]] = 1;
+			}
+
+			i = n.Skip;
+			continue;
+		}
+
+		if (n.Items)
+		{
+			first = n.Items >> 4;
+			end = first + (n.Items & 15);
+			for (unsigned int item = first; item < end; item++)
+			{
+				if (TestBox(frustum, itemMins[item], itemMaxs[item]) == 0)
+					continue;
+
+				result.Visible.push_back(itemIds[item]);
+				result.Flags[itemIds[item]] = 1;
+			}
+		}
+
+		// Next node is the left child, or the next subtree for a leaf
+		i++;
+	}
+}
+
+// Distance along the ray to a box, or a negative number on a miss
+static float RayBox(const XMFLOAT3& origin, const XMFLOAT3& invDir, const XMFLOAT3& min, const XMFLOAT3& max, float maxDistance)
+{
+	float tx0 = (min.x - origin.x) * invDir.x, tx1 = (max.x - origin.x) * invDir.x;
+	float ty0 = (min.y - origin.y) * invDir.y, ty1 = (max.y - origin.y) * invDir.y;
+	float tz0 = (min.z - origin.z) * invDir.z, tz1 = (max.z - origin.z) * invDir.z;
+
+	float tNear = fmaxf(fmaxf(fminf(tx0, tx1), fminf(ty0, ty1)), fmaxf(fminf(tz0, tz1), 0.0f));
+	float tFar = fminf(fminf(fmaxf(tx0, tx1), fmaxf(ty0, ty1)), fminf(fmaxf(tz0, tz1), maxDistance));
+	return tNear <= tFar ? tNear : -1.0f;
+}
+
+bool BVH::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, unsigned int* hitId, float* hitDistance)
+{
+	XMFLOAT3 invDir(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float best = maxDistance;
+	bool hit = false;
+
+	unsigned int count = (unsigned int)nodes.size();
+	unsigned int i = 0;
+	while (i < count)
+	{
+		const BVHNode& n = nodes[i];
+
+		// Missed, or can't beat what we've already hit
+		if (RayBox(origin, invDir, n.Min, n.Max, best) < 0)
+		{
+			i = n.Skip;
+			continue;
+		}
+
+		if (n.Items)
+		{
+			unsigned int first = n.Items >> 4;
+			unsigned int end = first + (n.Items & 15);
+			for (unsigned int item = first; item < end; item++)
+			{
+				float t = RayBox(origin, invDir, itemMins[item], itemMaxs[item], best);
+				if (t < 0)
+					continue;
+
+				best = t;
+				hit = true;
+				if (hitId) *hitId = itemIds[item];
+			}
+		}
+
+		i++;
+	}
+
+	if (hit && hitDistance) *hitDistance = best;
+	return hit;
+}
+
+void BVH::Overlap(const XMFLOAT3& min, const XMFLOAT3& max, std::vector<unsigned int>& ids)
+{
+	unsigned int count = (unsigned int)nodes.size();
+	unsigned int i = 0;
+	while (i < count)
+	{
+		const BVHNode& n = nodes[i];
+		if (n.Min.x > max.x || n.Max.x < min.x ||
+			n.Min.y > max.y || n.Max.y < min.y ||
+			n.Min.z > max.z || n.Max.z < min.z)
+		{
+			i = n.Skip;
+			continue;
+		}
+
+		if (n.Items)
+		{
+			unsigned int first = n.Items >> 4;
+			unsigned int end = first + (n.Items & 15);
+			for (unsigned int item = first; item < end; item++)
+			{
+				const XMFLOAT3& a = itemMins[item];
+				const XMFLOAT3& b = itemMaxs[item];
+				if (a.x <= max.x && b.x >= min.x &&
+					a.y <= max.y && b.y >= min.y &&
+					a.z <= max.z && b.z >= min.z)
+					ids.push_back(itemIds[item]);
+			}
+		}
+
+		i++;
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <unordered_map>
+
+#include "FrustumCuller.h"
+
+// --------------------------------------------------------
+// A BVH node, 32 bytes so two share a cache line.  Nodes are
+// stored depth first, so an internal node's left child is the
+// next node and its right child is where the left subtree ends.
+// --------------------------------------------------------
+struct BVHNode
+{
+	DirectX::XMFLOAT3 Min;
+	unsigned int Skip;		// Next node to visit once this subtree is done
+	DirectX::XMFLOAT3 Max;
+	unsigned int Items;		// Leaves: first item << 4 | item count.  Internal nodes: 0
+};
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over world-space boxes, meant for
+// lots of static entities
+//
+// Built with a binned surface area heuristic into one flat
+// node array.  Queries walk the array front to back using the
+// skip indices, so no stack is needed.  When some items move,
+// SetBounds() + Refit() adjusts the boxes without rebuilding.
+// --------------------------------------------------------
+class BVH
+{
+public:
+	BVH();
+	~BVH();
+
+	// Items are identified by the caller's ids (transform
+	// handles in Game).  Add them all, then Build().
+	void Clear();
+	void AddItem(unsigned int id, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+	void Build();
+
+	// Moves an existing item - call Refit() once they're all moved
+	bool SetBounds(unsigned int id, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+	bool GetBounds(unsigned int id, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extents);
+	void Refit();
+
+	// Marks every item at least partly inside the frustum as visible,
+	// adding to whatever is already in the result
+	void Cull(const Frustum& frustum, CullResult& result);
+
+	// Finds the nearest item whose box the ray hits
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, unsigned int* hitId, float* hitDistance);
+
+	// Finds every item whose box overlaps the given box
+	void Overlap(const DirectX::XMFLOAT3& min, const DirectX::XMFLOAT3& max, std::vector<unsigned int>& ids);
+
+	unsigned int GetItemCount() { return (unsigned int)itemIds.size(); }
+	unsigned int GetNodeCount() { return (unsigned int)nodes.size(); }
+
+private:
+	static const unsigned int MaxLeafItems = 4;
+	static const unsigned int BinCount = 16;
+
+	std::vector<BVHNode> nodes;
+	std::vector<unsigned int> parents;		// Only needed for partial refits
+
+	// Items in tree order, so each leaf's items are contiguous
+	std::vector<DirectX::XMFLOAT3> itemMins;
+	std::vector<DirectX::XMFLOAT3> itemMaxs;
+	std::vector<unsigned int> itemIds;
+	std::vector<unsigned int> itemLeaves;
+	std::unordered_map<unsigned int, unsigned int> idToItem;
+
+	std::vector<unsigned int> dirtyLeaves;	// Leaves with moved items since the last refit
+	unsigned int maxId;
+
+	unsigned int BuildNode(unsigned int start, unsigned int end, unsigned int parent);
+	void MakeLeaf(unsigned int node, unsigned int start, unsigned int end);
+	bool RefitNode(unsigned int node);
+};
+
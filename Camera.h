@@ -1,41 +1,45 @@
-#pragma once
-#include <DirectXMath.h>
-
-
-class Camera
-{
-public:
-	Camera(float x, float y, float z);
-	~Camera();
-
-	// Transformations
-	void MoveRelative(float x, float y, float z);
-	void MoveAbsolute(float x, float y, float z);
-	void Rotate(float x, float y);
-
-	// Updating
-	void Update(float dt);
-	void UpdateViewMatrix();
-	void UpdateProjectionMatrix(float aspectRatio);
-	void UpdateReflectionViewMatrix(float height);
-
-	// Getters
-	DirectX::XMFLOAT3 GetPosition() { return position; }
-	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
-	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
-	DirectX::XMFLOAT4X4 GetReflectionView() { return reflViewMatrix; }
-
-private:
-	// Camera matrices
-	DirectX::XMFLOAT4X4 viewMatrix;
-	DirectX::XMFLOAT4X4 projMatrix;
-	DirectX::XMFLOAT4X4 reflViewMatrix;
-
-	// Transformations
-	DirectX::XMFLOAT3 startPosition;
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT4 rotation;
-	float xRotation;
-	float yRotation;
-};
-
+#pragma once
+#include <DirectXMath.h>
+
+
+class Camera
+{
+public:
+	Camera(float x, float y, float z);
+	~Camera();
+
+	// Transformations
+	void MoveRelative(float x, float y, float z);
+	void MoveAbsolute(float x, float y, float z);
+	void Rotate(float x, float y);
+
+	// Updating
+	void Update(float dt);
+	void UpdateViewMatrix();
+	void UpdateProjectionMatrix(float aspectRatio);
+	void UpdateReflectionViewMatrix(float height);
+
+	// Getters
+	DirectX::XMFLOAT3 GetPosition() { return position; }
+	DirectX::XMFLOAT4 GetRotation() { return rotation; }
+	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
+	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
+	DirectX::XMFLOAT4X4 GetReflectionView() { return reflViewMatrix; }
+
+	// The view matrix (transposed) for any position and rotation
+	static DirectX::XMFLOAT4X4 BuildViewMatrix(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& rotation);
+
+private:
+	// Camera matrices
+	DirectX::XMFLOAT4X4 viewMatrix;
+	DirectX::XMFLOAT4X4 projMatrix;
+	DirectX::XMFLOAT4X4 reflViewMatrix;
+
+	// Transformations
+	DirectX::XMFLOAT3 startPosition;
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT4 rotation;
+	float xRotation;
+	float yRotation;
+};
+
@@ -0,0 +1,100 @@
+#include "ConstantBufferRing.h"
+#include <climits>
+
+ConstantBufferRing::ConstantBufferRing(ID3D11Device* device, ID3D11DeviceContext* context, unsigned int size)
+{
+	this->device = device;
+	this->context = context;
+	backend = RenderBackend::Get(context);
+	stateCache = StateCache::Get(context);
+	buffer = 0;
+	capacity = 0;
+	cursor = 0;
+
+	// Offsets only work with the 11.1 context and driver support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	ID3D11DeviceContext1* context1 = 0;
+	supported =
+		SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferOffsetting &&
+		options.MapNoOverwriteOnDynamicConstantBuffer &&
+		SUCCEEDED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&context1));
+
+	if (context1)
+		context1->Release();
+
+	if (supported)
+		supported = CreateBuffer(Align(size));
+}
+
+ConstantBufferRing::~ConstantBufferRing()
+{
+	if (buffer) buffer->Release();
+}
+
+bool ConstantBufferRing::CreateBuffer(unsigned int size)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = size;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ID3D11Buffer* created = 0;
+	if (FAILED(device->CreateBuffer(&desc, 0, &created)))
+		return false;
+
+	if (buffer) buffer->Release();
+	buffer = created;
+	capacity = size;
+	cursor = 0;
+	return true;
+}
+
+unsigned char* ConstantBufferRing::Map(unsigned int size, unsigned int& offset)
+{
+	if (!supported)
+		return 0;
+
+	// A fresh buffer has nothing in flight, so it's the same as a discard
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (size > capacity)
+	{
+		// Doubling stops before it would wrap, and then the size
+		// is asked for as is - CreateBuffer() turns down whatever
+		// D3D11 can't hold
+		unsigned int grown = capacity > 0 ? capacity : size;
+		while (grown < size && grown <= UINT_MAX / 2) grown *= 2;
+		if (grown < size) grown = size;
+		if (!CreateBuffer(grown))
+			return 0;
+		mapType = D3D11_MAP_WRITE_DISCARD;
+	}
+	else if (cursor + size > capacity)
+	{
+		cursor = 0;
+		mapType = D3D11_MAP_WRITE_DISCARD;
+	}
+
+	unsigned char* mapped = (unsigned char*)backend->Map(buffer, mapType, cursor, size);
+	if (!mapped)
+		return 0;
+
+	offset = cursor;
+	cursor += Align(size);
+	return mapped;
+}
+
+void ConstantBufferRing::Unmap()
+{
+	backend->Unmap(buffer);
+}
+
+bool ConstantBufferRing::Bind(ShaderStage stage, unsigned int slot, unsigned int offset, unsigned int size)
+{
+	if (!supported)
+		return false;
+
+	// Both are counted in 16 byte constants
+	return stateCache->SetConstantBufferRange(stage, slot, buffer, offset / 16, Align(size) / 16);
+}
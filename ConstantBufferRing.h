@@ -0,0 +1,56 @@
+#pragma once
+
+#include <d3d11.h>
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// One large dynamic constant buffer that many small constant
+// buffers are carved out of
+//
+// Each Map() reserves a block past the last one and maps with
+// WRITE_NO_OVERWRITE, so the GPU can keep reading earlier
+// blocks.  When the end is reached it starts over with
+// WRITE_DISCARD.  Blocks are bound by offset with the 11.1
+// *SetConstantBuffers1 calls, which need 256 byte aligned
+// offsets and sizes - see Align().
+//
+// Needs constant buffer offsetting and NO_OVERWRITE on
+// dynamic constant buffers (D3D 11.1).  IsSupported() is
+// false without them, and nothing else does anything.
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing(ID3D11Device* device, ID3D11DeviceContext* context, unsigned int size = 1024 * 1024);
+	~ConstantBufferRing();
+
+	bool IsSupported() { return supported; }
+
+	// Rounds a constant buffer size up to what a block needs
+	static unsigned int Align(unsigned int size) { return (size + 255) & ~255u; }
+
+	// Reserves and maps "size" bytes (a multiple of Align()),
+	// growing the ring if it's too small.  "offset" is where the
+	// returned memory starts, in bytes from the start of the ring.
+	// Null if the ring can't be used or mapping failed.
+	unsigned char* Map(unsigned int size, unsigned int& offset);
+	void Unmap();
+
+	// Binds "size" bytes at "offset" to a constant buffer slot
+	bool Bind(ShaderStage stage, unsigned int slot, unsigned int offset, unsigned int size);
+
+	unsigned int GetCapacity() { return capacity; }
+
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+	RenderBackend* backend;
+	StateCache* stateCache;
+
+	bool supported;
+	ID3D11Buffer* buffer;
+	unsigned int capacity;
+	unsigned int cursor;	// Where the next block goes
+
+	bool CreateBuffer(unsigned int size);
+};
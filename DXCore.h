@@ -1,91 +1,135 @@
-#pragma once
-
-#include <Windows.h>
-#include <d3d11.h>
-#include <string>
-
-// We can include the correct library files here
-// instead of in Visual Studio settings if we want
-#pragma comment(lib, "d3d11.lib")
-
-class DXCore
-{
-public:
-	DXCore(
-		HINSTANCE hInstance,		// The application's handle
-		char* titleBarText,			// Text for the window's title bar
-		unsigned int windowWidth,	// Width of the window's client area
-		unsigned int windowHeight,	// Height of the window's client area
-		bool debugTitleBarStats);	// Show extra stats (fps) in title bar?
-	~DXCore();
-
-	// Static requirements for OS-level message processing
-	static DXCore* DXCoreInstance;
-	static LRESULT CALLBACK WindowProc(
-		HWND hWnd,		// Window handle
-		UINT uMsg,		// Message
-		WPARAM wParam,	// Message's first parameter
-		LPARAM lParam	// Message's second parameter
-		);
-
-	// Internal method for message handling
-	LRESULT ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
-
-	// Initialization and game-loop related methods
-	HRESULT InitWindow();
-	HRESULT InitDirectX();
-	HRESULT Run();				
-	void Quit();
-	virtual void OnResize();
-	
-	// Pure virtual methods for setup and game functionality
-	virtual void Init()										= 0;
-	virtual void Update(float deltaTime, float totalTime)	= 0;
-	virtual void Draw(float deltaTime, float totalTime)		= 0;
-
-	// Convenience methods for handling mouse input, since we
-	// can easily grab mouse input from OS-level messages
-	virtual void OnMouseDown (WPARAM buttonState, int x, int y) { }
-	virtual void OnMouseUp	 (WPARAM buttonState, int x, int y) { }
-	virtual void OnMouseMove (WPARAM buttonState, int x, int y) { }
-	virtual void OnMouseWheel(float wheelDelta,   int x, int y) { }
-	
-protected:
-	HINSTANCE	hInstance;		// The handle to the application
-	HWND		hWnd;			// The handle to the window itself
-	std::string titleBarText;	// Custom text in window's title bar
-	bool		titleBarStats;	// Show extra stats in title bar?
-	
-	// Size of the window's client area
-	unsigned int width;
-	unsigned int height;
-	
-	// DirectX related objects and variables
-	D3D_FEATURE_LEVEL		dxFeatureLevel;
-	IDXGISwapChain*			swapChain;
-	ID3D11Device*			device;
-	ID3D11DeviceContext*	context;
-
-	ID3D11RenderTargetView* backBufferRTV;
-	ID3D11DepthStencilView* depthStencilView;
-
-	// Helper function for allocating a console window
-	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
-
-private:
-	// Timing related data
-	double perfCounterSeconds;
-	float totalTime;
-	float deltaTime;
-	__int64 startTime;
-	__int64 currentTime;
-	__int64 previousTime;
-
-	// FPS calculation
-	int fpsFrameCount;
-	float fpsTimeElapsed;
-	
-	void UpdateTimer();			// Updates the timer for this frame
-	void UpdateTitleBarStats();	// Puts debug info in the title bar
-};
-
+#pragma once
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <string>
+
+class RecordingRenderBackend;
+
+// We can include the correct library files here
+// instead of in Visual Studio settings if we want
+#pragma comment(lib, "d3d11.lib")
+
+class DXCore
+{
+public:
+	DXCore(
+		HINSTANCE hInstance,		// The application's handle
+		char* titleBarText,			// Text for the window's title bar
+		unsigned int windowWidth,	// Width of the window's client area
+		unsigned int windowHeight,	// Height of the window's client area
+		bool debugTitleBarStats);	// Show extra stats (fps) in title bar?
+	~DXCore();
+
+	// Static requirements for OS-level message processing
+	static DXCore* DXCoreInstance;
+	static LRESULT CALLBACK WindowProc(
+		HWND hWnd,		// Window handle
+		UINT uMsg,		// Message
+		WPARAM wParam,	// Message's first parameter
+		LPARAM lParam	// Message's second parameter
+		);
+
+	// Internal method for message handling
+	LRESULT ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+	// Initialization and game-loop related methods
+	HRESULT InitWindow();
+	HRESULT InitDirectX();
+	HRESULT Run();				
+
+	// No window or GPU - see InitHeadless() in DXCore.cpp
+	HRESULT InitHeadless();
+	HRESULT RunHeadless(unsigned int frames);
+
+	// Sends stdout and stderr to the console this was started
+	// from, if any, as a windowed app doesn't get one
+	static void AttachParentConsole();
+	void Quit();
+	virtual void OnResize();
+	
+	// Pure virtual methods for setup and game functionality
+	virtual void Init()										= 0;
+	virtual void Update(float deltaTime, float totalTime)	= 0;
+
+	// alpha - How far the frame is between the last two fixed
+	//         updates, 0 to 1.  Always 1 without a fixed timestep.
+	virtual void Draw(float deltaTime, float totalTime, float alpha) = 0;
+
+	// Runs Update() at a fixed rate instead of once per frame, as
+	// many times as it takes to catch up with the clock, but no
+	// more than maxUpdatesPerFrame.  0 goes back to once a frame.
+	void SetFixedTimestep(float updatesPerSecond, unsigned int maxUpdatesPerFrame = 5);
+
+	// Sleeps at the end of each frame to hold it to this rate,
+	// or 0 for no cap
+	void SetFrameRateCap(float framesPerSecond);
+
+	// Convenience methods for handling mouse input, since we
+	// can easily grab mouse input from OS-level messages
+	virtual void OnMouseDown (WPARAM buttonState, int x, int y) { }
+	virtual void OnMouseUp	 (WPARAM buttonState, int x, int y) { }
+	virtual void OnMouseMove (WPARAM buttonState, int x, int y) { }
+	virtual void OnMouseWheel(float wheelDelta,   int x, int y) { }
+
+	// Extra text for the title bar when debug stats are on
+	virtual std::string GetDebugStats() { return ""; }
+	
+protected:
+	HINSTANCE	hInstance;		// The handle to the application
+	HWND		hWnd;			// The handle to the window itself
+	std::string titleBarText;	// Custom text in window's title bar
+	bool		titleBarStats;	// Show extra stats in title bar?
+	
+	// Size of the window's client area
+	unsigned int width;
+	unsigned int height;
+	
+	// DirectX related objects and variables
+	D3D_FEATURE_LEVEL		dxFeatureLevel;
+	IDXGISwapChain*			swapChain;
+	ID3D11Device*			device;
+	ID3D11DeviceContext*	context;
+
+	ID3D11RenderTargetView* backBufferRTV;
+	ID3D11DepthStencilView* depthStencilView;
+
+	// Everything sent to the context when headless, or null.
+	// RenderBackend owns it.
+	RecordingRenderBackend* recorder;
+
+	// Helper function for allocating a console window
+	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
+
+private:
+	// Timing related data
+	double perfCounterSeconds;
+	float totalTime;
+	float deltaTime;
+	__int64 startTime;
+	__int64 currentTime;
+	__int64 previousTime;
+
+	// FPS calculation
+	int fpsFrameCount;
+	float fpsTimeElapsed;
+
+	// Fixed timestep
+	bool fixedTimestep;
+	float fixedDeltaTime;
+	unsigned int maxUpdatesPerFrame;
+	double accumulator;			// Time not simulated yet
+	double simulationTime;		// Total time the fixed updates have covered
+
+	// Frame rate cap
+	float frameRateCap;
+	HANDLE frameTimer;
+	bool frameTimerPeriodSet;	// timeBeginPeriod() was needed for the fallback timer
+	__int64 nextFrameTime;
+
+	void UpdateTimer();			// Updates the timer for this frame
+	void UpdateTitleBarStats();	// Puts debug info in the title bar
+	void RunUpdates();			// One Update(), or enough fixed ones to catch up
+	void WaitForNextFrame();	// Sleeps off the rest of a capped frame
+};
+
@@ -0,0 +1,406 @@
+#include "EntityWorld.h"
+#include "JobSystem.h"
+#include <mutex>
+#include <malloc.h>
+#include <cassert>
+
+// --------------------------------------------------------
+// Component type registry, shared by every world.  Entries
+// never change once written, so reading them needs no lock.
+// --------------------------------------------------------
+namespace
+{
+	std::mutex typeMutex;
+	unsigned int typeCount = 0;
+	unsigned int typeSizes[ComponentTypes::MaxTypes];
+	unsigned int typeAlignments[ComponentTypes::MaxTypes];
+}
+
+const unsigned int ComponentTypes::MaxTypes;
+const unsigned int EntityWorld::ChunkSize;
+const unsigned int EntityWorld::ChunkAlignment;
+
+unsigned int ComponentTypes::Register(unsigned int size, unsigned int alignment)
+{
+	std::lock_guard<std::mutex> lock(typeMutex);
+	assert(typeCount < MaxTypes && "Too many component types for a ComponentMask");
+
+	typeSizes[typeCount] = size;
+	typeAlignments[typeCount] = alignment;
+	return typeCount++;
+}
+
+unsigned int ComponentTypes::GetSize(unsigned int id)
+{
+	return typeSizes[id];
+}
+
+unsigned int ComponentTypes::GetAlignment(unsigned int id)
+{
+	return typeAlignments[id];
+}
+
+EntityWorld::EntityWorld()
+{
+	entityCount = 0;
+}
+
+EntityWorld::~EntityWorld()
+{
+	Clear();
+
+	for (auto& a : archetypes)
+		delete a;
+	for (auto& c : freeChunks)
+		_aligned_free(c);
+}
+
+// --------------------------------------------------------
+// Destroys every entity.  Archetypes and chunk memory are
+// kept, so refilling the world doesn't allocate.
+// --------------------------------------------------------
+void EntityWorld::Clear()
+{
+	for (auto& a : archetypes)
+	{
+		for (auto& chunk : a->Chunks)
+			freeChunks.push_back(chunk.Data);
+		a->Chunks.clear();
+		a->EntityCount = 0;
+	}
+
+	freeIndices.clear();
+	for (unsigned int i = 0; i < records.size(); i++)
+	{
+		if (records[i].Type)
+		{
+			records[i].Type = 0;
+			records[i].Generation++;
+		}
+		freeIndices.push_back((unsigned int)records.size() - 1 - i);
+	}
+	entityCount = 0;
+}
+
+Entity EntityWorld::Create(ComponentMask components)
+{
+	Entity e;
+	if (freeIndices.empty())
+	{
+		EntityRecord record = {};
+		e.Index = (unsigned int)records.size();
+		records.push_back(record);
+	}
+	else
+	{
+		e.Index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	e.Generation = records[e.Index].Generation;
+
+	Archetype* type = GetArchetype(components);
+	EntityRecord& record = records[e.Index];
+	record.Type = type;
+	AddRow(type, record.Chunk, record.Row);
+
+	// Components start out zeroed
+	EntityChunk& chunk = type->Chunks[record.Chunk];
+	type->GetEntities(chunk)[record.Row] = e;
+	for (auto& id : type->Components)
+	{
+		unsigned int size = type->Sizes[id];
+		memset((unsigned char*)type->GetArray(chunk, id) + record.Row * size, 0, size);
+	}
+
+	entityCount++;
+	return e;
+}
+
+void EntityWorld::Destroy(Entity e)
+{
+	EntityRecord* record = Find(e);
+	if (!record)
+		return;
+
+	RemoveRow(record->Type, record->Chunk, record->Row);
+	record->Type = 0;
+	record->Generation++;
+	freeIndices.push_back(e.Index);
+	entityCount--;
+}
+
+bool EntityWorld::IsAlive(Entity e)
+{
+	return Find(e) != 0;
+}
+
+bool EntityWorld::AddRaw(Entity e, unsigned int id, const void* value)
+{
+	EntityRecord* record = Find(e);
+	if (!record)
+		return false;
+
+	ComponentMask bit = 1ull << id;
+	if (!(record->Type->Mask & bit))
+		MoveEntity(e, GetArchetype(record->Type->Mask | bit));
+
+	return value ? SetRaw(e, id, value) : true;
+}
+
+bool EntityWorld::RemoveRaw(Entity e, unsigned int id)
+{
+	EntityRecord* record = Find(e);
+	if (!record)
+		return false;
+
+	ComponentMask bit = 1ull << id;
+	if (record->Type->Mask & bit)
+		MoveEntity(e, GetArchetype(record->Type->Mask & ~bit));
+	return true;
+}
+
+bool EntityWorld::SetRaw(Entity e, unsigned int id, const void* value)
+{
+	void* component = GetRaw(e, id);
+	if (!component)
+		return false;
+
+	memcpy(component, value, ComponentTypes::GetSize(id));
+	return true;
+}
+
+void* EntityWorld::GetRaw(Entity e, unsigned int id)
+{
+	EntityRecord* record = Find(e);
+	if (!record || !(record->Type->Mask & (1ull << id)))
+		return 0;
+
+	Archetype* type = record->Type;
+	unsigned char* array = (unsigned char*)type->GetArray(type->Chunks[record->Chunk], id);
+	return array + record->Row * type->Sizes[id];
+}
+
+unsigned int EntityWorld::GetChunkCount()
+{
+	unsigned int count = 0;
+	for (auto& a : archetypes)
+		count += (unsigned int)a->Chunks.size();
+	return count;
+}
+
+EntityWorld::EntityRecord* EntityWorld::Find(Entity e)
+{
+	if (e.Index >= records.size())
+		return 0;
+
+	EntityRecord* record = &records[e.Index];
+	return record->Type && record->Generation == e.Generation ? record : 0;
+}
+
+// --------------------------------------------------------
+// Finds or makes the archetype for a set of components and
+// works out how its arrays are laid out in a chunk
+// --------------------------------------------------------
+Archetype* EntityWorld::GetArchetype(ComponentMask mask)
+{
+	auto found = archetypeLookup.find(mask);
+	if (found != archetypeLookup.end())
+		return found->second;
+
+	Archetype* type = new Archetype();
+	type->Mask = mask;
+	type->EntityCount = 0;
+	memset(type->Offsets, 0, sizeof(type->Offsets));
+	memset(type->Sizes, 0, sizeof(type->Sizes));
+
+	// Leave room for every array to be padded out to its alignment
+	unsigned int rowSize = sizeof(Entity);
+	unsigned int padding = 0;
+	for (unsigned int id = 0; id < ComponentTypes::MaxTypes; id++)
+	{
+		if (!(mask & (1ull << id)))
+			continue;
+
+		type->Components.push_back(id);
+		type->Sizes[id] = ComponentTypes::GetSize(id);
+		rowSize += type->Sizes[id];
+		padding += ComponentTypes::GetAlignment(id);
+	}
+	type->Capacity = (ChunkSize - padding) / rowSize;
+
+	unsigned int offset = type->Capacity * sizeof(Entity);
+	for (auto& id : type->Components)
+	{
+		unsigned int alignment = ComponentTypes::GetAlignment(id);
+		offset = (offset + alignment - 1) / alignment * alignment;
+		type->Offsets[id] = offset;
+		offset += type->Capacity * type->Sizes[id];
+	}
+
+	archetypes.push_back(type);
+	archetypeLookup[mask] = type;
+	return type;
+}
+
+// Claims the next row at the end of an archetype
+void EntityWorld::AddRow(Archetype* type, unsigned int& chunk, unsigned int& row)
+{
+	if (type->Chunks.empty() || type->Chunks.back().Count == type->Capacity)
+	{
+		// Aligned by hand, as new[] only promises 8 bytes on Win32
+		EntityChunk fresh;
+		fresh.Count = 0;
+		if (freeChunks.empty())
+			fresh.Data = (unsigned char*)_aligned_malloc(ChunkSize, ChunkAlignment);
+		else
+		{
+			fresh.Data = freeChunks.back();
+			freeChunks.pop_back();
+		}
+		type->Chunks.push_back(fresh);
+	}
+
+	chunk = (unsigned int)type->Chunks.size() - 1;
+	row = type->Chunks[chunk].Count++;
+	type->EntityCount++;
+}
+
+// --------------------------------------------------------
+// Fills a hole by moving the archetype's last entity into it,
+// which keeps every chunk but the last one full
+// --------------------------------------------------------
+void EntityWorld::RemoveRow(Archetype* type, unsigned int chunk, unsigned int row)
+{
+	unsigned int lastChunk = (unsigned int)type->Chunks.size() - 1;
+	EntityChunk& last = type->Chunks[lastChunk];
+	unsigned int lastRow = last.Count - 1;
+
+	if (chunk != lastChunk || row != lastRow)
+	{
+		EntityChunk& hole = type->Chunks[chunk];
+		Entity moved = type->GetEntities(last)[lastRow];
+		type->GetEntities(hole)[row] = moved;
+
+		for (auto& id : type->Components)
+		{
+			unsigned int size = type->Sizes[id];
+			memcpy(
+				(unsigned char*)type->GetArray(hole, id) + row * size,
+				(unsigned char*)type->GetArray(last, id) + lastRow * size,
+				size);
+		}
+
+		records[moved.Index].Chunk = chunk;
+		records[moved.Index].Row = row;
+	}
+
+	last.Count--;
+	type->EntityCount--;
+	if (last.Count == 0)
+	{
+		freeChunks.push_back(last.Data);
+		type->Chunks.pop_back();
+	}
+}
+
+// --------------------------------------------------------
+// Moves an entity to another archetype, keeping the
+// components they share and zeroing any new ones
+// --------------------------------------------------------
+void EntityWorld::MoveEntity(Entity e, Archetype* to)
+{
+	EntityRecord& record = records[e.Index];
+	Archetype* from = record.Type;
+	unsigned int fromChunk = record.Chunk;
+	unsigned int fromRow = record.Row;
+
+	unsigned int toChunk, toRow;
+	AddRow(to, toChunk, toRow);
+
+	EntityChunk& src = from->Chunks[fromChunk];
+	EntityChunk& dst = to->Chunks[toChunk];
+	to->GetEntities(dst)[toRow] = e;
+	for (auto& id : to->Components)
+	{
+		unsigned int size = to->Sizes[id];
+		unsigned char* target = (unsigned char*)to->GetArray(dst, id) + toRow * size;
+		if (from->Mask & (1ull << id))
+			memcpy(target, (unsigned char*)from->GetArray(src, id) + fromRow * size, size);
+		else
+			memset(target, 0, size);
+	}
+
+	// Removing may move another entity, so this entity's
+	// record is only updated afterwards
+	RemoveRow(from, fromChunk, fromRow);
+	record.Type = to;
+	record.Chunk = toChunk;
+	record.Row = toRow;
+}
+
+void EntityWorld::RunParallel(JobSystem* jobs, unsigned int count, const std::function<void(unsigned int)>& body)
+{
+	if (!jobs)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			body(i);
+		return;
+	}
+
+	jobs->ParallelFor(count, 1, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			body(i);
+	});
+}
+
+EntityCommandBuffer::EntityCommandBuffer()
+{
+}
+
+EntityCommandBuffer::~EntityCommandBuffer()
+{
+}
+
+void EntityCommandBuffer::Record(CommandType type, Entity target, ComponentMask mask, unsigned int component, const void* value)
+{
+	Command command;
+	command.Type = type;
+	command.Target = target;
+	command.Mask = mask;
+	command.Component = component;
+	command.DataOffset = (unsigned int)data.size();
+
+	if (value)
+	{
+		unsigned int size = ComponentTypes::GetSize(component);
+		data.resize(data.size() + size);
+		memcpy(&data[command.DataOffset], value, size);
+	}
+
+	commands.push_back(command);
+}
+
+void EntityCommandBuffer::Playback(EntityWorld* world)
+{
+	Entity created = NoEntity;
+	for (auto& c : commands)
+	{
+		switch (c.Type)
+		{
+		case COMMAND_CREATE:		created = world->Create(c.Mask); break;
+		case COMMAND_SET_CREATED:	world->SetRaw(created, c.Component, &data[c.DataOffset]); break;
+		case COMMAND_DESTROY:		world->Destroy(c.Target); break;
+		case COMMAND_ADD:			world->AddRaw(c.Target, c.Component, &data[c.DataOffset]); break;
+		case COMMAND_REMOVE:		world->RemoveRaw(c.Target, c.Component); break;
+		}
+	}
+
+	Clear();
+}
+
+void EntityCommandBuffer::Clear()
+{
+	commands.clear();
+	data.clear();
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+#include <cstring>
+#include <functional>
+
+class JobSystem;
+
+typedef unsigned long long ComponentMask;
+
+// --------------------------------------------------------
+// Handle to an entity in an EntityWorld.  The generation
+// changes when an index is reused, so stale handles fail.
+// --------------------------------------------------------
+struct Entity
+{
+	unsigned int Index;
+	unsigned int Generation;
+
+	bool operator==(const Entity& other) const { return Index == other.Index && Generation == other.Generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+static const Entity NoEntity = { 0xFFFFFFFF, 0 };
+
+// --------------------------------------------------------
+// Hands out an id per component type the first time it's
+// used.  Components are plain data - they're moved around
+// with memcpy and start out zeroed.
+// --------------------------------------------------------
+class ComponentTypes
+{
+public:
+	static const unsigned int MaxTypes = 64;	// One bit each in a ComponentMask
+
+	template<typename T> static unsigned int Id()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Components must be plain data");
+		static_assert(alignof(T) <= 16, "Chunks are only 16 byte aligned");
+		static const unsigned int id = Register(sizeof(T), alignof(T));
+		return id;
+	}
+
+	template<typename T> static ComponentMask Mask() { return 1ull << Id<T>(); }
+
+	static unsigned int GetSize(unsigned int id);
+	static unsigned int GetAlignment(unsigned int id);
+
+private:
+	static unsigned int Register(unsigned int size, unsigned int alignment);
+};
+
+// Mask with a bit for each of the given component types
+template<typename... T> ComponentMask MaskOf()
+{
+	ComponentMask mask = 0;
+	int expand[] = { 0, ((mask |= ComponentTypes::Mask<T>()), 0)... };
+	(void)expand;
+	return mask;
+}
+
+// --------------------------------------------------------
+// Every entity with exactly the same set of components lives
+// in the same archetype.  Its entities are packed into fixed
+// size chunks, with one array per component inside each chunk,
+// so a query walks straight through memory.  Chunks stay full
+// except the last one - removing an entity moves the archetype's
+// last entity into the hole.
+// --------------------------------------------------------
+struct EntityChunk
+{
+	unsigned char* Data;	// Entity array, then one array per component
+	unsigned int Count;
+};
+
+struct Archetype
+{
+	ComponentMask Mask;
+	unsigned int Capacity;							// Entities per chunk
+	unsigned int Offsets[ComponentTypes::MaxTypes];	// Array offsets in a chunk, by component id
+	unsigned int Sizes[ComponentTypes::MaxTypes];	// Copied from ComponentTypes, by id
+	std::vector<unsigned int> Components;			// Ids in this archetype
+	std::vector<EntityChunk> Chunks;
+	unsigned int EntityCount;
+
+	Entity* GetEntities(const EntityChunk& chunk) { return (Entity*)chunk.Data; }
+	void* GetArray(const EntityChunk& chunk, unsigned int id) { return chunk.Data + Offsets[id]; }
+};
+
+// --------------------------------------------------------
+// Archetype-based entity/component storage
+//
+// Entities are created with a set of components and can have
+// components added or removed later, which moves them to a
+// different archetype.  Those structural changes must not
+// happen while a query is running - record them in an
+// EntityCommandBuffer and play it back afterwards instead.
+// Reading and writing component values during a query is fine.
+// --------------------------------------------------------
+class EntityWorld
+{
+public:
+	static const unsigned int ChunkSize = 16 * 1024;
+	static const unsigned int ChunkAlignment = 16;
+
+	EntityWorld();
+	~EntityWorld();
+
+	// Creates an entity with the given components, all zeroed
+	Entity Create(ComponentMask components);
+
+	// Creates an entity and copies the given values in
+	template<typename... T> Entity Create(const T&... values)
+	{
+		Entity e = Create(MaskOf<T...>());
+		int expand[] = { 0, (SetRaw(e, ComponentTypes::Id<T>(), &values), 0)... };
+		(void)expand;
+		return e;
+	}
+
+	void Destroy(Entity e);
+	void Clear();
+	bool IsAlive(Entity e);
+	unsigned int GetCount() { return entityCount; }
+
+	// Structural changes by component id, used by the templates
+	// below and by command buffers
+	bool AddRaw(Entity e, unsigned int id, const void* value);
+	bool RemoveRaw(Entity e, unsigned int id);
+	bool SetRaw(Entity e, unsigned int id, const void* value);
+	void* GetRaw(Entity e, unsigned int id);
+
+	// Adding a component an entity already has just sets it
+	template<typename T> bool Add(Entity e, const T& value) { return AddRaw(e, ComponentTypes::Id<T>(), &value); }
+	template<typename T> bool Remove(Entity e) { return RemoveRaw(e, ComponentTypes::Id<T>()); }
+	template<typename T> bool Has(Entity e) { return GetRaw(e, ComponentTypes::Id<T>()) != 0; }
+
+	// Null if the entity is gone or doesn't have the component
+	template<typename T> T* Get(Entity e) { return (T*)GetRaw(e, ComponentTypes::Id<T>()); }
+
+	// Calls f(count, entities, arrays...) once for every chunk
+	// holding all of T... and none of "exclude"
+	template<typename... T, typename F> void ForEachChunk(F f, ComponentMask exclude = 0)
+	{
+		ComponentMask include = MaskOf<T...>();
+		for (auto& a : archetypes)
+		{
+			if ((a->Mask & include) != include || (a->Mask & exclude) != 0)
+				continue;
+
+			for (auto& chunk : a->Chunks)
+				f(chunk.Count, a->GetEntities(chunk), (T*)a->GetArray(chunk, ComponentTypes::Id<T>())...);
+		}
+	}
+
+	// Calls f(entity, components...) for every matching entity
+	template<typename... T, typename F> void ForEach(F f, ComponentMask exclude = 0)
+	{
+		ForEachChunk<T...>([&](unsigned int count, Entity* entities, T*... arrays)
+		{
+			for (unsigned int i = 0; i < count; i++)
+				f(entities[i], arrays[i]...);
+		}, exclude);
+	}
+
+	// Same as ForEachChunk(), with the chunks spread over the job system
+	template<typename... T, typename F> void ParallelForEachChunk(JobSystem* jobs, F f, ComponentMask exclude = 0)
+	{
+		std::vector<EntityChunk*> chunks;
+		std::vector<Archetype*> owners;
+		ComponentMask include = MaskOf<T...>();
+		for (auto& a : archetypes)
+		{
+			if ((a->Mask & include) != include || (a->Mask & exclude) != 0)
+				continue;
+
+			for (auto& chunk : a->Chunks)
+			{
+				chunks.push_back(&chunk);
+				owners.push_back(a);
+			}
+		}
+
+		RunParallel(jobs, (unsigned int)chunks.size(), [&](unsigned int c)
+		{
+			Archetype* a = owners[c];
+			EntityChunk& chunk = *chunks[c];
+			f(chunk.Count, a->GetEntities(chunk), (T*)a->GetArray(chunk, ComponentTypes::Id<T>())...);
+		});
+	}
+
+	unsigned int GetArchetypeCount() { return (unsigned int)archetypes.size(); }
+	unsigned int GetChunkCount();
+
+private:
+	// Where each entity lives, by entity index
+	struct EntityRecord
+	{
+		Archetype* Type;		// Null while the index is free
+		unsigned int Chunk;
+		unsigned int Row;
+		unsigned int Generation;
+	};
+
+	std::vector<EntityRecord> records;
+	std::vector<unsigned int> freeIndices;
+	unsigned int entityCount;
+
+	std::vector<Archetype*> archetypes;
+	std::unordered_map<ComponentMask, Archetype*> archetypeLookup;
+
+	// Empty chunks are kept for reuse instead of being freed
+	std::vector<unsigned char*> freeChunks;
+
+	EntityRecord* Find(Entity e);
+	Archetype* GetArchetype(ComponentMask mask);
+	void AddRow(Archetype* type, unsigned int& chunk, unsigned int& row);
+	void RemoveRow(Archetype* type, unsigned int chunk, unsigned int row);
+	void MoveEntity(Entity e, Archetype* to);
+
+	void RunParallel(JobSystem* jobs, unsigned int count, const std::function<void(unsigned int)>& body);
+};
+
+// --------------------------------------------------------
+// Structural changes recorded to be applied later, so queries
+// (and jobs) can create, destroy, add and remove while the
+// world is being iterated.  Each job should use its own buffer.
+// Commands are played back in the order they were recorded.
+// --------------------------------------------------------
+class EntityCommandBuffer
+{
+public:
+	EntityCommandBuffer();
+	~EntityCommandBuffer();
+
+	// The new entity doesn't exist until playback
+	template<typename... T> void Create(const T&... values)
+	{
+		Record(COMMAND_CREATE, NoEntity, MaskOf<T...>(), 0, 0);
+		int expand[] = { 0, (Record(COMMAND_SET_CREATED, NoEntity, 0, ComponentTypes::Id<T>(), &values), 0)... };
+		(void)expand;
+	}
+
+	void Destroy(Entity e) { Record(COMMAND_DESTROY, e, 0, 0, 0); }
+	template<typename T> void Add(Entity e, const T& value) { Record(COMMAND_ADD, e, 0, ComponentTypes::Id<T>(), &value); }
+	template<typename T> void Remove(Entity e) { Record(COMMAND_REMOVE, e, 0, ComponentTypes::Id<T>(), 0); }
+
+	// Applies every command, then empties the buffer
+	void Playback(EntityWorld* world);
+	void Clear();
+	bool IsEmpty() { return commands.empty(); }
+
+private:
+	enum CommandType
+	{
+		COMMAND_CREATE,
+		COMMAND_SET_CREATED,	// Sets a component on the last entity created
+		COMMAND_DESTROY,
+		COMMAND_ADD,
+		COMMAND_REMOVE
+	};
+
+	struct Command
+	{
+		CommandType Type;
+		Entity Target;
+		ComponentMask Mask;
+		unsigned int Component;
+		unsigned int DataOffset;	// Into data, for set and add
+	};
+
+	std::vector<Command> commands;
+	std::vector<unsigned char> data;
+
+	void Record(CommandType type, Entity target, ComponentMask mask, unsigned int component, const void* value);
+};
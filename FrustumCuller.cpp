@@ -0,0 +1,187 @@
+#include "FrustumCuller.h"
+#include <emmintrin.h>
+#include <cmath>
+#include <limits>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Extracts frustum planes from the combined view-projection
+// matrix (Gribb & Hartmann).  The camera stores everything
+// transposed, so rows of projection * view here are the
+// columns of the usual view * projection.
+// --------------------------------------------------------
+Frustum Frustum::FromMatrices(const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&projection), XMLoadFloat4x4(&view)));
+
+	XMVECTOR r0 = XMVectorSet(m._11, m._12, m._13, m._14);
+	XMVECTOR r1 = XMVectorSet(m._21, m._22, m._23, m._24);
+	XMVECTOR r2 = XMVectorSet(m._31, m._32, m._33, m._34);
+	XMVECTOR r3 = XMVectorSet(m._41, m._42, m._43, m._44);
+
+	// D3D clip space has 0 <= z <= w
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(r3, r0),		// Left
+		XMVectorSubtract(r3, r0),	// Right
+		XMVectorAdd(r3, r1),		// Bottom
+		XMVectorSubtract(r3, r1),	// Top
+		r2,							// Near
+		XMVectorSubtract(r3, r2)	// Far
+	};
+
+	Frustum f;
+	f.PlaneCount = 6;
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&f.Planes[i], XMPlaneNormalize(planes[i]));
+	return f;
+}
+
+void Frustum::AddPlane(const XMFLOAT4& plane)
+{
+	if (PlaneCount < 8)
+		XMStoreFloat4(&Planes[PlaneCount++], XMPlaneNormalize(XMLoadFloat4(&plane)));
+}
+
+FrustumCuller::FrustumCuller()
+{
+	count = 0;
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+unsigned int FrustumCuller::Add()
+{
+	unsigned int item = count++;
+
+	// Grow by a whole group of 4 at a time.  Centers start as NaN,
+	// which fails every plane test, so items without bounds are
+	// never visible.
+	if (item >= centerX.size())
+	{
+		float none = std::numeric_limits<float>::quiet_NaN();
+		centerX.resize(centerX.size() + 4, none);
+		centerY.resize(centerY.size() + 4, none);
+		centerZ.resize(centerZ.size() + 4, none);
+		extentX.resize(extentX.size() + 4, 0.0f);
+		extentY.resize(extentY.size() + 4, 0.0f);
+		extentZ.resize(extentZ.size() + 4, 0.0f);
+	}
+
+	return item;
+}
+
+void FrustumCuller::SetBounds(unsigned int item, const XMFLOAT3& c, const XMFLOAT3& e, const XMFLOAT4X4& w)
+{
+	XMFLOAT3 center, extents;
+	TransformBounds(c, e, w, center, extents);
+	SetWorldBounds(item, center, extents);
+}
+
+void FrustumCuller::SetWorldBounds(unsigned int item, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	centerX[item] = center.x;
+	centerY[item] = center.y;
+	centerZ[item] = center.z;
+	extentX[item] = extents.x;
+	extentY[item] = extents.y;
+	extentZ[item] = extents.z;
+}
+
+bool FrustumCuller::GetWorldBounds(unsigned int item, XMFLOAT3& center, XMFLOAT3& extents)
+{
+	// Unset centers are NaN, which never equals itself
+	if (item >= count || centerX[item] != centerX[item])
+		return false;
+
+	center = XMFLOAT3(centerX[item], centerY[item], centerZ[item]);
+	extents = XMFLOAT3(extentX[item], extentY[item], extentZ[item]);
+	return true;
+}
+
+// --------------------------------------------------------
+// Transforms a local box into a world-space box that
+// contains it: the center is transformed as a point and
+// the extents by the absolute value of the 3x3 part (Arvo)
+// --------------------------------------------------------
+void FrustumCuller::TransformBounds(const XMFLOAT3& c, const XMFLOAT3& e, const XMFLOAT4X4& w, XMFLOAT3& center, XMFLOAT3& extents)
+{
+	// Row i of the transposed matrix is column i of the world matrix
+	center = XMFLOAT3(
+		w._11 * c.x + w._12 * c.y + w._13 * c.z + w._14,
+		w._21 * c.x + w._22 * c.y + w._23 * c.z + w._24,
+		w._31 * c.x + w._32 * c.y + w._33 * c.z + w._34);
+
+	extents = XMFLOAT3(
+		fabsf(w._11) * e.x + fabsf(w._12) * e.y + fabsf(w._13) * e.z,
+		fabsf(w._21) * e.x + fabsf(w._22) * e.y + fabsf(w._23) * e.z,
+		fabsf(w._31) * e.x + fabsf(w._32) * e.y + fabsf(w._33) * e.z);
+}
+
+// --------------------------------------------------------
+// Tests 4 boxes at a time against every plane.  A box is
+// outside a plane when its center is further behind it than
+// the box's projected radius, |n.x|*e.x + |n.y|*e.y + |n.z|*e.z.
+// --------------------------------------------------------
+void FrustumCuller::Cull(const Frustum& frustum, CullResult& result)
+{
+	result.Visible.clear();
+	result.Flags.assign(count, 0);
+
+	// Splat each plane (and its absolute normal) once up front
+	__m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 nx[8], ny[8], nz[8], d[8], ax[8], ay[8], az[8];
+	for (unsigned int p = 0; p < frustum.PlaneCount; p++)
+	{
+		nx[p] = _mm_set1_ps(frustum.Planes[p].x);
+		ny[p] = _mm_set1_ps(frustum.Planes[p].y);
+		nz[p] = _mm_set1_ps(frustum.Planes[p].z);
+		d[p] = _mm_set1_ps(frustum.Planes[p].w);
+		ax[p] = _mm_and_ps(nx[p], absMask);
+		ay[p] = _mm_and_ps(ny[p], absMask);
+		az[p] = _mm_and_ps(nz[p], absMask);
+	}
+
+	__m128 zero = _mm_setzero_ps();
+	for (unsigned int first = 0; first < count; first += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&centerX[first]);
+		__m128 cy = _mm_loadu_ps(&centerY[first]);
+		__m128 cz = _mm_loadu_ps(&centerZ[first]);
+		__m128 ex = _mm_loadu_ps(&extentX[first]);
+		__m128 ey = _mm_loadu_ps(&extentY[first]);
+		__m128 ez = _mm_loadu_ps(&extentZ[first]);
+
+		// All lanes start visible and get knocked out plane by plane
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (unsigned int p = 0; p < frustum.PlaneCount; p++)
+		{
+			__m128 dist = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+				_mm_add_ps(_mm_mul_ps(nz[p], cz), d[p]));
+			__m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)),
+				_mm_mul_ps(az[p], ez));
+
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), zero));
+		}
+
+		// Ignore the padding past the last item
+		int mask = _mm_movemask_ps(inside);
+		if (count - first < 4)
+			mask &= (1 << (count - first)) - 1;
+
+		for (unsigned int i = 0; mask != 0; i++, mask >>= 1)
+		{
+			if (mask & 1)
+			{
+				result.Visible.push_back(first + i);
+				result.Flags[first + i] = 1;
+			}
+		}
+	}
+}
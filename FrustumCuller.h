@@ -0,0 +1,71 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Up to 8 planes (a view frustum plus any clip planes).
+// Plane normals point inwards, so a point is inside when
+// dot(normal, point) + d >= 0 for every plane.
+// --------------------------------------------------------
+struct Frustum
+{
+	DirectX::XMFLOAT4 Planes[8];
+	unsigned int PlaneCount;
+
+	// Builds the six frustum planes from view and projection
+	// matrices, both transposed the way the Camera stores them
+	static Frustum FromMatrices(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	void AddPlane(const DirectX::XMFLOAT4& plane);
+};
+
+// --------------------------------------------------------
+// The result of one culling pass
+// --------------------------------------------------------
+struct CullResult
+{
+	std::vector<unsigned int> Visible;	// Visible item indices, in order
+	std::vector<unsigned char> Flags;	// 1 per item, non-zero if visible
+
+	bool IsVisible(unsigned int item) { return item < Flags.size() && Flags[item] != 0; }
+};
+
+// --------------------------------------------------------
+// Culls world-space bounding boxes against a frustum
+//
+// Boxes are kept as center/extents in structure-of-arrays form
+// so each SSE instruction tests 4 boxes against a plane at once.
+// --------------------------------------------------------
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+	~FrustumCuller();
+
+	// Adds an item with no bounds (never visible) and returns its index
+	unsigned int Add();
+	unsigned int GetCount() { return count; }
+
+	// Sets an item's world bounds from its local box and world
+	// matrix (transposed, as the TransformStore keeps them)
+	void SetBounds(unsigned int item, const DirectX::XMFLOAT3& localCenter, const DirectX::XMFLOAT3& localExtents, const DirectX::XMFLOAT4X4& world);
+	void SetWorldBounds(unsigned int item, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+
+	// False for items that don't have bounds yet
+	bool GetWorldBounds(unsigned int item, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extents);
+
+	// The world box around a transformed local box, as used by SetBounds()
+	static void TransformBounds(const DirectX::XMFLOAT3& localCenter, const DirectX::XMFLOAT3& localExtents, const DirectX::XMFLOAT4X4& world, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extents);
+
+	// Fills in which items are at least partly inside the frustum
+	void Cull(const Frustum& frustum, CullResult& result);
+
+private:
+	unsigned int count;
+
+	// Padded to a multiple of 4
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+};
+
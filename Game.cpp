@@ -1,812 +1,1309 @@
-#include "Game.h"
-#include "Vertex.h"
-#include "WICTextureLoader.h" // From DirectX Tool Kit
-#include "DDSTextureLoader.h" // For loading skyboxes (cube maps)
-
-// For the DirectX Math library
-using namespace DirectX;
-
-
-Game::Game(HINSTANCE hInstance)
-	: DXCore( 
-		hInstance,		   // The application's handle
-		"DirectX Game",	   // Text for the window's title bar
-		1280,			   // Width of the window's client area
-		720,			   // Height of the window's client area
-		true)			   // Show extra stats (fps) in title bar?
-{
-	// Initialize fields
-	vertexBuffer = 0;
-	indexBuffer = 0;
-	vertexShader = 0;
-	pixelShader = 0;
-	waterVS = 0;
-	waterPS = 0;
-	refractionVS = 0;
-	refractionPS = 0;
-	_reflectionTexture = 0;
-	_refractionTexture = 0;
-	camera = 0;
-
-#if defined(DEBUG) || defined(_DEBUG)
-	// Do we want a console window?  Probably only in debug mode
-	CreateConsoleWindow(500, 120, 32, 120);
-	printf("Console window created successfully.  Feel free to printf() here.");
-#endif
-}
-
-
-Game::~Game()
-{
-	// Release any (and all!) DirectX objects
-	// we've made in the Game class
-	if (vertexBuffer) { vertexBuffer->Release(); }
-	if (indexBuffer) { indexBuffer->Release(); }
-	
-	sampler->Release();
-	textureSRV->Release();
-	normalMapSRV->Release();
-	bathSRV->Release();
-	bathNormalMapSRV->Release();
-	waterNormalMapSRV->Release();
-
-	skySRV->Release();
-	rsSky->Release();
-	dsSky->Release();
-
-	// Delete our simple shader objects, which
-	// will clean up their own internal DirectX stuff
-	delete vertexShader;
-	delete pixelShader;
-	delete skyVS;
-	delete skyPS;
-	delete waterVS;
-	delete waterPS;
-	delete refractionVS;
-	delete refractionPS;
-	delete _refractionTexture;
-	delete _reflectionTexture;
-
-	// Clean up resources
-	for(auto& e : entities) delete e;
-	for(auto& m : meshes) delete m;
-	delete camera;
-	delete water;
-	delete bathBottom;
-	delete bathLeft;
-	delete bathRight;
-	delete bathBack;
-	delete bathFront;
-}
-
-
-void Game::Init()
-{
-	LoadShaders();
-	CreateMatrices();
-	CreateBasicGeometry();
-	//Initialize water class
-	water = new Water();
-	water->Initialize(device, L"Debug/Textures/waterNormal.dds", 2.75f, 1.0f);
-
-	//Create the refraction render to the texture object
-	_refractionTexture = new RenderTexture();
-	_refractionTexture->Initialize(device, width, height, 100.0f, 0.1f);
-
-	// Create the reflection render to texture object.
-	_reflectionTexture = new RenderTexture();
-	_reflectionTexture->Initialize(device, width, height, 100.0f, 0.1f);
-
-	
-
-	// Load ground texture stuff
-	CreateWICTextureFromFile(device,context, L"Debug/Textures/ground.jpg", 0,&textureSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/Textures/groundNormalMap.jpg", 0, &normalMapSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/Textures/bath.tiff", 0, &bathSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/Textures/bathNormal.tiff", 0, &bathNormalMapSRV);
-
-	CreateDDSTextureFromFile(device, L"Debug/Textures/SunnyCubeMap.dds", 0, &skySRV);
-	CreateDDSTextureFromFile(device, L"Debug/Textures/waterNormal.dds", 0, &waterNormalMapSRV);
-
-	// Create a sampler state for texture sampling
-	D3D11_SAMPLER_DESC samplerDesc = {};
-	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
-	samplerDesc.MaxAnisotropy = 16;
-	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	
-	// Ask the device to create a state
-	device->CreateSamplerState(&samplerDesc, &sampler);
-
-	// Set up sky stuff
-	
-	// Set up the rasterize state
-	D3D11_RASTERIZER_DESC rsDesc = {};
-	rsDesc.FillMode = D3D11_FILL_SOLID;
-	rsDesc.CullMode = D3D11_CULL_FRONT;
-	rsDesc.DepthClipEnable = true;
-	device->CreateRasterizerState(&rsDesc, &rsSky);
-
-	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-	dsDesc.DepthEnable = true;
-	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	dsDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	device->CreateDepthStencilState(&dsDesc, &dsSky);
-
-	// Tell the input assembler stage of the pipeline what kind of
-	// geometric primitives (points, lines or triangles) we want to draw.  
-	// Essentially: "What kind of shape should the GPU draw with our data?"
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-}
-
-
-void Game::LoadShaders()
-{
-	vertexShader = new SimpleVertexShader(device, context);
-	if (!vertexShader->LoadShaderFile(L"Debug/VertexShader.cso"))
-		vertexShader->LoadShaderFile(L"VertexShader.cso");		
-
-	pixelShader = new SimplePixelShader(device, context);
-	if(!pixelShader->LoadShaderFile(L"Debug/PixelShader.cso"))	
-		pixelShader->LoadShaderFile(L"PixelShader.cso");
-
-	skyVS = new SimpleVertexShader(device, context);
-	if (!skyVS->LoadShaderFile(L"Debug/SkyVS.cso"))
-		skyVS->LoadShaderFile(L"SkyVS.cso");
-
-	skyPS = new SimplePixelShader(device, context);
-	if (!skyPS->LoadShaderFile(L"Debug/SkyPS.cso"))
-		skyPS->LoadShaderFile(L"SkyPS.cso");
-
-	waterVS = new SimpleVertexShader(device, context);
-	if (!waterVS->LoadShaderFile(L"Debug/WaterVS.cso"))
-		waterVS->LoadShaderFile(L"WaterVS.cso");
-
-	waterPS = new SimplePixelShader(device, context);
-	if (!waterPS->LoadShaderFile(L"Debug/WaterPS.cso"))
-		waterPS->LoadShaderFile(L"WaterPS.cso");
-
-	refractionVS = new SimpleVertexShader(device, context);
-	if (!refractionVS->LoadShaderFile(L"Debug/RefractionVS.cso"))
-		refractionVS->LoadShaderFile(L"RefractionVS.cso");
-
-	refractionPS = new SimplePixelShader(device, context);
-	if (!refractionPS->LoadShaderFile(L"Debug/RefractionPS.cso"))
-		refractionPS->LoadShaderFile(L"RefractionPS.cso");
-
-}
-
-
-
-
-void Game::CreateMatrices()
-{
-	XMStoreFloat4x4(&worldMatrix1, XMMatrixIdentity());
-
-	camera = new Camera(0, 0, -5);
-	camera->UpdateProjectionMatrix((float)width / height);
-}
-
-
-
-void Game::CreateBasicGeometry()
-{
-	Mesh* groundMesh = new Mesh("Models/cube.obj", device);
-	Mesh* cubeMesh = new Mesh("Models/cube.obj", device);
-
-	meshes.push_back(groundMesh);
-	meshes.push_back(cubeMesh);
-
-	// Make some entities
-	GameEntity* ground = new GameEntity(groundMesh);	
-    bathBottom = new GameEntity(cubeMesh);
-	bathRight = new GameEntity(cubeMesh);
-	bathLeft = new GameEntity(cubeMesh);
-	bathBack = new GameEntity(cubeMesh);
-	bathFront = new GameEntity(cubeMesh);
-	GameEntity* cube = new GameEntity(cubeMesh);
-
-	entities.push_back(ground);	
-	entities.push_back(cube);
-
-	ground->SetScale(5.0f, 0.025f, 5.0f);
-	ground->SetPosition(0.0f, -0.20f, 0.0f);
-
-	bathBottom->SetPosition(0.0f, -0.15f, 0.0f);
-	bathBottom->SetScale(2.0f, 0.15f, 2.0f);
-
-	bathRight->SetPosition(1.0f, 0.0f, 0.0f);
-	bathRight->SetScale(0.15f, 0.5f, 2.0f);
-
-	bathLeft->SetPosition(-1.0f, 0.0f, 0.0f);
-	bathLeft->SetScale(0.15f, 0.5f, 2.0f);
-
-	bathBack->SetPosition(0.0f, 0.0f, 1.0f);
-	bathBack->SetScale(2.0f, 0.5f, 0.15f);
-
-	bathFront->SetPosition(0.0f, 0.0f, -1.0f);
-	bathFront->SetScale(2.0f, 0.5f, 0.15f);
-
-	cube->SetScale(10, 10, 10);
-
-
-//	//Water Vertices
-//	WaterVertex* waterVertices;
-//	waterVertices = new WaterVertex[6];
-//	waterVertices[0].Position = XMFLOAT3(-2.0f,0.0f,2.0f);  // Top left.
-//	waterVertices[0].UV = XMFLOAT2(0.0f,0.0f);
-//
-//	waterVertices[1].Position = XMFLOAT3(2.0f,0.0f,-2.0f);  // Top right.
-//	waterVertices[1].UV = XMFLOAT2(1.0f, 0.0f);
-//
-//	waterVertices[2].Position = XMFLOAT3(-2.0f,0.0f,-2.0f);  // Bottom left.
-//	waterVertices[2].UV = XMFLOAT2(0.0f, 1.0f);
-//
-//	waterVertices[3].Position = XMFLOAT3(2.0f,0.0f,2.0f);  // Bottom left.
-//	waterVertices[3].UV = XMFLOAT2(0.0f, 1.0f);
-//
-//	waterVertices[4].Position = XMFLOAT3(2.0f, 0.0f, -2.0f);  // Top right.
-//	waterVertices[4].UV = XMFLOAT2(1.0f, 0.0f);
-//
-//	waterVertices[5].Position = XMFLOAT3(-2.0f, 0.0f, 2.0f);  // Bottom right.
-//	waterVertices[5].UV = XMFLOAT2(1.0f, 1.0f);
-//
-//	/*WaterVertex waterVertices[]
-//	{
-//		{ XMFLOAT3(+0.0f, +0.0f, +0.0f),XMFLOAT4(1.0f,0.0f,0.0f,1.0f) },
-//		{ XMFLOAT3(+0.0f, +1.0f, +0.0f),XMFLOAT4(0.0f,0.0f,0.0f,1.0f) },
-//		{ XMFLOAT3(+1.0f, +1.0f, +0.0f), XMFLOAT4(0.0f,0.0f,0.0f,1.0f) },
-//		{ XMFLOAT3(+1.0f, +0.0f, +0.0f),XMFLOAT4(0.0f,0.0f,0.0f,1.0f) },
-//	};
-//*/
-//	//int indices2[] = { 0,1,2,0,2,3 };
-//
-//	// Load the index array with data.
-//	unsigned long* indices;
-//	indices = new unsigned long[6];
-//	indices[0] = 0;
-//	indices[1] = 1;
-//	indices[2] = 2;
-//	indices[3] = 3;
-//	indices[4] = 4;
-//	indices[5] = 5;
-//
-//	indexCount = sizeof(indices) / sizeof(int);
-//
-//	// Create the vertex buffer
-//	D3D11_BUFFER_DESC vbd;
-//	vbd.Usage = D3D11_USAGE_DEFAULT;
-//	vbd.ByteWidth = sizeof(WaterVertex) * 6;
-//	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-//	vbd.CPUAccessFlags = 0;
-//	vbd.MiscFlags = 0;
-//	vbd.StructureByteStride = 0;
-//
-//	// Give the subresource structure a pointer to the vertex data.
-//	D3D11_SUBRESOURCE_DATA vertexData;
-//	vertexData.pSysMem = waterVertices;
-//	vertexData.SysMemPitch = 0;
-//	vertexData.SysMemSlicePitch = 0;
-//
-//	// Now finally create the vertex buffer.
-//	device->CreateBuffer(&vbd, &vertexData, &waterVertexBuffer);
-//
-//	// Create the index buffer
-//	D3D11_BUFFER_DESC ibd;
-//	ibd.Usage = D3D11_USAGE_DEFAULT;
-//	ibd.ByteWidth = sizeof(unsigned long) * 6;
-//	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-//	ibd.CPUAccessFlags = 0;
-//	ibd.MiscFlags = 0;
-//	ibd.StructureByteStride = 0;
-//
-//	// Give the subresource structure a pointer to the index data.
-//	D3D11_SUBRESOURCE_DATA indexData;
-//	indexData.pSysMem = indices;
-//	indexData.SysMemPitch = 0;
-//	indexData.SysMemSlicePitch = 0;
-//
-//	// Create the index buffer.
-//	device->CreateBuffer(&ibd, &indexData, &waterIndexBuffer);
-//
-	currentEntity = 0;
-}
-
-bool Game::RenderRefractionToTexture()
-{
-	XMFLOAT4 clipPlane;
-
-	//Setting up a clip plane based on the height of the water to clip everything above it to create a refraction.
-	clipPlane = XMFLOAT4(0.0f, -1.0f, 0.0f, water->GetWaterHeight() + 0.1f);
-
-	//Set the render target to be the refraction render to texture
-	_refractionTexture->SetRenderTarget(context);
-
-	//Clear the refraction render to texture
-	_refractionTexture->ClearRenderTarget(context, 0.0f, 0.0f, 0.0f, 1.0f);
-
-	//Generate view matrix based on camera's position
-	camera->UpdateViewMatrix();
-
-	//Render the ground
-
-	ID3D11Buffer* vb = bathBottom->GetMesh()->GetVertexBuffer();
-	ID3D11Buffer* ib = bathBottom->GetMesh()->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	refractionVS->SetMatrix4x4("world", *bathBottom->GetWorldMatrix());
-	refractionVS->SetMatrix4x4("view", camera->GetView());
-	refractionVS->SetMatrix4x4("projection", camera->GetProjection());
-
-	refractionVS->SetFloat4("clipPlane", clipPlane);
-
-	refractionVS->CopyAllBufferData();
-	refractionVS->SetShader();
-
-	refractionPS->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	refractionPS->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	refractionPS->SetFloat3("PointLightPosition", XMFLOAT3(0.5, 0, 0));
-	refractionPS->SetFloat4("PointLightColor", XMFLOAT4(1, 0.3f, 0.3f, 1));
-	refractionPS->SetFloat3("CameraPosition", camera->GetPosition());
-
-	refractionPS->SetSamplerState("Sampler", sampler);
-	refractionPS->SetShaderResourceView("shaderTexture", bathSRV);
-	refractionPS->SetShaderResourceView("NormalMap", bathNormalMapSRV);
-	refractionPS->SetShaderResourceView("Sky", skySRV);
-
-	refractionPS->CopyAllBufferData();
-	refractionPS->SetShader();
-
-	// Finally do the actual drawing
-	context->DrawIndexed(bathBottom->GetMesh()->GetIndexCount(), 0, 0);
-
-	//Set the render target back to back buffer
-	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
-
-	return true;
-}
-
-
-
-void Game::OnResize()
-{
-	// Handle base-level DX resize stuff
-	DXCore::OnResize();
-
-	// Update the projection matrix assuming the
-	// camera exists
-	if( camera ) 
-		camera->UpdateProjectionMatrix((float)width / height);
-}
-
-void Game::Update(float deltaTime, float totalTime)
-{
-	// Quit if the escape key is pressed
-	if (GetAsyncKeyState(VK_ESCAPE))
-		Quit();
-
-	// Update the camera
-	camera->Update(deltaTime);
-
-	// Always update current entity's world matrix
-	entities[currentEntity]->UpdateWorldMatrix();
-	bathBottom->UpdateWorldMatrix();
-	bathRight->UpdateWorldMatrix();
-	bathLeft->UpdateWorldMatrix();
-	bathBack->UpdateWorldMatrix();
-	bathFront->UpdateWorldMatrix();
-
-	//Do water frame processing
-	water->Update();
-
-	////Render the refraction of scene to a texture
-	RenderRefractionToTexture();
-
-	////Render the reflection
-	//RenderReflectionToTexture();
-
-	Draw(deltaTime, totalTime);
-}
-
-
-void Game::Draw(float deltaTime, float totalTime)
-{
-	// Background color for clearing
-	const float color[4] = {1,1,1,1};
-
-	// Render the refraction of the scene to a texture.
-	RenderRefractionToTexture();
-
-	// Render the reflection of the scene to a texture.
-	//RenderReflectionToTexture();
-
-	// Clear the render target and depth buffer (erases what's on the screen)
-	//  - Do this ONCE PER FRAME
-	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV, color);
-	context->ClearDepthStencilView(
-		depthStencilView,
-		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
-		1.0f,
-		0);
-
-	
-
-
-	/********************************************************************/
-	// Draw the sky ------------------------
-	ID3D11Buffer* vb = meshes[1]->GetVertexBuffer();
-	ID3D11Buffer* ib = meshes[1]->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	// Set up the sky shaders
-	skyVS->SetMatrix4x4("view", camera->GetView());
-	skyVS->SetMatrix4x4("projection", camera->GetProjection());
-	skyVS->CopyAllBufferData();
-	skyVS->SetShader();
-
-	skyPS->SetShaderResourceView("Sky", skySRV);
-	skyPS->CopyAllBufferData();
-	skyPS->SetShader();
-
-	context->RSSetState(rsSky);
-	context->OMSetDepthStencilState(dsSky, 0);
-	context->DrawIndexed(meshes[1]->GetIndexCount(), 0, 0);
-
-	// Reset the render states we've changed
-	context->RSSetState(0);
-	context->OMSetDepthStencilState(0, 0);
-
-	/******************************************************************/
-	//Draw the ground ---------------------------------------
-	// Grab the data from the first entity's mesh
-	GameEntity* ge = entities[currentEntity];
-	vb = ge->GetMesh()->GetVertexBuffer();
-	ib = ge->GetMesh()->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	vertexShader->SetMatrix4x4("world", *ge->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
-
-	pixelShader->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	pixelShader->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	pixelShader->SetFloat3("PointLightPosition", XMFLOAT3(0.3, 0, 0));
-	pixelShader->SetFloat4("PointLightColor", XMFLOAT4(1, 0.3f, 0.3f, 1));
-	pixelShader->SetFloat3("CameraPosition", camera->GetPosition());
-
-	pixelShader->SetSamplerState("Sampler", sampler);
-	pixelShader->SetShaderResourceView("Texture", textureSRV);
-	pixelShader->SetShaderResourceView("NormalMap", normalMapSRV);
-	pixelShader->SetShaderResourceView("Sky", skySRV);
-
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
-
-	// Finally do the actual drawing
-	context->DrawIndexed(ge->GetMesh()->GetIndexCount(), 0, 0);
-
-	/***********************************************************************************/
-	//Draw Bath model
-	//Bottom
-	vb = bathBottom->GetMesh()->GetVertexBuffer();
-	ib = bathBottom->GetMesh()->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	vertexShader->SetMatrix4x4("world", *bathBottom->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
-
-	pixelShader->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	pixelShader->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	pixelShader->SetFloat3("PointLightPosition", XMFLOAT3(3, 0, 0));
-	pixelShader->SetFloat4("PointLightColor", XMFLOAT4(1, 0.3f, 0.3f, 1));
-	pixelShader->SetFloat3("CameraPosition", camera->GetPosition());
-
-	pixelShader->SetSamplerState("Sampler", sampler);
-	pixelShader->SetShaderResourceView("Texture", bathSRV);
-	pixelShader->SetShaderResourceView("NormalMap", bathNormalMapSRV);
-	pixelShader->SetShaderResourceView("Sky", skySRV);
-
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
-
-	// Finally do the actual drawing
-	context->DrawIndexed(bathBottom->GetMesh()->GetIndexCount(), 0, 0);
-
-	//Left
-	vb = bathLeft->GetMesh()->GetVertexBuffer();
-	ib = bathLeft->GetMesh()->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	vertexShader->SetMatrix4x4("world", *bathLeft->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
-
-	pixelShader->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	pixelShader->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	pixelShader->SetFloat3("PointLightPosition", XMFLOAT3(3, 0, 0));
-	pixelShader->SetFloat4("PointLightColor", XMFLOAT4(1, 0.3f, 0.3f, 1));
-	pixelShader->SetFloat3("CameraPosition", camera->GetPosition());
-
-	pixelShader->SetSamplerState("Sampler", sampler);
-	pixelShader->SetShaderResourceView("Texture", bathSRV);
-	pixelShader->SetShaderResourceView("NormalMap", bathNormalMapSRV);
-	pixelShader->SetShaderResourceView("Sky", skySRV);
-
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
-
-	// Finally do the actual drawing
-	context->DrawIndexed(bathLeft->GetMesh()->GetIndexCount(), 0, 0);
-
-	//Right
-	vb = bathRight->GetMesh()->GetVertexBuffer();
-	ib = bathRight->GetMesh()->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	vertexShader->SetMatrix4x4("world", *bathRight->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
-
-	pixelShader->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	pixelShader->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	pixelShader->SetFloat3("PointLightPosition", XMFLOAT3(3, 0, 0));
-	pixelShader->SetFloat4("PointLightColor", XMFLOAT4(1, 0.3f, 0.3f, 1));
-	pixelShader->SetFloat3("CameraPosition", camera->GetPosition());
-
-	pixelShader->SetSamplerState("Sampler", sampler);
-	pixelShader->SetShaderResourceView("Texture", bathSRV);
-	pixelShader->SetShaderResourceView("NormalMap", bathNormalMapSRV);
-	pixelShader->SetShaderResourceView("Sky", skySRV);
-
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
-
-	// Finally do the actual drawing
-	context->DrawIndexed(bathRight->GetMesh()->GetIndexCount(), 0, 0);
-
-	//back
-	vb = bathBack->GetMesh()->GetVertexBuffer();
-	ib = bathBack->GetMesh()->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	vertexShader->SetMatrix4x4("world", *bathBack->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
-
-	pixelShader->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	pixelShader->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	pixelShader->SetFloat3("PointLightPosition", XMFLOAT3(3, 0, 0));
-	pixelShader->SetFloat4("PointLightColor", XMFLOAT4(1, 0.3f, 0.3f, 1));
-	pixelShader->SetFloat3("CameraPosition", camera->GetPosition());
-
-	pixelShader->SetSamplerState("Sampler", sampler);
-	pixelShader->SetShaderResourceView("Texture", bathSRV);
-	pixelShader->SetShaderResourceView("NormalMap", bathNormalMapSRV);
-	pixelShader->SetShaderResourceView("Sky", skySRV);
-
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
-
-	// Finally do the actual drawing
-	context->DrawIndexed(bathBack->GetMesh()->GetIndexCount(), 0, 0);
-
-	//Front
-	vb = bathFront->GetMesh()->GetVertexBuffer();
-	ib = bathFront->GetMesh()->GetIndexBuffer();
-
-	// Set buffers in the input assembler
-
-	context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
-	context->IASetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
-
-	vertexShader->SetMatrix4x4("world", *bathFront->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
-
-	pixelShader->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	pixelShader->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	pixelShader->SetFloat3("PointLightPosition", XMFLOAT3(3, 0, 0));
-	pixelShader->SetFloat4("PointLightColor", XMFLOAT4(1, 0.3f, 0.3f, 1));
-	pixelShader->SetFloat3("CameraPosition", camera->GetPosition());
-
-	pixelShader->SetSamplerState("Sampler", sampler);
-	pixelShader->SetShaderResourceView("Texture", bathSRV);
-	pixelShader->SetShaderResourceView("NormalMap", bathNormalMapSRV);
-	pixelShader->SetShaderResourceView("Sky", skySRV);
-
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
-
-	// Finally do the actual drawing
-	context->DrawIndexed(bathFront->GetMesh()->GetIndexCount(), 0, 0);
-
-
-	/**********************************************************************/
-	//Draw water ---------------------------------------------------
-	water->Render(context);
-
-	camera->UpdateReflectionViewMatrix(water->GetWaterHeight());
-
-	//waterVS->SetMatrix4x4("world", worldMatrix1);
-	//waterVS->SetMatrix4x4("view", camera->GetView());
-	//waterVS->SetMatrix4x4("projection", camera->GetProjection());
-	//waterVS->SetMatrix4x4("reflection", camera->GetReflectionView() );
-	//waterVS->SetFloat3("CameraPosition", camera->GetPosition());
-	//waterVS->SetFloat2("normalMapTiling", water->GetNormalMapTiling());
-	//waterVS->CopyAllBufferData();
-	//waterVS->SetShader();
-	//waterPS->SetShaderResourceView("reflectionTexture", skySRV);
-	//waterPS->SetShaderResourceView("refractionTexture", _refractionTexture->GetShaderResourceView());
-	//waterPS->SetShaderResourceView("normalTexture", water->GetTexture());
-	//waterPS->SetSamplerState("SampleType", sampler);
-	//waterPS->SetFloat("WaterTranslation", water->GetWaterTranslation());
-	//waterPS->SetFloat("reflectRefractScale", water->GetReflectRefractScale());
-	//waterPS->SetFloat4("refractionTint", water->GetRefractionTint());
-	////waterPS->SetFloat3("lightDirection", XMFLOAT3(1, 0, 0));
-	//waterPS->SetFloat3("CameraPosition", camera->GetPosition());
-	//waterPS->SetFloat("WaterTranslation", water->GetWaterTranslation());
-	//waterPS->SetFloat("reflectRefractScale", water->GetReflectRefractScale());
-	//waterPS->SetFloat("specularShininess", water->GetSpecularShininess());
-	//
-	//waterPS->CopyAllBufferData();
-	//waterPS->SetShader();
-	
-	//context->IASetVertexBuffers(0, 1, , &stride, &offset);
-	//context->IASetIndexBuffer(waterIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
-	//context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	camera->UpdateReflectionViewMatrix(water->GetWaterHeight());
-	waterVS->SetMatrix4x4("world", worldMatrix1);
-	waterVS->SetMatrix4x4("view", camera->GetView());
-	waterVS->SetMatrix4x4("projection", camera->GetProjection());
-	waterVS->SetMatrix4x4("reflection", camera->GetReflectionView());
-
-	waterVS->CopyAllBufferData();
-	waterVS->SetShader();
-
-	waterPS->SetFloat4("DirLightColor", XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
-	waterPS->SetFloat3("DirLightDirection", XMFLOAT3(1, 0, 0));
-	waterPS->SetFloat4("PointLightColor", XMFLOAT4(0.3, 0.3f, 0.3f, 1));
-	waterPS->SetFloat3("PointLightPosition", XMFLOAT3(3, 0, 0));
-	waterPS->SetFloat3("CameraPosition", camera->GetPosition());
-
-	waterPS->SetFloat("waterTranslation", water->GetWaterTranslation());
-
-	waterPS->SetShaderResourceView("reflectionTexture", skySRV);
-	waterPS->SetShaderResourceView("refractionTexture",bathSRV);
-	waterPS->SetShaderResourceView("NormalMap", water->GetTexture());
-	waterPS->SetShaderResourceView("Sky", skySRV);
-	waterPS->SetSamplerState("Sampler", sampler);
-	
-	waterPS->CopyAllBufferData();
-	waterPS->SetShader();
-
-	
-	context->DrawIndexed(water->GetIndexCount(),0,0);
-	//	
-
-
-	/******************************************************************/
-
-
-
-
-	
-	
-
-	swapChain->Present(0, 0);
-}
-
-
-#pragma region Mouse Input
-
-// --------------------------------------------------------
-// Helper method for mouse clicking.  We get this information
-// from the OS-level messages anyway, so these helpers have
-// been created to provide basic mouse input if you want it.
-// --------------------------------------------------------
-void Game::OnMouseDown(WPARAM buttonState, int x, int y)
-{
-	// Add any custom code here...
-
-	// Save the previous mouse position, so we have it for the future
-	prevMousePos.x = x;
-	prevMousePos.y = y;
-
-	// Caputure the mouse so we keep getting mouse move
-	// events even if the mouse leaves the window.  we'll be
-	// releasing the capture once a mouse button is released
-	SetCapture(hWnd);
-}
-
-// --------------------------------------------------------
-// Helper method for mouse release
-// --------------------------------------------------------
-void Game::OnMouseUp(WPARAM buttonState, int x, int y)
-{
-	// Add any custom code here...
-
-	// We don't care about the tracking the cursor outside
-	// the window anymore (we're not dragging if the mouse is up)
-	ReleaseCapture();
-}
-
-// --------------------------------------------------------
-// Helper method for mouse movement.  We only get this message
-// if the mouse is currently over the window, or if we're 
-// currently capturing the mouse.
-// --------------------------------------------------------
-void Game::OnMouseMove(WPARAM buttonState, int x, int y)
-{
-	// Check left mouse button
-	if (buttonState & 0x0001)
-	{
-		float xDiff = (x - prevMousePos.x) * 0.005f;
-		float yDiff = (y - prevMousePos.y) * 0.005f;
-		camera->Rotate(yDiff, xDiff);
-	}
-
-	// Save the previous mouse position, so we have it for the future
-	prevMousePos.x = x;
-	prevMousePos.y = y;
-}
-
-// --------------------------------------------------------
-// Helper method for mouse wheel scrolling.  
-// WheelDelta may be positive or negative, depending 
-// on the direction of the scroll
-// --------------------------------------------------------
-void Game::OnMouseWheel(float wheelDelta, int x, int y)
-{
-	// Add any custom code here...
-}
+#include "Game.h"
+#include "Vertex.h"
+#include "ShaderStructs.h"
+
+#include <sstream>
+#include <cstring>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+
+Game::Game(HINSTANCE hInstance, bool headless)
+	: DXCore( 
+		hInstance,		   // The application's handle
+		"DirectX Game",	   // Text for the window's title bar
+		1280,			   // Width of the window's client area
+		720,			   // Height of the window's client area
+		true)			   // Show extra stats (fps) in title bar?
+{
+	// The scene steps 60 times a second, whatever the frame rate
+	SetFixedTimestep(60.0f);
+
+	// Initialize fields
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	vertexShader = 0;
+	instancedVS = 0;
+	pixelShader = 0;
+	skyVS = 0;
+	skyPS = 0;
+	waterVS = 0;
+	waterPS = 0;
+	refractionVS = 0;
+	refractionPS = 0;
+	shaderArchive = 0;
+	permutations = 0;
+	_reflectionTexture = 0;
+	_refractionTexture = 0;
+	camera = 0;
+	water = 0;
+	assets = 0;
+	jobs = 0;
+	transforms = 0;
+	world = 0;
+	culler = 0;
+	sceneBVH = 0;
+	occlusion = 0;
+	renderQueue = 0;
+	staticBatch = 0;
+	scene = 0;
+	skyMesh = 0;
+	ground = 0;
+	bathBottom = 0;
+	bathRight = 0;
+	bathLeft = 0;
+	bathBack = 0;
+	bathFront = 0;
+	sampler = 0;
+	rsSky = 0;
+	dsSky = 0;
+
+	// Merge the ground and bath into a couple of big meshes
+	batchStatic = true;
+
+	// Skip drawing what the bath walls hide
+	occlusionCulling = true;
+
+	// Update the next frame while this one draws
+	pipelined = true;
+	drawSnapshot = 0;
+	pendingRotation = XMFLOAT2(0, 0);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Do we want a console window?  Probably only in debug mode
+	if (!headless)
+	{
+		CreateConsoleWindow(500, 120, 32, 120);
+		printf("Console window created successfully.  Feel free to printf() here.");
+	}
+#endif
+}
+
+
+Game::~Game()
+{
+	// An update may still be running on a worker
+	WaitForUpdate();
+
+	// Release any (and all!) DirectX objects
+	// we've made in the Game class
+	if (vertexBuffer) { vertexBuffer->Release(); }
+	if (indexBuffer) { indexBuffer->Release(); }
+	
+	if (sampler) { sampler->Release(); }
+	if (rsSky) { rsSky->Release(); }
+	if (dsSky) { dsSky->Release(); }
+
+	// Delete our simple shader objects, which
+	// will clean up their own internal DirectX stuff
+	ReleaseShaders();
+	delete _refractionTexture;
+	delete _reflectionTexture;
+	StateCache::Release(context);
+	RenderBackend::Release(context);
+
+	// Clean up resources
+	for(auto& e : entities) delete e;
+	delete camera;
+	delete water;
+	delete bathBottom;
+	delete bathLeft;
+	delete bathRight;
+	delete bathBack;
+	delete bathFront;
+	delete transforms;
+	delete world;
+	delete culler;
+	delete sceneBVH;
+	delete occlusion;
+	delete renderQueue;
+	delete staticBatch;
+	delete scene;
+
+	// Meshes and textures belong to the registry
+	if (assets)
+	{
+		for (auto& a : sceneMeshes) assets->Release(a);
+		for (auto& a : sceneTextures) assets->Release(a);
+		delete assets;
+	}
+
+	// Last, since the registry may still be waiting on jobs
+	delete jobs;
+}
+
+
+void Game::Init()
+{
+	jobs = new JobSystem();
+
+	// Nothing to show without a scene
+	if (!LoadScene("bath"))
+	{
+		Quit();
+		return;
+	}
+
+	LoadShaders();
+	CreateMatrices();
+	LoadAssets();
+	CreateBasicGeometry();
+
+	// Create a sampler state for texture sampling,
+	// which the materials need
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
+	samplerDesc.MaxAnisotropy = 16;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	
+	// Ask the device to create a state
+	device->CreateSamplerState(&samplerDesc, &sampler);
+	CreateRenderQueue();
+
+	//Initialize water class
+	water = new Water();
+	water->Initialize(device, waterNormalMapSRV, scene->GetWaterHeight(), scene->GetWaterRadius());
+
+	// World matrices and bounds for the starting layout, which
+	// is all the static batch needs
+	transforms->UpdateWorldMatrices(jobs);
+	UpdateBounds();
+	if (batchStatic)
+		BuildStaticBatch();
+
+	// Both snapshots start out the same, since a fixed timestep
+	// can draw a frame before the first update has run
+	camera->UpdateReflectionViewMatrix(water->GetWaterHeight());
+	lastState = CaptureState();
+	UpdateScene(0.0f, XMFLOAT2(0, 0), snapshots[drawSnapshot]);
+	snapshots[drawSnapshot ^ 1] = snapshots[drawSnapshot];
+
+	// Everything's been pulled out of the scene file now
+	delete scene;
+	scene = 0;
+
+	//Create the refraction render to the texture object
+	_refractionTexture = new RenderTexture();
+	_refractionTexture->Initialize(device, width, height, 100.0f, 0.1f);
+
+	// Create the reflection render to texture object.
+	_reflectionTexture = new RenderTexture();
+	_reflectionTexture->Initialize(device, width, height, 100.0f, 0.1f);
+
+	// Set up sky stuff
+	
+	// Set up the rasterize state
+	D3D11_RASTERIZER_DESC rsDesc = {};
+	rsDesc.FillMode = D3D11_FILL_SOLID;
+	rsDesc.CullMode = D3D11_CULL_FRONT;
+	rsDesc.DepthClipEnable = true;
+	device->CreateRasterizerState(&rsDesc, &rsSky);
+
+	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+	dsDesc.DepthEnable = true;
+	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	dsDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	device->CreateDepthStencilState(&dsDesc, &dsSky);
+
+	// Tell the input assembler stage of the pipeline what kind of
+	// geometric primitives (points, lines or triangles) we want to draw.  
+	// Essentially: "What kind of shape should the GPU draw with our data?"
+	StateCache::Get(context)->SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+
+// --------------------------------------------------------
+// Sets a whole constant buffer from its generated struct.  A
+// struct that didn't match the shader when it loaded is set
+// one variable at a time, by name, instead.
+// --------------------------------------------------------
+template<typename T>
+static void SetBufferStruct(ISimpleShader* shader, const SimpleBufferHandle& handle, const T& data)
+{
+	if (shader->SetBufferData(handle, data))
+		return;
+
+	const ShaderLayout& layout = T::GetLayout();
+	for (unsigned int i = 0; i < layout.FieldCount; i++)
+		shader->SetData(layout.Fields[i].Name, (const unsigned char*)&data + layout.Fields[i].Offset, layout.Fields[i].Size);
+}
+
+// --------------------------------------------------------
+// Loads every shader the game draws with, and returns how
+// long that took in milliseconds.  Without the reflection
+// cache, nothing is read from or saved to it, so every
+// shader is reflected (a cold start).
+// --------------------------------------------------------
+double Game::LoadShaders(bool reflectionCache)
+{
+	LARGE_INTEGER start, end, frequency;
+	QueryPerformanceCounter(&start);
+
+	if (!reflectionCache)
+		ShaderReflectionCache::Clear();
+
+	skyVS = new SimpleVertexShader(device, context);
+	skyPS = new SimplePixelShader(device, context);
+	waterVS = new SimpleVertexShader(device, context);
+	waterPS = new SimplePixelShader(device, context);
+
+	ISimpleShader* shaders[] = { skyVS, skyPS, waterVS, waterPS };
+	const char* names[] = { "SkyVS", "SkyPS", "WaterVS", "WaterPS" };
+	const unsigned int shaderCount = sizeof(shaders) / sizeof(shaders[0]);
+	std::vector<bool> loaded(shaderCount, false);
+
+	// The build packs every shader (and its reflection) into one
+	// archive, which loads them all in parallel
+	shaderArchive = new ShaderArchive();
+	bool packed = shaderArchive->Open("Debug/Shaders.pack") || shaderArchive->Open("Shaders.pack");
+	if (packed)
+	{
+		if (reflectionCache && !shaderArchive->LoadReflection())
+			ShaderReflectionCache::Load("ShaderReflection.cache");
+		ShaderReflectionCache::ResetStats();
+
+		ShaderArchive::Request requests[shaderCount];
+		for (unsigned int i = 0; i < shaderCount; i++)
+			requests[i] = { shaders[i], names[i] };
+		shaderArchive->Load(requests, shaderCount, jobs, loaded);
+	}
+	else
+	{
+		// Shaders seen on an earlier run skip reflection
+		if (reflectionCache)
+			ShaderReflectionCache::Load("ShaderReflection.cache");
+		ShaderReflectionCache::ResetStats();
+	}
+
+	// Anything not in the archive comes from its own .cso
+	for (unsigned int i = 0; i < shaderCount; i++)
+	{
+		if (loaded[i])
+			continue;
+
+		std::wstring name(names[i], names[i] + strlen(names[i]));
+		if (!shaders[i]->LoadShaderFile((L"Debug/" + name + L".cso").c_str()))
+			shaders[i]->LoadShaderFile((name + L".cso").c_str());
+	}
+
+	// The lit shaders are variants of one source each.  These are
+	// the ones the passes use; any other loads when first asked for.
+	const ShaderKey litVariants[] =
+	{
+		MakeShaderKey(SHADER_SOURCE_VERTEX_SHADER),
+		MakeShaderKey(SHADER_SOURCE_VERTEX_SHADER, SHADER_FEATURE_INSTANCED),
+		MakeShaderKey(SHADER_SOURCE_VERTEX_SHADER, SHADER_FEATURE_CLIP_PLANE),
+		MakeShaderKey(SHADER_SOURCE_PIXEL_SHADER),
+		MakeShaderKey(SHADER_SOURCE_PIXEL_SHADER, SHADER_FEATURE_UNLIT),
+	};
+	permutations = new ShaderPermutations(device, context, packed ? shaderArchive : 0);
+	permutations->Preload(litVariants, sizeof(litVariants) / sizeof(litVariants[0]), jobs);
+
+	vertexShader = permutations->GetVertexShader(litVariants[0]);
+	instancedVS = permutations->GetVertexShader(litVariants[1]);
+	refractionVS = permutations->GetVertexShader(litVariants[2]);
+	pixelShader = permutations->GetPixelShader(litVariants[3]);
+	refractionPS = permutations->GetPixelShader(litVariants[4]);
+
+	// Per-frame data goes up as one struct per buffer, as long as
+	// ShaderStructs.h was generated from these shaders
+	litFrameVS = vertexShader->GetBufferHandle(VertexShader_perFrame::GetLayout());
+	instancedFrameVS = instancedVS->GetBufferHandle(VertexShader_perFrame::GetLayout());
+	refractionFrameVS = refractionVS->GetBufferHandle(VertexShader_CLIP_PLANE_perFrame::GetLayout());
+	litFramePS = pixelShader->GetBufferHandle(PixelShader_perFrame::GetLayout());
+	skyFrameVS = skyVS->GetBufferHandle(SkyVS_perFrame::GetLayout());
+	if (!litFrameVS.IsValid() || !refractionFrameVS.IsValid() || !litFramePS.IsValid() || !skyFrameVS.IsValid() ||
+		(instancedVS->IsShaderValid() && !instancedFrameVS.IsValid()))
+		printf("ShaderStructs.h doesn't match the shaders - rebuild to regenerate it\n");
+
+	if (reflectionCache && !packed && ShaderReflectionCache::IsModified())
+		ShaderReflectionCache::Save("ShaderReflection.cache");
+
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+	double milliseconds = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+	ShaderReflectionStats& reflected = ShaderReflectionCache::GetStats();
+	printf("\nShaders loaded %sin %.2fms (%u cached, %u reflected)\n",
+		packed ? "from archive " : "",
+		milliseconds,
+		reflected.Hits,
+		reflected.Misses);
+	return milliseconds;
+}
+
+void Game::ReleaseShaders()
+{
+	delete permutations;
+	delete skyVS;
+	delete skyPS;
+	delete waterVS;
+	delete waterPS;
+	delete shaderArchive;
+
+	// The lit shaders belong to the permutations
+	permutations = 0;
+	skyVS = 0;
+	skyPS = 0;
+	waterVS = 0;
+	waterPS = 0;
+	shaderArchive = 0;
+	vertexShader = 0;
+	instancedVS = 0;
+	refractionVS = 0;
+	pixelShader = 0;
+	refractionPS = 0;
+}
+
+// --------------------------------------------------------
+// "-shaderbench [rounds]", after InitHeadless(): loads the
+// shaders cold (reflection cache emptied) and warm, "rounds"
+// times each, and prints the average of each.  One untimed
+// warm load comes first, so the cache file exists.  Nothing
+// else in the game is set up.
+// --------------------------------------------------------
+HRESULT Game::BenchmarkShaders(unsigned int rounds)
+{
+	if (rounds == 0)
+		return E_INVALIDARG;
+
+	jobs = new JobSystem();
+	LoadShaders(true);
+	ReleaseShaders();
+
+	double cold = 0;
+	double warm = 0;
+	unsigned int reflected = 0;
+	unsigned int cached = 0;
+	for (unsigned int r = 0; r < rounds; r++)
+	{
+		cold += LoadShaders(false);
+		reflected = ShaderReflectionCache::GetStats().Misses;
+		ReleaseShaders();
+
+		warm += LoadShaders(true);
+		cached = ShaderReflectionCache::GetStats().Hits;
+		ReleaseShaders();
+	}
+
+	printf("\nShader loads over %u rounds:\n", rounds);
+	printf("  Cold (%u reflected):  %.2fms\n", reflected, cold / rounds);
+	printf("  Warm (%u cached):     %.2fms\n", cached, warm / rounds);
+	return S_OK;
+}
+
+
+
+
+void Game::CreateMatrices()
+{
+	camera = new Camera(0, 0, -5);
+	camera->UpdateProjectionMatrix((float)width / height);
+}
+
+
+
+// --------------------------------------------------------
+// Maps Scenes/<name>.scenebin, compiling it from the .scene
+// text first if the binary is missing or out of date.  The
+// demo needs the ground, the bath pieces, a sky and water.
+// --------------------------------------------------------
+bool Game::LoadScene(const char* name)
+{
+	const char* folders[] = { "", "Debug/" };
+	for (auto& folder : folders)
+	{
+		std::string text = std::string(folder) + "Scenes/" + name + ".scene";
+		std::string binary = text + "bin";
+		if (Scene::NeedsCompile(text.c_str(), binary.c_str()) &&
+			!Scene::Compile(text.c_str(), binary.c_str()))
+			continue;
+
+		scene = new Scene();
+		if (scene->Load(binary.c_str()))
+			break;
+
+		delete scene;
+		scene = 0;
+	}
+
+	if (!scene)
+	{
+		printf("Couldn't load scene \"%s\"\n", name);
+		return false;
+	}
+
+	const char* required[] = { "ground", "bathBottom", "bathRight", "bathLeft", "bathBack", "bathFront" };
+	for (auto& entity : required)
+	{
+		unsigned int e = scene->FindEntity(entity);
+		if (e == SceneNone || scene->GetEntityMesh(e) == SceneNone)
+		{
+			printf("Scene \"%s\" needs a \"%s\" entity with a mesh\n", name, entity);
+			return false;
+		}
+	}
+
+	if (scene->GetSkyMesh() == SceneNone || scene->GetWaterEntity() == SceneNone)
+	{
+		printf("Scene \"%s\" needs a sky and water\n", name);
+		return false;
+	}
+	return true;
+}
+
+// The SRV of one of the scene's textures, or null for none
+ID3D11ShaderResourceView* Game::GetSceneTexture(unsigned int texture)
+{
+	return texture < sceneTextures.size() ? sceneTextures[texture]->TextureSRV : 0;
+}
+
+// Starts every mesh and texture load at once, then waits for
+// them together so startup only costs as much as the slowest one
+void Game::LoadAssets()
+{
+	assets = new AssetRegistry(device, context, jobs);
+
+	// Batched meshes keep their geometry on the CPU to merge
+	for (unsigned int m = 0; m < scene->GetMeshCount(); m++)
+		sceneMeshes.push_back(assets->LoadMesh(scene->GetMeshPath(m), AssetCallback(), batchStatic));
+
+	for (unsigned int t = 0; t < scene->GetTextureCount(); t++)
+	{
+		const char* path = scene->GetTexturePath(t);
+		size_t length = strlen(path);
+		bool dds = length > 4 && _stricmp(path + length - 4, ".dds") == 0;
+		sceneTextures.push_back(dds ? assets->LoadTextureDDS(path) : assets->LoadTexture(path));
+	}
+
+	assets->WaitForAll();
+
+	// The ground and bath materials use whatever those entities reference
+	unsigned int groundEntity = scene->FindEntity("ground");
+	unsigned int bathEntity = scene->FindEntity("bathBottom");
+	textureSRV = GetSceneTexture(scene->GetEntityTexture(groundEntity));
+	normalMapSRV = GetSceneTexture(scene->GetEntityNormalMap(groundEntity));
+	bathSRV = GetSceneTexture(scene->GetEntityTexture(bathEntity));
+	bathNormalMapSRV = GetSceneTexture(scene->GetEntityNormalMap(bathEntity));
+	skySRV = GetSceneTexture(scene->GetSkyTexture());
+	waterNormalMapSRV = GetSceneTexture(scene->GetWaterNormalMap());
+}
+
+void Game::CreateBasicGeometry()
+{
+	// Make some entities, all sharing one transform store
+	transforms = new TransformStore();
+	world = new EntityWorld();
+	culler = new FrustumCuller();
+	sceneBVH = new BVH();
+	occlusion = new OcclusionCuller(jobs);
+
+	// One transform per scene entity, already parented.  Moving
+	// the bath's transform moves the whole tub.
+	unsigned int first = scene->CreateTransforms(transforms);
+	unsigned int bath = scene->FindEntity("bath");
+	bathTransform = bath == SceneNone ? TransformStore::NoTransform : first + bath;
+	waterTransform = first + scene->GetWaterEntity();
+
+	// Entities with a mesh get drawn.  The bath pieces are picked
+	// out by name, everything else goes in the entity list.
+	const char* bathNames[] = { "bathBottom", "bathRight", "bathLeft", "bathBack", "bathFront" };
+	GameEntity** bathPieces[] = { &bathBottom, &bathRight, &bathLeft, &bathBack, &bathFront };
+	for (unsigned int e = 0; e < scene->GetEntityCount(); e++)
+	{
+		unsigned int mesh = scene->GetEntityMesh(e);
+		if (mesh == SceneNone)
+			continue;
+
+		GameEntity* entity = new GameEntity(sceneMeshes[mesh]->MeshData, transforms, first + e);
+		const char* name = scene->GetEntityName(e);
+
+		bool isBath = false;
+		for (unsigned int b = 0; b < 5 && !isBath; b++)
+		{
+			if (strcmp(name, bathNames[b]) == 0)
+			{
+				*bathPieces[b] = entity;
+				isBath = true;
+			}
+		}
+		if (isBath)
+			continue;
+
+		if (strcmp(name, "ground") == 0)
+			ground = entity;
+		entities.push_back(entity);
+		world->Create(Renderable{ entity->GetMesh(), entity->GetTransform() });
+	}
+
+	skyMesh = sceneMeshes[scene->GetSkyMesh()]->MeshData;
+
+
+//	//Water Vertices
+//	WaterVertex* waterVertices;
+//	waterVertices = new WaterVertex[6];
+//	waterVertices[0].Position = XMFLOAT3(-2.0f,0.0f,2.0f);  // Top left.
+//	waterVertices[0].UV = XMFLOAT2(0.0f,0.0f);
+//
+//	waterVertices[1].Position = XMFLOAT3(2.0f,0.0f,-2.0f);  // Top right.
+//	waterVertices[1].UV = XMFLOAT2(1.0f, 0.0f);
+//
+//	waterVertices[2].Position = XMFLOAT3(-2.0f,0.0f,-2.0f);  // Bottom left.
+//	waterVertices[2].UV = XMFLOAT2(0.0f, 1.0f);
+//
+//	waterVertices[3].Position = XMFLOAT3(2.0f,0.0f,2.0f);  // Bottom left.
+//	waterVertices[3].UV = XMFLOAT2(0.0f, 1.0f);
+//
+//	waterVertices[4].Position = XMFLOAT3(2.0f, 0.0f, -2.0f);  // Top right.
+//	waterVertices[4].UV = XMFLOAT2(1.0f, 0.0f);
+//
+//	waterVertices[5].Position = XMFLOAT3(-2.0f, 0.0f, 2.0f);  // Bottom right.
+//	waterVertices[5].UV = XMFLOAT2(1.0f, 1.0f);
+//
+//	/*WaterVertex waterVertices[]
+//	{
+//		{ XMFLOAT3(+0.0f, +0.0f, +0.0f),XMFLOAT4(1.0f,0.0f,0.0f,1.0f) },
+//		{ XMFLOAT3(+0.0f, +1.0f, +0.0f),XMFLOAT4(0.0f,0.0f,0.0f,1.0f) },
+//		{ XMFLOAT3(+1.0f, +1.0f, +0.0f), XMFLOAT4(0.0f,0.0f,0.0f,1.0f) },
+//		{ XMFLOAT3(+1.0f, +0.0f, +0.0f),XMFLOAT4(0.0f,0.0f,0.0f,1.0f) },
+//	};
+//*/
+//	//int indices2[] = { 0,1,2,0,2,3 };
+//
+//	// Load the index array with data.
+//	unsigned long* indices;
+//	indices = new unsigned long[6];
+//	indices[0] = 0;
+//	indices[1] = 1;
+//	indices[2] = 2;
+//	indices[3] = 3;
+//	indices[4] = 4;
+//	indices[5] = 5;
+//
+//	indexCount = sizeof(indices) / sizeof(int);
+//
+//	// Create the vertex buffer
+//	D3D11_BUFFER_DESC vbd;
+//	vbd.Usage = D3D11_USAGE_DEFAULT;
+//	vbd.ByteWidth = sizeof(WaterVertex) * 6;
+//	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+//	vbd.CPUAccessFlags = 0;
+//	vbd.MiscFlags = 0;
+//	vbd.StructureByteStride = 0;
+//
+//	// Give the subresource structure a pointer to the vertex data.
+//	D3D11_SUBRESOURCE_DATA vertexData;
+//	vertexData.pSysMem = waterVertices;
+//	vertexData.SysMemPitch = 0;
+//	vertexData.SysMemSlicePitch = 0;
+//
+//	// Now finally create the vertex buffer.
+//	device->CreateBuffer(&vbd, &vertexData, &waterVertexBuffer);
+//
+//	// Create the index buffer
+//	D3D11_BUFFER_DESC ibd;
+//	ibd.Usage = D3D11_USAGE_DEFAULT;
+//	ibd.ByteWidth = sizeof(unsigned long) * 6;
+//	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+//	ibd.CPUAccessFlags = 0;
+//	ibd.MiscFlags = 0;
+//	ibd.StructureByteStride = 0;
+//
+//	// Give the subresource structure a pointer to the index data.
+//	D3D11_SUBRESOURCE_DATA indexData;
+//	indexData.pSysMem = indices;
+//	indexData.SysMemPitch = 0;
+//	indexData.SysMemSlicePitch = 0;
+//
+//	// Create the index buffer.
+//	device->CreateBuffer(&ibd, &indexData, &waterIndexBuffer);
+//
+	currentEntity = 0;
+}
+
+// --------------------------------------------------------
+// The lights, the same for every lit pass
+// --------------------------------------------------------
+static PixelShader_perFrame GetLightData(const RenderSnapshot& frame)
+{
+	PixelShader_perFrame lights = {};
+	lights.DirLightColor = XMFLOAT4(0.8f, 0.8f, 0.8f, 1);
+	lights.DirLightDirection = XMFLOAT3(1, 0, 0);
+	lights.PointLightColor = XMFLOAT4(1, 0.3f, 0.3f, 1);
+	lights.CameraPosition = frame.CameraPosition;
+	return lights;
+}
+
+bool Game::RenderRefractionToTexture()
+{
+	XMFLOAT4 clipPlane;
+
+	//Setting up a clip plane based on the height of the water to clip everything above it to create a refraction.
+	clipPlane = GetRefractionClipPlane();
+
+	//Set the render target to be the refraction render to texture
+	_refractionTexture->SetRenderTarget(context);
+
+	//Clear the refraction render to texture
+	_refractionTexture->ClearRenderTarget(context, 0.0f, 0.0f, 0.0f, 1.0f);
+
+	// Values shared by everything in the pass
+	RenderSnapshot& frame = snapshots[drawSnapshot];
+	VertexShader_CLIP_PLANE_perFrame vsFrame = {};
+	vsFrame.view = frame.View;
+	vsFrame.projection = frame.Projection;
+	vsFrame.clipPlane = clipPlane;
+	SetBufferStruct(refractionVS, refractionFrameVS, vsFrame);
+
+	renderQueue->Draw(RENDER_PASS_REFRACTION);
+
+	//Set the render target back to back buffer
+	RenderBackend::Get(context)->SetRenderTargets(1, &backBufferRTV, depthStencilView);
+
+	return true;
+}
+
+
+
+// --------------------------------------------------------
+// Keeps each culling item's world bounds in step with its
+// transform.  Items share their index with transform handles,
+// and only boxes whose world matrix changed are touched.
+// --------------------------------------------------------
+void Game::UpdateBounds()
+{
+	while (culler->GetCount() < transforms->GetCount())
+		culler->Add();
+
+	world->ForEachChunk<Renderable>([&](unsigned int count, Entity*, Renderable* drawn)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int t = drawn[i].Transform;
+			if (transforms->WasChanged(t))
+				culler->SetBounds(t, drawn[i].MeshData->GetBoundsCenter(), drawn[i].MeshData->GetBoundsExtents(), *transforms->GetWorldMatrix(t));
+		}
+	});
+
+	// The static scene is built into the BVH the first time
+	// through, and only refit if something in it ever moves
+	bool building = sceneBVH->GetItemCount() == 0;
+	bool moved = false;
+	auto placeStatic = [&](unsigned int t, const XMFLOAT3& localCenter, const XMFLOAT3& localExtents)
+	{
+		if (!building && !transforms->WasChanged(t))
+			return;
+
+		XMFLOAT3 center, extents;
+		FrustumCuller::TransformBounds(localCenter, localExtents, *transforms->GetWorldMatrix(t), center, extents);
+		if (building) sceneBVH->AddItem(t, center, extents);
+		else moved |= sceneBVH->SetBounds(t, center, extents);
+	};
+
+	GameEntity* bath[] = { bathBottom, bathRight, bathLeft, bathBack, bathFront };
+	for (auto& piece : bath)
+		placeStatic(piece->GetTransform(), piece->GetMesh()->GetBoundsCenter(), piece->GetMesh()->GetBoundsExtents());
+	placeStatic(waterTransform, water->GetBoundsCenter(), water->GetBoundsExtents());
+
+	if (building) sceneBVH->Build();
+	else if (moved) sceneBVH->Refit();
+}
+
+// --------------------------------------------------------
+// Culls everything against the main camera, then again with
+// the refraction clip plane for the refraction pass.  The sky
+// surrounds the camera, so it is never culled.
+// --------------------------------------------------------
+void Game::CullViews(RenderSnapshot& frame)
+{
+	Frustum view = Frustum::FromMatrices(camera->GetView(), camera->GetProjection());
+	culler->Cull(view, frame.MainVisible);
+	sceneBVH->Cull(view, frame.MainVisible);
+	if (staticBatch)
+		staticBatch->Cull(view, frame.BatchVisible);
+	if (occlusionCulling)
+		OcclusionCull(frame);
+
+	// Same camera, but only what's below the water
+	view.AddPlane(GetRefractionClipPlane());
+	culler->Cull(view, frame.RefractionVisible);
+	sceneBVH->Cull(view, frame.RefractionVisible);
+}
+
+// --------------------------------------------------------
+// Rasterizes the bath walls on the CPU, then drops anything
+// in the main view that they completely hide.  The walls
+// are cubes, so their boxes are exact occluders.
+// --------------------------------------------------------
+void Game::OcclusionCull(RenderSnapshot& frame)
+{
+	occlusion->Begin(camera->GetView(), camera->GetProjection());
+
+	GameEntity* walls[] = { bathBottom, bathLeft, bathRight, bathBack, bathFront };
+	for (auto& wall : walls)
+		occlusion->AddOccluderBox(wall->GetMesh()->GetBoundsCenter(), wall->GetMesh()->GetBoundsExtents(), *wall->GetWorldMatrix());
+	occlusion->Rasterize();
+
+	// Items are transform handles, with bounds in whichever culler has them
+	occlusion->Cull(frame.MainVisible, [this](unsigned int t, XMFLOAT3& center, XMFLOAT3& extents)
+	{
+		return culler->GetWorldBounds(t, center, extents) || sceneBVH->GetBounds(t, center, extents);
+	});
+
+	if (staticBatch)
+	{
+		occlusion->Cull(frame.BatchVisible, [this](unsigned int chunk, XMFLOAT3& center, XMFLOAT3& extents)
+		{
+			center = staticBatch->GetChunk(chunk).Center;
+			extents = staticBatch->GetChunk(chunk).Extents;
+			return true;
+		});
+	}
+
+	frame.Occlusion = occlusion->GetStats();
+}
+
+// Clips everything above the water for the refraction texture
+XMFLOAT4 Game::GetRefractionClipPlane()
+{
+	return XMFLOAT4(0.0f, -1.0f, 0.0f, water->GetWaterHeight() + 0.1f);
+}
+
+
+// --------------------------------------------------------
+// Registers the shaders and materials the queue draws with
+// --------------------------------------------------------
+void Game::CreateRenderQueue()
+{
+	renderQueue = new RenderQueue(device, context);
+
+	// Entities sharing a mesh and material are instanced, as long
+	// as the instanced shader loaded.  The plain one draws them if
+	// the instance buffer can't be filled.
+	if (instancedVS->IsShaderValid())
+		litShaders = renderQueue->AddShaders(instancedVS, pixelShader, vertexShader);
+	else
+		litShaders = renderQueue->AddShaders(vertexShader, pixelShader);
+	refractionShaders = renderQueue->AddShaders(refractionVS, refractionPS);
+
+	// Each material binds its textures, the sky and the sampler
+	// in one call each
+	auto addMaterial = [&](SimplePixelShader* shader, ID3D11ShaderResourceView* texture, ID3D11ShaderResourceView* normalMap, XMFLOAT3 pointLight)
+	{
+		Material* material = new Material(shader);
+		material->SetShaderResourceView("Texture", texture);
+		material->SetShaderResourceView("NormalMap", normalMap);
+		material->SetShaderResourceView("Sky", skySRV);
+		material->SetSamplerState("Sampler", sampler);
+		material->SetFloat3("PointLightPosition", pointLight);
+		return renderQueue->AddMaterial(material);
+	};
+	groundMaterial = addMaterial(pixelShader, textureSRV, normalMapSRV, XMFLOAT3(0.3f, 0, 0));
+	bathMaterial = addMaterial(pixelShader, bathSRV, bathNormalMapSRV, XMFLOAT3(3, 0, 0));
+	bathRefractionMaterial = addMaterial(refractionPS, bathSRV, bathNormalMapSRV, XMFLOAT3(0.5f, 0, 0));
+}
+
+// --------------------------------------------------------
+// Submits every visible lit entity for this frame's passes
+// --------------------------------------------------------
+void Game::QueueDraws()
+{
+	renderQueue->Clear();
+	RenderSnapshot& frame = snapshots[drawSnapshot];
+
+	// Once batched, the ground and bath are drawn as chunks instead
+	bool batched = staticBatch && staticBatch->GetChunkCount() > 0;
+
+	GameEntity* ge = entities[currentEntity];
+	if (!(batched && ge == ground) && IsVisible(frame.MainVisible, ge))
+		renderQueue->Submit(RENDER_PASS_OPAQUE, litShaders, groundMaterial, ge->GetMesh(), GetDrawMatrix(ge), GetViewDepth(ge));
+
+	if (batched)
+	{
+		for (unsigned int i = 0; i < staticBatch->GetChunkCount(); i++)
+		{
+			StaticChunk& chunk = staticBatch->GetChunk(i);
+			if (frame.BatchVisible.IsVisible(i))
+				renderQueue->Submit(RENDER_PASS_OPAQUE, litShaders, chunk.Material, chunk.MeshData, staticBatch->GetWorldMatrix(), GetViewDepth(chunk.Center));
+		}
+	}
+	else
+	{
+		GameEntity* bath[] = { bathBottom, bathLeft, bathRight, bathBack, bathFront };
+		for (auto& piece : bath)
+		{
+			if (IsVisible(frame.MainVisible, piece))
+				renderQueue->Submit(RENDER_PASS_OPAQUE, litShaders, bathMaterial, piece->GetMesh(), GetDrawMatrix(piece), GetViewDepth(piece));
+		}
+	}
+
+	// Only the bottom of the bath shows through the water
+	if (IsVisible(frame.RefractionVisible, bathBottom))
+		renderQueue->Submit(RENDER_PASS_REFRACTION, refractionShaders, bathRefractionMaterial, bathBottom->GetMesh(), GetDrawMatrix(bathBottom), GetViewDepth(bathBottom));
+
+	renderQueue->Sort();
+}
+
+// Squared distance from the camera, for sorting front to back
+float Game::GetViewDepth(const XMFLOAT3& position)
+{
+	XMFLOAT3 eye = snapshots[drawSnapshot].CameraPosition;
+	float x = position.x - eye.x;
+	float y = position.y - eye.y;
+	float z = position.z - eye.z;
+	return x * x + y * y + z * z;
+}
+
+float Game::GetViewDepth(GameEntity* entity)
+{
+	// Translation is the last column of the transposed matrix
+	XMFLOAT4X4* world = GetDrawMatrix(entity);
+	return GetViewDepth(XMFLOAT3(world->_14, world->_24, world->_34));
+}
+
+// --------------------------------------------------------
+// Pre-transforms the ground and bath into world space and
+// merges them into one mesh per material.  Needs their world
+// matrices, so this runs after they're first updated.  If any
+// piece can't be batched they're all drawn one by one instead.
+// --------------------------------------------------------
+void Game::BuildStaticBatch()
+{
+	staticBatch = new StaticBatch(jobs);
+
+	// Each scene mesh becomes a source the first time it's used
+	std::vector<unsigned int> sources(sceneMeshes.size(), SceneNone);
+	auto addInstance = [&](GameEntity* entity, unsigned int material) -> bool
+	{
+		for (unsigned int m = 0; m < sceneMeshes.size(); m++)
+		{
+			Asset* asset = sceneMeshes[m];
+			if (asset->MeshData != entity->GetMesh() || asset->Vertices.empty())
+				continue;
+
+			if (sources[m] == SceneNone)
+			{
+				sources[m] = staticBatch->AddSource(
+					&asset->Vertices[0], (unsigned int)asset->Vertices.size(),
+					&asset->Indices[0], (unsigned int)asset->Indices.size());
+			}
+			staticBatch->AddInstance(sources[m], material, *entity->GetWorldMatrix());
+			return true;
+		}
+		return false;
+	};
+
+	bool complete = addInstance(ground, groundMaterial);
+
+	GameEntity* bath[] = { bathBottom, bathLeft, bathRight, bathBack, bathFront };
+	for (auto& piece : bath)
+		complete = addInstance(piece, bathMaterial) && complete;
+
+	complete = staticBatch->Build(device, 10.0f) && complete;
+
+	// The batch has its own copy now
+	for (auto& asset : sceneMeshes)
+		assets->ReleaseGeometry(asset);
+
+	if (!complete)
+	{
+		printf("Static batch couldn't be built - drawing the ground and bath one by one\n");
+		delete staticBatch;
+		staticBatch = 0;
+	}
+}
+
+// Draw calls, state changes and sort time for the title bar
+std::string Game::GetDebugStats()
+{
+	if (!renderQueue)
+		return "";
+
+	RenderStats& stats = renderQueue->GetStats();
+	std::ostringstream output;
+	output.precision(3);
+	output <<
+		"    Draws: "			<< stats.Draws <<
+		"    Instances: "		<< stats.Instances <<
+		"    State Changes: "	<< stats.GetStateChanges() <<
+		"    Sort: "			<< stats.SortMilliseconds << "ms";
+	if (stats.Rejected > 0)
+		output << "    Rejected: " << stats.Rejected;
+
+	RenderSnapshot& frame = snapshots[drawSnapshot];
+	output << "    Update: " << frame.UpdateMilliseconds << "ms";
+
+	SimpleShaderStats& uploads = ISimpleShader::GetStats();
+	output <<
+		"    CB Uploads: "		<< uploads.Uploads <<
+		" (" << uploads.BytesUploaded << " bytes, " << uploads.UploadsSkipped << " skipped)";
+
+	StateCacheStats& binds = StateCache::Get(context)->GetStats();
+	output << "    Binds Filtered: " << binds.Filtered << "/" << binds.Calls;
+
+	if (occlusionCulling)
+	{
+		OcclusionStats& occluded = frame.Occlusion;
+		output <<
+			"    Occluded: "		<< occluded.Rejected << "/" << occluded.Tested <<
+			"    Raster: "			<< occluded.RasterMilliseconds << "ms";
+	}
+	return output.str();
+}
+
+void Game::OnResize()
+{
+	// Handle base-level DX resize stuff
+	DXCore::OnResize();
+
+	// Update the projection matrix assuming the
+	// camera exists (and isn't in use by an update)
+	WaitForUpdate();
+	if( camera ) 
+		camera->UpdateProjectionMatrix((float)width / height);
+}
+
+void Game::Update(float deltaTime, float totalTime)
+{
+	// Quit if the escape key is pressed
+	if (GetAsyncKeyState(VK_ESCAPE))
+		Quit();
+
+	// Mouse movement is saved up here, so the camera is only
+	// ever touched by the update
+	XMFLOAT2 rotation = pendingRotation;
+	pendingRotation = XMFLOAT2(0, 0);
+
+	WaitForUpdate();
+	if (!pipelined)
+	{
+		UpdateScene(deltaTime, rotation, snapshots[drawSnapshot]);
+		return;
+	}
+
+	// Draw what the last update made, and make the next one
+	// in the other snapshot while that happens
+	drawSnapshot ^= 1;
+	unsigned int next = drawSnapshot ^ 1;
+	jobs->Run([this, deltaTime, rotation, next]() { UpdateScene(deltaTime, rotation, snapshots[next]); }, &updateJob);
+}
+
+// --------------------------------------------------------
+// Moves the camera and scene along one frame, then fills a
+// snapshot with everything the draw needs.  When pipelined
+// this runs on a worker, so it mustn't touch the context.
+// --------------------------------------------------------
+void Game::UpdateScene(float deltaTime, XMFLOAT2 rotation, RenderSnapshot& frame)
+{
+	LARGE_INTEGER start, end, frequency;
+	QueryPerformanceCounter(&start);
+
+	// Update the camera
+	if (rotation.x != 0 || rotation.y != 0)
+		camera->Rotate(rotation.y, rotation.x);
+	camera->Update(deltaTime);
+	camera->UpdateReflectionViewMatrix(water->GetWaterHeight());
+
+	// Rebuild the world matrices of anything that moved
+	transforms->UpdateWorldMatrices(jobs);
+
+	// Work out what each view can see
+	UpdateBounds();
+	CullViews(frame);
+
+	//Do water frame processing
+	water->Update();
+
+	// Draw() blends between where things were and where they are
+	frame.Projection = camera->GetProjection();
+	frame.Previous = lastState;
+	frame.Current = CaptureState();
+	lastState = frame.Current;
+	BlendSnapshot(frame, 1.0f);
+	transforms->CopyWorldMatrices(frame.WorldMatrices);
+
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+	frame.UpdateMilliseconds = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+}
+
+void Game::WaitForUpdate()
+{
+	if (jobs)
+		jobs->Wait(&updateJob);
+}
+
+SimulationState Game::CaptureState()
+{
+	SimulationState state;
+	state.CameraPosition = camera->GetPosition();
+	state.CameraRotation = camera->GetRotation();
+	state.ReflectionView = camera->GetReflectionView();
+	state.WaterTranslation = water->GetWaterTranslation();
+	return state;
+}
+
+// --------------------------------------------------------
+// Fills in the camera and water for a point between the
+// snapshot's last two updates.  World matrices aren't blended -
+// nothing in the scene moves on its own yet.
+// --------------------------------------------------------
+void Game::BlendSnapshot(RenderSnapshot& frame, float alpha)
+{
+	SimulationState& from = frame.Previous;
+	SimulationState& to = frame.Current;
+
+	XMStoreFloat3(&frame.CameraPosition, XMVectorLerp(XMLoadFloat3(&from.CameraPosition), XMLoadFloat3(&to.CameraPosition), alpha));
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionSlerp(XMLoadFloat4(&from.CameraRotation), XMLoadFloat4(&to.CameraRotation), alpha));
+	frame.View = Camera::BuildViewMatrix(frame.CameraPosition, rotation);
+
+	// The reflection always looks the same way and only its
+	// position moves, so blending the matrices is exact
+	XMMATRIX reflection = XMLoadFloat4x4(&from.ReflectionView);
+	XMMATRIX reflectionTo = XMLoadFloat4x4(&to.ReflectionView);
+	for (int row = 0; row < 4; row++)
+		reflection.r[row] = XMVectorLerp(reflection.r[row], reflectionTo.r[row], alpha);
+	XMStoreFloat4x4(&frame.ReflectionView, reflection);
+
+	// The water's offset wraps from 1 back to 0
+	float step = to.WaterTranslation - from.WaterTranslation;
+	if (step < 0)
+		step += 1.0f;
+	frame.WaterTranslation = from.WaterTranslation + step * alpha;
+	if (frame.WaterTranslation > 1.0f)
+		frame.WaterTranslation -= 1.0f;
+}
+
+
+void Game::Draw(float deltaTime, float totalTime, float alpha)
+{
+	// Background color for clearing
+	const float color[4] = {1,1,1,1};
+
+	// Place the camera and water between the last two updates
+	BlendSnapshot(snapshots[drawSnapshot], alpha);
+
+	// Constant buffer upload and bind counts are per frame
+	ISimpleShader::ResetStats();
+	StateCache* state = StateCache::Get(context);
+	state->ResetStats();
+	RenderBackend* backend = RenderBackend::Get(context);
+	backend->ResetStats();
+
+	// Render targets change below, and D3D unbinds any of their
+	// textures still bound as SRVs, so start from a clean slate
+	state->Invalidate();
+
+	// Sort this frame's draws for every pass
+	QueueDraws();
+
+	// Render the refraction of the scene to a texture.
+	RenderRefractionToTexture();
+
+	// Render the reflection of the scene to a texture.
+	//RenderReflectionToTexture();
+
+	// Clear the render target and depth buffer (erases what's on the screen)
+	//  - Do this ONCE PER FRAME
+	//  - At the beginning of Draw (before drawing *anything*)
+	backend->ClearRenderTarget(backBufferRTV, color);
+	backend->ClearDepthStencil(
+		depthStencilView,
+		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
+		1.0f,
+		0);
+
+	
+
+
+	/********************************************************************/
+	// Draw the sky ------------------------
+	ID3D11Buffer* vb = skyMesh->GetVertexBuffer();
+	ID3D11Buffer* ib = skyMesh->GetIndexBuffer();
+
+	// Set buffers in the input assembler
+	state->SetVertexBuffers(0, 1, &vb, &stride, &offset);
+	state->SetIndexBuffer(ib, DXGI_FORMAT_R32_UINT, 0);
+
+	// Set up the sky shaders
+	RenderSnapshot& frame = snapshots[drawSnapshot];
+	SkyVS_perFrame skyFrame = {};
+	skyFrame.view = frame.View;
+	skyFrame.projection = frame.Projection;
+	SetBufferStruct(skyVS, skyFrameVS, skyFrame);
+	skyVS->CopyAllBufferData();
+	skyVS->SetShader();
+
+	skyPS->SetShaderResourceView("Sky", skySRV);
+	skyPS->CopyAllBufferData();
+	skyPS->SetShader();
+
+	backend->SetRasterizerState(rsSky);
+	backend->SetDepthStencilState(dsSky, 0);
+	backend->DrawIndexed(skyMesh->GetIndexCount(), 0, 0);
+
+	// Reset the render states we've changed
+	backend->SetRasterizerState(0);
+	backend->SetDepthStencilState(0, 0);
+
+	/******************************************************************/
+	//Draw the ground and bath -------------------------------
+	VertexShader_perFrame vsFrame = {};
+	vsFrame.view = frame.View;
+	vsFrame.projection = frame.Projection;
+	SetBufferStruct(vertexShader, litFrameVS, vsFrame);
+	if (instancedVS->IsShaderValid())
+		SetBufferStruct(instancedVS, instancedFrameVS, vsFrame);
+
+	SetBufferStruct(pixelShader, litFramePS, GetLightData(frame));
+
+	renderQueue->Draw(RENDER_PASS_OPAQUE);
+
+
+	/**********************************************************************/
+	//Draw water ---------------------------------------------------
+	if (frame.MainVisible.IsVisible(waterTransform))
+	{
+		water->Render(context);
+
+		//waterVS->SetMatrix4x4("world", worldMatrix1);
+		//waterVS->SetMatrix4x4("view", camera->GetView());
+		//waterVS->SetMatrix4x4("projection", camera->GetProjection());
+		//waterVS->SetMatrix4x4("reflection", camera->GetReflectionView() );
+		//waterVS->SetFloat3("CameraPosition", camera->GetPosition());
+		//waterVS->SetFloat2("normalMapTiling", water->GetNormalMapTiling());
+		//waterVS->CopyAllBufferData();
+		//waterVS->SetShader();
+		//waterPS->SetShaderResourceView("reflectionTexture", skySRV);
+		//waterPS->SetShaderResourceView("refractionTexture", _refractionTexture->GetShaderResourceView());
+		//waterPS->SetShaderResourceView("normalTexture", water->GetTexture());
+		//waterPS->SetSamplerState("SampleType", sampler);
+		//waterPS->SetFloat("WaterTranslation", water->GetWaterTranslation());
+		//waterPS->SetFloat("reflectRefractScale", water->GetReflectRefractScale());
+		//waterPS->SetFloat4("refractionTint", water->GetRefractionTint());
+		////waterPS->SetFloat3("lightDirection", XMFLOAT3(1, 0, 0));
+		//waterPS->SetFloat3("CameraPosition", camera->GetPosition());
+		//waterPS->SetFloat("WaterTranslation", water->GetWaterTranslation());
+		//waterPS->SetFloat("reflectRefractScale", water->GetReflectRefractScale());
+		//waterPS->SetFloat("specularShininess", water->GetSpecularShininess());
+		//
+		//waterPS->CopyAllBufferData();
+		//waterPS->SetShader();
+	
+		//context->IASetVertexBuffers(0, 1, , &stride, &offset);
+		//context->IASetIndexBuffer(waterIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		//context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		waterVS->SetMatrix4x4(SHADER_KEY("world"), frame.WorldMatrices[waterTransform]);
+		waterVS->SetMatrix4x4(SHADER_KEY("view"), frame.View);
+		waterVS->SetMatrix4x4(SHADER_KEY("projection"), frame.Projection);
+		waterVS->SetMatrix4x4(SHADER_KEY("reflection"), frame.ReflectionView);
+
+		waterVS->CopyAllBufferData();
+		waterVS->SetShader();
+
+		waterPS->SetFloat4(SHADER_KEY("DirLightColor"), XMFLOAT4(0.8f, 0.8f, 0.8f, 1));
+		waterPS->SetFloat3(SHADER_KEY("DirLightDirection"), XMFLOAT3(1, 0, 0));
+		waterPS->SetFloat4(SHADER_KEY("PointLightColor"), XMFLOAT4(0.3, 0.3f, 0.3f, 1));
+		waterPS->SetFloat3(SHADER_KEY("PointLightPosition"), XMFLOAT3(3, 0, 0));
+		waterPS->SetFloat3(SHADER_KEY("CameraPosition"), frame.CameraPosition);
+
+		waterPS->SetFloat(SHADER_KEY("waterTranslation"), frame.WaterTranslation);
+
+		waterPS->SetShaderResourceView("reflectionTexture", skySRV);
+		waterPS->SetShaderResourceView("refractionTexture",bathSRV);
+		waterPS->SetShaderResourceView("NormalMap", water->GetTexture());
+		waterPS->SetShaderResourceView("Sky", skySRV);
+		waterPS->SetSamplerState("Sampler", sampler);
+	
+		waterPS->CopyAllBufferData();
+		waterPS->SetShader();
+
+	
+		backend->DrawIndexed(water->GetIndexCount(),0,0);
+	}
+	//	
+
+
+	/******************************************************************/
+
+
+
+
+	
+	
+
+	// Nothing to present to when running headless
+	if (swapChain)
+		swapChain->Present(0, 0);
+}
+
+
+#pragma region Mouse Input
+
+// --------------------------------------------------------
+// Helper method for mouse clicking.  We get this information
+// from the OS-level messages anyway, so these helpers have
+// been created to provide basic mouse input if you want it.
+// --------------------------------------------------------
+void Game::OnMouseDown(WPARAM buttonState, int x, int y)
+{
+	// Add any custom code here...
+
+	// Save the previous mouse position, so we have it for the future
+	prevMousePos.x = x;
+	prevMousePos.y = y;
+
+	// Caputure the mouse so we keep getting mouse move
+	// events even if the mouse leaves the window.  we'll be
+	// releasing the capture once a mouse button is released
+	SetCapture(hWnd);
+}
+
+// --------------------------------------------------------
+// Helper method for mouse release
+// --------------------------------------------------------
+void Game::OnMouseUp(WPARAM buttonState, int x, int y)
+{
+	// Add any custom code here...
+
+	// We don't care about the tracking the cursor outside
+	// the window anymore (we're not dragging if the mouse is up)
+	ReleaseCapture();
+}
+
+// --------------------------------------------------------
+// Helper method for mouse movement.  We only get this message
+// if the mouse is currently over the window, or if we're 
+// currently capturing the mouse.
+// --------------------------------------------------------
+void Game::OnMouseMove(WPARAM buttonState, int x, int y)
+{
+	// Check left mouse button
+	if (buttonState & 0x0001)
+	{
+		float xDiff = (x - prevMousePos.x) * 0.005f;
+		float yDiff = (y - prevMousePos.y) * 0.005f;
+		pendingRotation.x += xDiff;
+		pendingRotation.y += yDiff;
+	}
+
+	// Save the previous mouse position, so we have it for the future
+	prevMousePos.x = x;
+	prevMousePos.y = y;
+}
+
+// --------------------------------------------------------
+// Helper method for mouse wheel scrolling.  
+// WheelDelta may be positive or negative, depending 
+// on the direction of the scroll
+// --------------------------------------------------------
+void Game::OnMouseWheel(float wheelDelta, int x, int y)
+{
+	// Add any custom code here...
+}
 #pragma endregion
\ No newline at end of file
@@ -1,111 +1,259 @@
-#pragma once
-
-#include "DXCore.h"
-#include "SimpleShader.h"
-#include <DirectXMath.h>
-
-#include "Camera.h"
-#include "Mesh.h"
-#include "GameEntity.h"
-#include "RenderTexture.h"
-#include "Water.h"
-
-class Game 
-	: public DXCore
-{
-
-public:
-	Game(HINSTANCE hInstance);
-	~Game();
-
-	// Overridden setup and game loop methods, which
-	// will be called automatically
-	void Init();
-	void OnResize();
-	void Update(float deltaTime, float totalTime);
-	void Draw(float deltaTime, float totalTime);
-
-	// Overridden mouse input helper methods
-	void OnMouseDown (WPARAM buttonState, int x, int y);
-	void OnMouseUp	 (WPARAM buttonState, int x, int y);
-	void OnMouseMove (WPARAM buttonState, int x, int y);
-	void OnMouseWheel(float wheelDelta,   int x, int y);
-private:
-
-
-
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-
-
-	// Input and mesh swapping
-	bool prevTab;
-	unsigned int currentEntity;
-
-	// Keep track of "stuff" to clean up
-	std::vector<Mesh*> meshes;
-	std::vector<GameEntity*> entities;
-	Camera* camera;
-
-	// Initialization helper methods - feel free to customize, combine, etc.
-	void LoadShaders(); 
-	void CreateMatrices();
-	void CreateBasicGeometry();
-
-	//Water stuff
-	Mesh* waterMesh;
-	//GameEntity* water;
-	Water* water;
-	GameEntity* bathBottom;
-	GameEntity* bathRight;
-	GameEntity* bathLeft;
-	GameEntity* bathBack;
-	GameEntity* bathFront;
-
-	SimpleVertexShader* waterVS;
-	SimplePixelShader* waterPS;
-	SimpleVertexShader* refractionVS;
-	SimplePixelShader* refractionPS;
-
-	RenderTexture* _refractionTexture;
-	RenderTexture* _reflectionTexture;
-
-	bool RenderRefractionToTexture();
-	bool RenderReflectionToTexture();
-
-
-	// Texture related DX stuff
-	ID3D11ShaderResourceView* textureSRV;
-	ID3D11ShaderResourceView* normalMapSRV;
-	ID3D11ShaderResourceView* waterNormalMapSRV;
-	ID3D11ShaderResourceView* bathSRV;
-	ID3D11ShaderResourceView* bathNormalMapSRV;
-	ID3D11SamplerState* sampler;
-
-	// Sky stuff
-	ID3D11ShaderResourceView* skySRV;
-	SimpleVertexShader* skyVS;
-	SimplePixelShader* skyPS;
-	ID3D11RasterizerState* rsSky;
-	ID3D11DepthStencilState* dsSky;
-
-	// Buffers to hold actual geometry data
-	ID3D11Buffer* vertexBuffer;
-	ID3D11Buffer* indexBuffer;
-
-	// Wrappers for DirectX shaders to provide simplified functionality
-	SimpleVertexShader* vertexShader;
-	SimplePixelShader* pixelShader;
-
-	// The matrices to go from model space to screen space
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 viewMatrix;
-	DirectX::XMFLOAT4X4 projectionMatrix;
-
-	DirectX::XMFLOAT4X4 worldMatrix1;
-
-	// Keeps track of the old mouse position.  Useful for 
-	// determining how far the mouse moved in a single frame.
-	POINT prevMousePos;
-};
-
+#pragma once
+
+#include "DXCore.h"
+#include "SimpleShader.h"
+#include <DirectXMath.h>
+
+#include "Camera.h"
+#include "Mesh.h"
+#include "GameEntity.h"
+#include "RenderTexture.h"
+#include "Water.h"
+#include "AssetRegistry.h"
+#include "JobSystem.h"
+#include "FrustumCuller.h"
+#include "BVH.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "StaticBatch.h"
+#include "Scene.h"
+#include "EntityWorld.h"
+#include "ShaderArchive.h"
+#include "ShaderPermutations.h"
+
+// --------------------------------------------------------
+// Components for entities kept in the EntityWorld
+// --------------------------------------------------------
+struct Renderable
+{
+	Mesh* MeshData;
+	unsigned int Transform;
+};
+
+// --------------------------------------------------------
+// The camera and water after one update.  With a fixed
+// timestep, Draw() blends between two of these.
+// --------------------------------------------------------
+struct SimulationState
+{
+	DirectX::XMFLOAT3 CameraPosition;
+	DirectX::XMFLOAT4 CameraRotation;
+	DirectX::XMFLOAT4X4 ReflectionView;
+	float WaterTranslation;
+};
+
+// --------------------------------------------------------
+// Everything Draw() reads from one update.  There are two, so
+// the next update can fill one while the other is drawn.
+// --------------------------------------------------------
+struct RenderSnapshot
+{
+	// Blended from Previous and Current by Draw()
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 ReflectionView;
+	DirectX::XMFLOAT3 CameraPosition;
+	float WaterTranslation;
+
+	SimulationState Previous;
+	SimulationState Current;
+	DirectX::XMFLOAT4X4 Projection;
+
+	std::vector<DirectX::XMFLOAT4X4> WorldMatrices;	// By transform handle
+	CullResult MainVisible;
+	CullResult RefractionVisible;
+	CullResult BatchVisible;			// Static batch chunks
+
+	OcclusionStats Occlusion;
+	double UpdateMilliseconds;
+};
+
+class Game 
+	: public DXCore
+{
+
+public:
+	// headless - No debug console window, for the command line
+	//            modes that print to the parent's console
+	Game(HINSTANCE hInstance, bool headless = false);
+	~Game();
+
+	// Overridden setup and game loop methods, which
+	// will be called automatically
+	void Init();
+	void OnResize();
+	void Update(float deltaTime, float totalTime);
+	void Draw(float deltaTime, float totalTime, float alpha);
+
+	// Overridden mouse input helper methods
+	void OnMouseDown (WPARAM buttonState, int x, int y);
+	void OnMouseUp	 (WPARAM buttonState, int x, int y);
+	void OnMouseMove (WPARAM buttonState, int x, int y);
+	void OnMouseWheel(float wheelDelta,   int x, int y);
+
+	std::string GetDebugStats();
+
+	// Times loading the shaders with and without the
+	// reflection cache, instead of running the game
+	HRESULT BenchmarkShaders(unsigned int rounds);
+private:
+
+
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+
+
+	// Input and mesh swapping
+	bool prevTab;
+	unsigned int currentEntity;
+
+	// Worker threads for updates and asset loading
+	JobSystem* jobs;
+
+	// Shared meshes and textures, loaded in the background
+	AssetRegistry* assets;
+
+	// The scene layout, only kept around during Init().  Its
+	// meshes and textures are indexed the same way as the scene's.
+	Scene* scene;
+	std::vector<Asset*> sceneMeshes;
+	std::vector<Asset*> sceneTextures;
+	bool LoadScene(const char* name);
+	ID3D11ShaderResourceView* GetSceneTexture(unsigned int texture);
+
+	// Keep track of "stuff" to clean up
+	Mesh* skyMesh;
+	std::vector<GameEntity*> entities;
+	TransformStore* transforms;
+
+	// Everything in the entity list is also in the world, so
+	// per-entity updates can run as chunk queries
+	EntityWorld* world;
+	Camera* camera;
+
+	// Initialization helper methods - feel free to customize, combine, etc.
+	double LoadShaders(bool reflectionCache = true);
+	void ReleaseShaders();
+	void CreateMatrices();
+	void LoadAssets();
+	void CreateBasicGeometry();
+
+	//Water stuff
+	Mesh* waterMesh;
+	//GameEntity* water;
+	Water* water;
+	GameEntity* ground;
+	unsigned int bathTransform;	// Parent of all five bath pieces
+	unsigned int waterTransform;
+	GameEntity* bathBottom;
+	GameEntity* bathRight;
+	GameEntity* bathLeft;
+	GameEntity* bathBack;
+	GameEntity* bathFront;
+
+	SimpleVertexShader* waterVS;
+	SimplePixelShader* waterPS;
+	SimpleVertexShader* refractionVS;	// From permutations, like the lit shaders
+	SimplePixelShader* refractionPS;
+
+	RenderTexture* _refractionTexture;
+	RenderTexture* _reflectionTexture;
+
+	bool RenderRefractionToTexture();
+	bool RenderReflectionToTexture();
+	DirectX::XMFLOAT4 GetRefractionClipPlane();
+
+	// Visibility - culling items share their index with transform handles.
+	// Entities that move are culled one by one, the static bath and
+	// water go through the BVH.
+	FrustumCuller* culler;
+	BVH* sceneBVH;
+	void UpdateBounds();
+	void CullViews(RenderSnapshot& frame);
+	bool IsVisible(CullResult& view, GameEntity* entity) { return view.IsVisible(entity->GetTransform()); }
+
+	// The bath walls hide whatever's behind them from the main view
+	bool occlusionCulling;
+	OcclusionCuller* occlusion;
+	void OcclusionCull(RenderSnapshot& frame);
+
+	// With pipelining on, the next frame's update runs as a job
+	// while this frame is drawn from the snapshot before it
+	bool pipelined;
+	RenderSnapshot snapshots[2];
+	unsigned int drawSnapshot;			// The one Draw() reads
+	JobCounter updateJob;
+	DirectX::XMFLOAT2 pendingRotation;	// Mouse movement since the last update
+	void UpdateScene(float deltaTime, DirectX::XMFLOAT2 rotation, RenderSnapshot& frame);
+	void WaitForUpdate();
+
+	// The state the last update ended on, so the next one
+	// knows where it started from
+	SimulationState lastState;
+	SimulationState CaptureState();
+	void BlendSnapshot(RenderSnapshot& frame, float alpha);
+	DirectX::XMFLOAT4X4* GetDrawMatrix(GameEntity* entity) { return &snapshots[drawSnapshot].WorldMatrices[entity->GetTransform()]; }
+
+	// Lit entities are drawn through the queue, sorted by state
+	RenderQueue* renderQueue;
+	unsigned int litShaders;
+	unsigned int refractionShaders;
+
+	// Per-frame buffers, set whole from ShaderStructs.h
+	SimpleBufferHandle litFrameVS;
+	SimpleBufferHandle instancedFrameVS;
+	SimpleBufferHandle refractionFrameVS;
+	SimpleBufferHandle litFramePS;
+	SimpleBufferHandle skyFrameVS;
+	unsigned int groundMaterial;
+	unsigned int bathMaterial;
+	unsigned int bathRefractionMaterial;
+	void CreateRenderQueue();
+	void QueueDraws();
+	float GetViewDepth(const DirectX::XMFLOAT3& position);
+	float GetViewDepth(GameEntity* entity);
+
+	// The ground and bath never move, so they can be merged
+	bool batchStatic;
+	StaticBatch* staticBatch;
+	void BuildStaticBatch();
+
+
+	// Texture related DX stuff
+	ID3D11ShaderResourceView* textureSRV;
+	ID3D11ShaderResourceView* normalMapSRV;
+	ID3D11ShaderResourceView* waterNormalMapSRV;
+	ID3D11ShaderResourceView* bathSRV;
+	ID3D11ShaderResourceView* bathNormalMapSRV;
+	ID3D11SamplerState* sampler;
+
+	// Sky stuff
+	ID3D11ShaderResourceView* skySRV;
+	SimpleVertexShader* skyVS;
+	SimplePixelShader* skyPS;
+	ID3D11RasterizerState* rsSky;
+	ID3D11DepthStencilState* dsSky;
+
+	// Buffers to hold actual geometry data
+	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+
+	// Wrappers for DirectX shaders to provide simplified functionality
+	// - The lit shaders belong to the permutations
+	SimpleVertexShader* vertexShader;
+	SimpleVertexShader* instancedVS;	// Same, with per-instance world matrices
+	SimplePixelShader* pixelShader;
+	ShaderPermutations* permutations;
+	ShaderArchive* shaderArchive;	// Must outlive every shader, since they use its bytes
+
+	// The matrices to go from model space to screen space
+	DirectX::XMFLOAT4X4 worldMatrix;
+	DirectX::XMFLOAT4X4 viewMatrix;
+	DirectX::XMFLOAT4X4 projectionMatrix;
+
+
+	// Keeps track of the old mouse position.  Useful for 
+	// determining how far the mouse moved in a single frame.
+	POINT prevMousePos;
+};
+
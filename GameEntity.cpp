@@ -1,32 +1,24 @@
-#include "GameEntity.h"
-
-using namespace DirectX;
-
-GameEntity::GameEntity(Mesh* mesh)
-{
-	// Save the mesh
-	this->mesh = mesh;
-
-	// Set up transform
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	position = XMFLOAT3(0, 0, 0);
-	rotation = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
-}
-
-GameEntity::~GameEntity(void)
-{
-}
-
-// Update the world matrix
-void GameEntity::UpdateWorldMatrix()
-{
-	XMMATRIX trans = XMMatrixTranslation(position.x, position.y, position.z);
-	XMMATRIX rotX = XMMatrixRotationX(rotation.x);
-	XMMATRIX rotY = XMMatrixRotationY(rotation.y);
-	XMMATRIX rotZ = XMMatrixRotationZ(rotation.z);
-	XMMATRIX sc = XMMatrixScaling(scale.x, scale.y, scale.z);
-
-	XMMATRIX total = sc * rotZ * rotY * rotX * trans;
-	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(total));
-}
+#include "GameEntity.h"
+
+using namespace DirectX;
+
+GameEntity::GameEntity(Mesh* mesh, TransformStore* transforms)
+{
+	// Save the mesh
+	this->mesh = mesh;
+
+	// Grab an identity transform from the store
+	this->transforms = transforms;
+	transform = transforms->Create();
+}
+
+GameEntity::GameEntity(Mesh* mesh, TransformStore* transforms, unsigned int transform)
+{
+	this->mesh = mesh;
+	this->transforms = transforms;
+	this->transform = transform;
+}
+
+GameEntity::~GameEntity(void)
+{
+}
@@ -1,34 +1,42 @@
-#pragma once
-
-#include <DirectXMath.h>
-#include "Mesh.h"
-
-class GameEntity
-{
-public:
-	GameEntity(Mesh* mesh);
-
-	~GameEntity(void);
-
-	void UpdateWorldMatrix();
-
-	void Move(float x, float y, float z)		{ position.x += x;	position.y += y;	position.z += z; }
-	void Rotate(float x, float y, float z)		{ rotation.x += x;	rotation.y += y;	rotation.z += z; }
-
-	void SetPosition(float x, float y, float z) { position.x = x;	position.y = y;		position.z = z; }
-	void SetRotation(float x, float y, float z) { rotation.x = x;	rotation.y = y;		rotation.z = z; }
-	void SetScale(float x, float y, float z)	{ scale.x = x;		scale.y = y;		scale.z = z;	}
-
-	Mesh* GetMesh() { return mesh; }
-	DirectX::XMFLOAT4X4* GetWorldMatrix() { return &worldMatrix; }
-private:
-
-	Mesh* mesh;
-
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 rotation;
-	DirectX::XMFLOAT3 scale;
-
-};
-
+#pragma once
+
+#include <DirectXMath.h>
+#include "Mesh.h"
+#include "TransformStore.h"
+
+// --------------------------------------------------------
+// A mesh plus a handle into the shared TransformStore.
+// The transform data itself lives in the store.
+// --------------------------------------------------------
+class GameEntity
+{
+public:
+	GameEntity(Mesh* mesh, TransformStore* transforms);
+
+	// Uses a transform that's already in the store, like one a scene made
+	GameEntity(Mesh* mesh, TransformStore* transforms, unsigned int transform);
+
+	~GameEntity(void);
+
+	void Move(float x, float y, float z)		{ transforms->Move(transform, x, y, z); }
+	void Rotate(float x, float y, float z)		{ transforms->Rotate(transform, x, y, z); }
+
+	void SetPosition(float x, float y, float z) { transforms->SetPosition(transform, x, y, z); }
+	void SetRotation(float x, float y, float z) { transforms->SetRotation(transform, x, y, z); }
+	void SetScale(float x, float y, float z)	{ transforms->SetScale(transform, x, y, z); }
+
+	// Makes this entity's transform relative to another transform
+	bool SetParent(unsigned int parentTransform) { return transforms->SetParent(transform, parentTransform); }
+
+	Mesh* GetMesh() { return mesh; }
+	unsigned int GetTransform() { return transform; }
+	DirectX::XMFLOAT4X4* GetWorldMatrix() { return transforms->GetWorldMatrix(transform); }
+private:
+
+	Mesh* mesh;
+
+	TransformStore* transforms;
+	unsigned int transform;
+
+};
+
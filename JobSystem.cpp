@@ -0,0 +1,347 @@
+#include "JobSystem.h"
+
+// Which system and worker the current thread belongs to, if any
+static thread_local JobSystem* currentSystem = 0;
+static thread_local unsigned int currentWorker = 0;
+
+static const unsigned int NoWorker = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Chase-Lev deque, following "Correct and Efficient Work-Stealing
+// for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli)
+// --------------------------------------------------------
+JobDeque::JobDeque()
+{
+	top = 0;
+	bottom = 0;
+	for (long long i = 0; i < Capacity; i++)
+		jobs[i].store(0, std::memory_order_relaxed);
+}
+
+bool JobDeque::Push(Job* job)
+{
+	long long b = bottom.load(std::memory_order_relaxed);
+	long long t = top.load(std::memory_order_acquire);
+	if (b - t >= Capacity)
+		return false;
+
+	jobs[b & (Capacity - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job* JobDeque::Pop()
+{
+	long long b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long t = top.load(std::memory_order_relaxed);
+
+	// Empty
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	Job* job = jobs[b & (Capacity - 1)].load(std::memory_order_relaxed);
+
+	// Last job - race any thieves for it
+	if (t == b)
+	{
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = 0;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+Job* JobDeque::Steal()
+{
+	long long t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return 0;
+
+	Job* job = jobs[t & (Capacity - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return 0;
+
+	return job;
+}
+
+// --------------------------------------------------------
+// Constructor - Starts the worker threads, making the
+// calling thread worker 0
+// --------------------------------------------------------
+JobSystem::JobSystem(int workerThreads)
+{
+	queuedJobs = 0;
+	sleepingWorkers = 0;
+	stopping = false;
+
+	if (workerThreads < 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	currentSystem = this;
+	currentWorker = 0;
+
+	for (int i = 0; i <= workerThreads; i++)
+		deques.push_back(new JobDeque());
+
+	for (int i = 1; i <= workerThreads; i++)
+		threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+}
+
+// --------------------------------------------------------
+// Destructor - Stops the workers.  Jobs that never got to
+// run are thrown away.
+// --------------------------------------------------------
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (auto& t : threads) t.join();
+
+	for (auto& d : deques)
+	{
+		while (Job* job = d->Steal()) delete job;
+		delete d;
+	}
+	for (auto& job : externalJobs) delete job;
+
+	if (currentSystem == this)
+		currentSystem = 0;
+}
+
+unsigned int JobSystem::CurrentWorker()
+{
+	return currentSystem == this ? currentWorker : NoWorker;
+}
+
+void JobSystem::Run(const JobFunction& function, JobCounter* counter)
+{
+	if (counter) counter->Pending++;
+
+	Job* job = new Job();
+	job->Function = function;
+	job->Counter = counter;
+	Queue(job);
+}
+
+// --------------------------------------------------------
+// Holds a job back until "dependency" is done.  The job's
+// own counter is incremented straight away, so waiting on
+// it also waits for the dependency.
+// --------------------------------------------------------
+void JobSystem::RunAfter(JobCounter* dependency, const JobFunction& function, JobCounter* counter)
+{
+	if (counter) counter->Pending++;
+
+	Job* job = new Job();
+	job->Function = function;
+	job->Counter = counter;
+
+	{
+		std::lock_guard<std::mutex> lock(dependency->ContinuationMutex);
+		if (dependency->Pending.load() > 0)
+		{
+			dependency->Continuations.push_back(job);
+			return;
+		}
+	}
+
+	Queue(job);
+}
+
+// --------------------------------------------------------
+// Puts a job where a worker can find it - the current
+// worker's own deque, or the shared queue for outside threads
+// --------------------------------------------------------
+void JobSystem::Queue(Job* job)
+{
+	// No workers, so just do it now
+	if (threads.empty())
+	{
+		Execute(job);
+		return;
+	}
+
+	unsigned int index = CurrentWorker();
+	queuedJobs++;
+
+	if (index != NoWorker)
+	{
+		// Deque full - running it here is better than blocking
+		if (!deques[index]->Push(job))
+		{
+			queuedJobs--;
+			Execute(job);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(externalMutex);
+		externalJobs.push_back(job);
+	}
+
+	// Only touch the mutex if someone might be asleep
+	if (sleepingWorkers.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		workAvailable.notify_one();
+	}
+}
+
+// --------------------------------------------------------
+// Own deque first (newest job, still warm in cache), then
+// outside jobs, then steal the oldest job from another worker
+// --------------------------------------------------------
+Job* JobSystem::FindJob(unsigned int index)
+{
+	Job* job = 0;
+
+	if (index != NoWorker)
+		job = deques[index]->Pop();
+
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(externalMutex);
+		if (!externalJobs.empty())
+		{
+			job = externalJobs.front();
+			externalJobs.pop_front();
+		}
+	}
+
+	unsigned int count = (unsigned int)deques.size();
+	unsigned int start = index == NoWorker ? 0 : index + 1;
+	for (unsigned int i = 0; !job && i < count; i++)
+	{
+		unsigned int victim = (start + i) % count;
+		if (victim != index)
+			job = deques[victim]->Steal();
+	}
+
+	if (job) queuedJobs--;
+	return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	job->Function();
+
+	JobCounter* counter = job->Counter;
+	delete job;
+	Finish(counter);
+}
+
+// --------------------------------------------------------
+// Counts a finished job, releasing any held-back jobs
+// once nothing is left
+// --------------------------------------------------------
+void JobSystem::Finish(JobCounter* counter)
+{
+	if (!counter)
+		return;
+
+	// Everything happens under the lock, so once Wait() gets the
+	// lock too it knows the counter is no longer being touched
+	std::vector<Job*> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->ContinuationMutex);
+		if (counter->Pending.fetch_sub(1) == 1)
+			continuations.swap(counter->Continuations);
+	}
+
+	for (auto& job : continuations)
+		Queue(job);
+}
+
+bool JobSystem::TryRunJob()
+{
+	Job* job = FindJob(CurrentWorker());
+	if (!job)
+		return false;
+
+	Execute(job);
+	return true;
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	while (!counter->IsDone())
+	{
+		if (!TryRunJob())
+			std::this_thread::yield();
+	}
+
+	// Let the last job finish with the counter, since
+	// callers often free it as soon as this returns
+	std::lock_guard<std::mutex> lock(counter->ContinuationMutex);
+}
+
+// --------------------------------------------------------
+// Splits [0, count) into batches and runs them as jobs,
+// with the calling thread doing the first batch itself
+// --------------------------------------------------------
+void JobSystem::ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int, unsigned int)>& body)
+{
+	if (count == 0)
+		return;
+	if (batchSize == 0)
+		batchSize = 1;
+
+	// In order, on this thread
+	if (threads.empty() || count <= batchSize)
+	{
+		for (unsigned int begin = 0; begin < count; begin += batchSize)
+			body(begin, count - begin < batchSize ? count : begin + batchSize);
+		return;
+	}
+
+	JobCounter counter;
+	for (unsigned int begin = batchSize; begin < count; begin += batchSize)
+	{
+		unsigned int end = count - begin < batchSize ? count : begin + batchSize;
+		Run([&body, begin, end]() { body(begin, end); }, &counter);
+	}
+
+	body(0, batchSize);
+	Wait(&counter);
+}
+
+// --------------------------------------------------------
+// Worker thread body - runs jobs until there are none,
+// then sleeps until more are queued
+// --------------------------------------------------------
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	currentSystem = this;
+	currentWorker = index;
+
+	while (!stopping.load())
+	{
+		Job* job = FindJob(index);
+		if (job)
+		{
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers++;
+		workAvailable.wait(lock, [this] { return stopping.load() || queuedJobs.load() > 0; });
+		sleepingWorkers--;
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+typedef std::function<void()> JobFunction;
+
+struct Job;
+
+// --------------------------------------------------------
+// Counts outstanding jobs so they can be waited on, and
+// holds jobs that should only start once the count hits zero
+// --------------------------------------------------------
+struct JobCounter
+{
+	JobCounter() : Pending(0) { }
+
+	bool IsDone() { return Pending.load() == 0; }
+
+	std::atomic<int> Pending;
+
+	// Jobs queued by RunAfter() once Pending reaches zero
+	std::mutex ContinuationMutex;
+	std::vector<Job*> Continuations;
+};
+
+// --------------------------------------------------------
+// A single queued job
+// --------------------------------------------------------
+struct Job
+{
+	JobFunction Function;
+	JobCounter* Counter;
+};
+
+// --------------------------------------------------------
+// Fixed-size Chase-Lev work-stealing deque.  The owning thread
+// pushes and pops at the bottom, everyone else steals from
+// the top.
+// --------------------------------------------------------
+class JobDeque
+{
+public:
+	JobDeque();
+
+	bool Push(Job* job);	// Owner only, false when full
+	Job* Pop();				// Owner only
+	Job* Steal();			// Any thread
+
+private:
+	static const long long Capacity = 4096;	// Must be a power of 2
+
+	std::atomic<long long> top;
+	std::atomic<long long> bottom;
+	std::atomic<Job*> jobs[Capacity];
+};
+
+// --------------------------------------------------------
+// Work-stealing job scheduler
+//
+// The thread that creates the JobSystem becomes worker 0 and
+// only runs jobs while it waits.  The other workers run jobs
+// all the time, stealing from each other when they run dry.
+// With zero worker threads every job runs inline, in the order
+// it was started, which keeps things deterministic for debugging.
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	// workerThreads - Extra threads to start, or -1 to pick one
+	//                 fewer than the number of hardware threads
+	JobSystem(int workerThreads = -1);
+	~JobSystem();
+
+	// Starts a job.  The counter (optional) is incremented now
+	// and decremented once the job finishes.
+	void Run(const JobFunction& function, JobCounter* counter = 0);
+
+	// Starts a job once every job tracked by "dependency" is done
+	void RunAfter(JobCounter* dependency, const JobFunction& function, JobCounter* counter = 0);
+
+	// Runs other jobs on this thread until the counter hits zero
+	void Wait(JobCounter* counter);
+
+	// Runs one queued job on this thread, if there is one
+	bool TryRunJob();
+
+	// Calls body(begin, end) over [0, count) in batches of
+	// batchSize, spread over every worker, and waits for it
+	void ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int, unsigned int)>& body);
+
+	unsigned int GetWorkerCount() { return (unsigned int)threads.size(); }
+
+private:
+	std::vector<std::thread> threads;
+	std::vector<JobDeque*> deques;	// One per worker, 0 is the owning thread
+
+	// Jobs started from threads outside the system
+	std::deque<Job*> externalJobs;
+	std::mutex externalMutex;
+
+	// Sleeping when there is nothing to do
+	std::atomic<int> queuedJobs;
+	std::atomic<int> sleepingWorkers;
+	std::mutex sleepMutex;
+	std::condition_variable workAvailable;
+	std::atomic<bool> stopping;
+
+	void WorkerLoop(unsigned int index);
+	void Queue(Job* job);
+	Job* FindJob(unsigned int index);
+	void Execute(Job* job);
+	void Finish(JobCounter* counter);
+
+	unsigned int CurrentWorker();
+};
+
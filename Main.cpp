@@ -1,41 +1,132 @@
-
-#include <Windows.h>
-#include "Game.h"
-
-// --------------------------------------------------------
-// Entry point for a graphical (non-console) Windows application
-// --------------------------------------------------------
-int WINAPI WinMain(
-	HINSTANCE hInstance,		// The handle to this app's instance
-	HINSTANCE hPrevInstance,	// A handle to the previous instance of the app (always NULL)
-	LPSTR lpCmdLine,			// Command line params
-	int nCmdShow)				// How the window should be shown (we ignore this)
-{
-#if defined(DEBUG) | defined(_DEBUG)
-	// Enable memory leak detection as a quick and dirty
-	// way of determining if we forgot to clean something up
-	//  - You may want to use something more advanced, like Visual Leak Detector
-	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
-#endif
-
-	// Create the Game object using
-	// the app handle we got from WinMain
-	Game dxGame(hInstance);
-
-	// Result variable for function calls below
-	HRESULT hr = S_OK;
-
-	// Attempt to create the window for our program, and
-	// exit early if something failed
-	hr = dxGame.InitWindow();
-	if(FAILED(hr)) return hr;
-
-	// Attempt to initialize DirectX, and exit
-	// early if something failed
-	hr = dxGame.InitDirectX();
-	if(FAILED(hr)) return hr;
-
-	// Begin the message and game loop, and then return
-	// whatever we get back once the game loop is over
-	return dxGame.Run();
-}
+
+#include <Windows.h>
+#include "Game.h"
+#include "ShaderArchive.h"
+#include "ShaderPermutations.h"
+#include "ShaderLayout.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Entry point for a graphical (non-console) Windows application
+// --------------------------------------------------------
+int WINAPI WinMain(
+	HINSTANCE hInstance,		// The handle to this app's instance
+	HINSTANCE hPrevInstance,	// A handle to the previous instance of the app (always NULL)
+	LPSTR lpCmdLine,			// Command line params
+	int nCmdShow)				// How the window should be shown (we ignore this)
+{
+#if defined(DEBUG) | defined(_DEBUG)
+	// Enable memory leak detection as a quick and dirty
+	// way of determining if we forgot to clean something up
+	//  - You may want to use something more advanced, like Visual Leak Detector
+	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+#endif
+
+	// "-packshaders <output folder> [<source folder>]" is the
+	// post-build step: compile the shader permutations from the
+	// source folder, regenerate its ShaderStructs.h, then pack
+	// every compiled shader in the output folder into its
+	// Shaders.pack and quit
+	const char packShaders[] = "-packshaders";
+	if (strncmp(lpCmdLine, packShaders, sizeof(packShaders) - 1) == 0)
+	{
+		DXCore::AttachParentConsole();
+
+		// Folders may be quoted, and end in a backslash
+		std::vector<std::string> folders;
+		const char* c = lpCmdLine + sizeof(packShaders) - 1;
+		while (*c)
+		{
+			if (*c == ' ' || *c == '\t') { c++; continue; }
+			const char* end = (*c == '"') ? strchr(++c, '"') : strpbrk(c, " \t");
+			if (!end) end = c + strlen(c);
+			folders.push_back(std::string(c, end));
+			c = *end ? end + 1 : end;
+		}
+		if (folders.empty() || folders[0].empty())
+			return 1;
+
+		for (auto& folder : folders)
+		{
+			if (!folder.empty() && folder.back() != '\\' && folder.back() != '/')
+				folder += '\\';
+		}
+
+		bool structsChanged = false;
+		std::string structsFile = folders.size() > 1 ? folders[1] + "ShaderStructs.h" : "";
+		if (folders.size() > 1 &&
+			(!ShaderPermutations::Compile(folders[1].c_str(), folders[0].c_str()) ||
+			!ShaderLayoutGenerator::Generate(folders[0].c_str(), structsFile.c_str(), structsChanged)))
+			return 1;
+
+		if (!ShaderArchive::Build(folders[0].c_str(), (folders[0] + "Shaders.pack").c_str()))
+			return 1;
+
+		// The game was just compiled against the old structs, so
+		// this build can't be used.  Written the way Visual Studio
+		// lists errors.
+		if (structsChanged)
+		{
+			fprintf(stderr, "%s : error : regenerated from the compiled shaders - build again\n", structsFile.c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	// "-headless [frames]" draws that many frames (600 by
+	// default) with no window or GPU, recording what would have
+	// been sent to the GPU instead, then prints timings and
+	// counts to stdout and quits
+	const char headless[] = "-headless";
+	if (strncmp(lpCmdLine, headless, sizeof(headless) - 1) == 0)
+	{
+		DXCore::AttachParentConsole();
+
+		int frames = atoi(lpCmdLine + sizeof(headless) - 1);
+
+		Game dxGame(hInstance, true);
+		HRESULT hr = dxGame.InitHeadless();
+		if (FAILED(hr)) return hr;
+		return dxGame.RunHeadless(frames > 0 ? frames : 600);
+	}
+
+	// "-shaderbench [rounds]" loads the shaders with an empty
+	// reflection cache and with a full one, 20 times each by
+	// default, on a software device, then prints the average
+	// times to stdout and quits
+	const char shaderBench[] = "-shaderbench";
+	if (strncmp(lpCmdLine, shaderBench, sizeof(shaderBench) - 1) == 0)
+	{
+		DXCore::AttachParentConsole();
+
+		int rounds = atoi(lpCmdLine + sizeof(shaderBench) - 1);
+
+		Game dxGame(hInstance, true);
+		HRESULT hr = dxGame.InitHeadless();
+		if (FAILED(hr)) return hr;
+		return dxGame.BenchmarkShaders(rounds > 0 ? rounds : 20);
+	}
+
+	// Create the Game object using
+	// the app handle we got from WinMain
+	Game dxGame(hInstance);
+
+	// Result variable for function calls below
+	HRESULT hr = S_OK;
+
+	// Attempt to create the window for our program, and
+	// exit early if something failed
+	hr = dxGame.InitWindow();
+	if(FAILED(hr)) return hr;
+
+	// Attempt to initialize DirectX, and exit
+	// early if something failed
+	hr = dxGame.InitDirectX();
+	if(FAILED(hr)) return hr;
+
+	// Begin the message and game loop, and then return
+	// whatever we get back once the game loop is over
+	return dxGame.Run();
+}
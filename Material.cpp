@@ -0,0 +1,95 @@
+#include "Material.h"
+
+#include <cstring>
+
+// --------------------------------------------------------
+// Puts an item in a register-ordered array, growing it at
+// either end to cover the register
+// --------------------------------------------------------
+template<typename T>
+static void Place(std::vector<T*>& items, unsigned int& first, unsigned int slot, T* item)
+{
+	if (items.empty())
+	{
+		first = slot;
+		items.push_back(item);
+		return;
+	}
+
+	if (slot < first)
+	{
+		items.insert(items.begin(), first - slot, 0);
+		first = slot;
+	}
+	else if (slot >= first + items.size())
+	{
+		items.resize(slot - first + 1, 0);
+	}
+	items[slot - first] = item;
+}
+
+Material::Material(SimplePixelShader* shader)
+{
+	this->shader = shader;
+	id = 0;
+	firstTexture = 0;
+	firstSampler = 0;
+}
+
+bool Material::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
+{
+	const SimpleSRV* info = shader->GetShaderResourceViewInfo(name);
+	if (!info)
+		return false;
+
+	Place(textures, firstTexture, info->BindIndex, srv);
+	return true;
+}
+
+bool Material::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
+{
+	const SimpleSampler* info = shader->GetSamplerInfo(name);
+	if (!info)
+		return false;
+
+	Place(samplers, firstSampler, info->BindIndex, samplerState);
+	return true;
+}
+
+bool Material::SetData(const std::string& name, const void* data, unsigned int size)
+{
+	SimpleShaderHandle handle = shader->GetVariableHandle(name);
+	if (!handle.IsValid() || handle.Size != size)
+		return false;
+
+	// Setting the same variable again replaces its value
+	for (auto& constant : constants)
+	{
+		if (constant.Handle.ConstantBufferIndex == handle.ConstantBufferIndex &&
+			constant.Handle.ByteOffset == handle.ByteOffset)
+		{
+			memcpy(&constantData[constant.Offset], data, size);
+			return true;
+		}
+	}
+
+	Constant constant;
+	constant.Handle = handle;
+	constant.Offset = (unsigned int)constantData.size();
+	constantData.resize(constantData.size() + size);
+	memcpy(&constantData[constant.Offset], data, size);
+	constants.push_back(constant);
+	return true;
+}
+
+void Material::Apply(StateCache* state)
+{
+	if (!textures.empty())
+		state->SetShaderResources(SHADER_STAGE_PIXEL, firstTexture, (unsigned int)textures.size(), textures.data());
+	if (!samplers.empty())
+		state->SetSamplers(SHADER_STAGE_PIXEL, firstSampler, (unsigned int)samplers.size(), samplers.data());
+
+	for (auto& constant : constants)
+		shader->SetData(constant.Handle, &constantData[constant.Offset], constant.Handle.Size);
+	shader->CopyAllBufferData();
+}
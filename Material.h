@@ -0,0 +1,64 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+#include "SimpleShader.h"
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// Everything a pixel shader needs from one material, worked
+// out against that shader once, up front
+//
+// Textures and samplers are kept as arrays by register, so
+// Apply() binds each with one range call (registers a
+// material doesn't use are left null).  Constants are set
+// through handles, with no lookups.
+//
+// A material only works with the shader it was made for.
+// It doesn't AddRef() its textures or samplers; whoever made
+// them keeps them alive.
+// --------------------------------------------------------
+class Material
+{
+public:
+	Material(SimplePixelShader* shader);
+
+	// False if the shader has no such texture, sampler or variable
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
+	bool SetData(const std::string& name, const void* data, unsigned int size);
+	bool SetFloat3(const std::string& name, const DirectX::XMFLOAT3& data) { return SetData(name, &data, sizeof(data)); }
+	bool SetFloat4(const std::string& name, const DirectX::XMFLOAT4& data) { return SetData(name, &data, sizeof(data)); }
+
+	// Binds everything, and uploads the shader's constants
+	void Apply(StateCache* state);
+
+	SimplePixelShader* GetShader() { return shader; }
+
+	// Where the material sorts in a RenderQueue - set when it's
+	// added, and the same every frame after
+	unsigned int GetId() { return id; }
+
+private:
+	friend class RenderQueue;
+
+	struct Constant
+	{
+		SimpleShaderHandle Handle;
+		unsigned int Offset;	// Into constantData
+	};
+
+	SimplePixelShader* shader;
+	unsigned int id;
+
+	unsigned int firstTexture;
+	std::vector<ID3D11ShaderResourceView*> textures;
+	unsigned int firstSampler;
+	std::vector<ID3D11SamplerState*> samplers;
+
+	std::vector<Constant> constants;
+	std::vector<unsigned char> constantData;
+};
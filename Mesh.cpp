@@ -1,304 +1,611 @@
-#include "Mesh.h"
-#include <DirectXMath.h>
-#include <vector>
-#include <fstream>
-
-using namespace DirectX;
-
-Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device)
-{
-	CreateBuffers(vertArray, numVerts, indexArray, numIndices, device);
-}
-
-Mesh::Mesh(WaterVertex * vertArray, int numVerts, unsigned int * indexArray, int numIndices, ID3D11Device * device)
-{
-}
-
-Mesh::Mesh(const char* objFile, ID3D11Device* device)
-{
-	// File input object
-	std::ifstream obj(objFile);
-
-	// Check for successful open
-	if (!obj.is_open())
-	{
-		// Check the debug folder
-		char debugFolder[256] = {};
-		strcat_s(debugFolder, "Debug/");
-		strcat_s(debugFolder, objFile);
-
-		// Attempt to open again
-		obj.open(debugFolder);
-
-		// If not found, give up
-		if (!obj.is_open())
-			return;
-	}
-
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
-
-										 // Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-			}
-		}
-	}
-
-	// Close the file and create the actual buffers
-	obj.close();
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
-}
-
-
-
-Mesh::~Mesh(void)
-{
-	vb->Release(); vb = 0;
-	ib->Release(); ib = 0;
-}
-
-
-void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device)
-{
-	// Calculate the tangents before copying to buffer
-	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
-
-	// Create the vertex buffer
-	D3D11_BUFFER_DESC vbd;
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVerts; // Number of vertices
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertArray;
-	device->CreateBuffer(&vbd, &initialVertexData, &vb);
-
-	// Create the index buffer
-	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndices; // Number of indices
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indexArray;
-	device->CreateBuffer(&ibd, &initialIndexData, &ib);
-
-	// Save the indices
-	this->numIndices = numIndices;
-}
-
-
-// Calculates the tangents of the vertices in a mesh
-// Code adapted from: http://www.terathon.com/code/tangent.html
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
-{
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
-
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numVerts;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-		
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx; 
-		v1->Tangent.y += ty; 
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx; 
-		v2->Tangent.y += ty; 
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx; 
-		v3->Tangent.y += ty; 
-		v3->Tangent.z += tz;
-	}
-
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthogonalize
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-		
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
+#include "Mesh.h"
+#include "RenderBackend.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <fstream>
+#include <climits>
+#include <cfloat>
+#include <cctype>
+
+using namespace DirectX;
+
+Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device)
+{
+	vb = 0;
+	ib = 0;
+	this->numIndices = 0;
+	importPeakBytes = 0;
+	ResetBounds();
+
+	CreateBuffers(vertArray, numVerts, indexArray, numIndices, device);
+}
+
+Mesh::Mesh(WaterVertex * vertArray, int numVerts, unsigned int * indexArray, int numIndices, ID3D11Device * device)
+{
+	vb = 0;
+	ib = 0;
+	this->numIndices = 0;
+	importPeakBytes = 0;
+	ResetBounds();
+}
+
+// Opens an OBJ file, falling back to the debug folder
+static bool OpenObjFile(const char* objFile, std::ifstream& obj)
+{
+	obj.open(objFile);
+
+	// Check for successful open
+	if (!obj.is_open())
+	{
+		// Check the debug folder
+		char debugFolder[256] = {};
+		strcat_s(debugFolder, "Debug/");
+		strcat_s(debugFolder, objFile);
+
+		// Attempt to open again
+		obj.open(debugFolder);
+	}
+
+	return obj.is_open();
+}
+
+// Builds the vertices for a single OBJ face line, returning
+// how many were written to "out" (3 for a triangle, 6 for a quad)
+static int ReadObjFace(
+	const char* chars,
+	const std::vector<XMFLOAT3>& positions,
+	const std::vector<XMFLOAT2>& uvs,
+	const std::vector<XMFLOAT3>& normals,
+	Vertex* out)
+{
+	// Read the face indices into an array
+	unsigned int i[12];
+	int facesRead = sscanf_s(
+		chars,
+		"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+		&i[0], &i[1], &i[2],
+		&i[3], &i[4], &i[5],
+		&i[6], &i[7], &i[8],
+		&i[9], &i[10], &i[11]);
+
+	// - Create the verts by looking up
+	//    corresponding data from vectors
+	// - OBJ File indices are 1-based, so
+	//    they need to be adusted
+	Vertex v1;
+	v1.Position = positions[i[0] - 1];
+	v1.UV = uvs[i[1] - 1];
+	v1.Normal = normals[i[2] - 1];
+
+	Vertex v2;
+	v2.Position = positions[i[3] - 1];
+	v2.UV = uvs[i[4] - 1];
+	v2.Normal = normals[i[5] - 1];
+
+	Vertex v3;
+	v3.Position = positions[i[6] - 1];
+	v3.UV = uvs[i[7] - 1];
+	v3.Normal = normals[i[8] - 1];
+
+	// The model is most likely in a right-handed space,
+	// especially if it came from Maya.  We want to convert
+	// to a left-handed space for DirectX.  This means we 
+	// need to:
+	//  - Invert the Z position
+	//  - Invert the normal's Z
+	//  - Flip the winding order
+	// We also need to flip the UV coordinate since DirectX
+	// defines (0,0) as the top left of the texture, and many
+	// 3D modeling packages use the bottom left as (0,0)
+
+	// Flip the UV's since they're probably "upside down"
+	v1.UV.y = 1.0f - v1.UV.y;
+	v2.UV.y = 1.0f - v2.UV.y;
+	v3.UV.y = 1.0f - v3.UV.y;
+
+	// Flip Z (LH vs. RH)
+	v1.Position.z *= -1.0f;
+	v2.Position.z *= -1.0f;
+	v3.Position.z *= -1.0f;
+
+	// Flip normal Z
+	v1.Normal.z *= -1.0f;
+	v2.Normal.z *= -1.0f;
+	v3.Normal.z *= -1.0f;
+
+	// Add the verts (flipping the winding order)
+	out[0] = v1;
+	out[1] = v3;
+	out[2] = v2;
+
+	// Was there a 4th face?
+	if (facesRead != 12)
+		return 3;
+
+	// Make the last vertex
+	Vertex v4;
+	v4.Position = positions[i[9] - 1];
+	v4.UV = uvs[i[10] - 1];
+	v4.Normal = normals[i[11] - 1];
+
+	// Flip the UV, Z pos and normal
+	v4.UV.y = 1.0f - v4.UV.y;
+	v4.Position.z *= -1.0f;
+	v4.Normal.z *= -1.0f;
+
+	// Add a whole triangle (flipping the winding order)
+	out[3] = v1;
+	out[4] = v4;
+	out[5] = v3;
+	return 6;
+}
+
+// Reads a vertex attribute line (v, vt or vn) into the matching list
+static void ReadObjAttribute(
+	const char* chars,
+	std::vector<XMFLOAT3>& positions,
+	std::vector<XMFLOAT2>& uvs,
+	std::vector<XMFLOAT3>& normals)
+{
+	// Check the type of line
+	if (chars[0] == 'v' && chars[1] == 'n')
+	{
+		// Read the 3 numbers directly into an XMFLOAT3
+		XMFLOAT3 norm;
+		sscanf_s(
+			chars,
+			"vn %f %f %f",
+			&norm.x, &norm.y, &norm.z);
+
+		// Add to the list of normals
+		normals.push_back(norm);
+	}
+	else if (chars[0] == 'v' && chars[1] == 't')
+	{
+		// Read the 2 numbers directly into an XMFLOAT2
+		XMFLOAT2 uv;
+		sscanf_s(
+			chars,
+			"vt %f %f",
+			&uv.x, &uv.y);
+
+		// Add to the list of uv's
+		uvs.push_back(uv);
+	}
+	else if (chars[0] == 'v')
+	{
+		// Read the 3 numbers directly into an XMFLOAT3
+		XMFLOAT3 pos;
+		sscanf_s(
+			chars,
+			"v %f %f %f",
+			&pos.x, &pos.y, &pos.z);
+
+		// Add to the positions
+		positions.push_back(pos);
+	}
+}
+
+Mesh::Mesh(const char* objFile, ID3D11Device* device)
+{
+	vb = 0;
+	ib = 0;
+	numIndices = 0;
+	importPeakBytes = 0;
+	ResetBounds();
+
+	// Read the whole file, then create the actual buffers
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (!LoadObj(objFile, verts, indices, &importPeakBytes) || verts.empty())
+		return;
+
+	CreateBuffers(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), device);
+}
+
+bool Mesh::LoadObj(const char* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, size_t* peakBytes)
+{
+	// File input object
+	std::ifstream obj;
+
+	// If not found, give up
+	if (!OpenObjFile(objFile, obj))
+		return false;
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions;     // Positions from the file
+	std::vector<XMFLOAT3> normals;       // Normals from the file
+	std::vector<XMFLOAT2> uvs;           // UVs from the file
+	unsigned int vertCounter = 0;        // Count of vertices/indices
+	char chars[100];                     // String for line reading
+	Vertex faceVerts[6];                 // Verts of the current face
+
+										 // Still have data left?
+	while (obj.good())
+	{
+		// Get the line (100 characters should be more than enough)
+		obj.getline(chars, 100);
+
+		// Faces become verts, anything else might be an attribute
+		if (chars[0] != 'f')
+		{
+			ReadObjAttribute(chars, positions, uvs, normals);
+			continue;
+		}
+
+		// Add the face's verts and indices
+		int faceVertCount = ReadObjFace(chars, positions, uvs, normals, faceVerts);
+		for (int v = 0; v < faceVertCount; v++)
+		{
+			verts.push_back(faceVerts[v]);
+			indices.push_back(vertCounter); vertCounter += 1;
+		}
+	}
+
+	// Everything was alive at once before the buffers were made
+	if (peakBytes)
+	{
+		*peakBytes =
+			positions.capacity() * sizeof(XMFLOAT3) +
+			normals.capacity() * sizeof(XMFLOAT3) +
+			uvs.capacity() * sizeof(XMFLOAT2) +
+			verts.capacity() * sizeof(Vertex) +
+			indices.capacity() * sizeof(unsigned int);
+	}
+
+	obj.close();
+	return true;
+}
+
+// --------------------------------------------------------
+// Streaming OBJ import for very large files
+//
+// The file is scanned once to count its attributes and faces so the
+// GPU buffers can be sized up front, then read again with faces being
+// assembled in fixed-size blocks that are copied straight into those
+// buffers.  Only the raw attribute lists and one block of assembled
+// vertices/indices are ever held in memory at the same time.
+//
+// memoryCeiling - Maximum bytes the importer may hold at once.  If the
+//                 attribute lists alone do not fit, nothing is created.
+// --------------------------------------------------------
+Mesh::Mesh(const char* objFile, ID3D11Device* device, ID3D11DeviceContext* context, size_t memoryCeiling)
+{
+	vb = 0;
+	ib = 0;
+	numIndices = 0;
+	importPeakBytes = 0;
+	ResetBounds();
+
+	std::ifstream obj;
+	if (!OpenObjFile(objFile, obj))
+		return;
+
+	// First pass - just count things
+	size_t positionCount = 0;
+	size_t normalCount = 0;
+	size_t uvCount = 0;
+	size_t totalVerts = 0;
+	char chars[100];
+	while (obj.good())
+	{
+		obj.getline(chars, 100);
+
+		if (chars[0] == 'v' && chars[1] == 'n') normalCount++;
+		else if (chars[0] == 'v' && chars[1] == 't') uvCount++;
+		else if (chars[0] == 'v') positionCount++;
+		else if (chars[0] == 'f')
+		{
+			// Quads have a 4th "x/y/z" group.  Groups are counted
+			// rather than spaces, as lines can end in spaces or a
+			// '\r' from a Windows-saved file.
+			int groups = 0;
+			for (const char* c = chars + 1; *c; )
+			{
+				while (*c && isspace((unsigned char)*c)) c++;
+				if (!*c) break;
+				groups++;
+				while (*c && !isspace((unsigned char)*c)) c++;
+			}
+			totalVerts += (groups >= 4) ? 6 : 3;
+		}
+	}
+
+	// The buffers use 32-bit counts, and have to fit in a D3D11 buffer
+	size_t vertexBytes, indexBytes;
+	if (totalVerts == 0 || totalVerts > INT_MAX || !GetBufferSizes(totalVerts, vertexBytes, indexBytes))
+		return;
+
+	// The attribute lists have to stay resident for the whole import,
+	// so whatever is left of the budget goes to the face blocks
+	size_t attributeBytes =
+		positionCount * sizeof(XMFLOAT3) +
+		normalCount * sizeof(XMFLOAT3) +
+		uvCount * sizeof(XMFLOAT2);
+	size_t perVertBytes = sizeof(Vertex) + sizeof(unsigned int);
+	if (attributeBytes + perVertBytes * 6 > memoryCeiling)
+		return;
+
+	// Block size is a whole number of quads (6 verts) so faces never straddle blocks
+	size_t blockVerts = (memoryCeiling - attributeBytes) / perVertBytes;
+	blockVerts -= blockVerts % 6;
+	if (blockVerts > totalVerts)
+		blockVerts = totalVerts + (6 - totalVerts % 6) % 6;
+
+	// Create empty GPU buffers of the final size, which the blocks are copied into
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.ByteWidth = (UINT)vertexBytes;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	if (FAILED(device->CreateBuffer(&vbd, 0, &vb)))
+		return;
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_DEFAULT;
+	ibd.ByteWidth = (UINT)indexBytes;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	if (FAILED(device->CreateBuffer(&ibd, 0, &ib)))
+	{
+		vb->Release(); vb = 0;
+		return;
+	}
+
+	// Second pass - the real import
+	obj.clear();
+	obj.seekg(0);
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	positions.reserve(positionCount);
+	normals.reserve(normalCount);
+	uvs.reserve(uvCount);
+
+	std::vector<Vertex> blockVertArray(blockVerts);
+	std::vector<unsigned int> blockIndexArray(blockVerts);
+	importPeakBytes = attributeBytes + blockVerts * perVertBytes;
+
+	size_t blockCount = 0;      // Verts in the current block
+	size_t vertsWritten = 0;    // Verts already copied to the GPU
+	bool done = false;
+	while (!done)
+	{
+		// Read lines until the block fills up or the file ends
+		done = !obj.good();
+		if (!done)
+		{
+			obj.getline(chars, 100);
+			if (chars[0] != 'f')
+			{
+				ReadObjAttribute(chars, positions, uvs, normals);
+				continue;
+			}
+
+			blockCount += ReadObjFace(chars, positions, uvs, normals, &blockVertArray[blockCount]);
+
+			// Room for one more quad?
+			if (blockCount + 6 <= blockVerts && vertsWritten + blockCount < totalVerts)
+				continue;
+		}
+
+		// Never write past the end of the buffers, even if the
+		// second pass somehow disagrees with the first
+		if (vertsWritten + blockCount > totalVerts)
+			blockCount = totalVerts - vertsWritten;
+		if (blockCount == 0)
+			continue;
+
+		// Verts are never shared between faces, so tangents can be
+		// computed on just this block using block-relative indices
+		for (size_t i = 0; i < blockCount; i++)
+			blockIndexArray[i] = (unsigned int)i;
+		CalculateTangents(&blockVertArray[0], (int)blockCount, &blockIndexArray[0], (int)blockCount);
+		GrowBounds(&blockVertArray[0], (int)blockCount);
+
+		// Now make the indices absolute
+		for (size_t i = 0; i < blockCount; i++)
+			blockIndexArray[i] += (unsigned int)vertsWritten;
+
+		// Copy this block into its spot in each buffer.  Blocks end
+		// within the buffers, whose sizes were checked to fit a UINT.
+		D3D11_BOX vertBox = {};
+		vertBox.left = (UINT)(vertsWritten * sizeof(Vertex));
+		vertBox.right = (UINT)((vertsWritten + blockCount) * sizeof(Vertex));
+		vertBox.bottom = 1;
+		vertBox.back = 1;
+		RenderBackend* backend = RenderBackend::Get(context);
+		backend->UpdateSubresource(vb, &vertBox, &blockVertArray[0], vertBox.right - vertBox.left);
+
+		D3D11_BOX indexBox = vertBox;
+		indexBox.left = (UINT)(vertsWritten * sizeof(unsigned int));
+		indexBox.right = (UINT)((vertsWritten + blockCount) * sizeof(unsigned int));
+		backend->UpdateSubresource(ib, &indexBox, &blockIndexArray[0], indexBox.right - indexBox.left);
+
+		vertsWritten += blockCount;
+		blockCount = 0;
+	}
+
+	obj.close();
+	numIndices = (int)vertsWritten;
+}
+
+
+
+// --------------------------------------------------------
+// Byte sizes of the vertex and index buffers for a number of
+// (unshared) vertices.  False if either is past what a D3D11
+// buffer can hold - 2 GB at most, and less on GPUs with little
+// memory, where CreateBuffer() fails instead.
+// --------------------------------------------------------
+bool Mesh::GetBufferSizes(size_t vertexCount, size_t& vertexBytes, size_t& indexBytes)
+{
+	const size_t maxResourceBytes = (size_t)D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_C_TERM * 1024 * 1024;
+
+	// Checked before multiplying, which could wrap a 32-bit size_t
+	if (vertexCount > maxResourceBytes / sizeof(Vertex) ||
+		vertexCount > maxResourceBytes / sizeof(unsigned int))
+		return false;
+
+	vertexBytes = vertexCount * sizeof(Vertex);
+	indexBytes = vertexCount * sizeof(unsigned int);
+	return vertexBytes <= UINT_MAX && indexBytes <= UINT_MAX;
+}
+
+Mesh::~Mesh(void)
+{
+	if (vb) { vb->Release(); vb = 0; }
+	if (ib) { ib->Release(); ib = 0; }
+}
+
+
+void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device)
+{
+	// Calculate the tangents and bounds before copying to buffer
+	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
+	GrowBounds(vertArray, numVerts);
+
+	// Create the vertex buffer
+	D3D11_BUFFER_DESC vbd;
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = sizeof(Vertex) * numVerts; // Number of vertices
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+	D3D11_SUBRESOURCE_DATA initialVertexData;
+	initialVertexData.pSysMem = vertArray;
+	device->CreateBuffer(&vbd, &initialVertexData, &vb);
+
+	// Create the index buffer
+	D3D11_BUFFER_DESC ibd;
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = sizeof(unsigned int) * numIndices; // Number of indices
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+	D3D11_SUBRESOURCE_DATA initialIndexData;
+	initialIndexData.pSysMem = indexArray;
+	device->CreateBuffer(&ibd, &initialIndexData, &ib);
+
+	// Save the indices
+	this->numIndices = numIndices;
+}
+
+
+// Empties the bounding box, ready for GrowBounds()
+void Mesh::ResetBounds()
+{
+	boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+// Expands the bounding box to contain the given vertices
+void Mesh::GrowBounds(const Vertex* verts, int numVerts)
+{
+	for (int i = 0; i < numVerts; i++)
+	{
+		const XMFLOAT3& p = verts[i].Position;
+		if (p.x < boundsMin.x) boundsMin.x = p.x;
+		if (p.y < boundsMin.y) boundsMin.y = p.y;
+		if (p.z < boundsMin.z) boundsMin.z = p.z;
+		if (p.x > boundsMax.x) boundsMax.x = p.x;
+		if (p.y > boundsMax.y) boundsMax.y = p.y;
+		if (p.z > boundsMax.z) boundsMax.z = p.z;
+	}
+}
+
+// Center of the local-space bounding box
+XMFLOAT3 Mesh::GetBoundsCenter()
+{
+	if (boundsMin.x > boundsMax.x) return XMFLOAT3(0, 0, 0);
+	return XMFLOAT3(
+		(boundsMin.x + boundsMax.x) * 0.5f,
+		(boundsMin.y + boundsMax.y) * 0.5f,
+		(boundsMin.z + boundsMax.z) * 0.5f);
+}
+
+// Half-size of the local-space bounding box
+XMFLOAT3 Mesh::GetBoundsExtents()
+{
+	if (boundsMin.x > boundsMax.x) return XMFLOAT3(0, 0, 0);
+	return XMFLOAT3(
+		(boundsMax.x - boundsMin.x) * 0.5f,
+		(boundsMax.y - boundsMin.y) * 0.5f,
+		(boundsMax.z - boundsMin.z) * 0.5f);
+}
+
+
+// Calculates the tangents of the vertices in a mesh
+// Code adapted from: http://www.terathon.com/code/tangent.html
+void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	// Reset tangents
+	for (int i = 0; i < numVerts; i++)
+	{
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (int i = 0; i < numVerts;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+		
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->Tangent.x += tx; 
+		v1->Tangent.y += ty; 
+		v1->Tangent.z += tz;
+
+		v2->Tangent.x += tx; 
+		v2->Tangent.y += ty; 
+		v2->Tangent.z += tz;
+
+		v3->Tangent.x += tx; 
+		v3->Tangent.y += ty; 
+		v3->Tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (int i = 0; i < numVerts; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+		// Use Gram-Schmidt orthogonalize
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+		
+		// Store the tangent
+		XMStoreFloat3(&verts[i].Tangent, tangent);
+	}
 }
\ No newline at end of file
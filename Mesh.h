@@ -1,28 +1,50 @@
-#pragma once
-
-#include <d3d11.h>
-
-#include "Vertex.h"
-
-
-class Mesh
-{
-public:
-	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device);
-	Mesh(WaterVertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device);
-	Mesh(const char* objFile, ID3D11Device* device);
-	~Mesh(void);
-
-	ID3D11Buffer* GetVertexBuffer() { return vb; }
-	ID3D11Buffer* GetIndexBuffer() { return ib; }
-	int GetIndexCount() { return numIndices; }
-
-private:
-	ID3D11Buffer* vb;
-	ID3D11Buffer* ib;
-	int numIndices;
-
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
-	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device);
-};
-
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+
+#include "Vertex.h"
+
+
+class Mesh
+{
+public:
+	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device);
+	Mesh(WaterVertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device);
+	Mesh(const char* objFile, ID3D11Device* device);
+	Mesh(const char* objFile, ID3D11Device* device, ID3D11DeviceContext* context, size_t memoryCeiling);
+	~Mesh(void);
+
+	ID3D11Buffer* GetVertexBuffer() { return vb; }
+	ID3D11Buffer* GetIndexBuffer() { return ib; }
+	int GetIndexCount() { return numIndices; }
+
+	// Reads an OBJ file into CPU-side arrays without touching the device,
+	// so it is safe to call from any thread
+	static bool LoadObj(const char* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, size_t* peakBytes = 0);
+
+	// Byte sizes of the buffers for vertexCount unshared vertices,
+	// or false if they don't fit in a D3D11 buffer
+	static bool GetBufferSizes(size_t vertexCount, size_t& vertexBytes, size_t& indexBytes);
+
+	// Bytes the OBJ importer held at its high-water mark (0 if not loaded from a file)
+	size_t GetImportPeakBytes() { return importPeakBytes; }
+
+	// Local-space axis-aligned bounding box
+	DirectX::XMFLOAT3 GetBoundsCenter();
+	DirectX::XMFLOAT3 GetBoundsExtents();
+
+private:
+	ID3D11Buffer* vb;
+	ID3D11Buffer* ib;
+	int numIndices;
+	size_t importPeakBytes;
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+
+	void ResetBounds();
+	void GrowBounds(const Vertex* verts, int numVerts);
+	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device);
+};
+
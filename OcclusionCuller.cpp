@@ -0,0 +1,468 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+
+#include <Windows.h>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Triangles are clipped to 2x the screen in x and y, which keeps
+// the edge functions well within float precision
+static const float GuardBand = 2.0f;
+static const unsigned int ClipPlaneCount = 5;
+
+// Corners are numbered with x in bit 0, y in bit 1 and z in bit 2.
+// Every face is clockwise seen from outside, like a regular mesh.
+static const unsigned int BoxIndices[36] =
+{
+	2, 3, 1,	2, 1, 0,	// -z
+	7, 6, 4,	7, 4, 5,	// +z
+	6, 2, 0,	6, 0, 4,	// -x
+	3, 7, 5,	3, 5, 1,	// +x
+	6, 7, 3,	6, 3, 2,	// +y
+	5, 4, 0,	5, 0, 1		// -y
+};
+
+// Clip space position of a point, using a transposed matrix
+static XMFLOAT4 TransformPoint(const XMFLOAT4X4& m, const XMFLOAT3& p)
+{
+	return XMFLOAT4(
+		m._11 * p.x + m._12 * p.y + m._13 * p.z + m._14,
+		m._21 * p.x + m._22 * p.y + m._23 * p.z + m._24,
+		m._31 * p.x + m._32 * p.y + m._33 * p.z + m._34,
+		m._41 * p.x + m._42 * p.y + m._43 * p.z + m._44);
+}
+
+// Positive on the inside of the near plane and the guard band
+static float PlaneDistance(unsigned int plane, const XMFLOAT4& v)
+{
+	switch (plane)
+	{
+	case 0:  return v.z;
+	case 1:  return GuardBand * v.w - v.x;
+	case 2:  return GuardBand * v.w + v.x;
+	case 3:  return GuardBand * v.w - v.y;
+	default: return GuardBand * v.w + v.y;
+	}
+}
+
+OcclusionCuller::OcclusionCuller(JobSystem* jobs, unsigned int width, unsigned int height)
+{
+	this->jobs = jobs;
+	tilesX = (width + TileSize - 1) / TileSize;
+	tilesY = (height + TileSize - 1) / TileSize;
+	this->width = tilesX * TileSize;
+	this->height = tilesY * TileSize;
+	bins.resize(tilesX * tilesY);
+
+	// Halve down to a single texel, rounding up so odd sizes
+	// still cover every pixel
+	unsigned int w = this->width, h = this->height;
+	while (true)
+	{
+		levels.push_back(std::vector<float>(w * h, 1.0f));
+		levelWidths.push_back(w);
+		levelHeights.push_back(h);
+		if (w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	stats = {};
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::Begin(const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	// Transposed matrices multiply in reverse
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&projection), XMLoadFloat4x4(&view)));
+
+	triangles.clear();
+	std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+	stats = {};
+}
+
+void OcclusionCuller::AddOccluder(const Vertex* verts, unsigned int vertCount, const unsigned int* indices, unsigned int indexCount, const XMFLOAT4X4& world)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&viewProjection), XMLoadFloat4x4(&world)));
+
+	clipVerts.resize(vertCount);
+	for (unsigned int i = 0; i < vertCount; i++)
+		clipVerts[i] = TransformPoint(m, verts[i].Position);
+
+	AddTriangles(indices, indexCount);
+	stats.Occluders++;
+}
+
+void OcclusionCuller::AddOccluderBox(const XMFLOAT3& c, const XMFLOAT3& e, const XMFLOAT4X4& world)
+{
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&viewProjection), XMLoadFloat4x4(&world)));
+
+	clipVerts.resize(8);
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		XMFLOAT3 corner(
+			(i & 1) ? c.x + e.x : c.x - e.x,
+			(i & 2) ? c.y + e.y : c.y - e.y,
+			(i & 4) ? c.z + e.z : c.z - e.z);
+		clipVerts[i] = TransformPoint(m, corner);
+	}
+
+	AddTriangles(BoxIndices, 36);
+	stats.Occluders++;
+}
+
+// --------------------------------------------------------
+// Clips each triangle of clipVerts against the near plane and
+// the guard band, then sets up whatever is left
+// --------------------------------------------------------
+void OcclusionCuller::AddTriangles(const unsigned int* indices, unsigned int indexCount)
+{
+	unsigned int vertCount = (unsigned int)clipVerts.size();
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+	{
+		if (indices[i] >= vertCount || indices[i + 1] >= vertCount || indices[i + 2] >= vertCount)
+			continue;
+
+		const XMFLOAT4& a = clipVerts[indices[i]];
+		const XMFLOAT4& b = clipVerts[indices[i + 1]];
+		const XMFLOAT4& c = clipVerts[indices[i + 2]];
+
+		// Most triangles need no clipping at all
+		bool inside = true;
+		for (unsigned int p = 0; p < ClipPlaneCount && inside; p++)
+			inside = PlaneDistance(p, a) >= 0.0f && PlaneDistance(p, b) >= 0.0f && PlaneDistance(p, c) >= 0.0f;
+		if (inside)
+		{
+			SetupTriangle(a, b, c);
+			continue;
+		}
+
+		// Each plane adds at most one vertex to the polygon
+		XMFLOAT4 polygons[2][3 + ClipPlaneCount];
+		polygons[0][0] = a;
+		polygons[0][1] = b;
+		polygons[0][2] = c;
+		unsigned int count = 3;
+		for (unsigned int p = 0; p < ClipPlaneCount && count >= 3; p++)
+		{
+			const XMFLOAT4* in = polygons[p & 1];
+			XMFLOAT4* out = polygons[(p + 1) & 1];
+			unsigned int outCount = 0;
+			for (unsigned int j = 0; j < count; j++)
+			{
+				const XMFLOAT4& from = in[j];
+				const XMFLOAT4& to = in[(j + 1) % count];
+				float fromDistance = PlaneDistance(p, from);
+				float toDistance = PlaneDistance(p, to);
+
+				if (fromDistance >= 0.0f)
+					out[outCount++] = from;
+				if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+				{
+					float t = fromDistance / (fromDistance - toDistance);
+					out[outCount++] = XMFLOAT4(
+						from.x + (to.x - from.x) * t,
+						from.y + (to.y - from.y) * t,
+						from.z + (to.z - from.z) * t,
+						from.w + (to.w - from.w) * t);
+				}
+			}
+			count = outCount;
+		}
+
+		const XMFLOAT4* clipped = polygons[ClipPlaneCount & 1];
+		for (unsigned int j = 1; j + 1 < count; j++)
+			SetupTriangle(clipped[0], clipped[j], clipped[j + 1]);
+	}
+}
+
+// --------------------------------------------------------
+// Projects a clipped triangle to the screen and works out its
+// edge functions and depth plane, both offset to pixel centers
+// --------------------------------------------------------
+void OcclusionCuller::SetupTriangle(const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c)
+{
+	float x[3], y[3], z[3];
+	const XMFLOAT4* v[3] = { &a, &b, &c };
+	for (int i = 0; i < 3; i++)
+	{
+		float invW = 1.0f / v[i]->w;
+		x[i] = (v[i]->x * invW * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - v[i]->y * invW * 0.5f) * height;
+		z[i] = v[i]->z * invW;
+	}
+
+	// Clockwise on screen is front facing, same as the default
+	// rasterizer state.  This also drops degenerate triangles.
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+	if (!(area > 0.0f))
+		return;
+
+	Triangle t;
+	float minX = x[0] < x[1] ? (x[0] < x[2] ? x[0] : x[2]) : (x[1] < x[2] ? x[1] : x[2]);
+	float maxX = x[0] > x[1] ? (x[0] > x[2] ? x[0] : x[2]) : (x[1] > x[2] ? x[1] : x[2]);
+	float minY = y[0] < y[1] ? (y[0] < y[2] ? y[0] : y[2]) : (y[1] < y[2] ? y[1] : y[2]);
+	float maxY = y[0] > y[1] ? (y[0] > y[2] ? y[0] : y[2]) : (y[1] > y[2] ? y[1] : y[2]);
+	t.MinX = (int)floorf(minX) < 0 ? 0 : (int)floorf(minX);
+	t.MinY = (int)floorf(minY) < 0 ? 0 : (int)floorf(minY);
+	t.MaxX = (int)floorf(maxX) >= (int)width ? (int)width - 1 : (int)floorf(maxX);
+	t.MaxY = (int)floorf(maxY) >= (int)height ? (int)height - 1 : (int)floorf(maxY);
+	if (t.MinX > t.MaxX || t.MinY > t.MaxY)
+		return;
+
+	// Edge i runs from vertex i to the next, positive on the inside
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		t.EdgeA[i] = y[i] - y[j];
+		t.EdgeB[i] = x[j] - x[i];
+		t.EdgeC[i] = x[i] * y[j] - x[j] * y[i] + 0.5f * (t.EdgeA[i] + t.EdgeB[i]);
+	}
+
+	// z / w is linear in screen space
+	t.DepthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	t.DepthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	t.DepthC = z[0] - t.DepthA * x[0] - t.DepthB * y[0] + 0.5f * (t.DepthA + t.DepthB);
+
+	triangles.push_back(t);
+}
+
+// --------------------------------------------------------
+// Bins triangles by tile, fills the tiles as jobs (no two
+// share a pixel), then builds the pyramid
+// --------------------------------------------------------
+void OcclusionCuller::Rasterize()
+{
+	LARGE_INTEGER start, end, frequency;
+	QueryPerformanceCounter(&start);
+
+	for (auto& bin : bins)
+		bin.clear();
+
+	for (unsigned int i = 0; i < triangles.size(); i++)
+	{
+		Triangle& t = triangles[i];
+		for (int ty = t.MinY / (int)TileSize; ty <= t.MaxY / (int)TileSize; ty++)
+			for (int tx = t.MinX / (int)TileSize; tx <= t.MaxX / (int)TileSize; tx++)
+				bins[ty * tilesX + tx].push_back(i);
+	}
+
+	if (!triangles.empty())
+	{
+		jobs->ParallelFor(tilesX * tilesY, 1, [this](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int tile = begin; tile < end; tile++)
+				RasterizeTile(tile);
+		});
+	}
+
+	BuildPyramid();
+	stats.Triangles = (unsigned int)triangles.size();
+
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+	stats.RasterMilliseconds = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+}
+
+// --------------------------------------------------------
+// Walks each binned triangle's pixels in the tile 4 at a
+// time, keeping the nearest depth wherever all 3 edge
+// functions are non-negative
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeTile(unsigned int tile)
+{
+	if (bins[tile].empty())
+		return;
+
+	int tileMinX = (tile % tilesX) * TileSize;
+	int tileMinY = (tile / tilesX) * TileSize;
+	int tileMaxX = tileMinX + TileSize - 1;
+	int tileMaxY = tileMinY + TileSize - 1;
+
+	float* depth = &levels[0][0];
+	__m128 zero = _mm_setzero_ps();
+	__m128 offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+	for (auto& index : bins[tile])
+	{
+		const Triangle& t = triangles[index];
+
+		// Groups of 4 start on a multiple of 4, and tiles are whole
+		// groups, so a group never crosses into the next tile
+		int minX = (t.MinX > tileMinX ? t.MinX : tileMinX) & ~3;
+		int maxX = t.MaxX < tileMaxX ? t.MaxX : tileMaxX;
+		int minY = t.MinY > tileMinY ? t.MinY : tileMinY;
+		int maxY = t.MaxY < tileMaxY ? t.MaxY : tileMaxY;
+
+		__m128 edgeA[3], edgeB[3], edgeC[3], edgeStep[3];
+		for (int e = 0; e < 3; e++)
+		{
+			edgeA[e] = _mm_set1_ps(t.EdgeA[e]);
+			edgeB[e] = _mm_set1_ps(t.EdgeB[e]);
+			edgeC[e] = _mm_set1_ps(t.EdgeC[e]);
+			edgeStep[e] = _mm_set1_ps(t.EdgeA[e] * 4.0f);
+		}
+		__m128 depthA = _mm_set1_ps(t.DepthA);
+		__m128 depthB = _mm_set1_ps(t.DepthB);
+		__m128 depthC = _mm_set1_ps(t.DepthC);
+		__m128 depthStep = _mm_set1_ps(t.DepthA * 4.0f);
+
+		__m128 startX = _mm_add_ps(_mm_set1_ps((float)minX), offsets);
+		for (int y = minY; y <= maxY; y++)
+		{
+			__m128 fy = _mm_set1_ps((float)y);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA[0], startX), _mm_add_ps(_mm_mul_ps(edgeB[0], fy), edgeC[0]));
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA[1], startX), _mm_add_ps(_mm_mul_ps(edgeB[1], fy), edgeC[1]));
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA[2], startX), _mm_add_ps(_mm_mul_ps(edgeB[2], fy), edgeC[2]));
+			__m128 z = _mm_add_ps(_mm_mul_ps(depthA, startX), _mm_add_ps(_mm_mul_ps(depthB, fy), depthC));
+
+			float* row = depth + y * width;
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				__m128 inside = _mm_and_ps(
+					_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+					_mm_cmpge_ps(e2, zero));
+
+				if (_mm_movemask_ps(inside))
+				{
+					__m128 old = _mm_loadu_ps(row + x);
+					__m128 nearer = _mm_min_ps(old, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+				}
+
+				e0 = _mm_add_ps(e0, edgeStep[0]);
+				e1 = _mm_add_ps(e1, edgeStep[1]);
+				e2 = _mm_add_ps(e2, edgeStep[2]);
+				z = _mm_add_ps(z, depthStep);
+			}
+		}
+	}
+}
+
+// Each texel keeps the farthest of the 2x2 below it
+void OcclusionCuller::BuildPyramid()
+{
+	for (unsigned int level = 1; level < levels.size(); level++)
+	{
+		const std::vector<float>& source = levels[level - 1];
+		std::vector<float>& dest = levels[level];
+		unsigned int sourceWidth = levelWidths[level - 1];
+		unsigned int sourceHeight = levelHeights[level - 1];
+		unsigned int destWidth = levelWidths[level];
+		unsigned int destHeight = levelHeights[level];
+
+		for (unsigned int y = 0; y < destHeight; y++)
+		{
+			const float* row0 = &source[(y * 2) * sourceWidth];
+			const float* row1 = &source[(y * 2 + 1 < sourceHeight ? y * 2 + 1 : y * 2) * sourceWidth];
+			for (unsigned int x = 0; x < destWidth; x++)
+			{
+				unsigned int x0 = x * 2;
+				unsigned int x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+				float a = row0[x0] > row0[x1] ? row0[x0] : row0[x1];
+				float b = row1[x0] > row1[x1] ? row1[x0] : row1[x1];
+				dest[y * destWidth + x] = a > b ? a : b;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Projects the box's corners, then compares its nearest depth
+// against the farthest occluder depth over its screen rect, on
+// a pyramid level where that rect is at most 4x4 texels
+// --------------------------------------------------------
+bool OcclusionCuller::IsVisible(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	stats.Tested++;
+
+	// Transform the center and the three half-axes once, then
+	// build each corner from them
+	const XMFLOAT4X4& m = viewProjection;
+	XMFLOAT4 c = TransformPoint(m, center);
+	XMFLOAT4 ax(m._11 * extents.x, m._21 * extents.x, m._31 * extents.x, m._41 * extents.x);
+	XMFLOAT4 ay(m._12 * extents.y, m._22 * extents.y, m._32 * extents.y, m._42 * extents.y);
+	XMFLOAT4 az(m._13 * extents.z, m._23 * extents.z, m._33 * extents.z, m._43 * extents.z);
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		float sx = (i & 1) ? 1.0f : -1.0f;
+		float sy = (i & 2) ? 1.0f : -1.0f;
+		float sz = (i & 4) ? 1.0f : -1.0f;
+		XMFLOAT4 clip(
+			c.x + sx * ax.x + sy * ay.x + sz * az.x,
+			c.y + sx * ax.y + sy * ay.y + sz * az.y,
+			c.z + sx * ax.z + sy * ay.z + sz * az.z,
+			c.w + sx * ax.w + sy * ay.w + sz * az.w);
+
+		// Anything reaching past the near plane could be right in front of us
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * invW * 0.5f) * height;
+		float z = clip.z * invW;
+		if (x < minX) minX = x;
+		if (x > maxX) maxX = x;
+		if (y < minY) minY = y;
+		if (y > maxY) maxY = y;
+		if (z < nearest) nearest = z;
+	}
+
+	// Every pixel the rect touches.  Off screen is left to the frustum culling.
+	int x0 = (int)floorf(minX), x1 = (int)floorf(maxX);
+	int y0 = (int)floorf(minY), y1 = (int)floorf(maxY);
+	if (x1 < 0 || y1 < 0 || x0 >= (int)width || y0 >= (int)height)
+		return true;
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 >= (int)width) x1 = width - 1;
+	if (y1 >= (int)height) y1 = height - 1;
+
+	unsigned int level = 0;
+	while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4))
+		level++;
+
+	const std::vector<float>& depth = levels[level];
+	unsigned int levelWidth = levelWidths[level];
+	for (int y = y0 >> level; y <= (y1 >> level); y++)
+	{
+		for (int x = x0 >> level; x <= (x1 >> level); x++)
+		{
+			if (depth[y * levelWidth + x] >= nearest)
+				return true;
+		}
+	}
+
+	stats.Rejected++;
+	return false;
+}
+
+void OcclusionCuller::Cull(CullResult& result, const std::function<bool(unsigned int, XMFLOAT3&, XMFLOAT3&)>& bounds)
+{
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < result.Visible.size(); i++)
+	{
+		unsigned int item = result.Visible[i];
+		XMFLOAT3 center, extents;
+		if (!bounds(item, center, extents) || IsVisible(center, extents))
+			result.Visible[kept++] = item;
+		else
+			result.Flags[item] = 0;
+	}
+	result.Visible.resize(kept);
+}
+
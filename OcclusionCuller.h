@@ -0,0 +1,96 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <functional>
+
+#include "Vertex.h"
+#include "FrustumCuller.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Numbers from the last frame, for the title bar
+// --------------------------------------------------------
+struct OcclusionStats
+{
+	unsigned int Occluders;
+	unsigned int Triangles;			// Occluder triangles left after clipping and back faces
+	unsigned int Tested;
+	unsigned int Rejected;
+	double RasterMilliseconds;		// Binning, rasterizing and building the pyramid
+};
+
+// --------------------------------------------------------
+// Software occlusion culling against a small depth buffer
+//
+// A few big occluders (the bath walls) are rasterized on the
+// CPU into a low resolution depth buffer, split into tiles that
+// are filled in parallel, 4 pixels per SSE edge function test.
+// A max-depth pyramid is built on top, and bounding boxes are
+// tested against whichever level covers them in a few texels.
+// Depth is D3D style: 0 at the near plane, 1 at the far plane.
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	// width and height are rounded up to whole tiles
+	OcclusionCuller(JobSystem* jobs, unsigned int width = 256, unsigned int height = 128);
+	~OcclusionCuller();
+
+	// Clears the depth buffer and occluders for a new view.  Both
+	// matrices are transposed, the way the Camera stores them.
+	void Begin(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	// world - Transposed, the way the TransformStore keeps it
+	void AddOccluder(const Vertex* verts, unsigned int vertCount, const unsigned int* indices, unsigned int indexCount, const DirectX::XMFLOAT4X4& world);
+	void AddOccluderBox(const DirectX::XMFLOAT3& localCenter, const DirectX::XMFLOAT3& localExtents, const DirectX::XMFLOAT4X4& world);
+
+	// Draws every occluder added since Begin() and builds the pyramid
+	void Rasterize();
+
+	// False only if the world-space box is completely hidden
+	bool IsVisible(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents);
+
+	// Removes hidden items from a frustum culling result.  bounds()
+	// gives an item's world box, or returns false to keep it anyway.
+	void Cull(CullResult& result, const std::function<bool(unsigned int, DirectX::XMFLOAT3&, DirectX::XMFLOAT3&)>& bounds);
+
+	unsigned int GetWidth() { return width; }
+	unsigned int GetHeight() { return height; }
+	OcclusionStats& GetStats() { return stats; }
+
+private:
+	static const unsigned int TileSize = 32;	// Pixels, a multiple of 4
+
+	// A screen-space triangle, ready to rasterize
+	struct Triangle
+	{
+		float EdgeA[3], EdgeB[3], EdgeC[3];	// Edge e is EdgeA*x + EdgeB*y + EdgeC, >= 0 inside
+		float DepthA, DepthB, DepthC;		// Depth is DepthA*x + DepthB*y + DepthC
+		int MinX, MinY, MaxX, MaxY;			// Pixel bounds, inclusive
+	};
+
+	JobSystem* jobs;
+	unsigned int width, height;
+	unsigned int tilesX, tilesY;
+
+	DirectX::XMFLOAT4X4 viewProjection;	// Transposed, so rows give clip x, y, z, w
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<unsigned int>> bins;	// Triangles touching each tile
+	std::vector<DirectX::XMFLOAT4> clipVerts;		// Scratch for AddOccluder()
+
+	// Level 0 is the depth buffer, each level after holds the
+	// farthest depth of 2x2 texels of the one before
+	std::vector<std::vector<float>> levels;
+	std::vector<unsigned int> levelWidths;
+	std::vector<unsigned int> levelHeights;
+
+	OcclusionStats stats;
+
+	void AddTriangles(const unsigned int* indices, unsigned int indexCount);
+	void SetupTriangle(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c);
+	void RasterizeTile(unsigned int tile);
+	void BuildPyramid();
+};
+
@@ -0,0 +1,540 @@
+#include "RenderBackend.h"
+
+#include <cstring>
+
+namespace
+{
+	std::unordered_map<ID3D11DeviceContext*, RenderBackend*> backends;
+}
+
+// --------------------------------------------------------
+// Finds the backend for a context, making a D3D11 one the
+// first time.  Backends live until Release() is called for
+// their context.
+// --------------------------------------------------------
+RenderBackend* RenderBackend::Get(ID3D11DeviceContext* context)
+{
+	RenderBackend*& backend = backends[context];
+	if (!backend)
+		backend = new D3D11RenderBackend(context);
+	return backend;
+}
+
+void RenderBackend::Set(ID3D11DeviceContext* context, RenderBackend* backend)
+{
+	RenderBackend*& current = backends[context];
+	if (current != backend)
+		delete current;
+	current = backend;
+}
+
+void RenderBackend::Release(ID3D11DeviceContext* context)
+{
+	auto found = backends.find(context);
+	if (found == backends.end())
+		return;
+
+	delete found->second;
+	backends.erase(found);
+}
+
+// --------------------------------------------------------
+// D3D11RenderBackend
+// --------------------------------------------------------
+
+D3D11RenderBackend::D3D11RenderBackend(ID3D11DeviceContext* context)
+{
+	this->context = context;
+
+	context1 = 0;
+	if (context)
+		context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&context1);
+}
+
+D3D11RenderBackend::~D3D11RenderBackend()
+{
+	if (context1)
+		context1->Release();
+}
+
+void D3D11RenderBackend::SetShader(ShaderStage stage, ID3D11DeviceChild* shader)
+{
+	stats.Binds++;
+	switch (stage)
+	{
+	case SHADER_STAGE_VERTEX:	context->VSSetShader(static_cast<ID3D11VertexShader*>(shader), 0, 0); break;
+	case SHADER_STAGE_HULL:		context->HSSetShader(static_cast<ID3D11HullShader*>(shader), 0, 0); break;
+	case SHADER_STAGE_DOMAIN:	context->DSSetShader(static_cast<ID3D11DomainShader*>(shader), 0, 0); break;
+	case SHADER_STAGE_GEOMETRY:	context->GSSetShader(static_cast<ID3D11GeometryShader*>(shader), 0, 0); break;
+	case SHADER_STAGE_PIXEL:	context->PSSetShader(static_cast<ID3D11PixelShader*>(shader), 0, 0); break;
+	case SHADER_STAGE_COMPUTE:	context->CSSetShader(static_cast<ID3D11ComputeShader*>(shader), 0, 0); break;
+	}
+}
+
+void D3D11RenderBackend::SetConstantBuffers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers)
+{
+	stats.Binds++;
+	switch (stage)
+	{
+	case SHADER_STAGE_VERTEX:	context->VSSetConstantBuffers(slot, count, buffers); break;
+	case SHADER_STAGE_HULL:		context->HSSetConstantBuffers(slot, count, buffers); break;
+	case SHADER_STAGE_DOMAIN:	context->DSSetConstantBuffers(slot, count, buffers); break;
+	case SHADER_STAGE_GEOMETRY:	context->GSSetConstantBuffers(slot, count, buffers); break;
+	case SHADER_STAGE_PIXEL:	context->PSSetConstantBuffers(slot, count, buffers); break;
+	case SHADER_STAGE_COMPUTE:	context->CSSetConstantBuffers(slot, count, buffers); break;
+	}
+}
+
+void D3D11RenderBackend::SetShaderResources(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11ShaderResourceView* const* views)
+{
+	stats.Binds++;
+	switch (stage)
+	{
+	case SHADER_STAGE_VERTEX:	context->VSSetShaderResources(slot, count, views); break;
+	case SHADER_STAGE_HULL:		context->HSSetShaderResources(slot, count, views); break;
+	case SHADER_STAGE_DOMAIN:	context->DSSetShaderResources(slot, count, views); break;
+	case SHADER_STAGE_GEOMETRY:	context->GSSetShaderResources(slot, count, views); break;
+	case SHADER_STAGE_PIXEL:	context->PSSetShaderResources(slot, count, views); break;
+	case SHADER_STAGE_COMPUTE:	context->CSSetShaderResources(slot, count, views); break;
+	}
+}
+
+void D3D11RenderBackend::SetSamplers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	stats.Binds++;
+	switch (stage)
+	{
+	case SHADER_STAGE_VERTEX:	context->VSSetSamplers(slot, count, samplers); break;
+	case SHADER_STAGE_HULL:		context->HSSetSamplers(slot, count, samplers); break;
+	case SHADER_STAGE_DOMAIN:	context->DSSetSamplers(slot, count, samplers); break;
+	case SHADER_STAGE_GEOMETRY:	context->GSSetSamplers(slot, count, samplers); break;
+	case SHADER_STAGE_PIXEL:	context->PSSetSamplers(slot, count, samplers); break;
+	case SHADER_STAGE_COMPUTE:	context->CSSetSamplers(slot, count, samplers); break;
+	}
+}
+
+bool D3D11RenderBackend::SetConstantBufferRange(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!context1)
+		return false;
+
+	stats.Binds++;
+	switch (stage)
+	{
+	case SHADER_STAGE_VERTEX:	context1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+	case SHADER_STAGE_HULL:		context1->HSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+	case SHADER_STAGE_DOMAIN:	context1->DSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+	case SHADER_STAGE_GEOMETRY:	context1->GSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+	case SHADER_STAGE_PIXEL:	context1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+	case SHADER_STAGE_COMPUTE:	context1->CSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+	}
+	return true;
+}
+
+void D3D11RenderBackend::SetUnorderedAccessViews(unsigned int slot, unsigned int count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts)
+{
+	stats.Binds++;
+	context->CSSetUnorderedAccessViews(slot, count, views, initialCounts);
+}
+
+void D3D11RenderBackend::SetStreamOutTargets(unsigned int count, ID3D11Buffer* const* buffers, const UINT* offsets)
+{
+	stats.Binds++;
+	context->SOSetTargets(count, buffers, offsets);
+}
+
+void D3D11RenderBackend::SetInputLayout(ID3D11InputLayout* layout)
+{
+	stats.Binds++;
+	context->IASetInputLayout(layout);
+}
+
+void D3D11RenderBackend::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	stats.Binds++;
+	context->IASetPrimitiveTopology(topology);
+}
+
+void D3D11RenderBackend::SetVertexBuffers(unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets)
+{
+	stats.Binds++;
+	context->IASetVertexBuffers(slot, count, buffers, strides, offsets);
+}
+
+void D3D11RenderBackend::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset)
+{
+	stats.Binds++;
+	context->IASetIndexBuffer(buffer, format, offset);
+}
+
+void D3D11RenderBackend::SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depthView)
+{
+	stats.Binds++;
+	context->OMSetRenderTargets(count, views, depthView);
+}
+
+void D3D11RenderBackend::SetViewports(unsigned int count, const D3D11_VIEWPORT* viewports)
+{
+	stats.Binds++;
+	context->RSSetViewports(count, viewports);
+}
+
+void D3D11RenderBackend::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	stats.Binds++;
+	context->RSSetState(state);
+}
+
+void D3D11RenderBackend::SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef)
+{
+	stats.Binds++;
+	context->OMSetDepthStencilState(state, stencilRef);
+}
+
+void D3D11RenderBackend::ClearRenderTarget(ID3D11RenderTargetView* view, const float color[4])
+{
+	context->ClearRenderTargetView(view, color);
+}
+
+void D3D11RenderBackend::ClearDepthStencil(ID3D11DepthStencilView* view, unsigned int flags, float depth, unsigned char stencil)
+{
+	context->ClearDepthStencilView(view, flags, depth, stencil);
+}
+
+void D3D11RenderBackend::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	stats.Draws++;
+	context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderBackend::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	stats.Draws++;
+	context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void D3D11RenderBackend::Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
+{
+	stats.Draws++;
+	context->Dispatch(groupsX, groupsY, groupsZ);
+}
+
+void* D3D11RenderBackend::Map(ID3D11Resource* resource, D3D11_MAP mapType, unsigned int offset, unsigned int size)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(resource, 0, mapType, 0, &mapped)))
+		return 0;
+
+	stats.BytesUploaded += size;
+	return (unsigned char*)mapped.pData + offset;
+}
+
+void D3D11RenderBackend::Unmap(ID3D11Resource* resource)
+{
+	context->Unmap(resource, 0);
+}
+
+void D3D11RenderBackend::UpdateSubresource(ID3D11Resource* resource, const D3D11_BOX* box, const void* data, unsigned int size)
+{
+	stats.BytesUploaded += size;
+
+	// The 11.1 version is the only one that takes a box on a
+	// constant buffer, and is the same as the old one otherwise
+	if (context1)
+		context1->UpdateSubresource1(resource, 0, box, data, 0, 0, 0);
+	else
+		context->UpdateSubresource(resource, 0, box, data, 0, 0);
+}
+
+// --------------------------------------------------------
+// RecordingRenderBackend
+// --------------------------------------------------------
+
+RecordingRenderBackend::RecordingRenderBackend()
+{
+	commandCount = 0;
+	header = 0;
+}
+
+void RecordingRenderBackend::Clear()
+{
+	commands.clear();
+	commandCount = 0;
+}
+
+void RecordingRenderBackend::Begin(RenderCommandType type)
+{
+	header = commands.size();
+	RenderCommand command = { (unsigned short)type, 0 };
+	unsigned int word;
+	memcpy(&word, &command, sizeof(word));
+	commands.push_back(word);
+}
+
+void RecordingRenderBackend::End()
+{
+	RenderCommand command = { 0, 0 };
+	memcpy(&command, &commands[header], sizeof(command));
+	command.Words = (unsigned short)(commands.size() - header - 1);
+	memcpy(&commands[header], &command, sizeof(command));
+	commandCount++;
+}
+
+void RecordingRenderBackend::Write(float word)
+{
+	unsigned int bits;
+	memcpy(&bits, &word, sizeof(bits));
+	commands.push_back(bits);
+}
+
+void RecordingRenderBackend::Write(const void* pointer)
+{
+	unsigned long long bits = (unsigned long long)(size_t)pointer;
+	commands.push_back((unsigned int)bits);
+	commands.push_back((unsigned int)(bits >> 32));
+}
+
+template<typename T>
+void RecordingRenderBackend::WriteArray(unsigned int count, const T* items)
+{
+	Write(count);
+	for (unsigned int i = 0; i < count; i++)
+		Write(items ? items[i] : T());
+}
+
+void RecordingRenderBackend::SetShader(ShaderStage stage, ID3D11DeviceChild* shader)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_SHADER);
+	Write((unsigned int)stage);
+	Write(shader);
+	End();
+}
+
+void RecordingRenderBackend::SetConstantBuffers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_CONSTANT_BUFFERS);
+	Write((unsigned int)stage);
+	Write(slot);
+	WriteArray(count, buffers);
+	End();
+}
+
+void RecordingRenderBackend::SetShaderResources(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11ShaderResourceView* const* views)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_SHADER_RESOURCES);
+	Write((unsigned int)stage);
+	Write(slot);
+	WriteArray(count, views);
+	End();
+}
+
+void RecordingRenderBackend::SetSamplers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_SAMPLERS);
+	Write((unsigned int)stage);
+	Write(slot);
+	WriteArray(count, samplers);
+	End();
+}
+
+// Recorded as if the 11.1 context were there, so the ring's
+// path is the one that gets measured
+bool RecordingRenderBackend::SetConstantBufferRange(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_CONSTANT_BUFFER_RANGE);
+	Write((unsigned int)stage);
+	Write(slot);
+	Write(buffer);
+	Write(firstConstant);
+	Write(constantCount);
+	End();
+	return true;
+}
+
+void RecordingRenderBackend::SetUnorderedAccessViews(unsigned int slot, unsigned int count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_UNORDERED_ACCESS_VIEWS);
+	Write(slot);
+	WriteArray(count, views);
+	WriteArray(count, initialCounts);
+	End();
+}
+
+void RecordingRenderBackend::SetStreamOutTargets(unsigned int count, ID3D11Buffer* const* buffers, const UINT* offsets)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_STREAM_OUT_TARGETS);
+	WriteArray(count, buffers);
+	WriteArray(count, offsets);
+	End();
+}
+
+void RecordingRenderBackend::SetInputLayout(ID3D11InputLayout* layout)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_INPUT_LAYOUT);
+	Write(layout);
+	End();
+}
+
+void RecordingRenderBackend::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_PRIMITIVE_TOPOLOGY);
+	Write((unsigned int)topology);
+	End();
+}
+
+void RecordingRenderBackend::SetVertexBuffers(unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_VERTEX_BUFFERS);
+	Write(slot);
+	WriteArray(count, buffers);
+	WriteArray(count, strides);
+	WriteArray(count, offsets);
+	End();
+}
+
+void RecordingRenderBackend::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_INDEX_BUFFER);
+	Write(buffer);
+	Write((unsigned int)format);
+	Write(offset);
+	End();
+}
+
+void RecordingRenderBackend::SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depthView)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_RENDER_TARGETS);
+	WriteArray(count, views);
+	Write(depthView);
+	End();
+}
+
+void RecordingRenderBackend::SetViewports(unsigned int count, const D3D11_VIEWPORT* viewports)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_VIEWPORTS);
+	Write(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Write(viewports[i].TopLeftX);
+		Write(viewports[i].TopLeftY);
+		Write(viewports[i].Width);
+		Write(viewports[i].Height);
+		Write(viewports[i].MinDepth);
+		Write(viewports[i].MaxDepth);
+	}
+	End();
+}
+
+void RecordingRenderBackend::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_RASTERIZER_STATE);
+	Write(state);
+	End();
+}
+
+void RecordingRenderBackend::SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef)
+{
+	stats.Binds++;
+	Begin(RENDER_COMMAND_SET_DEPTH_STENCIL_STATE);
+	Write(state);
+	Write(stencilRef);
+	End();
+}
+
+void RecordingRenderBackend::ClearRenderTarget(ID3D11RenderTargetView* view, const float color[4])
+{
+	Begin(RENDER_COMMAND_CLEAR_RENDER_TARGET);
+	Write(view);
+	for (unsigned int i = 0; i < 4; i++)
+		Write(color[i]);
+	End();
+}
+
+void RecordingRenderBackend::ClearDepthStencil(ID3D11DepthStencilView* view, unsigned int flags, float depth, unsigned char stencil)
+{
+	Begin(RENDER_COMMAND_CLEAR_DEPTH_STENCIL);
+	Write(view);
+	Write(flags);
+	Write(depth);
+	Write((unsigned int)stencil);
+	End();
+}
+
+void RecordingRenderBackend::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	stats.Draws++;
+	Begin(RENDER_COMMAND_DRAW_INDEXED);
+	Write(indexCount);
+	Write(startIndex);
+	Write(baseVertex);
+	End();
+}
+
+void RecordingRenderBackend::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	stats.Draws++;
+	Begin(RENDER_COMMAND_DRAW_INDEXED_INSTANCED);
+	Write(indexCount);
+	Write(instanceCount);
+	Write(startIndex);
+	Write(baseVertex);
+	Write(startInstance);
+	End();
+}
+
+void RecordingRenderBackend::Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
+{
+	stats.Draws++;
+	Begin(RENDER_COMMAND_DISPATCH);
+	Write(groupsX);
+	Write(groupsY);
+	Write(groupsZ);
+	End();
+}
+
+void* RecordingRenderBackend::Map(ID3D11Resource* resource, D3D11_MAP mapType, unsigned int offset, unsigned int size)
+{
+	std::vector<unsigned char>& memory = mapped[resource];
+	if (memory.size() < size)
+		memory.resize(size);
+
+	stats.BytesUploaded += size;
+	Begin(RENDER_COMMAND_MAP);
+	Write(resource);
+	Write((unsigned int)mapType);
+	Write(offset);
+	Write(size);
+	End();
+	return memory.data();
+}
+
+void RecordingRenderBackend::Unmap(ID3D11Resource* resource)
+{
+	Begin(RENDER_COMMAND_UNMAP);
+	Write(resource);
+	End();
+}
+
+void RecordingRenderBackend::UpdateSubresource(ID3D11Resource* resource, const D3D11_BOX* box, const void* data, unsigned int size)
+{
+	stats.BytesUploaded += size;
+	Begin(RENDER_COMMAND_UPDATE_SUBRESOURCE);
+	Write(resource);
+	Write(box ? box->left : 0u);
+	Write(size);
+	End();
+}
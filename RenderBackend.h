@@ -0,0 +1,248 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <unordered_map>
+#include <vector>
+
+enum ShaderStage
+{
+	SHADER_STAGE_VERTEX,
+	SHADER_STAGE_HULL,
+	SHADER_STAGE_DOMAIN,
+	SHADER_STAGE_GEOMETRY,
+	SHADER_STAGE_PIXEL,
+	SHADER_STAGE_COMPUTE,
+	SHADER_STAGE_COUNT
+};
+
+// --------------------------------------------------------
+// What reached a backend since the last ResetStats()
+// --------------------------------------------------------
+struct RenderBackendStats
+{
+	unsigned int Draws;				// Draws and dispatches
+	unsigned int Binds;				// Shaders, resources, buffers and states
+	unsigned long long BytesUploaded;	// Through Map() and UpdateSubresource()
+};
+
+// --------------------------------------------------------
+// The device context calls everything above the device makes,
+// behind one interface
+//
+// D3D11RenderBackend passes them straight to a context, and
+// is what Get() makes by default.  RecordingRenderBackend
+// only writes them down, so the whole frame path can run
+// (and be timed, and have its draws and binds counted)
+// without anything being drawn - see DXCore::InitHeadless().
+//
+// Resources are only ever passed through as pointers, so the
+// device still has to create them.
+// --------------------------------------------------------
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() { }
+
+	// The one backend everything on a context goes through,
+	// made the first time it's asked for.  Set() swaps in a
+	// different one (and owns it), and has to happen before
+	// anything else asks for the context's backend.
+	static RenderBackend* Get(ID3D11DeviceContext* context);
+	static void Set(ID3D11DeviceContext* context, RenderBackend* backend);
+	static void Release(ID3D11DeviceContext* context);
+
+	// Any of the six shader types, for that stage
+	virtual void SetShader(ShaderStage stage, ID3D11DeviceChild* shader) = 0;
+
+	virtual void SetConstantBuffers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers) = 0;
+	virtual void SetShaderResources(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11ShaderResourceView* const* views) = 0;
+	virtual void SetSamplers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11SamplerState* const* samplers) = 0;
+
+	// Part of a buffer, in 16 byte constants.  False without the
+	// 11.1 context.
+	virtual bool SetConstantBufferRange(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount) = 0;
+
+	virtual void SetUnorderedAccessViews(unsigned int slot, unsigned int count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts) = 0;
+	virtual void SetStreamOutTargets(unsigned int count, ID3D11Buffer* const* buffers, const UINT* offsets) = 0;
+
+	virtual void SetInputLayout(ID3D11InputLayout* layout) = 0;
+	virtual void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual void SetVertexBuffers(unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets) = 0;
+	virtual void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset) = 0;
+
+	virtual void SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depthView) = 0;
+	virtual void SetViewports(unsigned int count, const D3D11_VIEWPORT* viewports) = 0;
+	virtual void SetRasterizerState(ID3D11RasterizerState* state) = 0;
+	virtual void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef) = 0;
+
+	virtual void ClearRenderTarget(ID3D11RenderTargetView* view, const float color[4]) = 0;
+	virtual void ClearDepthStencil(ID3D11DepthStencilView* view, unsigned int flags, float depth, unsigned char stencil) = 0;
+
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) = 0;
+	virtual void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) = 0;
+
+	// Maps subresource 0 to write "size" bytes at "offset",
+	// returning where those bytes go, or null on failure
+	virtual void* Map(ID3D11Resource* resource, D3D11_MAP mapType, unsigned int offset, unsigned int size) = 0;
+	virtual void Unmap(ID3D11Resource* resource) = 0;
+
+	// Copies "size" bytes to subresource 0, or to just the box.
+	// A box on a constant buffer needs the 11.1 context.
+	virtual void UpdateSubresource(ID3D11Resource* resource, const D3D11_BOX* box, const void* data, unsigned int size) = 0;
+
+	RenderBackendStats& GetStats() { return stats; }
+	void ResetStats() { stats = RenderBackendStats(); }
+
+protected:
+	RenderBackendStats stats;
+
+	RenderBackend() { stats = RenderBackendStats(); }
+};
+
+// --------------------------------------------------------
+// Everything goes straight to the device context
+// --------------------------------------------------------
+class D3D11RenderBackend : public RenderBackend
+{
+public:
+	D3D11RenderBackend(ID3D11DeviceContext* context);
+	~D3D11RenderBackend();
+
+	void SetShader(ShaderStage stage, ID3D11DeviceChild* shader);
+	void SetConstantBuffers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers);
+	void SetShaderResources(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11SamplerState* const* samplers);
+	bool SetConstantBufferRange(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
+	void SetUnorderedAccessViews(unsigned int slot, unsigned int count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts);
+	void SetStreamOutTargets(unsigned int count, ID3D11Buffer* const* buffers, const UINT* offsets);
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetVertexBuffers(unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset);
+	void SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depthView);
+	void SetViewports(unsigned int count, const D3D11_VIEWPORT* viewports);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+	void ClearRenderTarget(ID3D11RenderTargetView* view, const float color[4]);
+	void ClearDepthStencil(ID3D11DepthStencilView* view, unsigned int flags, float depth, unsigned char stencil);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+	void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
+	void* Map(ID3D11Resource* resource, D3D11_MAP mapType, unsigned int offset, unsigned int size);
+	void Unmap(ID3D11Resource* resource);
+	void UpdateSubresource(ID3D11Resource* resource, const D3D11_BOX* box, const void* data, unsigned int size);
+
+private:
+	ID3D11DeviceContext* context;
+	ID3D11DeviceContext1* context1;
+};
+
+// --------------------------------------------------------
+// What a RecordingRenderBackend writes for each call
+// --------------------------------------------------------
+enum RenderCommandType
+{
+	RENDER_COMMAND_SET_SHADER,
+	RENDER_COMMAND_SET_CONSTANT_BUFFERS,
+	RENDER_COMMAND_SET_SHADER_RESOURCES,
+	RENDER_COMMAND_SET_SAMPLERS,
+	RENDER_COMMAND_SET_CONSTANT_BUFFER_RANGE,
+	RENDER_COMMAND_SET_UNORDERED_ACCESS_VIEWS,
+	RENDER_COMMAND_SET_STREAM_OUT_TARGETS,
+	RENDER_COMMAND_SET_INPUT_LAYOUT,
+	RENDER_COMMAND_SET_PRIMITIVE_TOPOLOGY,
+	RENDER_COMMAND_SET_VERTEX_BUFFERS,
+	RENDER_COMMAND_SET_INDEX_BUFFER,
+	RENDER_COMMAND_SET_RENDER_TARGETS,
+	RENDER_COMMAND_SET_VIEWPORTS,
+	RENDER_COMMAND_SET_RASTERIZER_STATE,
+	RENDER_COMMAND_SET_DEPTH_STENCIL_STATE,
+	RENDER_COMMAND_CLEAR_RENDER_TARGET,
+	RENDER_COMMAND_CLEAR_DEPTH_STENCIL,
+	RENDER_COMMAND_DRAW_INDEXED,
+	RENDER_COMMAND_DRAW_INDEXED_INSTANCED,
+	RENDER_COMMAND_DISPATCH,
+	RENDER_COMMAND_MAP,
+	RENDER_COMMAND_UNMAP,
+	RENDER_COMMAND_UPDATE_SUBRESOURCE,
+	RENDER_COMMAND_COUNT
+};
+
+// --------------------------------------------------------
+// The start of every recorded command.  The call's arguments
+// follow it as 4 byte words - pointers as two words, arrays
+// as a count and then their items.  Uploaded bytes aren't
+// kept, only how many there were.
+// --------------------------------------------------------
+struct RenderCommand
+{
+	unsigned short Type;		// A RenderCommandType
+	unsigned short Words;		// Argument words after this header
+
+	const unsigned int* GetArgs() const { return (const unsigned int*)(this + 1); }
+	const RenderCommand* GetNext() const { return (const RenderCommand*)(GetArgs() + Words); }
+};
+
+// --------------------------------------------------------
+// Writes every call into one linear buffer and does nothing
+// else.  Nothing on the GPU changes, so Map() hands out
+// memory of its own (one block per resource, kept for reuse).
+//
+// The buffer keeps growing until Clear(), which keeps its
+// memory - clear it once a frame and recording allocates
+// nothing after the first few frames.
+// --------------------------------------------------------
+class RecordingRenderBackend : public RenderBackend
+{
+public:
+	RecordingRenderBackend();
+
+	// Walk from GetFirst() with GetNext() until GetEnd()
+	const RenderCommand* GetFirst() const { return (const RenderCommand*)commands.data(); }
+	const RenderCommand* GetEnd() const { return (const RenderCommand*)(commands.data() + commands.size()); }
+	unsigned int GetCommandCount() const { return commandCount; }
+	size_t GetRecordedBytes() const { return commands.size() * sizeof(unsigned int); }
+
+	void Clear();
+
+	void SetShader(ShaderStage stage, ID3D11DeviceChild* shader);
+	void SetConstantBuffers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers);
+	void SetShaderResources(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11SamplerState* const* samplers);
+	bool SetConstantBufferRange(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
+	void SetUnorderedAccessViews(unsigned int slot, unsigned int count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts);
+	void SetStreamOutTargets(unsigned int count, ID3D11Buffer* const* buffers, const UINT* offsets);
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetVertexBuffers(unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset);
+	void SetRenderTargets(unsigned int count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depthView);
+	void SetViewports(unsigned int count, const D3D11_VIEWPORT* viewports);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+	void ClearRenderTarget(ID3D11RenderTargetView* view, const float color[4]);
+	void ClearDepthStencil(ID3D11DepthStencilView* view, unsigned int flags, float depth, unsigned char stencil);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+	void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
+	void* Map(ID3D11Resource* resource, D3D11_MAP mapType, unsigned int offset, unsigned int size);
+	void Unmap(ID3D11Resource* resource);
+	void UpdateSubresource(ID3D11Resource* resource, const D3D11_BOX* box, const void* data, unsigned int size);
+
+private:
+	std::vector<unsigned int> commands;
+	unsigned int commandCount;
+	size_t header;			// Where the command being written starts
+
+	std::unordered_map<ID3D11Resource*, std::vector<unsigned char>> mapped;
+
+	void Begin(RenderCommandType type);
+	void Write(unsigned int word) { commands.push_back(word); }
+	void Write(int word) { commands.push_back((unsigned int)word); }
+	void Write(float word);
+	void Write(const void* pointer);
+	template<typename T> void WriteArray(unsigned int count, const T* items);
+	void End();
+};
@@ -0,0 +1,429 @@
+#include "RenderQueue.h"
+
+#include <cassert>
+#include <cstring>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+RenderQueue::RenderQueue(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	this->device = device;
+	this->context = context;
+	backend = RenderBackend::Get(context);
+	instanceBuffer = 0;
+	instanceCapacity = 0;
+	objectsUploaded = false;
+	memset(&stats, 0, sizeof(stats));
+
+	objectRing = new ConstantBufferRing(device, context);
+	if (!objectRing->IsSupported())
+	{
+		delete objectRing;
+		objectRing = 0;
+	}
+}
+
+RenderQueue::~RenderQueue()
+{
+	if (instanceBuffer) instanceBuffer->Release();
+	delete objectRing;
+	for (auto& material : materials)
+		delete material;
+}
+
+unsigned int RenderQueue::AddShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader, SimpleVertexShader* fallbackVertexShader)
+{
+	assert(shaders.size() < MaxShaders && "Too many shader pairs for the sort key");
+
+	ShaderPair pair;
+	pair.VertexShader = vertexShader;
+	pair.PixelShader = pixelShader;
+	pair.Instanced = vertexShader->GetPerInstanceCompatible();
+	pair.World = vertexShader->GetVariableHandle("world");
+
+	pair.FallbackVertexShader = 0;
+	if (pair.Instanced && fallbackVertexShader)
+	{
+		pair.FallbackVertexShader = fallbackVertexShader;
+		pair.FallbackWorld = fallbackVertexShader->GetVariableHandle("world");
+	}
+
+	pair.ObjectBuffer = 0;
+	if (objectRing && !pair.Instanced && pair.World.IsValid())
+	{
+		pair.ObjectBuffer = vertexShader->GetBufferInfo(SIMPLE_BUFFER_PER_OBJECT);
+		if (pair.ObjectBuffer)
+			vertexShader->SetObjectDataExternal(true);
+	}
+	shaders.push_back(pair);
+	return (unsigned int)shaders.size() - 1;
+}
+
+// --------------------------------------------------------
+// Materials are numbered in the order they're added, which
+// is the order they sort in
+// --------------------------------------------------------
+unsigned int RenderQueue::AddMaterial(Material* material)
+{
+	assert(materials.size() < MaxMaterials && "Too many materials for the sort key");
+
+	material->id = (unsigned int)materials.size();
+	materials.push_back(material);
+	return material->id;
+}
+
+// --------------------------------------------------------
+// Forgets last frame's draws (keeping the memory) and
+// starts counting stats again
+// --------------------------------------------------------
+void RenderQueue::Clear()
+{
+	draws.clear();
+	entries.clear();
+	meshIds.clear();
+	memset(&stats, 0, sizeof(stats));
+}
+
+// --------------------------------------------------------
+// Queues one draw
+//
+// depth - Anything that grows with distance from the camera
+//         (squared distance is fine), never negative
+//
+// Returns false, queuing nothing, if an id is unknown or too
+// big for its part of the key.
+// --------------------------------------------------------
+bool RenderQueue::Submit(RenderPass pass, unsigned int shaderId, unsigned int materialId, Mesh* mesh, const XMFLOAT4X4* world, float depth)
+{
+	// Meshes are numbered in the order they're first seen this frame
+	auto found = meshIds.find(mesh);
+	unsigned int meshId = found != meshIds.end() ? found->second : (unsigned int)meshIds.size();
+
+	if ((unsigned int)pass >= MaxPasses ||
+		shaderId >= shaders.size() || shaderId >= MaxShaders ||
+		materialId >= materials.size() || materialId >= MaxMaterials ||
+		meshId >= MaxMeshes)
+	{
+		assert(!"Draw ids don't fit the sort key");
+		stats.Rejected++;
+		return false;
+	}
+	if (found == meshIds.end())
+		meshIds[mesh] = meshId;
+
+	// Positive floats sort the same as their bits, so the top
+	// 24 bits of the float are a good enough depth
+	unsigned int depthBits;
+	if (depth < 0.0f) depth = 0.0f;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	SortEntry entry;
+	entry.Key =
+		((unsigned long long)pass << PassShift) |
+		((unsigned long long)shaderId << ShaderShift) |
+		((unsigned long long)materialId << MaterialShift) |
+		((unsigned long long)meshId << MeshShift) |
+		(depthBits >> 8);
+	entry.Draw = (unsigned int)draws.size();
+	entries.push_back(entry);
+
+	DrawCall draw;
+	draw.MeshData = mesh;
+	draw.World = world;
+	draws.push_back(draw);
+	return true;
+}
+
+// --------------------------------------------------------
+// LSD radix sort on the keys, a byte at a time.  Bytes that
+// are the same in every key (most of the high ones, usually)
+// are skipped without moving anything.
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	LARGE_INTEGER start, end, frequency;
+	QueryPerformanceCounter(&start);
+
+	unsigned int count = (unsigned int)entries.size();
+	scratch.resize(count);
+
+	// One histogram per byte, all filled in a single pass
+	unsigned int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned long long key = entries[i].Key;
+		for (int b = 0; b < 8; b++)
+			histograms[b][(key >> (b * 8)) & 0xFF]++;
+	}
+
+	SortEntry* from = count > 0 ? &entries[0] : 0;
+	SortEntry* to = count > 0 ? &scratch[0] : 0;
+	for (int b = 0; b < 8; b++)
+	{
+		unsigned int* histogram = histograms[b];
+		int shift = b * 8;
+
+		// Everything in one bucket?  Nothing to do for this byte.
+		if (count == 0 || histogram[(from[0].Key >> shift) & 0xFF] == count)
+			continue;
+
+		unsigned int offsets[256];
+		unsigned int sum = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			offsets[d] = sum;
+			sum += histogram[d];
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+			to[offsets[(from[i].Key >> shift) & 0xFF]++] = from[i];
+
+		SortEntry* swap = from;
+		from = to;
+		to = swap;
+	}
+
+	// Odd number of passes leaves the result in the scratch array
+	if (count > 0 && from != &entries[0])
+		entries.swap(scratch);
+
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+	stats.SortMilliseconds += (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+
+	// Every pass's draws are known now, so their per-object
+	// constants can all go up together.  If the ring can't take
+	// them, ring-fed shaders upload their own per-object buffer
+	// on every draw instead, for this frame only.
+	objectsUploaded = FillObjectRing();
+	for (auto& pair : shaders)
+	{
+		if (pair.ObjectBuffer)
+			pair.VertexShader->SetObjectDataExternal(objectsUploaded);
+	}
+}
+
+// --------------------------------------------------------
+// Writes the per-object constants of every ring-fed draw,
+// in sorted order, with a single Map() of the ring
+// --------------------------------------------------------
+bool RenderQueue::FillObjectRing()
+{
+	if (!objectRing)
+		return false;
+
+	unsigned int count = (unsigned int)entries.size();
+	objectOffsets.resize(count);
+
+	unsigned int size = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ShaderPair& pair = shaders[(unsigned int)(entries[i].Key >> ShaderShift) & 0xFF];
+		if (!pair.ObjectBuffer)
+			continue;
+
+		objectOffsets[i] = size;
+		size += ConstantBufferRing::Align(pair.ObjectBuffer->Size);
+	}
+
+	if (size == 0)
+		return true;
+
+	unsigned int base;
+	unsigned char* data = objectRing->Map(size, base);
+	if (!data)
+		return false;
+
+	// The world matrix goes through the shader's local copy of
+	// the buffer, which is then copied whole into the ring
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ShaderPair& pair = shaders[(unsigned int)(entries[i].Key >> ShaderShift) & 0xFF];
+		if (!pair.ObjectBuffer)
+			continue;
+
+		pair.VertexShader->SetMatrix4x4(pair.World, *draws[entries[i].Draw].World);
+		memcpy(data + objectOffsets[i], pair.ObjectBuffer->LocalDataBuffer, pair.ObjectBuffer->Size);
+		objectOffsets[i] += base;
+	}
+
+	objectRing->Unmap();
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies the world matrices of every instanced draw in
+// [begin, end) into the instance buffer, in sorted order,
+// growing the buffer first if it's too small
+// --------------------------------------------------------
+bool RenderQueue::FillInstanceBuffer(unsigned int begin, unsigned int end)
+{
+	unsigned int needed = end - begin;
+	if (needed > instanceCapacity)
+	{
+		unsigned int capacity = instanceCapacity > 0 ? instanceCapacity : 64;
+		while (capacity < needed) capacity *= 2;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = capacity * sizeof(XMFLOAT4X4);
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		ID3D11Buffer* buffer = 0;
+		if (FAILED(device->CreateBuffer(&desc, 0, &buffer)))
+			return false;
+
+		if (instanceBuffer) instanceBuffer->Release();
+		instanceBuffer = buffer;
+		instanceCapacity = capacity;
+	}
+
+	XMFLOAT4X4* instances = (XMFLOAT4X4*)backend->Map(instanceBuffer, D3D11_MAP_WRITE_DISCARD, 0, needed * sizeof(XMFLOAT4X4));
+	if (!instances)
+		return false;
+
+	// Matrices are already transposed, which is what the shader wants
+	for (unsigned int i = begin; i < end; i++)
+	{
+		unsigned int shaderId = (unsigned int)(entries[i].Key >> ShaderShift) & 0xFF;
+		if (shaders[shaderId].Instanced)
+			*instances++ = *draws[entries[i].Draw].World;
+	}
+
+	backend->Unmap(instanceBuffer);
+	return true;
+}
+
+// --------------------------------------------------------
+// Issues one pass's draws, in key order.  Shaders, material
+// textures and mesh buffers are only bound when they differ
+// from the previous draw's.
+// --------------------------------------------------------
+void RenderQueue::Draw(RenderPass pass)
+{
+	// Keys are sorted, so the pass is one contiguous range
+	unsigned long long passKey = (unsigned long long)pass << PassShift;
+	unsigned int count = (unsigned int)entries.size();
+	unsigned int begin = 0;
+	while (begin < count && entries[begin].Key < passKey) begin++;
+	unsigned int end = begin;
+	while (end < count && (entries[end].Key >> PassShift) == (unsigned long long)pass) end++;
+
+	// Upload every instance in the pass at once
+	bool anyInstanced = false;
+	for (unsigned int i = begin; i < end && !anyInstanced; i++)
+		anyInstanced = shaders[(unsigned int)(entries[i].Key >> ShaderShift) & 0xFF].Instanced;
+	bool instancing = anyInstanced && FillInstanceBuffer(begin, end);
+	unsigned int nextInstance = 0;
+
+	// Whatever was bound before this pass is unknown
+	const unsigned int none = 0xFFFFFFFF;
+	unsigned int currentShaders = none;
+	unsigned int currentMaterial = none;
+	Mesh* currentMesh = 0;
+	ShaderPair* shaderPair = 0;
+	StateCache* state = StateCache::Get(context);
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	if (instancing)
+	{
+		UINT instanceStride = sizeof(XMFLOAT4X4);
+		state->SetVertexBuffers(1, 1, &instanceBuffer, &instanceStride, &offset);
+	}
+
+	unsigned int i = begin;
+	while (i < end)
+	{
+		unsigned long long key = entries[i].Key;
+		DrawCall& draw = draws[entries[i].Draw];
+		unsigned int shaderId = (unsigned int)(key >> ShaderShift) & 0xFF;
+		unsigned int materialId = (unsigned int)(key >> MaterialShift) & 0xFFF;
+
+		if (shaderId != currentShaders)
+		{
+			shaderPair = &shaders[shaderId];
+			shaderPair->VertexShader->SetShader();
+			shaderPair->PixelShader->SetShader();
+			currentShaders = shaderId;
+			currentMaterial = none;	// Its constants went to the old pixel shader
+			stats.ShaderChanges++;
+
+			// Instanced and ring-fed shaders only need their
+			// per-pass constants
+			if (shaderPair->Instanced || shaderPair->ObjectBuffer)
+				shaderPair->VertexShader->CopyAllBufferData();
+		}
+
+		if (materialId != currentMaterial)
+		{
+			materials[materialId]->Apply(state);
+			currentMaterial = materialId;
+			stats.MaterialChanges++;
+		}
+
+		if (draw.MeshData != currentMesh)
+		{
+			ID3D11Buffer* vb = draw.MeshData->GetVertexBuffer();
+			state->SetVertexBuffers(0, 1, &vb, &stride, &offset);
+			state->SetIndexBuffer(draw.MeshData->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
+			currentMesh = draw.MeshData;
+			stats.MeshChanges++;
+		}
+
+		if (shaderPair->Instanced)
+		{
+			// Everything up to the depth bits matches, so it can
+			// all go in one draw
+			unsigned int groupEnd = i + 1;
+			while (groupEnd < end && (entries[groupEnd].Key >> MeshShift) == (key >> MeshShift))
+				groupEnd++;
+
+			unsigned int instanceCount = groupEnd - i;
+			if (instancing)
+			{
+				backend->DrawIndexedInstanced(draw.MeshData->GetIndexCount(), instanceCount, 0, 0, nextInstance);
+				stats.Draws++;
+				stats.Instances += instanceCount;
+			}
+			else if (shaderPair->FallbackVertexShader)
+			{
+				// No instance buffer this frame, so one draw each
+				SimpleVertexShader* fallback = shaderPair->FallbackVertexShader;
+				fallback->SetShader();
+				for (unsigned int d = i; d < groupEnd; d++)
+				{
+					fallback->SetMatrix4x4(shaderPair->FallbackWorld, *draws[entries[d].Draw].World);
+					fallback->CopyAllBufferData();
+					backend->DrawIndexed(draw.MeshData->GetIndexCount(), 0, 0);
+				}
+				stats.Draws += instanceCount;
+				stats.Instances += instanceCount;
+
+				// The instanced vertex shader has to be set again
+				currentShaders = none;
+			}
+			nextInstance += instanceCount;
+			i = groupEnd;
+			continue;
+		}
+
+		// The world matrix is the only per-draw constant, and
+		// it's already in the ring if this shader uses it
+		if (shaderPair->ObjectBuffer && objectsUploaded)
+			objectRing->Bind(SHADER_STAGE_VERTEX, shaderPair->ObjectBuffer->BindIndex, objectOffsets[i], shaderPair->ObjectBuffer->Size);
+		else
+		{
+			shaderPair->VertexShader->SetMatrix4x4(shaderPair->World, *draw.World);
+			shaderPair->VertexShader->CopyAllBufferData();
+		}
+
+		backend->DrawIndexed(draw.MeshData->GetIndexCount(), 0, 0);
+		stats.Draws++;
+		stats.Instances++;
+		i++;
+	}
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <vector>
+#include <unordered_map>
+
+#include "SimpleShader.h"
+#include "ConstantBufferRing.h"
+#include "Material.h"
+#include "Mesh.h"
+
+// Passes are drawn separately, so they sort first
+enum RenderPass
+{
+	RENDER_PASS_REFRACTION,
+	RENDER_PASS_OPAQUE
+};
+
+// --------------------------------------------------------
+// What the last frame cost
+// --------------------------------------------------------
+struct RenderStats
+{
+	unsigned int Draws;
+	unsigned int Instances;		// Entities drawn, across all draws
+	unsigned int ShaderChanges;
+	unsigned int MaterialChanges;
+	unsigned int MeshChanges;
+	unsigned int Rejected;		// Submits with ids too big for their key field
+	double SortMilliseconds;
+
+	unsigned int GetStateChanges() { return ShaderChanges + MaterialChanges + MeshChanges; }
+};
+
+// --------------------------------------------------------
+// Collects a frame's draws and issues them in sorted order
+//
+// Each draw gets a 64-bit key, most significant first:
+//    pass (4 bits) | shaders (8) | material (12) | mesh (16) | depth (24)
+// so one radix sort groups draws by state, and front to back
+// within a state.  Draw() then only rebinds what changed from
+// the previous draw.  Ids that don't fit their field would
+// sort (and be drawn) as some other id, so those draws are
+// rejected instead.
+//
+// Per-pass values (view, projection, lights) are set on the
+// shaders by the caller before Draw().  Everything else the
+// pixel shader reads comes from the draw's Material.
+//
+// Shaders whose vertex shader takes a per-instance world matrix
+// (VertexShader.hlsl's INSTANCED variant) are instanced: every run of draws with
+// the same shaders, material and mesh becomes one
+// DrawIndexedInstanced, with the world matrices streamed
+// through a dynamic vertex buffer.
+//
+// Other shaders with a "perObject" constant buffer get theirs
+// out of a ConstantBufferRing when D3D 11.1 allows it: Sort()
+// writes every draw's per-object constants in one Map(), and
+// each draw just binds its block by offset.  Without 11.1 the
+// shader's own buffer is updated per draw instead.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	RenderQueue(ID3D11Device* device, ID3D11DeviceContext* context);
+	~RenderQueue();
+
+	// Registered once, up front.  Both return the id to submit with.
+	// The queue owns the materials, which have to be made for the
+	// pixel shader they're drawn with.
+	//
+	// fallbackVertexShader - For an instanced vertex shader, a plain
+	//                        one to draw with one entity at a time in
+	//                        frames where the instance buffer can't be
+	//                        filled.  It must not be registered itself.
+	unsigned int AddShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader, SimpleVertexShader* fallbackVertexShader = 0);
+	unsigned int AddMaterial(Material* material);
+
+	// Per frame: Clear(), Submit() everything, Sort(), then Draw() each
+	// pass.  Submit() fails for ids past what the key holds, or when a
+	// frame uses more meshes than that.
+	void Clear();
+	bool Submit(RenderPass pass, unsigned int shaders, unsigned int material, Mesh* mesh, const DirectX::XMFLOAT4X4* world, float depth);
+	void Sort();
+	void Draw(RenderPass pass);
+
+	// Covers everything since the last Clear()
+	RenderStats& GetStats() { return stats; }
+
+private:
+	static const int PassShift = 60;
+	static const int ShaderShift = 52;
+	static const int MaterialShift = 40;
+	static const int MeshShift = 24;
+
+	// How many of each fit in the key
+	static const unsigned int MaxPasses = 1 << 4;
+	static const unsigned int MaxShaders = 1 << 8;
+	static const unsigned int MaxMaterials = 1 << 12;
+	static const unsigned int MaxMeshes = 1 << 16;
+
+	struct ShaderPair
+	{
+		SimpleVertexShader* VertexShader;
+		SimplePixelShader* PixelShader;
+		bool Instanced;
+
+		// Set per draw, so looked up up front
+		SimpleShaderHandle World;
+
+		// Instanced pairs only - used when instancing fails
+		SimpleVertexShader* FallbackVertexShader;
+		SimpleShaderHandle FallbackWorld;
+
+		// The vertex shader's per-object buffer, when it's fed
+		// from the ring instead
+		const SimpleConstantBuffer* ObjectBuffer;
+	};
+
+	struct DrawCall
+	{
+		Mesh* MeshData;
+		const DirectX::XMFLOAT4X4* World;
+	};
+
+	struct SortEntry
+	{
+		unsigned long long Key;
+		unsigned int Draw;
+	};
+
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+	RenderBackend* backend;
+
+	std::vector<ShaderPair> shaders;
+	std::vector<Material*> materials;	// By id
+
+	// This frame's draws, and their keys in (eventually) sorted order
+	std::vector<DrawCall> draws;
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+	std::unordered_map<Mesh*, unsigned int> meshIds;
+
+	// Per-instance world matrices, grown as needed
+	ID3D11Buffer* instanceBuffer;
+	unsigned int instanceCapacity;
+	bool FillInstanceBuffer(unsigned int begin, unsigned int end);
+
+	// Per-object constants, and where each sorted entry's are
+	ConstantBufferRing* objectRing;
+	std::vector<unsigned int> objectOffsets;
+	bool objectsUploaded;
+	bool FillObjectRing();
+
+	RenderStats stats;
+};
+
@@ -1,198 +1,203 @@
-#include "RenderTexture.h"
-
-
-
-RenderTexture::RenderTexture()
-{
-	_renderTargetTexture = 0;
-	_renderTargetView = 0;
-	_shaderResourceView = 0;
-	_depthStencilBuffer = 0;
-	_depthStencilView = 0;
-}
-
-
-RenderTexture::~RenderTexture()
-{
-	if (_depthStencilView)
-	{
-		_depthStencilView->Release();
-		_depthStencilView = 0;
-	}
-
-	if (_depthStencilBuffer)
-	{
-		_depthStencilBuffer->Release();
-		_depthStencilBuffer = 0;
-	}
-
-	if (_shaderResourceView)
-	{
-		_shaderResourceView->Release();
-		_shaderResourceView = 0;
-	}
-
-	if (_renderTargetView)
-	{
-		_renderTargetView->Release();
-		_renderTargetView = 0;
-	}
-
-	if (_renderTargetTexture)
-	{
-		_renderTargetTexture->Release();
-		_renderTargetTexture = 0;
-	}
-
-	return;
-}
-
-bool RenderTexture::Initialize(ID3D11Device * device, int textureWidth, int textureHeight, float screenDepth, float screenNear)
-{
-	D3D11_TEXTURE2D_DESC textureDesc;
-	HRESULT result;
-	D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc;
-	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
-	D3D11_TEXTURE2D_DESC depthBufferDesc;
-	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
-
-
-	// Initialize the render target texture description.
-	ZeroMemory(&textureDesc, sizeof(textureDesc));
-
-	// Setup the render target texture description.
-	textureDesc.Width = textureWidth;
-	textureDesc.Height = textureHeight;
-	textureDesc.MipLevels = 1;
-	textureDesc.ArraySize = 1;
-	textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.MiscFlags = 0;
-
-	// Create the render target texture.
-	result = device->CreateTexture2D(&textureDesc, NULL, &_renderTargetTexture);
-	if (FAILED(result))
-	{
-		return false;
-	}
-
-	// Setup the description of the render target view.
-	renderTargetViewDesc.Format = textureDesc.Format;
-	renderTargetViewDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	renderTargetViewDesc.Texture2D.MipSlice = 0;
-
-	// Create the render target view.
-	result = device->CreateRenderTargetView(_renderTargetTexture, &renderTargetViewDesc, &_renderTargetView);
-	if (FAILED(result))
-	{
-		return false;
-	}
-
-	// Setup the description of the shader resource view.
-	shaderResourceViewDesc.Format = textureDesc.Format;
-	shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
-	shaderResourceViewDesc.Texture2D.MipLevels = 1;
-
-	// Create the shader resource view.
-	result = device->CreateShaderResourceView(_renderTargetTexture, &shaderResourceViewDesc, &_shaderResourceView);
-	if (FAILED(result))
-	{
-		return false;
-	}
-
-	// Initialize the description of the depth buffer.
-	ZeroMemory(&depthBufferDesc, sizeof(depthBufferDesc));
-
-	// Set up the description of the depth buffer.
-	depthBufferDesc.Width = textureWidth;
-	depthBufferDesc.Height = textureHeight;
-	depthBufferDesc.MipLevels = 1;
-	depthBufferDesc.ArraySize = 1;
-	depthBufferDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	depthBufferDesc.SampleDesc.Count = 1;
-	depthBufferDesc.SampleDesc.Quality = 0;
-	depthBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	depthBufferDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-	depthBufferDesc.CPUAccessFlags = 0;
-	depthBufferDesc.MiscFlags = 0;
-
-	// Create the texture for the depth buffer using the filled out description.
-	result = device->CreateTexture2D(&depthBufferDesc, NULL, &_depthStencilBuffer);
-	if (FAILED(result))
-	{
-		return false;
-	}
-
-	// Initailze the depth stencil view description.
-	ZeroMemory(&depthStencilViewDesc, sizeof(depthStencilViewDesc));
-
-	// Set up the depth stencil view description.
-	depthStencilViewDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	depthStencilViewDesc.Texture2D.MipSlice = 0;
-
-	// Create the depth stencil view.
-	result = device->CreateDepthStencilView(_depthStencilBuffer, &depthStencilViewDesc, &_depthStencilView);
-	if (FAILED(result))
-	{
-		return false;
-	}
-
-	// Setup the viewport for rendering.
-	_viewport.Width = (float)textureWidth;
-	_viewport.Height = (float)textureHeight;
-	_viewport.MinDepth = 0.0f;
-	_viewport.MaxDepth = 1.0f;
-	_viewport.TopLeftX = 0.0f;
-	_viewport.TopLeftY = 0.0f;
-
-	// Setup the projection matrix.
-	XMMATRIX proj = XMMatrixPerspectiveFovLH(((float)XM_PI / 4.0f), ((float)textureWidth / (float)textureHeight), screenNear, screenDepth);
-	XMStoreFloat4x4(&_projectionMatrix, proj);
-
-	// Create an orthographic projection matrix for 2D rendering.
-	XMMATRIX ortho = XMMatrixOrthographicLH((float)textureWidth, (float)textureHeight, screenNear, screenDepth);
-	XMStoreFloat4x4(&_orthoMatrix, ortho);
-
-	return true;
-}
-
-void RenderTexture::SetRenderTarget(ID3D11DeviceContext * context)
-{
-	// Bind the render target view and depth stencil buffer to the output render pipeline.
-	context->OMSetRenderTargets(1, &_renderTargetView, _depthStencilView);
-
-	// Set the viewport.
-	context->RSSetViewports(1, &_viewport);
-
-	return;
-}
-
-void RenderTexture::ClearRenderTarget(ID3D11DeviceContext * context, float red, float green, float blue, float alpha)
-{
-	float color[4];
-
-
-	// Setup the color to clear the buffer to.
-	color[0] = red;
-	color[1] = green;
-	color[2] = blue;
-	color[3] = alpha;
-
-	// Clear the back buffer.
-	context->ClearRenderTargetView(_renderTargetView, color);
-
-	// Clear the depth buffer.
-	context->ClearDepthStencilView(_depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
-}
-
-ID3D11ShaderResourceView * RenderTexture::GetShaderResourceView()
-{
-	return _shaderResourceView;
-}
-
-
+#include "RenderTexture.h"
+#include "RenderBackend.h"
+
+
+
+RenderTexture::RenderTexture()
+{
+	_renderTargetTexture = 0;
+	_renderTargetView = 0;
+	_shaderResourceView = 0;
+	_depthStencilBuffer = 0;
+	_depthStencilView = 0;
+}
+
+
+RenderTexture::~RenderTexture()
+{
+	if (_depthStencilView)
+	{
+		_depthStencilView->Release();
+		_depthStencilView = 0;
+	}
+
+	if (_depthStencilBuffer)
+	{
+		_depthStencilBuffer->Release();
+		_depthStencilBuffer = 0;
+	}
+
+	if (_shaderResourceView)
+	{
+		_shaderResourceView->Release();
+		_shaderResourceView = 0;
+	}
+
+	if (_renderTargetView)
+	{
+		_renderTargetView->Release();
+		_renderTargetView = 0;
+	}
+
+	if (_renderTargetTexture)
+	{
+		_renderTargetTexture->Release();
+		_renderTargetTexture = 0;
+	}
+
+	return;
+}
+
+bool RenderTexture::Initialize(ID3D11Device * device, int textureWidth, int textureHeight, float screenDepth, float screenNear)
+{
+	D3D11_TEXTURE2D_DESC textureDesc;
+	HRESULT result;
+	D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
+	D3D11_TEXTURE2D_DESC depthBufferDesc;
+	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
+
+
+	// Initialize the render target texture description.
+	ZeroMemory(&textureDesc, sizeof(textureDesc));
+
+	// Setup the render target texture description.
+	textureDesc.Width = textureWidth;
+	textureDesc.Height = textureHeight;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = 0;
+
+	// Create the render target texture.
+	result = device->CreateTexture2D(&textureDesc, NULL, &_renderTargetTexture);
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// Setup the description of the render target view.
+	renderTargetViewDesc.Format = textureDesc.Format;
+	renderTargetViewDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+	renderTargetViewDesc.Texture2D.MipSlice = 0;
+
+	// Create the render target view.
+	result = device->CreateRenderTargetView(_renderTargetTexture, &renderTargetViewDesc, &_renderTargetView);
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// Setup the description of the shader resource view.
+	shaderResourceViewDesc.Format = textureDesc.Format;
+	shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
+	shaderResourceViewDesc.Texture2D.MipLevels = 1;
+
+	// Create the shader resource view.
+	result = device->CreateShaderResourceView(_renderTargetTexture, &shaderResourceViewDesc, &_shaderResourceView);
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// Initialize the description of the depth buffer.
+	ZeroMemory(&depthBufferDesc, sizeof(depthBufferDesc));
+
+	// Set up the description of the depth buffer.
+	depthBufferDesc.Width = textureWidth;
+	depthBufferDesc.Height = textureHeight;
+	depthBufferDesc.MipLevels = 1;
+	depthBufferDesc.ArraySize = 1;
+	depthBufferDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthBufferDesc.SampleDesc.Count = 1;
+	depthBufferDesc.SampleDesc.Quality = 0;
+	depthBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	depthBufferDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	depthBufferDesc.CPUAccessFlags = 0;
+	depthBufferDesc.MiscFlags = 0;
+
+	// Create the texture for the depth buffer using the filled out description.
+	result = device->CreateTexture2D(&depthBufferDesc, NULL, &_depthStencilBuffer);
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// Initailze the depth stencil view description.
+	ZeroMemory(&depthStencilViewDesc, sizeof(depthStencilViewDesc));
+
+	// Set up the depth stencil view description.
+	depthStencilViewDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	depthStencilViewDesc.Texture2D.MipSlice = 0;
+
+	// Create the depth stencil view.
+	result = device->CreateDepthStencilView(_depthStencilBuffer, &depthStencilViewDesc, &_depthStencilView);
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// Setup the viewport for rendering.
+	_viewport.Width = (float)textureWidth;
+	_viewport.Height = (float)textureHeight;
+	_viewport.MinDepth = 0.0f;
+	_viewport.MaxDepth = 1.0f;
+	_viewport.TopLeftX = 0.0f;
+	_viewport.TopLeftY = 0.0f;
+
+	// Setup the projection matrix.
+	XMMATRIX proj = XMMatrixPerspectiveFovLH(((float)XM_PI / 4.0f), ((float)textureWidth / (float)textureHeight), screenNear, screenDepth);
+	XMStoreFloat4x4(&_projectionMatrix, proj);
+
+	// Create an orthographic projection matrix for 2D rendering.
+	XMMATRIX ortho = XMMatrixOrthographicLH((float)textureWidth, (float)textureHeight, screenNear, screenDepth);
+	XMStoreFloat4x4(&_orthoMatrix, ortho);
+
+	return true;
+}
+
+void RenderTexture::SetRenderTarget(ID3D11DeviceContext * context)
+{
+	RenderBackend* backend = RenderBackend::Get(context);
+
+	// Bind the render target view and depth stencil buffer to the output render pipeline.
+	backend->SetRenderTargets(1, &_renderTargetView, _depthStencilView);
+
+	// Set the viewport.
+	backend->SetViewports(1, &_viewport);
+
+	return;
+}
+
+void RenderTexture::ClearRenderTarget(ID3D11DeviceContext * context, float red, float green, float blue, float alpha)
+{
+	float color[4];
+
+
+	// Setup the color to clear the buffer to.
+	color[0] = red;
+	color[1] = green;
+	color[2] = blue;
+	color[3] = alpha;
+
+	RenderBackend* backend = RenderBackend::Get(context);
+
+	// Clear the back buffer.
+	backend->ClearRenderTarget(_renderTargetView, color);
+
+	// Clear the depth buffer.
+	backend->ClearDepthStencil(_depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
+}
+
+ID3D11ShaderResourceView * RenderTexture::GetShaderResourceView()
+{
+	return _shaderResourceView;
+}
+
+
@@ -0,0 +1,345 @@
+#include "Scene.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+
+using namespace DirectX;
+
+static const unsigned int SceneVersion = 1;
+
+Scene::Scene()
+{
+	file = 0;
+	mapping = 0;
+	data = 0;
+	header = 0;
+}
+
+Scene::~Scene()
+{
+	Unload();
+}
+
+// Looks up a name from the text form, with "-" meaning none
+static bool FindId(const std::unordered_map<std::string, unsigned int>& ids, const std::string& name, unsigned int* id)
+{
+	if (name == "-")
+	{
+		*id = SceneNone;
+		return true;
+	}
+
+	auto found = ids.find(name);
+	if (found == ids.end())
+		return false;
+
+	*id = found->second;
+	return true;
+}
+
+// Adds a string to the string table, returning its offset
+static unsigned int AddString(std::vector<char>& strings, const std::string& s)
+{
+	unsigned int offset = (unsigned int)strings.size();
+	strings.insert(strings.end(), s.begin(), s.end());
+	strings.push_back(0);
+	return offset;
+}
+
+// Appends a section, 16-byte aligned, returning its offset
+static unsigned int AddSection(std::vector<unsigned char>& out, const void* source, size_t bytes)
+{
+	out.resize((out.size() + 15) & ~(size_t)15, 0);
+	unsigned int offset = (unsigned int)out.size();
+	if (bytes > 0)
+	{
+		out.resize(out.size() + bytes);
+		memcpy(&out[offset], source, bytes);
+	}
+	return offset;
+}
+
+// --------------------------------------------------------
+// Reads the text form of a scene and writes the binary form.
+// All of the parsing happens here, so loading never has to.
+// --------------------------------------------------------
+bool Scene::Compile(const char* textFile, const char* binaryFile)
+{
+	std::ifstream in(textFile);
+	if (!in.is_open())
+		return false;
+
+	std::unordered_map<std::string, unsigned int> meshIds, textureIds, entityIds;
+	std::vector<std::string> meshPaths, texturePaths, names;
+	std::vector<XMFLOAT3> positions, scales;
+	std::vector<XMFLOAT4> rotations;
+	std::vector<unsigned int> parents, meshes, textures, normalMaps;
+
+	SceneHeader header = {};
+	header.SkyMesh = SceneNone;
+	header.SkyTexture = SceneNone;
+	header.WaterEntity = SceneNone;
+	header.WaterNormalMap = SceneNone;
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream words(line);
+		std::string kind;
+		if (!(words >> kind))
+			continue;
+
+		bool ok = false;
+		if (kind == "mesh" || kind == "texture")
+		{
+			std::string name, path;
+			bool isMesh = kind == "mesh";
+			std::vector<std::string>& paths = isMesh ? meshPaths : texturePaths;
+			ok = (words >> name >> path) &&
+				(isMesh ? meshIds : textureIds).insert(std::make_pair(name, (unsigned int)paths.size())).second;
+			if (ok) paths.push_back(path);
+		}
+		else if (kind == "entity")
+		{
+			std::string name, mesh, texture, normalMap, parent;
+			XMFLOAT3 p, r, s;
+			unsigned int meshId, textureId, normalMapId, parentId;
+			ok = (words >> name >> mesh >> texture >> normalMap >> parent >> p.x >> p.y >> p.z >> r.x >> r.y >> r.z >> s.x >> s.y >> s.z) &&
+				FindId(meshIds, mesh, &meshId) &&
+				FindId(textureIds, texture, &textureId) &&
+				FindId(textureIds, normalMap, &normalMapId) &&
+				FindId(entityIds, parent, &parentId) &&
+				entityIds.insert(std::make_pair(name, (unsigned int)names.size())).second;
+
+			if (ok)
+			{
+				XMFLOAT4 q;
+				XMStoreFloat4(&q, TransformStore::EulerToQuaternion(
+					XMConvertToRadians(r.x), XMConvertToRadians(r.y), XMConvertToRadians(r.z)));
+
+				names.push_back(name);
+				positions.push_back(p);
+				rotations.push_back(q);
+				scales.push_back(s);
+				parents.push_back(parentId);
+				meshes.push_back(meshId);
+				textures.push_back(textureId);
+				normalMaps.push_back(normalMapId);
+			}
+		}
+		else if (kind == "sky")
+		{
+			std::string mesh, texture;
+			ok = (words >> mesh >> texture) &&
+				FindId(meshIds, mesh, &header.SkyMesh) &&
+				FindId(textureIds, texture, &header.SkyTexture);
+		}
+		else if (kind == "water")
+		{
+			std::string entity, normalMap;
+			ok = (words >> entity >> normalMap >> header.WaterHeight >> header.WaterRadius) &&
+				FindId(entityIds, entity, &header.WaterEntity) &&
+				FindId(textureIds, normalMap, &header.WaterNormalMap);
+		}
+
+		// Anything left over is a mistake too
+		std::string extra;
+		if (!ok || (words >> extra))
+		{
+			printf("%s(%d): can't read \"%s\"\n", textFile, lineNumber, line.c_str());
+			return false;
+		}
+	}
+
+	// Strings all go in one table
+	std::vector<char> strings;
+	std::vector<unsigned int> meshPathOffsets, texturePathOffsets, nameOffsets;
+	for (auto& s : meshPaths) meshPathOffsets.push_back(AddString(strings, s));
+	for (auto& s : texturePaths) texturePathOffsets.push_back(AddString(strings, s));
+	for (auto& s : names) nameOffsets.push_back(AddString(strings, s));
+	if (strings.empty()) strings.push_back(0);
+
+	unsigned int entityCount = (unsigned int)names.size();
+	memcpy(header.Magic, "SCNB", 4);
+	header.Version = SceneVersion;
+	header.EntityCount = entityCount;
+	header.MeshCount = (unsigned int)meshPaths.size();
+	header.TextureCount = (unsigned int)texturePaths.size();
+
+	// Header first, filled in once the offsets are known
+	std::vector<unsigned char> out(sizeof(SceneHeader), 0);
+	header.MeshPaths = AddSection(out, meshPathOffsets.data(), meshPathOffsets.size() * sizeof(unsigned int));
+	header.TexturePaths = AddSection(out, texturePathOffsets.data(), texturePathOffsets.size() * sizeof(unsigned int));
+	header.Names = AddSection(out, nameOffsets.data(), entityCount * sizeof(unsigned int));
+	header.Positions = AddSection(out, positions.data(), entityCount * sizeof(XMFLOAT3));
+	header.Rotations = AddSection(out, rotations.data(), entityCount * sizeof(XMFLOAT4));
+	header.Scales = AddSection(out, scales.data(), entityCount * sizeof(XMFLOAT3));
+	header.Parents = AddSection(out, parents.data(), entityCount * sizeof(unsigned int));
+	header.Meshes = AddSection(out, meshes.data(), entityCount * sizeof(unsigned int));
+	header.Textures = AddSection(out, textures.data(), entityCount * sizeof(unsigned int));
+	header.NormalMaps = AddSection(out, normalMaps.data(), entityCount * sizeof(unsigned int));
+	header.Strings = AddSection(out, strings.data(), strings.size());
+	header.StringBytes = (unsigned int)strings.size();
+	header.FileSize = (unsigned int)out.size();
+	memcpy(&out[0], &header, sizeof(header));
+
+	std::ofstream binary(binaryFile, std::ios::binary | std::ios::trunc);
+	if (!binary.is_open())
+		return false;
+	binary.write((const char*)&out[0], out.size());
+	return binary.good();
+}
+
+bool Scene::NeedsCompile(const char* textFile, const char* binaryFile)
+{
+	WIN32_FILE_ATTRIBUTE_DATA text, binary;
+	if (!GetFileAttributesExA(textFile, GetFileExInfoStandard, &text))
+		return false;
+	if (!GetFileAttributesExA(binaryFile, GetFileExInfoStandard, &binary))
+		return true;
+
+	return CompareFileTime(&text.ftLastWriteTime, &binary.ftLastWriteTime) > 0;
+}
+
+// --------------------------------------------------------
+// Maps a compiled scene into memory.  Nothing is parsed or
+// copied, but every offset and reference is checked so a bad
+// file fails here instead of crashing later.
+// --------------------------------------------------------
+bool Scene::Load(const char* binaryFile)
+{
+	Unload();
+
+	file = CreateFileA(binaryFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = 0;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(SceneHeader) || size.QuadPart > 0x7FFFFFFF)
+	{
+		Unload();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping)
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	header = (const SceneHeader*)data;
+
+	if (!data || !Validate((unsigned int)size.QuadPart))
+	{
+		Unload();
+		return false;
+	}
+
+	return true;
+}
+
+void Scene::Unload()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	file = 0;
+	mapping = 0;
+	data = 0;
+	header = 0;
+}
+
+bool Scene::Validate(unsigned int fileSize)
+{
+	if (memcmp(header->Magic, "SCNB", 4) != 0 || header->Version != SceneVersion || header->FileSize != fileSize)
+		return false;
+
+	// Every section has to start 16-byte aligned, as Compile writes
+	// them, and fit inside the file
+	auto fits = [&](unsigned int offset, unsigned int count, unsigned int elementSize)
+	{
+		return offset % 16 == 0 && offset <= fileSize && (unsigned long long)count * elementSize <= fileSize - offset;
+	};
+
+	unsigned int entities = header->EntityCount;
+	if (!fits(header->MeshPaths, header->MeshCount, sizeof(unsigned int)) ||
+		!fits(header->TexturePaths, header->TextureCount, sizeof(unsigned int)) ||
+		!fits(header->Names, entities, sizeof(unsigned int)) ||
+		!fits(header->Positions, entities, sizeof(XMFLOAT3)) ||
+		!fits(header->Rotations, entities, sizeof(XMFLOAT4)) ||
+		!fits(header->Scales, entities, sizeof(XMFLOAT3)) ||
+		!fits(header->Parents, entities, sizeof(unsigned int)) ||
+		!fits(header->Meshes, entities, sizeof(unsigned int)) ||
+		!fits(header->Textures, entities, sizeof(unsigned int)) ||
+		!fits(header->NormalMaps, entities, sizeof(unsigned int)) ||
+		!fits(header->Strings, header->StringBytes, 1) ||
+		header->StringBytes == 0 ||
+		data[header->Strings + header->StringBytes - 1] != 0)
+		return false;
+
+	// The string table ends in a zero, so any offset inside it is a valid string
+	auto stringsFit = [&](unsigned int section, unsigned int count)
+	{
+		const unsigned int* offsets = Section<unsigned int>(section);
+		for (unsigned int i = 0; i < count; i++)
+			if (offsets[i] >= header->StringBytes) return false;
+		return true;
+	};
+	if (!stringsFit(header->MeshPaths, header->MeshCount) ||
+		!stringsFit(header->TexturePaths, header->TextureCount) ||
+		!stringsFit(header->Names, entities))
+		return false;
+
+	// References are either SceneNone or in range, and parents come first
+	auto valid = [](unsigned int id, unsigned int count) { return id == SceneNone || id < count; };
+	const unsigned int* parents = Section<unsigned int>(header->Parents);
+	const unsigned int* meshes = Section<unsigned int>(header->Meshes);
+	const unsigned int* textures = Section<unsigned int>(header->Textures);
+	const unsigned int* normalMaps = Section<unsigned int>(header->NormalMaps);
+	for (unsigned int e = 0; e < entities; e++)
+	{
+		if (!valid(parents[e], e) ||
+			!valid(meshes[e], header->MeshCount) ||
+			!valid(textures[e], header->TextureCount) ||
+			!valid(normalMaps[e], header->TextureCount))
+			return false;
+	}
+
+	return
+		valid(header->SkyMesh, header->MeshCount) &&
+		valid(header->SkyTexture, header->TextureCount) &&
+		valid(header->WaterEntity, entities) &&
+		valid(header->WaterNormalMap, header->TextureCount);
+}
+
+unsigned int Scene::FindEntity(const char* name)
+{
+	for (unsigned int e = 0; e < header->EntityCount; e++)
+	{
+		if (strcmp(GetEntityName(e), name) == 0)
+			return e;
+	}
+	return SceneNone;
+}
+
+unsigned int Scene::CreateTransforms(TransformStore* transforms)
+{
+	return transforms->CreateRange(
+		header->EntityCount,
+		Section<XMFLOAT3>(header->Positions),
+		Section<XMFLOAT4>(header->Rotations),
+		Section<XMFLOAT3>(header->Scales),
+		Section<unsigned int>(header->Parents));
+}
+
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Windows.h>
+#include <DirectXMath.h>
+#include <string>
+
+#include "TransformStore.h"
+
+// Marks a missing mesh, texture, parent or water in a scene
+static const unsigned int SceneNone = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Layout of a compiled (.scenebin) scene file
+//
+// Everything after the header is a plain array, 16-byte aligned,
+// located by its byte offset from the start of the file.  Entity
+// data is stored one array per field, so loading is a handful
+// of memcpys straight out of the mapped file.
+// --------------------------------------------------------
+struct SceneHeader
+{
+	char Magic[4];				// "SCNB"
+	unsigned int Version;
+	unsigned int FileSize;
+
+	unsigned int EntityCount;
+	unsigned int MeshCount;
+	unsigned int TextureCount;
+
+	unsigned int MeshPaths;		// unsigned int[MeshCount], offsets into Strings
+	unsigned int TexturePaths;	// unsigned int[TextureCount], offsets into Strings
+	unsigned int Names;			// unsigned int[EntityCount], offsets into Strings
+	unsigned int Positions;		// XMFLOAT3[EntityCount]
+	unsigned int Rotations;		// XMFLOAT4[EntityCount], normalized quaternions
+	unsigned int Scales;		// XMFLOAT3[EntityCount]
+	unsigned int Parents;		// unsigned int[EntityCount], an earlier entity or SceneNone
+	unsigned int Meshes;		// unsigned int[EntityCount], SceneNone for a bare transform
+	unsigned int Textures;		// unsigned int[EntityCount]
+	unsigned int NormalMaps;	// unsigned int[EntityCount]
+	unsigned int Strings;		// Zero-terminated strings
+	unsigned int StringBytes;
+
+	unsigned int SkyMesh;
+	unsigned int SkyTexture;
+	unsigned int WaterEntity;	// SceneNone when there's no water
+	unsigned int WaterNormalMap;
+	float WaterHeight;
+	float WaterRadius;
+};
+
+// --------------------------------------------------------
+// A scene layout: entities with transforms, the meshes and
+// textures they use, the sky and the water
+//
+// Scenes are written as text (.scene) and compiled to a binary
+// form (.scenebin) that is memory-mapped and used in place.
+// The text form, one item per line, with # for comments:
+//
+//   mesh    <name> <path>
+//   texture <name> <path>
+//   entity  <name> <mesh> <texture> <normal map> <parent>
+//           <position x y z> <rotation x y z> <scale x y z>
+//   sky     <mesh> <texture>
+//   water   <entity> <normal map> <height> <radius>
+//
+// Any reference can be "-" for none.  Rotations are Euler angles
+// in degrees, and parents must be listed before their children.
+// --------------------------------------------------------
+class Scene
+{
+public:
+	Scene();
+	~Scene();
+
+	// Text to binary.  Returns false (writing nothing) on any error.
+	static bool Compile(const char* textFile, const char* binaryFile);
+
+	// True when the text exists and the binary is missing or older
+	static bool NeedsCompile(const char* textFile, const char* binaryFile);
+
+	// Maps a compiled scene, checking every offset and reference
+	bool Load(const char* binaryFile);
+	void Unload();
+
+	unsigned int GetEntityCount() { return header->EntityCount; }
+	unsigned int GetMeshCount() { return header->MeshCount; }
+	unsigned int GetTextureCount() { return header->TextureCount; }
+
+	const char* GetMeshPath(unsigned int mesh) { return GetString(header->MeshPaths, mesh); }
+	const char* GetTexturePath(unsigned int texture) { return GetString(header->TexturePaths, texture); }
+	const char* GetEntityName(unsigned int entity) { return GetString(header->Names, entity); }
+	unsigned int FindEntity(const char* name);
+
+	unsigned int GetEntityMesh(unsigned int entity) { return Section<unsigned int>(header->Meshes)[entity]; }
+	unsigned int GetEntityTexture(unsigned int entity) { return Section<unsigned int>(header->Textures)[entity]; }
+	unsigned int GetEntityNormalMap(unsigned int entity) { return Section<unsigned int>(header->NormalMaps)[entity]; }
+
+	unsigned int GetSkyMesh() { return header->SkyMesh; }
+	unsigned int GetSkyTexture() { return header->SkyTexture; }
+	unsigned int GetWaterEntity() { return header->WaterEntity; }
+	unsigned int GetWaterNormalMap() { return header->WaterNormalMap; }
+	float GetWaterHeight() { return header->WaterHeight; }
+	float GetWaterRadius() { return header->WaterRadius; }
+
+	// Adds one transform per entity, parented as in the scene, and
+	// returns the first handle.  Entity e's transform is first + e.
+	unsigned int CreateTransforms(TransformStore* transforms);
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const unsigned char* data;
+	const SceneHeader* header;
+
+	template<typename T> const T* Section(unsigned int offset) { return (const T*)(data + offset); }
+	const char* GetString(unsigned int section, unsigned int index) { return (const char*)(data + header->Strings + Section<unsigned int>(section)[index]); }
+
+	bool Validate(unsigned int fileSize);
+};
+
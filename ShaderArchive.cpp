@@ -0,0 +1,297 @@
+#include "ShaderArchive.h"
+#include "JobSystem.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+const unsigned int ShaderArchive::ArchiveVersion;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Lets a shader hold on to bytecode inside the mapped archive
+	// without copying it.  Only valid while the archive is open.
+	// --------------------------------------------------------
+	class MappedBlob : public ID3DBlob
+	{
+	public:
+		MappedBlob(const void* bytes, SIZE_T size) : bytes(bytes), size(size), references(1) {}
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID id, void** object)
+		{
+			if (IsEqualIID(id, __uuidof(IUnknown)) || IsEqualIID(id, __uuidof(ID3D10Blob)))
+			{
+				*object = this;
+				AddRef();
+				return S_OK;
+			}
+			*object = 0;
+			return E_NOINTERFACE;
+		}
+
+		ULONG STDMETHODCALLTYPE AddRef() { return InterlockedIncrement(&references); }
+		ULONG STDMETHODCALLTYPE Release()
+		{
+			LONG count = InterlockedDecrement(&references);
+			if (count == 0)
+				delete this;
+			return count;
+		}
+
+		LPVOID STDMETHODCALLTYPE GetBufferPointer() { return (LPVOID)bytes; }
+		SIZE_T STDMETHODCALLTYPE GetBufferSize() { return size; }
+
+	private:
+		const void* bytes;
+		SIZE_T size;
+		LONG volatile references;
+	};
+}
+
+// Appends a section, 16-byte aligned, returning its offset
+static unsigned int AddSection(std::vector<unsigned char>& out, const void* source, size_t bytes)
+{
+	out.resize((out.size() + 15) & ~(size_t)15, 0);
+	unsigned int offset = (unsigned int)out.size();
+	if (bytes > 0)
+	{
+		out.resize(out.size() + bytes);
+		memcpy(&out[offset], source, bytes);
+	}
+	return offset;
+}
+
+ShaderArchive::ShaderArchive()
+{
+	file = 0;
+	mapping = 0;
+	data = 0;
+	header = 0;
+}
+
+ShaderArchive::~ShaderArchive()
+{
+	Close();
+}
+
+// --------------------------------------------------------
+// Reads every .cso in a folder, reflects each one and writes
+// them all out as a single archive.  Names are sorted, so the
+// same shaders always make the same file.
+// --------------------------------------------------------
+bool ShaderArchive::Build(const char* folder, const char* archiveFile)
+{
+	std::string path = folder;
+	if (!path.empty() && path.back() != '/' && path.back() != '\\')
+		path += '\\';
+
+	std::vector<std::string> names;
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((path + "*.cso").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+		return false;
+	do
+	{
+		if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			names.push_back(found.cFileName);
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+	std::sort(names.begin(), names.end());
+
+	// Header and table of contents first, filled in at the end
+	ShaderArchiveHeader archive = {};
+	std::vector<ShaderArchiveEntry> entries(names.size());
+	std::vector<unsigned char> out(sizeof(ShaderArchiveHeader), 0);
+	archive.Entries = AddSection(out, entries.data(), entries.size() * sizeof(ShaderArchiveEntry));
+
+	std::vector<char> strings;
+	for (unsigned int i = 0; i < names.size(); i++)
+	{
+		std::string name = names[i].substr(0, names[i].size() - 4);
+		entries[i].Name = (unsigned int)strings.size();
+		strings.insert(strings.end(), name.begin(), name.end());
+		strings.push_back(0);
+	}
+	if (strings.empty()) strings.push_back(0);
+	archive.Strings = AddSection(out, strings.data(), strings.size());
+	archive.StringBytes = (unsigned int)strings.size();
+
+	// Reflect each shader into a fresh cache as it's added
+	ShaderReflectionCache::Clear();
+	for (unsigned int i = 0; i < names.size(); i++)
+	{
+		std::ifstream cso(path + names[i], std::ios::binary | std::ios::ate);
+		if (!cso.is_open())
+			return false;
+
+		std::vector<unsigned char> bytecode((size_t)cso.tellg());
+		cso.seekg(0);
+		if (bytecode.empty() || !cso.read((char*)&bytecode[0], bytecode.size()))
+			return false;
+
+		if (!ShaderReflectionCache::Get(&bytecode[0], bytecode.size()))
+			return false;
+
+		entries[i].Bytecode = AddSection(out, &bytecode[0], bytecode.size());
+		entries[i].BytecodeSize = (unsigned int)bytecode.size();
+	}
+
+	std::vector<unsigned char> reflection;
+	ShaderReflectionCache::Save(reflection);
+	archive.Reflection = AddSection(out, reflection.data(), reflection.size());
+	archive.ReflectionBytes = (unsigned int)reflection.size();
+
+	memcpy(archive.Magic, "SHPK", 4);
+	archive.Version = ArchiveVersion;
+	archive.ShaderCount = (unsigned int)names.size();
+	archive.FileSize = (unsigned int)out.size();
+	memcpy(&out[0], &archive, sizeof(archive));
+	if (!entries.empty())
+		memcpy(&out[archive.Entries], entries.data(), entries.size() * sizeof(ShaderArchiveEntry));
+
+	std::ofstream binary(archiveFile, std::ios::binary | std::ios::trunc);
+	if (!binary.is_open())
+		return false;
+	binary.write((const char*)&out[0], out.size());
+	return binary.good();
+}
+
+// --------------------------------------------------------
+// Maps an archive into memory and checks every offset, so a
+// bad file fails here instead of crashing later
+// --------------------------------------------------------
+bool ShaderArchive::Open(const char* archiveFile)
+{
+	Close();
+
+	file = CreateFileA(archiveFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = 0;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(ShaderArchiveHeader) || size.QuadPart > 0x7FFFFFFF)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping)
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	header = (const ShaderArchiveHeader*)data;
+
+	if (!data || !Validate((unsigned int)size.QuadPart))
+	{
+		Close();
+		return false;
+	}
+
+	const ShaderArchiveEntry* entries = (const ShaderArchiveEntry*)(data + header->Entries);
+	const char* strings = (const char*)(data + header->Strings);
+	for (unsigned int i = 0; i < header->ShaderCount; i++)
+		lookup[strings + entries[i].Name] = i;
+
+	return true;
+}
+
+void ShaderArchive::Close()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	file = 0;
+	mapping = 0;
+	data = 0;
+	header = 0;
+	lookup.clear();
+}
+
+bool ShaderArchive::Validate(unsigned int fileSize)
+{
+	if (memcmp(header->Magic, "SHPK", 4) != 0 || header->Version != ArchiveVersion || header->FileSize != fileSize)
+		return false;
+
+	auto fits = [&](unsigned int offset, unsigned long long bytes)
+	{
+		return offset <= fileSize && bytes <= fileSize - offset;
+	};
+
+	if (header->Entries % 4 != 0 ||
+		!fits(header->Entries, (unsigned long long)header->ShaderCount * sizeof(ShaderArchiveEntry)) ||
+		!fits(header->Strings, header->StringBytes) ||
+		header->StringBytes == 0 ||
+		data[header->Strings + header->StringBytes - 1] != 0 ||
+		!fits(header->Reflection, header->ReflectionBytes))
+		return false;
+
+	// The string table ends in a zero, so any offset inside it is a valid name
+	const ShaderArchiveEntry* entries = (const ShaderArchiveEntry*)(data + header->Entries);
+	for (unsigned int i = 0; i < header->ShaderCount; i++)
+	{
+		if (entries[i].Name >= header->StringBytes || !fits(entries[i].Bytecode, entries[i].BytecodeSize))
+			return false;
+	}
+
+	return true;
+}
+
+bool ShaderArchive::LoadReflection()
+{
+	if (!header || header->ReflectionBytes == 0)
+		return false;
+
+	return ShaderReflectionCache::Load(data + header->Reflection, header->ReflectionBytes);
+}
+
+const void* ShaderArchive::Find(const char* name, unsigned int& size)
+{
+	auto found = lookup.find(name);
+	if (found == lookup.end())
+		return 0;
+
+	const ShaderArchiveEntry& entry = ((const ShaderArchiveEntry*)(data + header->Entries))[found->second];
+	size = entry.BytecodeSize;
+	return data + entry.Bytecode;
+}
+
+bool ShaderArchive::Load(ISimpleShader* shader, const char* name)
+{
+	unsigned int size;
+	const void* bytecode = Find(name, size);
+	if (!bytecode)
+		return false;
+
+	MappedBlob* blob = new MappedBlob(bytecode, size);
+	bool loaded = shader->LoadShaderBlob(blob);
+	blob->Release();
+	return loaded;
+}
+
+unsigned int ShaderArchive::Load(const Request* requests, unsigned int count, JobSystem* jobs, std::vector<bool>& loaded)
+{
+	// Written from many jobs at once, so not a vector<bool>
+	std::vector<char> results(count, 0);
+	auto loadRange = [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			results[i] = Load(requests[i].Shader, requests[i].Name) ? 1 : 0;
+	};
+
+	if (jobs)
+		jobs->ParallelFor(count, 1, loadRange);
+	else
+		loadRange(0, count);
+
+	loaded.assign(count, false);
+	unsigned int loadedCount = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		loaded[i] = results[i] != 0;
+		loadedCount += results[i];
+	}
+	return loadedCount;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "SimpleShader.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Layout of a shader archive (.pack) file
+//
+// A table of contents, the names, then every shader's bytecode
+// (16-byte aligned), located by byte offsets from the start of
+// the file.  The reflection of every shader can ride along as a
+// ShaderReflectionCache image, so loading reflects nothing.
+// --------------------------------------------------------
+struct ShaderArchiveHeader
+{
+	char Magic[4];				// "SHPK"
+	unsigned int Version;
+	unsigned int FileSize;
+
+	unsigned int ShaderCount;
+	unsigned int Entries;		// ShaderArchiveEntry[ShaderCount]
+	unsigned int Strings;		// Zero-terminated names
+	unsigned int StringBytes;
+	unsigned int Reflection;	// ShaderReflectionCache::Save() image
+	unsigned int ReflectionBytes;	// 0 when there isn't one
+};
+
+struct ShaderArchiveEntry
+{
+	unsigned int Name;			// Offset into Strings - the .cso name, no extension
+	unsigned int Bytecode;
+	unsigned int BytecodeSize;
+};
+
+// --------------------------------------------------------
+// Every compiled shader in one memory-mapped file
+//
+// Build() packs a folder's .cso files after the project builds
+// (see the post-build step and WinMain's -packshaders), and
+// Open() maps the result once at startup.  Shaders are created
+// straight from the mapped bytes, so the archive must stay open
+// as long as any shader loaded from it.
+// --------------------------------------------------------
+class ShaderArchive
+{
+public:
+	ShaderArchive();
+	~ShaderArchive();
+
+	// Packs every .cso in a folder, with their reflection.
+	// Returns false (writing nothing) on any error.
+	static bool Build(const char* folder, const char* archiveFile);
+
+	bool Open(const char* archiveFile);
+	void Close();
+	bool IsOpen() { return data != 0; }
+
+	// Loads the reflection stored in the archive into the
+	// ShaderReflectionCache.  False if there isn't one.
+	bool LoadReflection();
+
+	// Bytecode by name (e.g. "VertexShader"), or null
+	const void* Find(const char* name, unsigned int& size);
+
+	// Loads a shader from the archive.  False if it isn't there.
+	bool Load(ISimpleShader* shader, const char* name);
+
+	// Loads many at once, spread over the job system.  Returns
+	// how many loaded; failures are marked in "loaded".
+	struct Request
+	{
+		ISimpleShader* Shader;
+		const char* Name;
+	};
+	unsigned int Load(const Request* requests, unsigned int count, JobSystem* jobs, std::vector<bool>& loaded);
+
+	unsigned int GetShaderCount() { return header ? header->ShaderCount : 0; }
+
+private:
+	static const unsigned int ArchiveVersion = 1;
+
+	HANDLE file;
+	HANDLE mapping;
+	const unsigned char* data;
+	const ShaderArchiveHeader* header;
+	std::unordered_map<std::string, unsigned int> lookup;	// Name to entry
+
+	bool Validate(unsigned int fileSize);
+};
@@ -0,0 +1,275 @@
+#include "ShaderLayout.h"
+#include "ShaderPermutations.h"
+
+#include <Windows.h>
+#include <d3dcompiler.h>
+#include <d3d11shader.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Member
+	{
+		std::string Name;
+		std::string Type;		// Empty for raw bytes
+		unsigned int Offset;
+		unsigned int Size;
+
+		bool operator==(const Member& other) const
+		{
+			return Name == other.Name && Type == other.Type && Offset == other.Offset && Size == other.Size;
+		}
+	};
+
+	struct Struct
+	{
+		std::string Name;
+		std::string Shader;		// The base shader, without any "@features"
+		std::string Buffer;
+		unsigned int Size;
+		std::vector<Member> Members;
+		std::vector<std::string> UsedBy;
+	};
+}
+
+// Anything but letters, digits and underscores becomes an underscore
+static std::string Identifier(const std::string& name)
+{
+	std::string out = name;
+	for (auto& c : out)
+	{
+		if (!isalnum((unsigned char)c) && c != '_')
+			c = '_';
+	}
+	return out;
+}
+
+// --------------------------------------------------------
+// The C++ type with the same size and layout as an HLSL one,
+// or empty when there isn't a simple one (arrays, structs,
+// 3x3 matrices...), which are then left as raw bytes
+// --------------------------------------------------------
+static std::string CppType(const D3D11_SHADER_TYPE_DESC& type, unsigned int size)
+{
+	if (type.Elements > 0 || type.Members > 0)
+		return "";
+
+	const char* scalar = 0;
+	const char* vector = 0;
+	switch (type.Type)
+	{
+	case D3D_SVT_FLOAT: scalar = "float"; vector = "DirectX::XMFLOAT"; break;
+	case D3D_SVT_INT: scalar = "int"; vector = "DirectX::XMINT"; break;
+	case D3D_SVT_UINT: scalar = "unsigned int"; vector = "DirectX::XMUINT"; break;
+	case D3D_SVT_BOOL: scalar = "int"; break;	// 4 bytes in HLSL
+	default: return "";
+	}
+
+	std::string name;
+	if (type.Class == D3D_SVC_SCALAR)
+		name = scalar;
+	else if (type.Class == D3D_SVC_VECTOR && vector && type.Columns >= 2)
+		name = vector + std::to_string(type.Columns);
+	else if ((type.Class == D3D_SVC_MATRIX_ROWS || type.Class == D3D_SVC_MATRIX_COLUMNS) &&
+		type.Type == D3D_SVT_FLOAT && type.Rows == 4 && type.Columns == 4)
+		name = "DirectX::XMFLOAT4X4";
+	else
+		return "";
+
+	// Everything above is 4 bytes a component
+	unsigned int components = type.Class == D3D_SVC_SCALAR ? 1 : type.Rows * type.Columns;
+	return components * 4 == size ? name : "";
+}
+
+static bool ReadStructs(const std::string& file, const std::string& shaderName, std::vector<Struct>& structs)
+{
+	std::ifstream cso(file, std::ios::binary | std::ios::ate);
+	if (!cso.is_open())
+		return false;
+	std::vector<char> bytecode((size_t)cso.tellg());
+	cso.seekg(0);
+	if (bytecode.empty() || !cso.read(&bytecode[0], bytecode.size()))
+		return false;
+
+	ID3D11ShaderReflection* refl = 0;
+	if (FAILED(D3DReflect(&bytecode[0], bytecode.size(), IID_ID3D11ShaderReflection, (void**)&refl)))
+		return false;
+
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	// "VertexShader@1" is VertexShader with CLIP_PLANE
+	std::string base = shaderName.substr(0, shaderName.find('@'));
+	std::string features;
+	if (base.size() < shaderName.size())
+		features = ShaderPermutations::GetFeatureNames(std::stoull(shaderName.substr(base.size() + 1), 0, 16));
+
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		ID3D11ShaderReflectionConstantBuffer* cb = refl->GetConstantBufferByIndex(b);
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+
+		Struct s;
+		s.Shader = base;
+		s.Buffer = bufferDesc.Name;
+		s.Size = bufferDesc.Size;
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			ID3D11ShaderReflectionVariable* var = cb->GetVariableByIndex(v);
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			D3D11_SHADER_TYPE_DESC typeDesc;
+			var->GetDesc(&varDesc);
+			var->GetType()->GetDesc(&typeDesc);
+
+			Member member;
+			member.Name = Identifier(varDesc.Name);
+			member.Type = CppType(typeDesc, varDesc.Size);
+			member.Offset = varDesc.StartOffset;
+			member.Size = varDesc.Size;
+			s.Members.push_back(member);
+		}
+		std::sort(s.Members.begin(), s.Members.end(),
+			[](const Member& a, const Member& b) { return a.Offset < b.Offset; });
+
+		// Another variant may already have a struct for this
+		bool shared = false;
+		for (auto& existing : structs)
+		{
+			if (existing.Shader == s.Shader && existing.Buffer == s.Buffer &&
+				existing.Size == s.Size && existing.Members == s.Members)
+			{
+				existing.UsedBy.push_back(shaderName);
+				shared = true;
+				break;
+			}
+		}
+		if (shared)
+			continue;
+
+		s.Name = Identifier(base + (features.empty() ? "" : "_" + features) + "_" + s.Buffer);
+		s.UsedBy.push_back(shaderName);
+		structs.push_back(s);
+	}
+
+	refl->Release();
+	return true;
+}
+
+static void WriteStruct(std::ostream& out, const Struct& s)
+{
+	out << "// cbuffer " << s.Buffer << " in";
+	for (auto& shader : s.UsedBy)
+		out << " " << shader;
+	out << "\n";
+	out << "struct alignas(16) " << s.Name << "\n{\n";
+
+	unsigned int at = 0;
+	unsigned int pads = 0;
+	auto pad = [&](unsigned int to)
+	{
+		if (to <= at)
+			return;
+		if ((to - at) % 4 != 0)
+			out << "\tunsigned char _pad" << pads++ << "[" << (to - at) << "];\n";
+		else if (to - at == 4)
+			out << "\tfloat _pad" << pads++ << ";\n";
+		else
+			out << "\tfloat _pad" << pads++ << "[" << (to - at) / 4 << "];\n";
+		at = to;
+	};
+
+	for (auto& m : s.Members)
+	{
+		pad(m.Offset);
+		if (m.Type.empty())
+			out << "\tunsigned char " << m.Name << "[" << m.Size << "];\n";
+		else
+			out << "\t" << m.Type << " " << m.Name << ";\n";
+		at = m.Offset + m.Size;
+	}
+	pad(s.Size);
+
+	out << "\n\tstatic const ShaderLayout& GetLayout()\n\t{\n";
+	out << "\t\tstatic const ShaderLayoutField fields[] =\n\t\t{\n";
+	for (auto& m : s.Members)
+		out << "\t\t\t{ \"" << m.Name << "\", " << m.Offset << ", " << m.Size << " },\n";
+	out << "\t\t};\n";
+	out << "\t\tstatic const ShaderLayout layout = { \"" << s.Buffer << "\", " << s.Size << ", fields, " << s.Members.size() << " };\n";
+	out << "\t\treturn layout;\n\t}\n};\n";
+
+	out << "static_assert(sizeof(" << s.Name << ") == " << s.Size << ", \"" << s.Name << " size\");\n";
+	for (auto& m : s.Members)
+		out << "static_assert(offsetof(" << s.Name << ", " << m.Name << ") == " << m.Offset << ", \"" << s.Name << "::" << m.Name << "\");\n";
+	out << "\n";
+}
+
+bool ShaderLayoutGenerator::Generate(const char* folder, const char* headerFile, bool& rewritten)
+{
+	rewritten = false;
+	std::string path = folder;
+	if (!path.empty() && path.back() != '/' && path.back() != '\\')
+		path += '\\';
+
+	std::vector<std::string> names;
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((path + "*.cso").c_str(), &found);
+	if (search == INVALID_HANDLE_VALUE)
+		return false;
+	do
+	{
+		if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			names.push_back(found.cFileName);
+	} while (FindNextFileA(search, &found));
+	FindClose(search);
+
+	// Sorted, so each base shader comes before its variants
+	std::sort(names.begin(), names.end());
+
+	std::vector<Struct> structs;
+	for (auto& name : names)
+	{
+		if (!ReadStructs(path + name, name.substr(0, name.size() - 4), structs))
+			return false;
+	}
+
+	std::ostringstream out;
+	out << "#pragma once\n\n";
+	out << "// --------------------------------------------------------\n";
+	out << "// GENERATED by ShaderLayoutGenerator from the compiled\n";
+	out << "// shaders after each build - don't edit by hand.\n";
+	out << "//\n";
+	out << "// One struct per constant buffer, laid out the way HLSL\n";
+	out << "// packs it, so the whole buffer is set with one copy:\n";
+	out << "//    SimpleBufferHandle frame = vs->GetBufferHandle(VertexShader_perFrame::GetLayout());\n";
+	out << "//    vs->SetBufferData(frame, data);\n";
+	out << "// --------------------------------------------------------\n\n";
+	out << "#include <DirectXMath.h>\n";
+	out << "#include <cstddef>\n";
+	out << "#include \"ShaderLayout.h\"\n\n";
+	for (auto& s : structs)
+		WriteStruct(out, s);
+
+	// Left alone if nothing changed, so it doesn't look out of
+	// date.  Text mode both ways, to match however it's checked out.
+	std::string text = out.str();
+	std::ifstream existing(headerFile);
+	if (existing.is_open())
+	{
+		std::string previous((std::istreambuf_iterator<char>(existing)), std::istreambuf_iterator<char>());
+		if (previous == text)
+			return true;
+		existing.close();
+	}
+
+	std::ofstream header(headerFile, std::ios::trunc);
+	if (!header.is_open())
+		return false;
+	header << text;
+	rewritten = true;
+	return header.good();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+// --------------------------------------------------------
+// One variable of a constant buffer, as a generated struct
+// (see ShaderStructs.h) expects to find it
+// --------------------------------------------------------
+struct ShaderLayoutField
+{
+	const char* Name;
+	unsigned int Offset;
+	unsigned int Size;
+};
+
+// --------------------------------------------------------
+// The constant buffer a generated struct stands for.  Handed
+// to ISimpleShader::GetBufferHandle(), which checks it against
+// the shader's reflection.
+// --------------------------------------------------------
+struct ShaderLayout
+{
+	const char* Buffer;			// The cbuffer's name
+	unsigned int Size;
+	const ShaderLayoutField* Fields;
+	unsigned int FieldCount;
+};
+
+// --------------------------------------------------------
+// Writes ShaderStructs.h: a C++ struct for every constant
+// buffer of every .cso in a folder, with the padding HLSL's
+// packing rules put between variables and static_asserts on
+// every offset.  Variants of one shader ("Name@features")
+// that lay a buffer out the same way share a struct.
+//
+// Runs at build time, from WinMain's -packshaders.  The file
+// is only rewritten when its contents change, so a build
+// that changes nothing doesn't trigger another one.  When it
+// is rewritten, "rewritten" is set and -packshaders fails the
+// build, since the code just compiled used the old one.
+// --------------------------------------------------------
+class ShaderLayoutGenerator
+{
+public:
+	static bool Generate(const char* folder, const char* headerFile, bool& rewritten);
+};
@@ -0,0 +1,231 @@
+#include "ShaderPermutations.h"
+#include "ShaderArchive.h"
+#include "JobSystem.h"
+
+#include <d3dcompiler.h>
+#include <fstream>
+#include <vector>
+
+// --------------------------------------------------------
+// What each source is and which features it can be built with
+// --------------------------------------------------------
+struct ShaderSourceDesc
+{
+	const char* Name;
+	bool Vertex;				// Otherwise a pixel shader
+	unsigned long long Features;
+};
+
+static const ShaderSourceDesc sources[SHADER_SOURCE_COUNT] =
+{
+	{ "VertexShader", true, SHADER_FEATURE_CLIP_PLANE | SHADER_FEATURE_INSTANCED },
+	{ "PixelShader", false, SHADER_FEATURE_UNLIT },
+};
+
+// The #define for each feature bit, lowest first
+static const char* featureDefines[SHADER_FEATURE_COUNT] =
+{
+	"CLIP_PLANE",
+	"INSTANCED",
+	"UNLIT",
+};
+
+ShaderPermutations::ShaderPermutations(ID3D11Device* device, ID3D11DeviceContext* context, ShaderArchive* archive)
+{
+	this->device = device;
+	this->context = context;
+	this->archive = archive;
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+	for (auto& shader : shaders)
+		delete shader.second;
+}
+
+bool ShaderPermutations::IsSupported(ShaderKey key)
+{
+	unsigned int source = (unsigned int)(key >> 48);
+	unsigned long long features = key & 0xFFFFFFFFFFFFull;
+	return source < SHADER_SOURCE_COUNT && (features & ~sources[source].Features) == 0;
+}
+
+// --------------------------------------------------------
+// "VertexShader" or "VertexShader@3" - the name of the .cso,
+// and of the shader in an archive
+// --------------------------------------------------------
+std::string ShaderPermutations::GetVariantName(ShaderKey key)
+{
+	std::string name = sources[key >> 48].Name;
+	unsigned long long features = key & 0xFFFFFFFFFFFFull;
+	if (features)
+	{
+		char suffix[20];
+		sprintf_s(suffix, "@%llx", features);
+		name += suffix;
+	}
+	return name;
+}
+
+std::string ShaderPermutations::GetFeatureNames(unsigned long long features)
+{
+	std::string names;
+	for (unsigned int f = 0; f < SHADER_FEATURE_COUNT; f++)
+	{
+		if (!(features & (1ull << f)))
+			continue;
+		if (!names.empty())
+			names += '_';
+		names += featureDefines[f];
+	}
+	return names;
+}
+
+// --------------------------------------------------------
+// Compiles every variant but the plain one (which the project
+// compiles itself) of each source in sourceFolder, writing
+// the .cso files to outputFolder
+// --------------------------------------------------------
+bool ShaderPermutations::Compile(const char* sourceFolder, const char* outputFolder)
+{
+	std::string sourcePath = sourceFolder;
+	std::string outputPath = outputFolder;
+	if (!sourcePath.empty() && sourcePath.back() != '/' && sourcePath.back() != '\\') sourcePath += '\\';
+	if (!outputPath.empty() && outputPath.back() != '/' && outputPath.back() != '\\') outputPath += '\\';
+
+#if defined(DEBUG) || defined(_DEBUG)
+	UINT flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	UINT flags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+	for (unsigned int s = 0; s < SHADER_SOURCE_COUNT; s++)
+	{
+		std::string file = sourcePath + sources[s].Name + ".hlsl";
+		std::wstring wideFile(file.begin(), file.end());
+
+		// Every subset of the supported feature bits
+		unsigned long long supported = sources[s].Features;
+		for (unsigned long long features = supported; features != 0; features = (features - 1) & supported)
+		{
+			std::vector<D3D_SHADER_MACRO> defines;
+			for (unsigned int f = 0; f < SHADER_FEATURE_COUNT; f++)
+			{
+				if (features & (1ull << f))
+					defines.push_back({ featureDefines[f], "1" });
+			}
+			defines.push_back({ 0, 0 });
+
+			ID3DBlob* bytecode = 0;
+			ID3DBlob* errors = 0;
+			HRESULT hr = D3DCompileFromFile(
+				wideFile.c_str(),
+				&defines[0],
+				D3D_COMPILE_STANDARD_FILE_INCLUDE,
+				"main",
+				sources[s].Vertex ? "vs_5_0" : "ps_5_0",
+				flags,
+				0,
+				&bytecode,
+				&errors);
+
+			ShaderKey key = MakeShaderKey((ShaderSource)s, features);
+			if (errors)
+			{
+				printf("%s: %s\n", GetVariantName(key).c_str(), (const char*)errors->GetBufferPointer());
+				errors->Release();
+			}
+			if (FAILED(hr))
+				return false;
+
+			std::ofstream cso(outputPath + GetVariantName(key) + ".cso", std::ios::binary | std::ios::trunc);
+			cso.write((const char*)bytecode->GetBufferPointer(), bytecode->GetBufferSize());
+			bytecode->Release();
+			if (!cso.good())
+				return false;
+		}
+	}
+
+	return true;
+}
+
+ISimpleShader* ShaderPermutations::Create(ShaderKey key)
+{
+	ISimpleShader* shader;
+	if (sources[key >> 48].Vertex)
+		shader = new SimpleVertexShader(device, context);
+	else
+		shader = new SimplePixelShader(device, context);
+
+	shaders[key] = shader;
+	return shader;
+}
+
+void ShaderPermutations::LoadFromFile(ISimpleShader* shader, const std::string& name)
+{
+	std::wstring file(name.begin(), name.end());
+	if (!shader->LoadShaderFile((L"Debug/" + file + L".cso").c_str()))
+		shader->LoadShaderFile((file + L".cso").c_str());
+}
+
+void ShaderPermutations::Preload(const ShaderKey* keys, unsigned int count, JobSystem* jobs)
+{
+	// Shaders are created here, since that isn't thread-safe;
+	// only the loading is spread out
+	std::vector<ISimpleShader*> created;
+	std::vector<std::string> names;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (!IsSupported(keys[i]) || shaders.count(keys[i]))
+			continue;
+		created.push_back(Create(keys[i]));
+		names.push_back(GetVariantName(keys[i]));
+	}
+
+	std::vector<bool> loaded(created.size(), false);
+	if (archive && archive->IsOpen())
+	{
+		std::vector<ShaderArchive::Request> requests(created.size());
+		for (unsigned int i = 0; i < created.size(); i++)
+			requests[i] = { created[i], names[i].c_str() };
+		archive->Load(requests.data(), (unsigned int)requests.size(), jobs, loaded);
+	}
+
+	for (unsigned int i = 0; i < created.size(); i++)
+	{
+		if (!loaded[i])
+			LoadFromFile(created[i], names[i]);
+	}
+}
+
+ISimpleShader* ShaderPermutations::Get(ShaderKey key)
+{
+	auto found = shaders.find(key);
+	if (found != shaders.end())
+		return found->second;
+
+	if (!IsSupported(key))
+		return 0;
+
+	// First use - load it now.  A variant that fails to load is
+	// kept anyway (but invalid), so it isn't tried every time.
+	ISimpleShader* shader = Create(key);
+	std::string name = GetVariantName(key);
+	if (!archive || !archive->Load(shader, name.c_str()))
+		LoadFromFile(shader, name);
+	return shader;
+}
+
+SimpleVertexShader* ShaderPermutations::GetVertexShader(ShaderKey key)
+{
+	if ((key >> 48) >= SHADER_SOURCE_COUNT || !sources[key >> 48].Vertex)
+		return 0;
+	return static_cast<SimpleVertexShader*>(Get(key));
+}
+
+SimplePixelShader* ShaderPermutations::GetPixelShader(ShaderKey key)
+{
+	if ((key >> 48) >= SHADER_SOURCE_COUNT || sources[key >> 48].Vertex)
+		return 0;
+	return static_cast<SimplePixelShader*>(Get(key));
+}
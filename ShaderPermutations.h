@@ -0,0 +1,94 @@
+#pragma once
+
+#include <d3d11.h>
+#include <string>
+#include <unordered_map>
+
+#include "SimpleShader.h"
+
+class ShaderArchive;
+class JobSystem;
+
+// --------------------------------------------------------
+// Shader source files that are compiled in several variants
+// --------------------------------------------------------
+enum ShaderSource
+{
+	SHADER_SOURCE_VERTEX_SHADER,	// VertexShader.hlsl
+	SHADER_SOURCE_PIXEL_SHADER,		// PixelShader.hlsl
+	SHADER_SOURCE_COUNT
+};
+
+// --------------------------------------------------------
+// Feature bits, each one a #define of the same name in the
+// shader source (with the "SHADER_FEATURE_" dropped)
+// --------------------------------------------------------
+enum ShaderFeature : unsigned long long
+{
+	SHADER_FEATURE_NONE			= 0,
+	SHADER_FEATURE_CLIP_PLANE	= 1ull << 0,	// Outputs SV_ClipDistance0 from "clipPlane"
+	SHADER_FEATURE_INSTANCED	= 1ull << 1,	// World matrix per instance, not per object
+	SHADER_FEATURE_UNLIT		= 1ull << 2,	// The texture's color, with no lights
+	SHADER_FEATURE_COUNT		= 3
+};
+
+// --------------------------------------------------------
+// A source and a set of features, packed into one number:
+// the source in the top 16 bits, feature bits below.  A
+// constant expression, so call sites name a variant without
+// building any strings.
+// --------------------------------------------------------
+typedef unsigned long long ShaderKey;
+
+constexpr ShaderKey MakeShaderKey(ShaderSource source, unsigned long long features = SHADER_FEATURE_NONE)
+{
+	return ((ShaderKey)source << 48) | (features & 0xFFFFFFFFFFFFull);
+}
+
+// --------------------------------------------------------
+// Every variant of a few shader sources, by ShaderKey
+//
+// Compile() runs at build time (from WinMain's -packshaders)
+// and writes a .cso for each combination of features a source
+// supports, named "<Source>@<hex features>" - the variant with
+// no features is the one the project compiles as usual.  The
+// archive then packs them with everything else.
+//
+// At runtime Get() is a hash lookup.  Variants aren't loaded
+// until first asked for, unless Preload() loads them up front.
+// The permutations own their shaders.  Not thread-safe.
+// --------------------------------------------------------
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(ID3D11Device* device, ID3D11DeviceContext* context, ShaderArchive* archive);
+	~ShaderPermutations();
+
+	static bool Compile(const char* sourceFolder, const char* outputFolder);
+
+	// Loads several variants at once, spread over the job system
+	void Preload(const ShaderKey* keys, unsigned int count, JobSystem* jobs);
+
+	// The variant, loading it if needed.  Null for a feature the
+	// source doesn't support; check IsShaderValid() for the rest.
+	ISimpleShader* Get(ShaderKey key);
+	SimpleVertexShader* GetVertexShader(ShaderKey key);
+	SimplePixelShader* GetPixelShader(ShaderKey key);
+
+	unsigned int GetLoadedCount() { return (unsigned int)shaders.size(); }
+
+	// "CLIP_PLANE_INSTANCED" - the features' #defines, joined
+	static std::string GetFeatureNames(unsigned long long features);
+
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+	ShaderArchive* archive;		// Optional - otherwise each variant's .cso
+
+	std::unordered_map<ShaderKey, ISimpleShader*> shaders;
+
+	static bool IsSupported(ShaderKey key);
+	static std::string GetVariantName(ShaderKey key);
+	ISimpleShader* Create(ShaderKey key);
+	void LoadFromFile(ISimpleShader* shader, const std::string& name);
+};
@@ -0,0 +1,441 @@
+#include "ShaderReflectionCache.h"
+#include <d3dcompiler.h>
+#include <fstream>
+#include <cstring>
+#include <mutex>
+
+std::unordered_map<unsigned long long, ShaderReflectionCache::Entry*> ShaderReflectionCache::entries;
+bool ShaderReflectionCache::reflectedAny = false;
+ShaderReflectionStats ShaderReflectionCache::stats = {};
+
+const unsigned int ShaderReflectionCache::Version;
+
+namespace
+{
+	std::mutex entryMutex;
+
+	// Appends little pieces of a cache file
+	struct Writer
+	{
+		std::vector<unsigned char> Data;
+
+		void U32(unsigned int value) { Bytes(&value, sizeof(value)); }
+		void U64(unsigned long long value) { Bytes(&value, sizeof(value)); }
+		void String(const std::string& s) { U32((unsigned int)s.size()); Bytes(s.data(), s.size()); }
+		void Bytes(const void* bytes, size_t size)
+		{
+			const unsigned char* b = (const unsigned char*)bytes;
+			Data.insert(Data.end(), b, b + size);
+		}
+	};
+
+	// Reads them back, failing (for good) at the first read
+	// that would go past the end
+	struct Reader
+	{
+		const unsigned char* At;
+		const unsigned char* End;
+		bool Ok;
+
+		bool Bytes(void* out, size_t size)
+		{
+			if (!Ok || (size_t)(End - At) < size)
+				return Ok = false;
+			memcpy(out, At, size);
+			At += size;
+			return true;
+		}
+
+		unsigned int U32() { unsigned int v = 0; Bytes(&v, sizeof(v)); return v; }
+		unsigned long long U64() { unsigned long long v = 0; Bytes(&v, sizeof(v)); return v; }
+		std::string String()
+		{
+			unsigned int length = U32();
+			if (!Ok || (size_t)(End - At) < length)
+			{
+				Ok = false;
+				return std::string();
+			}
+			std::string s((const char*)At, length);
+			At += length;
+			return s;
+		}
+
+		// A count of records that each take at least "minSize" bytes,
+		// checked against what's left so a bad count can't allocate
+		unsigned int Count(unsigned int minSize)
+		{
+			unsigned int count = U32();
+			if (Ok && (unsigned long long)count * minSize > (unsigned long long)(End - At))
+				Ok = false;
+			return Ok ? count : 0;
+		}
+	};
+}
+
+// --------------------------------------------------------
+// 64-bit FNV-1a, eight bytes at a time where possible
+// --------------------------------------------------------
+unsigned long long ShaderReflectionCache::Hash(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = 14695981039346656037ull;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	for (; i < size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+const ShaderReflection* ShaderReflectionCache::Get(const void* bytecode, size_t size)
+{
+	unsigned long long hash = Hash(bytecode, size);
+	{
+		std::lock_guard<std::mutex> lock(entryMutex);
+		auto found = entries.find(hash);
+		if (found != entries.end() && found->second->BytecodeSize == size)
+		{
+			found->second->Used = true;
+			stats.Hits++;
+			return &found->second->Reflection;
+		}
+	}
+
+	// Reflected without the lock, so other loads aren't held up
+	Entry* entry = new Entry();
+	entry->BytecodeSize = (unsigned int)size;
+	entry->Used = true;
+	if (!Reflect(bytecode, size, entry->Reflection))
+	{
+		delete entry;
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lock(entryMutex);
+	auto found = entries.find(hash);
+	if (found != entries.end() && found->second->BytecodeSize == size)
+	{
+		// Another thread got there first
+		delete entry;
+		found->second->Used = true;
+		stats.Hits++;
+		return &found->second->Reflection;
+	}
+
+	// A stale entry with the same hash is replaced
+	if (found != entries.end())
+	{
+		delete found->second;
+		found->second = entry;
+	}
+	else
+	{
+		entries[hash] = entry;
+	}
+
+	reflectedAny = true;
+	stats.Misses++;
+	return &entry->Reflection;
+}
+
+bool ShaderReflectionCache::IsModified()
+{
+	if (reflectedAny)
+		return true;
+
+	for (auto& e : entries)
+		if (!e.second->Used) return true;
+	return false;
+}
+
+void ShaderReflectionCache::Clear()
+{
+	for (auto& e : entries)
+		delete e.second;
+	entries.clear();
+	reflectedAny = false;
+}
+
+// --------------------------------------------------------
+// Replaces the cache with a file's contents.  Nothing is
+// kept from a file that fails any check.
+// --------------------------------------------------------
+bool ShaderReflectionCache::Load(const char* file)
+{
+	Clear();
+
+	std::ifstream in(file, std::ios::binary | std::ios::ate);
+	if (!in.is_open())
+		return false;
+
+	std::vector<unsigned char> data((size_t)in.tellg());
+	in.seekg(0);
+	if (data.empty() || !in.read((char*)&data[0], data.size()))
+		return false;
+
+	return Load(&data[0], data.size());
+}
+
+bool ShaderReflectionCache::Load(const void* data, size_t size)
+{
+	Clear();
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	Reader reader = { bytes, bytes + size, true };
+	char magic[4];
+	reader.Bytes(magic, 4);
+	unsigned int version = reader.U32();
+	unsigned int fileSize = reader.U32();
+	if (!reader.Ok || memcmp(magic, "SRFC", 4) != 0 || version != Version || fileSize != size)
+		return false;
+
+	std::vector<std::pair<unsigned long long, Entry*>> loaded;
+	unsigned int entryCount = reader.Count(12);
+	for (unsigned int e = 0; e < entryCount && reader.Ok; e++)
+	{
+		unsigned long long hash = reader.U64();
+		Entry* entry = new Entry();
+		entry->BytecodeSize = reader.U32();
+		entry->Used = false;
+		loaded.push_back(std::make_pair(hash, entry));
+
+		ShaderReflection& r = entry->Reflection;
+		r.Buffers.resize(reader.Count(12));
+		for (auto& b : r.Buffers)
+		{
+			b.Name = reader.String();
+			b.Size = reader.U32();
+			b.BindIndex = reader.U32();
+		}
+
+		r.Variables.resize(reader.Count(16));
+		for (auto& v : r.Variables)
+		{
+			v.Name = reader.String();
+			v.Buffer = reader.U32();
+			v.ByteOffset = reader.U32();
+			v.Size = reader.U32();
+			if (v.Buffer >= r.Buffers.size() || v.ByteOffset + (unsigned long long)v.Size > r.Buffers[v.Buffer].Size)
+				reader.Ok = false;
+		}
+
+		r.Resources.resize(reader.Count(12));
+		for (auto& res : r.Resources)
+		{
+			res.Name = reader.String();
+			res.BindIndex = reader.U32();
+			res.Sampler = reader.U32() != 0;
+		}
+
+		r.InputElements.resize(reader.Count(16));
+		for (auto& input : r.InputElements)
+		{
+			input.SemanticName = reader.String();
+			input.SemanticIndex = reader.U32();
+			input.Format = (DXGI_FORMAT)reader.U32();
+			input.PerInstance = reader.U32() != 0;
+		}
+	}
+
+	if (!reader.Ok || reader.At != reader.End)
+	{
+		for (auto& l : loaded)
+			delete l.second;
+		return false;
+	}
+
+	for (auto& l : loaded)
+	{
+		Entry*& slot = entries[l.first];
+		delete slot;
+		slot = l.second;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Writes every entry used since loading
+// --------------------------------------------------------
+bool ShaderReflectionCache::Save(const char* file)
+{
+	std::vector<unsigned char> data;
+	Save(data);
+
+	std::ofstream binary(file, std::ios::binary | std::ios::trunc);
+	if (!binary.is_open())
+		return false;
+	binary.write((const char*)&data[0], data.size());
+	return binary.good();
+}
+
+void ShaderReflectionCache::Save(std::vector<unsigned char>& data)
+{
+	Writer out;
+	out.Bytes("SRFC", 4);
+	out.U32(Version);
+	out.U32(0);		// File size, filled in at the end
+
+	unsigned int entryCount = 0;
+	for (auto& e : entries)
+		if (e.second->Used) entryCount++;
+	out.U32(entryCount);
+
+	for (auto& e : entries)
+	{
+		if (!e.second->Used)
+			continue;
+
+		out.U64(e.first);
+		out.U32(e.second->BytecodeSize);
+
+		ShaderReflection& r = e.second->Reflection;
+		out.U32((unsigned int)r.Buffers.size());
+		for (auto& b : r.Buffers)
+		{
+			out.String(b.Name);
+			out.U32(b.Size);
+			out.U32(b.BindIndex);
+		}
+
+		out.U32((unsigned int)r.Variables.size());
+		for (auto& v : r.Variables)
+		{
+			out.String(v.Name);
+			out.U32(v.Buffer);
+			out.U32(v.ByteOffset);
+			out.U32(v.Size);
+		}
+
+		out.U32((unsigned int)r.Resources.size());
+		for (auto& res : r.Resources)
+		{
+			out.String(res.Name);
+			out.U32(res.BindIndex);
+			out.U32(res.Sampler ? 1 : 0);
+		}
+
+		out.U32((unsigned int)r.InputElements.size());
+		for (auto& input : r.InputElements)
+		{
+			out.String(input.SemanticName);
+			out.U32(input.SemanticIndex);
+			out.U32((unsigned int)input.Format);
+			out.U32(input.PerInstance ? 1 : 0);
+		}
+	}
+
+	unsigned int fileSize = (unsigned int)out.Data.size();
+	memcpy(&out.Data[8], &fileSize, sizeof(fileSize));
+	data.swap(out.Data);
+
+	// Entries that weren't written are gone as far as the file goes
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (it->second->Used)
+		{
+			++it;
+			continue;
+		}
+		delete it->second;
+		it = entries.erase(it);
+	}
+	reflectedAny = false;
+}
+
+// --------------------------------------------------------
+// Pulls everything SimpleShader uses out of D3DReflect()
+// --------------------------------------------------------
+bool ShaderReflectionCache::Reflect(const void* bytecode, size_t size, ShaderReflection& out)
+{
+	ID3D11ShaderReflection* refl = 0;
+	if (FAILED(D3DReflect(bytecode, size, IID_ID3D11ShaderReflection, (void**)&refl)))
+		return false;
+
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	// Textures and samplers - anything else bound is handled
+	// (or ignored) by the shader type itself
+	for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
+		refl->GetResourceBindingDesc(r, &resourceDesc);
+		if (resourceDesc.Type != D3D_SIT_TEXTURE && resourceDesc.Type != D3D_SIT_SAMPLER)
+			continue;
+
+		ShaderReflection::Resource resource;
+		resource.Name = resourceDesc.Name;
+		resource.BindIndex = resourceDesc.BindPoint;
+		resource.Sampler = resourceDesc.Type == D3D_SIT_SAMPLER;
+		out.Resources.push_back(resource);
+	}
+
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		ID3D11ShaderReflectionConstantBuffer* cb = refl->GetConstantBufferByIndex(b);
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		ShaderReflection::Buffer buffer;
+		buffer.Name = bufferDesc.Name;
+		buffer.Size = bufferDesc.Size;
+		buffer.BindIndex = bindDesc.BindPoint;
+		out.Buffers.push_back(buffer);
+
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+
+			ShaderReflection::Variable variable;
+			variable.Name = varDesc.Name;
+			variable.Buffer = b;
+			variable.ByteOffset = varDesc.StartOffset;
+			variable.Size = varDesc.Size;
+			out.Variables.push_back(variable);
+		}
+	}
+
+	// The input signature, with each element's format worked
+	// out from its component type and how many it uses
+	static const DXGI_FORMAT formats[4][3] =
+	{
+		{ DXGI_FORMAT_R32_UINT, DXGI_FORMAT_R32_SINT, DXGI_FORMAT_R32_FLOAT },
+		{ DXGI_FORMAT_R32G32_UINT, DXGI_FORMAT_R32G32_SINT, DXGI_FORMAT_R32G32_FLOAT },
+		{ DXGI_FORMAT_R32G32B32_UINT, DXGI_FORMAT_R32G32B32_SINT, DXGI_FORMAT_R32G32B32_FLOAT },
+		{ DXGI_FORMAT_R32G32B32A32_UINT, DXGI_FORMAT_R32G32B32A32_SINT, DXGI_FORMAT_R32G32B32A32_FLOAT },
+	};
+	const std::string perInstance = "_PER_INSTANCE";
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+
+		ShaderReflection::InputElement input;
+		input.SemanticName = paramDesc.SemanticName;
+		input.SemanticIndex = paramDesc.SemanticIndex;
+		input.PerInstance =
+			input.SemanticName.size() >= perInstance.size() &&
+			input.SemanticName.compare(input.SemanticName.size() - perInstance.size(), perInstance.size(), perInstance) == 0;
+
+		int components = paramDesc.Mask == 1 ? 0 : paramDesc.Mask <= 3 ? 1 : paramDesc.Mask <= 7 ? 2 : 3;
+		int type = -1;
+		if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) type = 0;
+		else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) type = 1;
+		else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) type = 2;
+		input.Format = type >= 0 ? formats[components][type] : DXGI_FORMAT_UNKNOWN;
+
+		out.InputElements.push_back(input);
+	}
+
+	refl->Release();
+	return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <d3d11.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Everything SimpleShader needs out of a shader's reflection:
+// constant buffers and their variables, bound textures and
+// samplers, and the input signature (used by vertex shaders
+// to build their input layout).  Kept in reflection order.
+// --------------------------------------------------------
+struct ShaderReflection
+{
+	struct Buffer
+	{
+		std::string Name;
+		unsigned int Size;
+		unsigned int BindIndex;
+	};
+
+	struct Variable
+	{
+		std::string Name;
+		unsigned int Buffer;	// Index into Buffers
+		unsigned int ByteOffset;
+		unsigned int Size;
+	};
+
+	struct Resource
+	{
+		std::string Name;
+		unsigned int BindIndex;
+		bool Sampler;			// Otherwise a texture
+	};
+
+	struct InputElement
+	{
+		std::string SemanticName;
+		unsigned int SemanticIndex;
+		DXGI_FORMAT Format;
+		bool PerInstance;		// Semantic ends in "_PER_INSTANCE"
+	};
+
+	std::vector<Buffer> Buffers;
+	std::vector<Variable> Variables;
+	std::vector<Resource> Resources;
+	std::vector<InputElement> InputElements;
+};
+
+// --------------------------------------------------------
+// Loads since the last ResetStats()
+// --------------------------------------------------------
+struct ShaderReflectionStats
+{
+	unsigned int Hits;		// Found in the cache
+	unsigned int Misses;	// Had to be reflected
+};
+
+// --------------------------------------------------------
+// Remembers shader reflection results, keyed by a hash of the
+// bytecode, and saves them to a file so later runs can skip
+// D3DReflect() entirely
+//
+// The file holds a header ("SRFC", version, size, entry count)
+// followed by each entry's hash, bytecode size and records,
+// strings stored with their length in front.  A file that
+// doesn't check out is ignored, and rebuilt on the next Save().
+// Changed shaders just get new entries; entries that aren't
+// used during a run are dropped when it saves.
+//
+// Get() can be called from several threads at once (shaders
+// loading in parallel); everything else can't.
+// --------------------------------------------------------
+class ShaderReflectionCache
+{
+public:
+	// From the cache if this bytecode has been seen, otherwise
+	// reflected and added.  Stays valid until Clear().  Null
+	// if reflection fails.
+	static const ShaderReflection* Get(const void* bytecode, size_t size);
+
+	static bool Load(const char* file);
+	static bool Save(const char* file);
+
+	// The same, for a cache stored inside something else
+	// (like a ShaderArchive)
+	static bool Load(const void* data, size_t size);
+	static void Save(std::vector<unsigned char>& out);
+
+	// True when Get() reflected anything, or an entry went unused,
+	// since the last Load() or Save()
+	static bool IsModified();
+
+	static void Clear();
+
+	static ShaderReflectionStats& GetStats() { return stats; }
+	static void ResetStats() { stats = ShaderReflectionStats(); }
+
+	static unsigned long long Hash(const void* data, size_t size);
+
+private:
+	static const unsigned int Version = 1;
+
+	struct Entry
+	{
+		unsigned int BytecodeSize;
+		bool Used;				// Asked for since loading
+		ShaderReflection Reflection;
+	};
+
+	static std::unordered_map<unsigned long long, Entry*> entries;
+	static bool reflectedAny;
+	static ShaderReflectionStats stats;
+
+	static bool Reflect(const void* bytecode, size_t size, ShaderReflection& out);
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+// --------------------------------------------------------
+// GENERATED by ShaderLayoutGenerator from the compiled
+// shaders after each build - don't edit by hand.
+//
+// One struct per constant buffer, laid out the way HLSL
+// packs it, so the whole buffer is set with one copy:
+//    SimpleBufferHandle frame = vs->GetBufferHandle(VertexShader_perFrame::GetLayout());
+//    vs->SetBufferData(frame, data);
+// --------------------------------------------------------
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include "ShaderLayout.h"
+
+// cbuffer perFrame in PixelShader
+struct alignas(16) PixelShader_perFrame
+{
+	DirectX::XMFLOAT4 DirLightColor;
+	DirectX::XMFLOAT3 DirLightDirection;
+	float _pad0;
+	DirectX::XMFLOAT4 PointLightColor;
+	DirectX::XMFLOAT3 CameraPosition;
+	float _pad1;
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "DirLightColor", 0, 16 },
+			{ "DirLightDirection", 16, 12 },
+			{ "PointLightColor", 32, 16 },
+			{ "CameraPosition", 48, 12 },
+		};
+		static const ShaderLayout layout = { "perFrame", 64, fields, 4 };
+		return layout;
+	}
+};
+static_assert(sizeof(PixelShader_perFrame) == 64, "PixelShader_perFrame size");
+static_assert(offsetof(PixelShader_perFrame, DirLightColor) == 0, "PixelShader_perFrame::DirLightColor");
+static_assert(offsetof(PixelShader_perFrame, DirLightDirection) == 16, "PixelShader_perFrame::DirLightDirection");
+static_assert(offsetof(PixelShader_perFrame, PointLightColor) == 32, "PixelShader_perFrame::PointLightColor");
+static_assert(offsetof(PixelShader_perFrame, CameraPosition) == 48, "PixelShader_perFrame::CameraPosition");
+
+// cbuffer perFrame in SkyVS
+struct alignas(16) SkyVS_perFrame
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "view", 0, 64 },
+			{ "projection", 64, 64 },
+		};
+		static const ShaderLayout layout = { "perFrame", 128, fields, 2 };
+		return layout;
+	}
+};
+static_assert(sizeof(SkyVS_perFrame) == 128, "SkyVS_perFrame size");
+static_assert(offsetof(SkyVS_perFrame, view) == 0, "SkyVS_perFrame::view");
+static_assert(offsetof(SkyVS_perFrame, projection) == 64, "SkyVS_perFrame::projection");
+
+// cbuffer perFrame in VertexShader VertexShader@2
+struct alignas(16) VertexShader_perFrame
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "view", 0, 64 },
+			{ "projection", 64, 64 },
+		};
+		static const ShaderLayout layout = { "perFrame", 128, fields, 2 };
+		return layout;
+	}
+};
+static_assert(sizeof(VertexShader_perFrame) == 128, "VertexShader_perFrame size");
+static_assert(offsetof(VertexShader_perFrame, view) == 0, "VertexShader_perFrame::view");
+static_assert(offsetof(VertexShader_perFrame, projection) == 64, "VertexShader_perFrame::projection");
+
+// cbuffer perObject in VertexShader VertexShader@1
+struct alignas(16) VertexShader_perObject
+{
+	DirectX::XMFLOAT4X4 world;
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "world", 0, 64 },
+		};
+		static const ShaderLayout layout = { "perObject", 64, fields, 1 };
+		return layout;
+	}
+};
+static_assert(sizeof(VertexShader_perObject) == 64, "VertexShader_perObject size");
+static_assert(offsetof(VertexShader_perObject, world) == 0, "VertexShader_perObject::world");
+
+// cbuffer perFrame in VertexShader@1 VertexShader@3
+struct alignas(16) VertexShader_CLIP_PLANE_perFrame
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT4 clipPlane;
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "view", 0, 64 },
+			{ "projection", 64, 64 },
+			{ "clipPlane", 128, 16 },
+		};
+		static const ShaderLayout layout = { "perFrame", 144, fields, 3 };
+		return layout;
+	}
+};
+static_assert(sizeof(VertexShader_CLIP_PLANE_perFrame) == 144, "VertexShader_CLIP_PLANE_perFrame size");
+static_assert(offsetof(VertexShader_CLIP_PLANE_perFrame, view) == 0, "VertexShader_CLIP_PLANE_perFrame::view");
+static_assert(offsetof(VertexShader_CLIP_PLANE_perFrame, projection) == 64, "VertexShader_CLIP_PLANE_perFrame::projection");
+static_assert(offsetof(VertexShader_CLIP_PLANE_perFrame, clipPlane) == 128, "VertexShader_CLIP_PLANE_perFrame::clipPlane");
+
+// cbuffer lightData in WaterPS
+struct alignas(16) WaterPS_lightData
+{
+	DirectX::XMFLOAT4 DirLightColor;
+	DirectX::XMFLOAT3 DirLightDirection;
+	float _pad0;
+	DirectX::XMFLOAT4 PointLightColor;
+	DirectX::XMFLOAT3 PointLightPosition;
+	float _pad1;
+	DirectX::XMFLOAT3 CameraPosition;
+	float _pad2;
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "DirLightColor", 0, 16 },
+			{ "DirLightDirection", 16, 12 },
+			{ "PointLightColor", 32, 16 },
+			{ "PointLightPosition", 48, 12 },
+			{ "CameraPosition", 64, 12 },
+		};
+		static const ShaderLayout layout = { "lightData", 80, fields, 5 };
+		return layout;
+	}
+};
+static_assert(sizeof(WaterPS_lightData) == 80, "WaterPS_lightData size");
+static_assert(offsetof(WaterPS_lightData, DirLightColor) == 0, "WaterPS_lightData::DirLightColor");
+static_assert(offsetof(WaterPS_lightData, DirLightDirection) == 16, "WaterPS_lightData::DirLightDirection");
+static_assert(offsetof(WaterPS_lightData, PointLightColor) == 32, "WaterPS_lightData::PointLightColor");
+static_assert(offsetof(WaterPS_lightData, PointLightPosition) == 48, "WaterPS_lightData::PointLightPosition");
+static_assert(offsetof(WaterPS_lightData, CameraPosition) == 64, "WaterPS_lightData::CameraPosition");
+
+// cbuffer waterData in WaterPS
+struct alignas(16) WaterPS_waterData
+{
+	float waterTranslation;
+	float _pad0[3];
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "waterTranslation", 0, 4 },
+		};
+		static const ShaderLayout layout = { "waterData", 16, fields, 1 };
+		return layout;
+	}
+};
+static_assert(sizeof(WaterPS_waterData) == 16, "WaterPS_waterData size");
+static_assert(offsetof(WaterPS_waterData, waterTranslation) == 0, "WaterPS_waterData::waterTranslation");
+
+// cbuffer externalData in WaterVS
+struct alignas(16) WaterVS_externalData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT4X4 reflection;
+
+	static const ShaderLayout& GetLayout()
+	{
+		static const ShaderLayoutField fields[] =
+		{
+			{ "world", 0, 64 },
+			{ "view", 64, 64 },
+			{ "projection", 128, 64 },
+			{ "reflection", 192, 64 },
+		};
+		static const ShaderLayout layout = { "externalData", 256, fields, 4 };
+		return layout;
+	}
+};
+static_assert(sizeof(WaterVS_externalData) == 256, "WaterVS_externalData size");
+static_assert(offsetof(WaterVS_externalData, world) == 0, "WaterVS_externalData::world");
+static_assert(offsetof(WaterVS_externalData, view) == 64, "WaterVS_externalData::view");
+static_assert(offsetof(WaterVS_externalData, projection) == 128, "WaterVS_externalData::projection");
+static_assert(offsetof(WaterVS_externalData, reflection) == 192, "WaterVS_externalData::reflection");
+
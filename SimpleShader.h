@@ -1,300 +1,489 @@
-#pragma once
-#pragma comment(lib, "dxguid.lib")
-#pragma comment(lib, "d3dcompiler.lib")
-
-#include <d3d11.h>
-#include <d3dcompiler.h>
-#include <DirectXMath.h>
-
-#include <unordered_map>
-#include <vector>
-#include <string>
-
-// --------------------------------------------------------
-// Used by simple shaders to store information about
-// specific variables in constant buffers
-// --------------------------------------------------------
-struct SimpleShaderVariable
-{
-	unsigned int ByteOffset;
-	unsigned int Size;
-	unsigned int ConstantBufferIndex;
-};
-
-// --------------------------------------------------------
-// Contains information about a specific
-// constant buffer in a shader, as well as
-// the local data buffer for it
-// --------------------------------------------------------
-struct SimpleConstantBuffer
-{
-	std::string Name;
-	unsigned int Size;
-	unsigned int BindIndex;
-	ID3D11Buffer* ConstantBuffer;
-	unsigned char* LocalDataBuffer;
-	std::vector<SimpleShaderVariable> Variables;
-};
-
-// --------------------------------------------------------
-// Contains info about a single SRV in a shader
-// --------------------------------------------------------
-struct SimpleSRV
-{
-	unsigned int Index;		// The raw index of the SRV
-	unsigned int BindIndex; // The register of the SRV
-};
-
-// --------------------------------------------------------
-// Contains info about a single Sampler in a shader
-// --------------------------------------------------------
-struct SimpleSampler
-{
-	unsigned int Index;		// The raw index of the Sampler
-	unsigned int BindIndex; // The register of the Sampler
-};
-
-// --------------------------------------------------------
-// Base abstract class for simplifying shader handling
-// --------------------------------------------------------
-class ISimpleShader
-{
-public:
-	ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context);
-	virtual ~ISimpleShader();
-
-	// Initialization method (since we can't invoke derived class
-	// overrides in the base class constructor)
-	bool LoadShaderFile(LPCWSTR shaderFile);
-
-	// Simple helpers
-	bool IsShaderValid() { return shaderValid; }
-
-	// Activating the shader and copying data
-	void SetShader();
-	void CopyAllBufferData();
-	void CopyBufferData(unsigned int index);
-	void CopyBufferData(std::string bufferName);
-
-	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
-
-	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
-	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
-
-	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
-	
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
-	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
-	unsigned int GetShaderResourceViewCount() { return textureTable.size(); }
-	
-	const SimpleSampler* GetSamplerInfo(std::string name);
-	const SimpleSampler* GetSamplerInfo(unsigned int index);
-	unsigned int GetSamplerCount() { return samplerTable.size(); }
-
-	// Get data about constant buffers
-	unsigned int GetBufferCount();
-	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
-	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
-	
-	// Misc getters
-	ID3DBlob* GetShaderBlob() { return shaderBlob; }
-
-protected:
-	
-	bool shaderValid;
-	ID3DBlob* shaderBlob;
-	ID3D11Device* device;
-	ID3D11DeviceContext* deviceContext;
-
-	// Resource counts
-	unsigned int constantBufferCount;
-	
-	// Maps for variables and buffers
-	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
-	std::vector<SimpleSRV*>		shaderResourceViews;
-	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
-
-	// Pure virtual functions for dealing with shader types
-	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
-	virtual void SetShaderAndCBs() = 0;
-
-	virtual void CleanUp();
-
-	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
-};
-
-// --------------------------------------------------------
-// Derived class for VERTEX shaders ///////////////////////
-// --------------------------------------------------------
-class SimpleVertexShader : public ISimpleShader
-{
-public:
-	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context);
-	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11InputLayout* inputLayout, bool perInstanceCompatible);
-	~SimpleVertexShader();
-	ID3D11VertexShader* GetDirectXShader() { return shader; }
-	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
-	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
-
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
-protected:
-	bool perInstanceCompatible;
-	ID3D11InputLayout* inputLayout;
-	ID3D11VertexShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCBs();
-	void CleanUp();
-};
-
-
-// --------------------------------------------------------
-// Derived class for PIXEL shaders ////////////////////////
-// --------------------------------------------------------
-class SimplePixelShader : public ISimpleShader
-{
-public:
-	SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context);
-	~SimplePixelShader();
-	ID3D11PixelShader* GetDirectXShader() { return shader; }
-
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
-protected:
-	ID3D11PixelShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCBs();
-	void CleanUp();
-};
-
-// --------------------------------------------------------
-// Derived class for DOMAIN shaders ///////////////////////
-// --------------------------------------------------------
-class SimpleDomainShader : public ISimpleShader
-{
-public:
-	SimpleDomainShader(ID3D11Device* device, ID3D11DeviceContext* context);
-	~SimpleDomainShader();
-	ID3D11DomainShader* GetDirectXShader() { return shader; }
-
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
-protected:
-	ID3D11DomainShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCBs();
-	void CleanUp();
-};
-
-// --------------------------------------------------------
-// Derived class for HULL shaders /////////////////////////
-// --------------------------------------------------------
-class SimpleHullShader : public ISimpleShader
-{
-public:
-	SimpleHullShader(ID3D11Device* device, ID3D11DeviceContext* context);
-	~SimpleHullShader();
-	ID3D11HullShader* GetDirectXShader() { return shader; }
-
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
-protected:
-	ID3D11HullShader* shader;
-	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCBs();
-	void CleanUp();
-};
-
-// --------------------------------------------------------
-// Derived class for GEOMETRY shaders /////////////////////
-// --------------------------------------------------------
-class SimpleGeometryShader : public ISimpleShader
-{
-public:
-	SimpleGeometryShader(ID3D11Device* device, ID3D11DeviceContext* context, bool useStreamOut = 0, bool allowStreamOutRasterization = 0);
-	~SimpleGeometryShader();
-	ID3D11GeometryShader* GetDirectXShader() { return shader; }
-
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
-	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
-
-	static void UnbindStreamOutStage(ID3D11DeviceContext* deviceContext);
-
-protected:
-	// Shader itself
-	ID3D11GeometryShader* shader;
-
-	// Stream out related
-	bool useStreamOut;
-	bool allowStreamOutRasterization;
-	unsigned int streamOutVertexSize;
-
-	bool CreateShader(ID3DBlob* shaderBlob);
-	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob);
-	void SetShaderAndCBs();
-	void CleanUp();
-
-	// Helpers
-	unsigned int CalcComponentCount(unsigned int mask);
-};
-
-
-// --------------------------------------------------------
-// Derived class for COMPUTE shaders //////////////////////
-// --------------------------------------------------------
-class SimpleComputeShader : public ISimpleShader
-{
-public:
-	SimpleComputeShader(ID3D11Device* device, ID3D11DeviceContext* context);
-	~SimpleComputeShader();
-	ID3D11ComputeShader* GetDirectXShader() { return shader; }
-
-	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
-	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
-
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
-
-	int GetUnorderedAccessViewIndex(std::string name);
-
-protected:
-	ID3D11ComputeShader* shader;
-	std::unordered_map<std::string, unsigned int> uavTable;
-
-	unsigned int threadsX;
-	unsigned int threadsY;
-	unsigned int threadsZ;
-	unsigned int threadsTotal;
-
-	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCBs();
-	void CleanUp();
+#pragma once
+#pragma comment(lib, "dxguid.lib")
+#pragma comment(lib, "d3dcompiler.lib")
+
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <d3dcompiler.h>
+#include <DirectXMath.h>
+#include "StateCache.h"
+#include "ShaderReflectionCache.h"
+#include "ShaderLayout.h"
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <type_traits>
+#include <cstring>
+
+// --------------------------------------------------------
+// Used by simple shaders to store information about
+// specific variables in constant buffers
+// --------------------------------------------------------
+struct SimpleShaderVariable
+{
+	unsigned int ByteOffset;
+	unsigned int Size;
+	unsigned int ConstantBufferIndex;
+};
+
+// --------------------------------------------------------
+// A variable looked up once, ahead of time, so setting it
+// later is just a copy.  Only good for the shader it came
+// from, and invalid (Size of 0) if that shader doesn't have
+// the variable.
+// --------------------------------------------------------
+struct SimpleShaderHandle
+{
+	unsigned int ByteOffset;
+	unsigned int Size;
+	unsigned int ConstantBufferIndex;
+
+	bool IsValid() const { return Size > 0; }
+};
+
+// --------------------------------------------------------
+// A whole constant buffer, checked against a generated struct
+// (see ShaderStructs.h).  Invalid (Size of 0) if the shader
+// doesn't have the buffer or lays it out differently.
+// --------------------------------------------------------
+struct SimpleBufferHandle
+{
+	unsigned int ConstantBufferIndex;
+	unsigned int Size;
+
+	bool IsValid() const { return Size > 0; }
+};
+
+// --------------------------------------------------------
+// FNV-1a hash of a variable name, usable at compile time
+// --------------------------------------------------------
+constexpr unsigned int SimpleShaderHash(const char* name, unsigned int hash = 2166136261u)
+{
+	return *name ? SimpleShaderHash(name + 1, (hash ^ (unsigned char)*name) * 16777619u) : hash;
+}
+
+// A variable name that's already been hashed
+struct SimpleShaderKey
+{
+	explicit constexpr SimpleShaderKey(unsigned int hash) : Hash(hash) { }
+	unsigned int Hash;
+};
+
+// Hashes a string literal while compiling, for setters that
+// don't keep a handle around:
+//    vs->SetMatrix4x4(SHADER_KEY("view"), view);
+#define SHADER_KEY(name) SimpleShaderKey(std::integral_constant<unsigned int, SimpleShaderHash(name)>::value)
+
+// --------------------------------------------------------
+// How often a constant buffer's values change, taken from
+// the start of its name in the shader:
+//    cbuffer perFrame, cbuffer perMaterial, cbuffer perObject
+// Any other name is untagged.
+// --------------------------------------------------------
+enum SimpleBufferFrequency
+{
+	SIMPLE_BUFFER_UNTAGGED,
+	SIMPLE_BUFFER_PER_FRAME,
+	SIMPLE_BUFFER_PER_MATERIAL,
+	SIMPLE_BUFFER_PER_OBJECT
+};
+
+// --------------------------------------------------------
+// Contains information about a specific
+// constant buffer in a shader, as well as
+// the local data buffer for it
+// --------------------------------------------------------
+struct SimpleConstantBuffer
+{
+	std::string Name;
+	unsigned int Size;
+	unsigned int BindIndex;
+	SimpleBufferFrequency Frequency;
+	ID3D11Buffer* ConstantBuffer;
+	unsigned char* LocalDataBuffer;
+	std::vector<SimpleShaderVariable> Variables;
+
+	// Bytes [DirtyStart, DirtyEnd) changed since the last upload
+	bool Dirty;
+	unsigned int DirtyStart;
+	unsigned int DirtyEnd;
+};
+
+// --------------------------------------------------------
+// Constant buffer traffic across every shader, since the
+// last ResetStats()
+// --------------------------------------------------------
+struct SimpleShaderStats
+{
+	unsigned int Uploads;
+	unsigned int UploadsSkipped;	// Copy requested, nothing had changed
+	unsigned int BytesUploaded;
+};
+
+// --------------------------------------------------------
+// Contains info about a single SRV in a shader
+// --------------------------------------------------------
+struct SimpleSRV
+{
+	unsigned int Index;		// The raw index of the SRV
+	unsigned int BindIndex; // The register of the SRV
+};
+
+// --------------------------------------------------------
+// Contains info about a single Sampler in a shader
+// --------------------------------------------------------
+struct SimpleSampler
+{
+	unsigned int Index;		// The raw index of the Sampler
+	unsigned int BindIndex; // The register of the Sampler
+};
+
+// --------------------------------------------------------
+// Base abstract class for simplifying shader handling
+// --------------------------------------------------------
+class ISimpleShader
+{
+public:
+	ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	virtual ~ISimpleShader();
+
+	// Initialization method (since we can't invoke derived class
+	// overrides in the base class constructor)
+	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadShaderBlob(ID3DBlob* blob);
+
+	// Simple helpers
+	bool IsShaderValid() { return shaderValid; }
+
+	// Activating the shader and copying data
+	void SetShader();
+	void CopyAllBufferData();
+	void CopyBufferData(unsigned int index);
+	void CopyBufferData(std::string bufferName);
+
+	// Sets arbitrary shader data
+	bool SetData(std::string name, const void* data, unsigned int size);
+
+	bool SetInt(std::string name, int data);
+	bool SetFloat(std::string name, float data);
+	bool SetFloat2(std::string name, const float data[2]);
+	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(std::string name, const float data[3]);
+	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(std::string name, const float data[4]);
+	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(std::string name, const float data[16]);
+	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+
+	// Looks a variable up once, for the handle setters below
+	SimpleShaderHandle GetVariableHandle(std::string name);
+	SimpleShaderHandle GetVariableHandle(SimpleShaderKey key);
+
+	// Sets shader data through a handle, with no lookup at all
+	bool SetData(const SimpleShaderHandle& handle, const void* data, unsigned int size)
+	{
+		if (handle.Size != size)
+			return false;
+
+		WriteData(constantBuffers[handle.ConstantBufferIndex], handle.ByteOffset, data, size);
+		return true;
+	}
+
+	bool SetInt(const SimpleShaderHandle& handle, int data)								{ return SetData(handle, &data, sizeof(int)); }
+	bool SetFloat(const SimpleShaderHandle& handle, float data)							{ return SetData(handle, &data, sizeof(float)); }
+	bool SetFloat2(const SimpleShaderHandle& handle, const DirectX::XMFLOAT2& data)		{ return SetData(handle, &data, sizeof(float) * 2); }
+	bool SetFloat3(const SimpleShaderHandle& handle, const DirectX::XMFLOAT3& data)		{ return SetData(handle, &data, sizeof(float) * 3); }
+	bool SetFloat4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4& data)		{ return SetData(handle, &data, sizeof(float) * 4); }
+	bool SetMatrix4x4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4X4& data)	{ return SetData(handle, &data, sizeof(float) * 16); }
+
+	// Sets shader data by hashed name - an integer lookup, but
+	// no string is built
+	bool SetInt(SimpleShaderKey key, int data)								{ return SetInt(GetVariableHandle(key), data); }
+	bool SetFloat(SimpleShaderKey key, float data)							{ return SetFloat(GetVariableHandle(key), data); }
+	bool SetFloat2(SimpleShaderKey key, const DirectX::XMFLOAT2& data)		{ return SetFloat2(GetVariableHandle(key), data); }
+	bool SetFloat3(SimpleShaderKey key, const DirectX::XMFLOAT3& data)		{ return SetFloat3(GetVariableHandle(key), data); }
+	bool SetFloat4(SimpleShaderKey key, const DirectX::XMFLOAT4& data)		{ return SetFloat4(GetVariableHandle(key), data); }
+	bool SetMatrix4x4(SimpleShaderKey key, const DirectX::XMFLOAT4X4& data)	{ return SetMatrix4x4(GetVariableHandle(key), data); }
+
+	// Checks a generated struct's layout against this shader's
+	// buffer of the same name, variable by variable
+	SimpleBufferHandle GetBufferHandle(const ShaderLayout& layout);
+
+	// Sets a whole buffer from its generated struct in one copy
+	bool SetBufferData(const SimpleBufferHandle& handle, const void* data, unsigned int size)
+	{
+		if (handle.Size != size)
+			return false;
+
+		WriteData(constantBuffers[handle.ConstantBufferIndex], 0, data, size);
+		return true;
+	}
+
+	template<typename T>
+	bool SetBufferData(const SimpleBufferHandle& handle, const T& data) { return SetBufferData(handle, &data, sizeof(T)); }
+
+	// Setting shader resources
+	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
+	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+
+	// Getting data about variables and resources
+	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	
+	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
+	unsigned int GetShaderResourceViewCount() { return textureTable.size(); }
+	
+	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(unsigned int index);
+	unsigned int GetSamplerCount() { return samplerTable.size(); }
+
+	// Get data about constant buffers
+	unsigned int GetBufferCount();
+	unsigned int GetBufferSize(unsigned int index);
+	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
+	const SimpleConstantBuffer* GetBufferInfo(SimpleBufferFrequency frequency);	// The first one with this tag
+
+	// Per-object buffers filled and bound by the caller instead,
+	// out of a ConstantBufferRing.  While set, CopyAllBufferData()
+	// and SetShader() leave them alone.
+	void SetObjectDataExternal(bool external) { externalObjectData = external; }
+	
+	// Misc getters
+	ID3DBlob* GetShaderBlob() { return shaderBlob; }
+
+	// Upload counts, shared by every shader
+	static SimpleShaderStats& GetStats() { return stats; }
+	static void ResetStats() { stats = SimpleShaderStats(); }
+
+protected:
+	
+	bool shaderValid;
+	ID3DBlob* shaderBlob;
+	ID3D11Device* device;
+	ID3D11DeviceContext* deviceContext;
+
+	// Set when constant buffers can be partly updated (D3D 11.1)
+	bool partialUpdates;
+
+	// Where uploads and dispatches go instead of the context
+	RenderBackend* backend;
+
+	// Shared with everything else binding on this context, so
+	// binds that change nothing are dropped
+	StateCache* stateCache;
+
+	static SimpleShaderStats stats;
+
+	bool externalObjectData;
+
+	// This shader's reflection, only while LoadShaderFile() runs
+	const ShaderReflection* reflection;
+	bool IsExternal(const SimpleConstantBuffer& cb) { return externalObjectData && cb.Frequency == SIMPLE_BUFFER_PER_OBJECT; }
+
+	// Resource counts
+	unsigned int constantBufferCount;
+	
+	// Maps for variables and buffers
+	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
+	std::vector<SimpleSRV*>		shaderResourceViews;
+	std::vector<SimpleSampler*>	samplerStates;
+	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
+	std::unordered_map<std::string, SimpleShaderVariable> varTable;
+	std::unordered_map<unsigned int, SimpleShaderVariable> keyTable;	// By SimpleShaderHash() of the name
+	std::unordered_map<std::string, SimpleSRV*> textureTable;
+	std::unordered_map<std::string, SimpleSampler*> samplerTable;
+
+	// Pure virtual functions for dealing with shader types
+	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
+	virtual void SetShaderAndCBs() = 0;
+
+	virtual void CleanUp();
+
+	// Copies data into a local buffer, marking the bytes dirty
+	// only if they actually changed
+	void WriteData(SimpleConstantBuffer& cb, unsigned int offset, const void* data, unsigned int size)
+	{
+		unsigned char* target = cb.LocalDataBuffer + offset;
+		if (memcmp(target, data, size) == 0)
+			return;
+
+		memcpy(target, data, size);
+		if (!cb.Dirty)
+		{
+			cb.Dirty = true;
+			cb.DirtyStart = offset;
+			cb.DirtyEnd = offset + size;
+			return;
+		}
+
+		if (offset < cb.DirtyStart) cb.DirtyStart = offset;
+		if (offset + size > cb.DirtyEnd) cb.DirtyEnd = offset + size;
+	}
+
+	// Sends a buffer's dirty bytes to the GPU, if there are any
+	void UploadBuffer(SimpleConstantBuffer& cb);
+
+	// Puts a variable in both lookup tables
+	void AddVariable(const std::string& name, const SimpleShaderVariable& variable);
+
+	// Helpers for finding data by name
+	SimpleShaderVariable* FindVariable(std::string name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+};
+
+// --------------------------------------------------------
+// Derived class for VERTEX shaders ///////////////////////
+// --------------------------------------------------------
+class SimpleVertexShader : public ISimpleShader
+{
+public:
+	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	SimpleVertexShader(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11InputLayout* inputLayout, bool perInstanceCompatible);
+	~SimpleVertexShader();
+	ID3D11VertexShader* GetDirectXShader() { return shader; }
+	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
+	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
+
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+
+protected:
+	bool perInstanceCompatible;
+	ID3D11InputLayout* inputLayout;
+	ID3D11VertexShader* shader;
+	bool CreateShader(ID3DBlob* shaderBlob);
+	void SetShaderAndCBs();
+	void CleanUp();
+};
+
+
+// --------------------------------------------------------
+// Derived class for PIXEL shaders ////////////////////////
+// --------------------------------------------------------
+class SimplePixelShader : public ISimpleShader
+{
+public:
+	SimplePixelShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	~SimplePixelShader();
+	ID3D11PixelShader* GetDirectXShader() { return shader; }
+
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+
+protected:
+	ID3D11PixelShader* shader;
+	bool CreateShader(ID3DBlob* shaderBlob);
+	void SetShaderAndCBs();
+	void CleanUp();
+};
+
+// --------------------------------------------------------
+// Derived class for DOMAIN shaders ///////////////////////
+// --------------------------------------------------------
+class SimpleDomainShader : public ISimpleShader
+{
+public:
+	SimpleDomainShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	~SimpleDomainShader();
+	ID3D11DomainShader* GetDirectXShader() { return shader; }
+
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+
+protected:
+	ID3D11DomainShader* shader;
+	bool CreateShader(ID3DBlob* shaderBlob);
+	void SetShaderAndCBs();
+	void CleanUp();
+};
+
+// --------------------------------------------------------
+// Derived class for HULL shaders /////////////////////////
+// --------------------------------------------------------
+class SimpleHullShader : public ISimpleShader
+{
+public:
+	SimpleHullShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	~SimpleHullShader();
+	ID3D11HullShader* GetDirectXShader() { return shader; }
+
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+
+protected:
+	ID3D11HullShader* shader;
+	bool CreateShader(ID3DBlob* shaderBlob);
+	void SetShaderAndCBs();
+	void CleanUp();
+};
+
+// --------------------------------------------------------
+// Derived class for GEOMETRY shaders /////////////////////
+// --------------------------------------------------------
+class SimpleGeometryShader : public ISimpleShader
+{
+public:
+	SimpleGeometryShader(ID3D11Device* device, ID3D11DeviceContext* context, bool useStreamOut = 0, bool allowStreamOutRasterization = 0);
+	~SimpleGeometryShader();
+	ID3D11GeometryShader* GetDirectXShader() { return shader; }
+
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+
+	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
+
+	static void UnbindStreamOutStage(ID3D11DeviceContext* deviceContext);
+
+protected:
+	// Shader itself
+	ID3D11GeometryShader* shader;
+
+	// Stream out related
+	bool useStreamOut;
+	bool allowStreamOutRasterization;
+	unsigned int streamOutVertexSize;
+
+	bool CreateShader(ID3DBlob* shaderBlob);
+	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob);
+	void SetShaderAndCBs();
+	void CleanUp();
+
+	// Helpers
+	unsigned int CalcComponentCount(unsigned int mask);
+};
+
+
+// --------------------------------------------------------
+// Derived class for COMPUTE shaders //////////////////////
+// --------------------------------------------------------
+class SimpleComputeShader : public ISimpleShader
+{
+public:
+	SimpleComputeShader(ID3D11Device* device, ID3D11DeviceContext* context);
+	~SimpleComputeShader();
+	ID3D11ComputeShader* GetDirectXShader() { return shader; }
+
+	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
+	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
+
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
+
+	int GetUnorderedAccessViewIndex(std::string name);
+
+protected:
+	ID3D11ComputeShader* shader;
+	std::unordered_map<std::string, unsigned int> uavTable;
+
+	unsigned int threadsX;
+	unsigned int threadsY;
+	unsigned int threadsZ;
+	unsigned int threadsTotal;
+
+	bool CreateShader(ID3DBlob* shaderBlob);
+	void SetShaderAndCBs();
+	void CleanUp();
 };
\ No newline at end of file
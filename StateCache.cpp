@@ -0,0 +1,239 @@
+#include "StateCache.h"
+#include <unordered_map>
+
+namespace
+{
+	char unknownState;
+	std::unordered_map<ID3D11DeviceContext*, StateCache*> caches;
+}
+
+void* const StateCache::Unknown = &unknownState;
+
+const unsigned int StateCache::MaxConstantBuffers;
+const unsigned int StateCache::MaxResources;
+const unsigned int StateCache::MaxSamplers;
+const unsigned int StateCache::MaxVertexBuffers;
+
+StateCache::StateCache(RenderBackend* backend)
+{
+	this->backend = backend;
+	stats = StateCacheStats();
+	Invalidate();
+}
+
+// --------------------------------------------------------
+// Finds the cache for a context, making it the first time.
+// Caches live until Release() is called for their context.
+// --------------------------------------------------------
+StateCache* StateCache::Get(ID3D11DeviceContext* context)
+{
+	StateCache*& cache = caches[context];
+	if (!cache)
+		cache = new StateCache(RenderBackend::Get(context));
+	return cache;
+}
+
+void StateCache::Release(ID3D11DeviceContext* context)
+{
+	auto found = caches.find(context);
+	if (found == caches.end())
+		return;
+
+	delete found->second;
+	caches.erase(found);
+}
+
+void StateCache::Invalidate()
+{
+	for (unsigned int s = 0; s < SHADER_STAGE_COUNT; s++)
+	{
+		shaders[s] = Unknown;
+		for (auto& b : constantBuffers[s]) b = Unknown;
+		for (auto& r : resources[s]) r = Unknown;
+		for (auto& t : samplers[s]) t = Unknown;
+	}
+
+	inputLayout = Unknown;
+	topologyKnown = false;
+	for (auto& v : vertexBuffers) v = Unknown;
+	indexBuffer = Unknown;
+}
+
+bool StateCache::ChangeShader(ShaderStage stage, void* shader)
+{
+	stats.Calls++;
+	if (shaders[stage] == shader)
+	{
+		stats.Filtered++;
+		return false;
+	}
+
+	shaders[stage] = shader;
+	return true;
+}
+
+void StateCache::SetShader(ID3D11VertexShader* shader)		{ if (ChangeShader(SHADER_STAGE_VERTEX, shader)) backend->SetShader(SHADER_STAGE_VERTEX, shader); }
+void StateCache::SetShader(ID3D11HullShader* shader)		{ if (ChangeShader(SHADER_STAGE_HULL, shader)) backend->SetShader(SHADER_STAGE_HULL, shader); }
+void StateCache::SetShader(ID3D11DomainShader* shader)		{ if (ChangeShader(SHADER_STAGE_DOMAIN, shader)) backend->SetShader(SHADER_STAGE_DOMAIN, shader); }
+void StateCache::SetShader(ID3D11GeometryShader* shader)	{ if (ChangeShader(SHADER_STAGE_GEOMETRY, shader)) backend->SetShader(SHADER_STAGE_GEOMETRY, shader); }
+void StateCache::SetShader(ID3D11PixelShader* shader)		{ if (ChangeShader(SHADER_STAGE_PIXEL, shader)) backend->SetShader(SHADER_STAGE_PIXEL, shader); }
+void StateCache::SetShader(ID3D11ComputeShader* shader)		{ if (ChangeShader(SHADER_STAGE_COMPUTE, shader)) backend->SetShader(SHADER_STAGE_COMPUTE, shader); }
+
+// --------------------------------------------------------
+// Works out which part of a range bind actually changes
+// anything, as [first, end), and remembers the new values.
+// False if nothing changes at all.
+// --------------------------------------------------------
+bool StateCache::Trim(void** cached, unsigned int capacity, unsigned int slot, unsigned int count, void* const* items, unsigned int& first, unsigned int& end)
+{
+	stats.Calls++;
+	first = slot;
+	end = slot + count;
+
+	// Partly past the tracked slots - bind it all, and keep
+	// whatever fits
+	if (end > capacity)
+	{
+		for (unsigned int i = slot; i < capacity; i++)
+			cached[i] = items[i - slot];
+		return true;
+	}
+
+	while (first < end && cached[first] == items[first - slot])
+		first++;
+	while (end > first && cached[end - 1] == items[end - 1 - slot])
+		end--;
+
+	if (first == end)
+	{
+		stats.Filtered++;
+		return false;
+	}
+
+	for (unsigned int i = first; i < end; i++)
+		cached[i] = items[i - slot];
+	return true;
+}
+
+void StateCache::SetConstantBuffers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers)
+{
+	unsigned int first, end;
+	if (!Trim(constantBuffers[stage], MaxConstantBuffers, slot, count, (void* const*)buffers, first, end))
+		return;
+
+	ID3D11Buffer* const* changed = buffers + (first - slot);
+	backend->SetConstantBuffers(stage, first, end - first, changed);
+}
+
+void StateCache::SetShaderResources(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11ShaderResourceView* const* views)
+{
+	unsigned int first, end;
+	if (!Trim(resources[stage], MaxResources, slot, count, (void* const*)views, first, end))
+		return;
+
+	ID3D11ShaderResourceView* const* changed = views + (first - slot);
+	backend->SetShaderResources(stage, first, end - first, changed);
+}
+
+void StateCache::SetSamplers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11SamplerState* const* states)
+{
+	unsigned int first, end;
+	if (!Trim(samplers[stage], MaxSamplers, slot, count, (void* const*)states, first, end))
+		return;
+
+	ID3D11SamplerState* const* changed = states + (first - slot);
+	backend->SetSamplers(stage, first, end - first, changed);
+}
+
+bool StateCache::SetConstantBufferRange(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	stats.Calls++;
+	if (slot < MaxConstantBuffers)
+		constantBuffers[stage][slot] = Unknown;
+
+	return backend->SetConstantBufferRange(stage, slot, buffer, firstConstant, constantCount);
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	stats.Calls++;
+	if (inputLayout == layout)
+	{
+		stats.Filtered++;
+		return;
+	}
+
+	inputLayout = layout;
+	backend->SetInputLayout(layout);
+}
+
+void StateCache::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	stats.Calls++;
+	if (topologyKnown && this->topology == topology)
+	{
+		stats.Filtered++;
+		return;
+	}
+
+	topologyKnown = true;
+	this->topology = topology;
+	backend->SetPrimitiveTopology(topology);
+}
+
+// --------------------------------------------------------
+// Vertex buffers match only if the buffer, stride and offset
+// all do, so these are trimmed separately from the others
+// --------------------------------------------------------
+void StateCache::SetVertexBuffers(unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets)
+{
+	stats.Calls++;
+	unsigned int first = slot;
+	unsigned int end = slot + count;
+
+	auto same = [&](unsigned int i)
+	{
+		unsigned int n = i - slot;
+		return vertexBuffers[i] == buffers[n] && vertexStrides[i] == strides[n] && vertexOffsets[i] == offsets[n];
+	};
+
+	if (end <= MaxVertexBuffers)
+	{
+		while (first < end && same(first))
+			first++;
+		while (end > first && same(end - 1))
+			end--;
+
+		if (first == end)
+		{
+			stats.Filtered++;
+			return;
+		}
+	}
+
+	for (unsigned int i = first; i < end && i < MaxVertexBuffers; i++)
+	{
+		unsigned int n = i - slot;
+		vertexBuffers[i] = buffers[n];
+		vertexStrides[i] = strides[n];
+		vertexOffsets[i] = offsets[n];
+	}
+
+	unsigned int n = first - slot;
+	backend->SetVertexBuffers(first, end - first, buffers + n, strides + n, offsets + n);
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset)
+{
+	stats.Calls++;
+	if (indexBuffer == buffer && indexFormat == format && indexOffset == offset)
+	{
+		stats.Filtered++;
+		return;
+	}
+
+	indexBuffer = buffer;
+	indexFormat = format;
+	indexOffset = offset;
+	backend->SetIndexBuffer(buffer, format, offset);
+}
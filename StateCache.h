@@ -0,0 +1,98 @@
+#pragma once
+
+#include <d3d11.h>
+#include "RenderBackend.h"
+
+// --------------------------------------------------------
+// Bind calls since the last ResetStats()
+// --------------------------------------------------------
+struct StateCacheStats
+{
+	unsigned int Calls;		// Bind calls made on the cache
+	unsigned int Filtered;	// Calls dropped because nothing changed
+};
+
+// --------------------------------------------------------
+// Remembers what's bound on a device context and drops binds
+// that wouldn't change anything.  What's left goes to the
+// context's RenderBackend.
+//
+// Tracks shaders, constant buffers, SRVs and samplers for every
+// stage, plus the input layout, topology, vertex buffers and
+// index buffer.  Range binds are trimmed down to the slots that
+// actually change.  The context holds a reference to whatever is
+// bound, so a matching pointer is always the same object.
+//
+// Anything that binds straight on the context behind the cache's
+// back (or that D3D unbinds by itself, like an SRV whose texture
+// becomes a render target) must be followed by Invalidate().
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	// Slots past these are bound every time, without filtering
+	static const unsigned int MaxConstantBuffers = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+	static const unsigned int MaxResources = 32;
+	static const unsigned int MaxSamplers = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+	static const unsigned int MaxVertexBuffers = 8;
+
+	StateCache(RenderBackend* backend);
+
+	// The one cache shared by everything binding on a context
+	static StateCache* Get(ID3D11DeviceContext* context);
+	static void Release(ID3D11DeviceContext* context);
+
+	void SetShader(ID3D11VertexShader* shader);
+	void SetShader(ID3D11HullShader* shader);
+	void SetShader(ID3D11DomainShader* shader);
+	void SetShader(ID3D11GeometryShader* shader);
+	void SetShader(ID3D11PixelShader* shader);
+	void SetShader(ID3D11ComputeShader* shader);
+
+	void SetConstantBuffers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers);
+	void SetShaderResources(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(ShaderStage stage, unsigned int slot, unsigned int count, ID3D11SamplerState* const* samplers);
+
+	// Binds part of a buffer, in 16 byte constants, with the 11.1
+	// context.  Offsets change per draw, so these always go through
+	// and leave the slot untracked.  False if the backend can't.
+	bool SetConstantBufferRange(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
+
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetVertexBuffers(unsigned int slot, unsigned int count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+	void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, unsigned int offset);
+
+	// Forgets everything, so the next bind of each kind goes through
+	void Invalidate();
+
+	StateCacheStats& GetStats() { return stats; }
+	void ResetStats() { stats = StateCacheStats(); }
+
+private:
+	RenderBackend* backend;
+	StateCacheStats stats;
+
+	// Stands in for "don't know what's bound" - null is a real binding
+	static void* const Unknown;
+
+	void* shaders[SHADER_STAGE_COUNT];
+	void* constantBuffers[SHADER_STAGE_COUNT][MaxConstantBuffers];
+	void* resources[SHADER_STAGE_COUNT][MaxResources];
+	void* samplers[SHADER_STAGE_COUNT][MaxSamplers];
+
+	void* inputLayout;
+	bool topologyKnown;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+
+	void* vertexBuffers[MaxVertexBuffers];
+	UINT vertexStrides[MaxVertexBuffers];
+	UINT vertexOffsets[MaxVertexBuffers];
+
+	void* indexBuffer;
+	DXGI_FORMAT indexFormat;
+	unsigned int indexOffset;
+
+	bool ChangeShader(ShaderStage stage, void* shader);
+	bool Trim(void** cached, unsigned int capacity, unsigned int slot, unsigned int count, void* const* items, unsigned int& first, unsigned int& end);
+};
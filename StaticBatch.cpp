@@ -0,0 +1,222 @@
+#include "StaticBatch.h"
+#include "JobSystem.h"
+
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+StaticBatch::StaticBatch(JobSystem* jobs)
+{
+	this->jobs = jobs;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+}
+
+StaticBatch::~StaticBatch()
+{
+	DestroyChunks();
+}
+
+void StaticBatch::DestroyChunks()
+{
+	for (auto& c : chunks) delete c.MeshData;
+	chunks.clear();
+	culler = FrustumCuller();
+}
+
+unsigned int StaticBatch::AddSource(const Vertex* verts, unsigned int vertCount, const unsigned int* indices, unsigned int indexCount)
+{
+	Source source;
+	source.Vertices.assign(verts, verts + vertCount);
+	source.Indices.assign(indices, indices + indexCount);
+
+	// Local bounds, so instances can be sorted into cells
+	XMFLOAT3 boxMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boxMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int i = 0; i < vertCount; i++)
+	{
+		const XMFLOAT3& p = verts[i].Position;
+		if (p.x < boxMin.x) boxMin.x = p.x;
+		if (p.y < boxMin.y) boxMin.y = p.y;
+		if (p.z < boxMin.z) boxMin.z = p.z;
+		if (p.x > boxMax.x) boxMax.x = p.x;
+		if (p.y > boxMax.y) boxMax.y = p.y;
+		if (p.z > boxMax.z) boxMax.z = p.z;
+	}
+	if (vertCount == 0)
+		boxMin = boxMax = XMFLOAT3(0, 0, 0);
+
+	source.Center = XMFLOAT3((boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f);
+	source.Extents = XMFLOAT3((boxMax.x - boxMin.x) * 0.5f, (boxMax.y - boxMin.y) * 0.5f, (boxMax.z - boxMin.z) * 0.5f);
+
+	sources.push_back(source);
+	return (unsigned int)sources.size() - 1;
+}
+
+void StaticBatch::AddInstance(unsigned int source, unsigned int material, const XMFLOAT4X4& world)
+{
+	Instance instance;
+	instance.Source = source;
+	instance.Material = material;
+	instance.World = world;
+	instances.push_back(instance);
+}
+
+// --------------------------------------------------------
+// Sorts the instances into chunks, merges each chunk's
+// geometry as a job, then creates one mesh per chunk
+// --------------------------------------------------------
+bool StaticBatch::Build(ID3D11Device* device, float chunkSize)
+{
+	DestroyChunks();
+
+	// Group by material and the grid cell each instance's
+	// world-space center falls in
+	std::unordered_map<unsigned long long, unsigned int> cellToChunk;
+	std::vector<std::vector<unsigned int>> chunkInstances;
+	for (unsigned int i = 0; i < instances.size(); i++)
+	{
+		Instance& instance = instances[i];
+		Source& source = sources[instance.Source];
+
+		XMFLOAT3 center, extents;
+		FrustumCuller::TransformBounds(source.Center, source.Extents, instance.World, center, extents);
+
+		// 16 bits per cell coordinate is plenty, and wraps harmlessly beyond that
+		unsigned long long x = (unsigned short)(int)floorf(center.x / chunkSize);
+		unsigned long long y = (unsigned short)(int)floorf(center.y / chunkSize);
+		unsigned long long z = (unsigned short)(int)floorf(center.z / chunkSize);
+		unsigned long long key = ((unsigned long long)(instance.Material & 0xFFFF) << 48) | (x << 32) | (y << 16) | z;
+
+		auto found = cellToChunk.find(key);
+		if (found == cellToChunk.end())
+		{
+			found = cellToChunk.insert(std::make_pair(key, (unsigned int)chunkInstances.size())).first;
+			chunkInstances.push_back(std::vector<unsigned int>());
+		}
+		chunkInstances[found->second].push_back(i);
+	}
+
+	// The merging is independent per chunk
+	unsigned int chunkCount = (unsigned int)chunkInstances.size();
+	std::vector<std::vector<Vertex>> chunkVerts(chunkCount);
+	std::vector<std::vector<unsigned int>> chunkIndices(chunkCount);
+	jobs->ParallelFor(chunkCount, 1, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int c = begin; c < end; c++)
+			MergeChunk(chunkInstances[c], chunkVerts[c], chunkIndices[c]);
+	});
+
+	// Buffers are made here, on the calling thread
+	bool succeeded = true;
+	for (unsigned int c = 0; c < chunkCount; c++)
+	{
+		if (chunkVerts[c].empty() || chunkIndices[c].empty())
+			continue;
+
+		// A chunk without buffers can't be drawn, so it's left out
+		StaticChunk chunk;
+		chunk.MeshData = new Mesh(&chunkVerts[c][0], (int)chunkVerts[c].size(), &chunkIndices[c][0], (int)chunkIndices[c].size(), device);
+		if (!chunk.MeshData->GetVertexBuffer() || !chunk.MeshData->GetIndexBuffer())
+		{
+			delete chunk.MeshData;
+			succeeded = false;
+			continue;
+		}
+
+		chunk.Material = instances[chunkInstances[c][0]].Material;
+		chunk.Center = chunk.MeshData->GetBoundsCenter();
+		chunk.Extents = chunk.MeshData->GetBoundsExtents();
+		chunks.push_back(chunk);
+	}
+
+	// Chunk bounds never change, so set them once
+	for (unsigned int c = 0; c < chunks.size(); c++)
+		culler.SetWorldBounds(culler.Add(), chunks[c].Center, chunks[c].Extents);
+
+	// Everything is in the chunks now
+	std::vector<Source>().swap(sources);
+	std::vector<Instance>().swap(instances);
+	return succeeded;
+}
+
+// --------------------------------------------------------
+// Appends world-space copies of every instance in a chunk.
+// Positions and tangents go through the world matrix, normals
+// through its inverse transpose so non-uniform scale is fine.
+// --------------------------------------------------------
+void StaticBatch::MergeChunk(const std::vector<unsigned int>& chunkInstances, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	size_t vertCount = 0, indexCount = 0;
+	for (auto& i : chunkInstances)
+	{
+		vertCount += sources[instances[i].Source].Vertices.size();
+		indexCount += sources[instances[i].Source].Indices.size();
+	}
+	verts.reserve(vertCount);
+	indices.reserve(indexCount);
+
+	for (auto& i : chunkInstances)
+	{
+		const Source& source = sources[instances[i].Source];
+		const XMFLOAT4X4& w = instances[i].World;
+
+		// Rows of the transposed matrix are the columns of the world matrix
+		XMFLOAT3 a(w._11, w._12, w._13);
+		XMFLOAT3 b(w._21, w._22, w._23);
+		XMFLOAT3 c(w._31, w._32, w._33);
+
+		// The inverse transpose is the cofactor matrix over the
+		// determinant, and only its direction matters for normals
+		XMFLOAT3 ca(b.y * c.z - b.z * c.y, b.z * c.x - b.x * c.z, b.x * c.y - b.y * c.x);
+		XMFLOAT3 cb(c.y * a.z - c.z * a.y, c.z * a.x - c.x * a.z, c.x * a.y - c.y * a.x);
+		XMFLOAT3 cc(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+		float det = a.x * ca.x + a.y * ca.y + a.z * ca.z;
+		float sign = det < 0.0f ? -1.0f : 1.0f;
+
+		unsigned int firstVert = (unsigned int)verts.size();
+		for (auto& v : source.Vertices)
+		{
+			Vertex out = v;
+			const XMFLOAT3& p = v.Position;
+			out.Position = XMFLOAT3(
+				a.x * p.x + a.y * p.y + a.z * p.z + w._14,
+				b.x * p.x + b.y * p.y + b.z * p.z + w._24,
+				c.x * p.x + c.y * p.y + c.z * p.z + w._34);
+
+			const XMFLOAT3& n = v.Normal;
+			XMFLOAT3 normal(
+				sign * (ca.x * n.x + ca.y * n.y + ca.z * n.z),
+				sign * (cb.x * n.x + cb.y * n.y + cb.z * n.z),
+				sign * (cc.x * n.x + cc.y * n.y + cc.z * n.z));
+			float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+			if (length > 0.0f)
+				out.Normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+
+			// The mesh recalculates tangents, but keep them sensible anyway
+			const XMFLOAT3& t = v.Tangent;
+			out.Tangent = XMFLOAT3(
+				a.x * t.x + a.y * t.y + a.z * t.z,
+				b.x * t.x + b.y * t.y + b.z * t.z,
+				c.x * t.x + c.y * t.y + c.z * t.z);
+
+			verts.push_back(out);
+		}
+
+		// A mirroring transform flips the winding, so flip it back
+		const std::vector<unsigned int>& in = source.Indices;
+		for (size_t t = 0; t + 2 < in.size(); t += 3)
+		{
+			indices.push_back(firstVert + in[t]);
+			indices.push_back(firstVert + (det < 0.0f ? in[t + 2] : in[t + 1]));
+			indices.push_back(firstVert + (det < 0.0f ? in[t + 1] : in[t + 2]));
+		}
+	}
+}
+
+void StaticBatch::Cull(const Frustum& frustum, CullResult& result)
+{
+	culler.Cull(frustum, result);
+}
+
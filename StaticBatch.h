@@ -0,0 +1,90 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Vertex.h"
+#include "Mesh.h"
+#include "FrustumCuller.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// One merged piece of the static scene: every instance of one
+// material whose bounds are centered in the same grid cell
+// --------------------------------------------------------
+struct StaticChunk
+{
+	Mesh* MeshData;
+	unsigned int Material;			// Whatever the caller passed to AddInstance()
+	DirectX::XMFLOAT3 Center;		// World-space bounds
+	DirectX::XMFLOAT3 Extents;
+};
+
+// --------------------------------------------------------
+// Merges geometry that never moves into a few big meshes
+//
+// Instances are pre-transformed into world space and merged
+// into one vertex/index buffer per material per grid cell, so
+// a static scene takes a handful of draws but chunks can still
+// be frustum culled.  Chunk vertices are built in parallel on
+// the job system, then the buffers are created on the calling
+// thread.
+// --------------------------------------------------------
+class StaticBatch
+{
+public:
+	StaticBatch(JobSystem* jobs);
+	~StaticBatch();
+
+	// Local-space geometry to place copies of.  The arrays are
+	// copied, and returns the id to pass to AddInstance().
+	unsigned int AddSource(const Vertex* verts, unsigned int vertCount, const unsigned int* indices, unsigned int indexCount);
+
+	// world - Transposed, the way the TransformStore keeps it
+	void AddInstance(unsigned int source, unsigned int material, const DirectX::XMFLOAT4X4& world);
+
+	// Merges every instance into chunks of roughly chunkSize world
+	// units, replacing any earlier chunks.  Sources and instances are
+	// freed afterwards.  False if any chunk's buffers couldn't be
+	// made; those chunks are left out, so their instances are missing.
+	bool Build(ID3D11Device* device, float chunkSize);
+
+	unsigned int GetChunkCount() { return (unsigned int)chunks.size(); }
+	StaticChunk& GetChunk(unsigned int chunk) { return chunks[chunk]; }
+
+	// Chunks draw with an identity world matrix (transposed, like every other)
+	const DirectX::XMFLOAT4X4* GetWorldMatrix() { return &identity; }
+
+	// Marks which chunks are at least partly inside the frustum
+	void Cull(const Frustum& frustum, CullResult& result);
+
+private:
+	struct Source
+	{
+		std::vector<Vertex> Vertices;
+		std::vector<unsigned int> Indices;
+		DirectX::XMFLOAT3 Center;
+		DirectX::XMFLOAT3 Extents;
+	};
+
+	struct Instance
+	{
+		unsigned int Source;
+		unsigned int Material;
+		DirectX::XMFLOAT4X4 World;
+	};
+
+	JobSystem* jobs;
+	std::vector<Source> sources;
+	std::vector<Instance> instances;
+
+	std::vector<StaticChunk> chunks;
+	FrustumCuller culler;
+	DirectX::XMFLOAT4X4 identity;
+
+	void DestroyChunks();
+	void MergeChunk(const std::vector<unsigned int>& chunkInstances, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+};
+
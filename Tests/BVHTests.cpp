@@ -0,0 +1,277 @@
+#include "Test.h"
+#include "../BVH.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// Boxes kept as min/max, the way the BVH stores them, so the
+	// brute force tests see exactly the same numbers
+	struct Box
+	{
+		unsigned int Id;
+		XMFLOAT3 Min;
+		XMFLOAT3 Max;
+	};
+}
+
+static XMFLOAT3 Center(const Box& b) { return XMFLOAT3((b.Min.x + b.Max.x) * 0.5f, (b.Min.y + b.Max.y) * 0.5f, (b.Min.z + b.Max.z) * 0.5f); }
+static XMFLOAT3 Extents(const Box& b) { return XMFLOAT3((b.Max.x - b.Min.x) * 0.5f, (b.Max.y - b.Min.y) * 0.5f, (b.Max.z - b.Min.z) * 0.5f); }
+
+// Boxes on a quarter unit grid, so centers and extents are exact
+static Box RandomBox(std::mt19937& random, unsigned int id, float range)
+{
+	std::uniform_int_distribution<int> position(-(int)(range * 4), (int)(range * 4));
+	std::uniform_int_distribution<int> size(1, 12);
+
+	Box b;
+	b.Id = id;
+	b.Min = XMFLOAT3(position(random) * 0.25f, position(random) * 0.125f, position(random) * 0.25f);
+	float x = size(random) * 0.25f;
+	float y = size(random) * 0.25f;
+	float z = size(random) * 0.25f;
+	b.Max = XMFLOAT3(b.Min.x + x, b.Min.y + y, b.Min.z + z);
+	return b;
+}
+
+// Camera at the origin, turned "yaw" radians from +Z
+static Frustum MakeFrustum(float yaw)
+{
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixRotationY(yaw));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 80.0f)));
+	return Frustum::FromMatrices(view, projection);
+}
+
+static bool IsInside(const Frustum& frustum, const Box& b)
+{
+	XMFLOAT3 c = Center(b);
+	XMFLOAT3 e = Extents(b);
+	for (unsigned int p = 0; p < frustum.PlaneCount; p++)
+	{
+		const XMFLOAT4& n = frustum.Planes[p];
+		if (n.x * c.x + n.y * c.y + n.z * c.z + n.w + fabsf(n.x) * e.x + fabsf(n.y) * e.y + fabsf(n.z) * e.z < 0)
+			return false;
+	}
+	return true;
+}
+
+// Checks one cull against testing every box, including that
+// nothing is listed twice
+static bool CullMatches(BVH& bvh, const std::vector<Box>& boxes, const Frustum& frustum)
+{
+	CullResult result;
+	bvh.Cull(frustum, result);
+
+	unsigned int visible = 0;
+	for (auto& b : boxes)
+	{
+		bool inside = IsInside(frustum, b);
+		if (result.IsVisible(b.Id) != inside)
+			return false;
+		visible += inside ? 1 : 0;
+	}
+	return result.Visible.size() == visible;
+}
+
+static void BuildBVH(BVH& bvh, const std::vector<Box>& boxes)
+{
+	bvh.Clear();
+	for (auto& b : boxes)
+		bvh.AddItem(b.Id, Center(b), Extents(b));
+	bvh.Build();
+}
+
+TEST(BVHCullMatchesBruteForce)
+{
+	std::mt19937 random(6);
+	std::vector<Box> boxes;
+	for (unsigned int i = 0; i < 5000; i++)
+		boxes.push_back(RandomBox(random, i * 3 + 7, 60));
+
+	BVH bvh;
+	BuildBVH(bvh, boxes);
+	CHECK(bvh.GetItemCount() == boxes.size());
+
+	bool matches = true;
+	for (int view = 0; view < 8; view++)
+		matches = matches && CullMatches(bvh, boxes, MakeFrustum(view * XM_PIDIV4));
+	CHECK(matches);
+
+	// A few moved items walk up from their leaves...
+	for (unsigned int i = 0; i < 50; i++)
+	{
+		Box& b = boxes[i * 97];
+		b = RandomBox(random, b.Id, 60);
+		CHECK(bvh.SetBounds(b.Id, Center(b), Extents(b)));
+	}
+	bvh.Refit();
+	matches = true;
+	for (int view = 0; view < 8; view++)
+		matches = matches && CullMatches(bvh, boxes, MakeFrustum(view * XM_PIDIV4));
+	CHECK(matches);
+
+	// ...and lots of them get a full sweep
+	for (unsigned int i = 0; i < boxes.size(); i += 2)
+	{
+		Box& b = boxes[i];
+		b = RandomBox(random, b.Id, 60);
+		bvh.SetBounds(b.Id, Center(b), Extents(b));
+	}
+	bvh.Refit();
+	matches = true;
+	for (int view = 0; view < 8; view++)
+		matches = matches && CullMatches(bvh, boxes, MakeFrustum(view * XM_PIDIV4));
+	CHECK(matches);
+
+	CHECK(!bvh.SetBounds(1, XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)));
+}
+
+TEST(BVHRaycastAndOverlap)
+{
+	std::mt19937 random(7);
+	std::vector<Box> boxes;
+	for (unsigned int i = 0; i < 2000; i++)
+		boxes.push_back(RandomBox(random, i, 40));
+
+	BVH bvh;
+	BuildBVH(bvh, boxes);
+
+	// Rays from the middle, checked against the nearest box hit
+	bool raysMatch = true;
+	for (int r = 0; r < 64; r++)
+	{
+		float angle = r * XM_2PI / 64;
+		XMFLOAT3 origin(0.1f, 0.3f, 0.2f);
+		XMFLOAT3 direction(cosf(angle), 0.05f, sinf(angle));
+
+		float nearest = 100;
+		bool expectHit = false;
+		for (auto& b : boxes)
+		{
+			float tNear = 0, tFar = nearest;
+			const float o[3] = { origin.x, origin.y, origin.z };
+			const float d[3] = { direction.x, direction.y, direction.z };
+			const float lo[3] = { b.Min.x, b.Min.y, b.Min.z };
+			const float hi[3] = { b.Max.x, b.Max.y, b.Max.z };
+			for (int a = 0; a < 3; a++)
+			{
+				float t0 = (lo[a] - o[a]) / d[a];
+				float t1 = (hi[a] - o[a]) / d[a];
+				tNear = fmaxf(tNear, fminf(t0, t1));
+				tFar = fminf(tFar, fmaxf(t0, t1));
+			}
+			if (tNear <= tFar)
+			{
+				nearest = tNear;
+				expectHit = true;
+			}
+		}
+
+		unsigned int id = 0;
+		float distance = 0;
+		bool hit = bvh.Raycast(origin, direction, 100, &id, &distance);
+		raysMatch = raysMatch && hit == expectHit && (!hit || fabsf(distance - nearest) < 1e-3f);
+	}
+	CHECK(raysMatch);
+
+	// Overlaps, checked against every box
+	bool overlapsMatch = true;
+	for (int q = 0; q < 32; q++)
+	{
+		Box query = RandomBox(random, 0, 40);
+		query.Max = XMFLOAT3(query.Max.x + 5, query.Max.y + 5, query.Max.z + 5);
+
+		std::vector<unsigned int> ids;
+		bvh.Overlap(query.Min, query.Max, ids);
+
+		std::vector<unsigned char> found(boxes.size(), 0);
+		for (auto id : ids) found[id]++;
+		for (auto& b : boxes)
+		{
+			bool overlaps =
+				b.Min.x <= query.Max.x && b.Max.x >= query.Min.x &&
+				b.Min.y <= query.Max.y && b.Max.y >= query.Min.y &&
+				b.Min.z <= query.Max.z && b.Max.z >= query.Min.z;
+			overlapsMatch = overlapsMatch && found[b.Id] == (overlaps ? 1 : 0);
+		}
+	}
+	CHECK(overlapsMatch);
+}
+
+// --------------------------------------------------------
+// Builds a BVH over a field of random boxes and times the
+// build, frustum culls (against the flat SIMD culler over
+// the same boxes), raycasts and refitting after a tenth of
+// the boxes move.
+// --------------------------------------------------------
+BENCHMARK(bvh, "[items = 100000] [queries = 200]")
+{
+	unsigned int itemCount = argc > 0 ? strtoul(argv[0], 0, 10) : 100000;
+	unsigned int queries = argc > 1 ? strtoul(argv[1], 0, 10) : 200;
+	if (itemCount == 0 || queries == 0)
+		return 1;
+
+	std::mt19937 random(8);
+	std::vector<Box> boxes;
+	FrustumCuller flat;
+	for (unsigned int i = 0; i < itemCount; i++)
+	{
+		boxes.push_back(RandomBox(random, i, 400));
+		flat.SetWorldBounds(flat.Add(), Center(boxes.back()), Extents(boxes.back()));
+	}
+
+	BVH bvh;
+	double start = GetMilliseconds();
+	BuildBVH(bvh, boxes);
+	double buildMilliseconds = GetMilliseconds() - start;
+
+	CullResult result;
+	size_t visible = 0;
+	start = GetMilliseconds();
+	for (unsigned int q = 0; q < queries; q++)
+	{
+		result.Visible.clear();
+		result.Flags.assign(result.Flags.size(), 0);
+		bvh.Cull(MakeFrustum(q * XM_2PI / queries), result);
+		visible += result.Visible.size();
+	}
+	double bvhCullMilliseconds = (GetMilliseconds() - start) / queries;
+
+	start = GetMilliseconds();
+	for (unsigned int q = 0; q < queries; q++)
+		flat.Cull(MakeFrustum(q * XM_2PI / queries), result);
+	double flatCullMilliseconds = (GetMilliseconds() - start) / queries;
+
+	unsigned int hits = 0;
+	const unsigned int rayCount = queries * 100;
+	start = GetMilliseconds();
+	for (unsigned int r = 0; r < rayCount; r++)
+	{
+		float angle = r * XM_2PI / rayCount;
+		if (bvh.Raycast(XMFLOAT3(0, 0, 0), XMFLOAT3(cosf(angle), 0.01f, sinf(angle)), 1000, 0, 0))
+			hits++;
+	}
+	double rayMicroseconds = (GetMilliseconds() - start) * 1000 / rayCount;
+
+	for (unsigned int i = 0; i < itemCount; i += 10)
+	{
+		Box moved = RandomBox(random, i, 400);
+		bvh.SetBounds(i, Center(moved), Extents(moved));
+	}
+	start = GetMilliseconds();
+	bvh.Refit();
+	double refitMilliseconds = GetMilliseconds() - start;
+
+	printf("Items:                 %u (%u nodes)\n", itemCount, bvh.GetNodeCount());
+	printf("Build:                 %.2f ms\n", buildMilliseconds);
+	printf("Frustum cull:          %.3f ms (flat culler %.3f ms), %.0f visible on average\n", bvhCullMilliseconds, flatCullMilliseconds, (double)visible / queries);
+	printf("Raycast:               %.2f us per ray, %u of %u hit\n", rayMicroseconds, hits, rayCount);
+	printf("Refit:                 %.2f ms with a tenth moved\n", refitMilliseconds);
+	return 0;
+}
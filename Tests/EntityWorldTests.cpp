@@ -0,0 +1,265 @@
+#include "Test.h"
+#include "../EntityWorld.h"
+#include "../JobSystem.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+
+namespace
+{
+	struct Position { float X, Y, Z; };
+	struct Velocity { float X, Y, Z; };
+	struct Tag { int Value; };
+	struct Matrix { float M[16]; };
+	struct alignas(16) Aligned { float V[4]; };
+
+	// What the test expects of each live entity
+	struct Expected
+	{
+		Entity Handle;
+		int PositionX;
+		int TagValue;		// -1 without a Tag
+	};
+}
+
+TEST(EntityWorldMatchesReference)
+{
+	EntityWorld world;
+	std::map<unsigned int, Expected> expected;
+	std::vector<Entity> alive;
+	std::mt19937 random(1);
+
+	// Random creates, destroys and component changes, each
+	// mirrored in a plain map
+	for (int step = 0; step < 200000; step++)
+	{
+		unsigned int action = random() % 6;
+		if (action < 2 || alive.empty())
+		{
+			Entity e;
+			if (random() % 2)
+			{
+				e = world.Create(Position{ (float)step, 0, 0 });
+				expected[e.Index] = { e, step, -1 };
+			}
+			else
+			{
+				e = world.Create(Position{ (float)step, 0, 0 }, Tag{ step });
+				expected[e.Index] = { e, step, step };
+			}
+			alive.push_back(e);
+			continue;
+		}
+
+		unsigned int pick = random() % alive.size();
+		Entity e = alive[pick];
+		switch (action)
+		{
+		case 2:
+			world.Destroy(e);
+			expected.erase(e.Index);
+			alive[pick] = alive.back();
+			alive.pop_back();
+			CHECK(!world.IsAlive(e));
+			break;
+		case 3:
+			world.Add(e, Tag{ step });
+			expected[e.Index].TagValue = step;
+			break;
+		case 4:
+			world.Remove<Tag>(e);
+			expected[e.Index].TagValue = -1;
+			break;
+		default:
+			world.Get<Position>(e)->X = (float)step;
+			expected[e.Index].PositionX = step;
+			break;
+		}
+	}
+
+	CHECK(world.GetCount() == expected.size());
+	size_t untagged = 0;
+	for (auto& entry : expected)
+	{
+		Position* position = world.Get<Position>(entry.second.Handle);
+		Tag* tag = world.Get<Tag>(entry.second.Handle);
+		CHECK(position && position->X == (float)entry.second.PositionX);
+		CHECK((tag == 0) == (entry.second.TagValue < 0));
+		CHECK(!tag || tag->Value == entry.second.TagValue);
+		if (!tag)
+			untagged++;
+	}
+
+	// Queries see every entity once, and exclusions work
+	size_t seen = 0;
+	bool handlesMatch = true;
+	world.ForEach<Position>([&](Entity e, Position&)
+	{
+		seen++;
+		handlesMatch = handlesMatch && expected[e.Index].Handle == e;
+	});
+	CHECK(seen == expected.size());
+	CHECK(handlesMatch);
+
+	size_t seenUntagged = 0;
+	world.ForEach<Position>([&](Entity, Position&) { seenUntagged++; }, MaskOf<Tag>());
+	CHECK(seenUntagged == untagged);
+
+	JobSystem jobs(0);
+	size_t parallelSeen = 0;
+	world.ParallelForEachChunk<Position>(&jobs, [&](unsigned int count, Entity*, Position*) { parallelSeen += count; });
+	CHECK(parallelSeen == expected.size());
+}
+
+TEST(EntityWorldCommandBuffer)
+{
+	EntityWorld world;
+	for (int i = 0; i < 1000; i++)
+	{
+		if (i % 3 == 0)
+			world.Create(Position{ 0, 0, 0 }, Tag{ i });
+		else
+			world.Create(Position{ 0, 0, 0 });
+	}
+
+	// Structural changes are held until playback
+	EntityCommandBuffer commands;
+	size_t tagged = 0;
+	world.ForEach<Tag>([&](Entity e, Tag&)
+	{
+		commands.Destroy(e);
+		commands.Create(Velocity{ 1, 2, 3 }, Tag{ -5 });
+		tagged++;
+	});
+	CHECK(world.GetCount() == 1000);
+	commands.Playback(&world);
+
+	size_t created = 0;
+	world.ForEach<Velocity, Tag>([&](Entity, Velocity& v, Tag& t)
+	{
+		if (v.Y == 2 && t.Value == -5)
+			created++;
+	});
+	CHECK(created == tagged);
+	CHECK(world.GetCount() == 1000);
+	CHECK(world.Get<Position>(NoEntity) == 0);
+}
+
+TEST(EntityWorldChunkAlignment)
+{
+	// Enough entities for several chunks, so fresh and reused
+	// chunks are both checked
+	EntityWorld world;
+	std::vector<Entity> entities;
+	for (int i = 0; i < 5000; i++)
+		entities.push_back(world.Create(Tag{ i }, Aligned{}, Position{}));
+	for (size_t i = 0; i < entities.size(); i += 2)
+		world.Destroy(entities[i]);
+	for (int i = 0; i < 5000; i++)
+		world.Create(Aligned{}, Matrix{});
+
+	bool aligned = true;
+	world.ForEach<Aligned>([&](Entity, Aligned& a)
+	{
+		aligned = aligned && ((uintptr_t)&a % alignof(Aligned)) == 0;
+	});
+	CHECK(aligned);
+}
+
+// --------------------------------------------------------
+// Moves entities the old way, one heap object each, and then
+// through the world, and times creating, iterating and
+// destroying both.  The heap objects are shuffled and mixed
+// with other allocations, like they would be after a while.
+// --------------------------------------------------------
+BENCHMARK(entities, "[count = 100000] [passes = 50]")
+{
+	unsigned int count = argc > 0 ? strtoul(argv[0], 0, 10) : 100000;
+	unsigned int passes = argc > 1 ? strtoul(argv[1], 0, 10) : 50;
+	if (count == 0 || passes == 0)
+		return 1;
+
+	struct HeapEntity
+	{
+		Position P;
+		Velocity V;
+		Matrix World;
+		void* Mesh;
+		void* Material;
+	};
+	std::mt19937 random(2);
+
+	std::vector<HeapEntity*> objects;
+	std::vector<char*> clutter;
+	double start = GetMilliseconds();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		objects.push_back(new HeapEntity{ { 0, 0, 0 }, { 1, 1, 1 } });
+		clutter.push_back(new char[16 + random() % 200]);
+	}
+	double heapCreate = GetMilliseconds() - start;
+	std::shuffle(objects.begin(), objects.end(), random);
+
+	start = GetMilliseconds();
+	for (unsigned int pass = 0; pass < passes; pass++)
+	{
+		for (auto o : objects)
+		{
+			o->P.X += o->V.X * 0.016f;
+			o->P.Y += o->V.Y * 0.016f;
+			o->P.Z += o->V.Z * 0.016f;
+		}
+	}
+	double heapIterate = (GetMilliseconds() - start) / passes;
+
+	start = GetMilliseconds();
+	for (auto o : objects)
+		delete o;
+	double heapDestroy = GetMilliseconds() - start;
+	for (auto c : clutter)
+		delete[] c;
+
+	EntityWorld world;
+	std::vector<Entity> entities;
+	start = GetMilliseconds();
+	for (unsigned int i = 0; i < count; i++)
+		entities.push_back(world.Create(Position{ 0, 0, 0 }, Velocity{ 1, 1, 1 }, Matrix{}));
+	double worldCreate = GetMilliseconds() - start;
+
+	start = GetMilliseconds();
+	for (unsigned int pass = 0; pass < passes; pass++)
+	{
+		world.ForEachChunk<Position, Velocity>([](unsigned int n, Entity*, Position* p, Velocity* v)
+		{
+			for (unsigned int i = 0; i < n; i++)
+			{
+				p[i].X += v[i].X * 0.016f;
+				p[i].Y += v[i].Y * 0.016f;
+				p[i].Z += v[i].Z * 0.016f;
+			}
+		});
+	}
+	double worldIterate = (GetMilliseconds() - start) / passes;
+
+	std::shuffle(entities.begin(), entities.end(), random);
+	start = GetMilliseconds();
+	for (auto e : entities)
+		world.Destroy(e);
+	double worldDestroy = GetMilliseconds() - start;
+
+	// Chunks are kept, so this shouldn't allocate
+	start = GetMilliseconds();
+	for (unsigned int i = 0; i < count; i++)
+		world.Create(Position{ 0, 0, 0 }, Velocity{ 1, 1, 1 }, Matrix{});
+	double worldRecreate = GetMilliseconds() - start;
+
+	printf("Entities:              %u, %u passes\n", count, passes);
+	printf("Heap objects:          create %.2f ms, iterate %.3f ms, destroy %.2f ms\n", heapCreate, heapIterate, heapDestroy);
+	printf("Entity world:          create %.2f ms, iterate %.3f ms, destroy %.2f ms, recreate %.2f ms\n", worldCreate, worldIterate, worldDestroy, worldRecreate);
+	printf("Chunks:                %u\n", world.GetChunkCount());
+	return 0;
+}
@@ -0,0 +1,188 @@
+#include "Test.h"
+#include "../FrustumCuller.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace DirectX;
+
+// Camera at the origin looking down +Z, transposed like the Camera
+// keeps them.  At z = 10 the view is about 8.3 wide and 4.1 high
+// either side of the center.
+static Frustum MakeFrustum()
+{
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixIdentity());
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMMatrixPerspectiveFovLH(0.25f * XM_PI, 2.0f, 0.1f, 100.0f)));
+	return Frustum::FromMatrices(view, projection);
+}
+
+// One box against every plane, the plain way
+static bool IsInside(const Frustum& frustum, const XMFLOAT3& c, const XMFLOAT3& e)
+{
+	for (unsigned int p = 0; p < frustum.PlaneCount; p++)
+	{
+		const XMFLOAT4& n = frustum.Planes[p];
+		float dist = n.x * c.x + n.y * c.y + n.z * c.z + n.w;
+		float radius = fabsf(n.x) * e.x + fabsf(n.y) * e.y + fabsf(n.z) * e.z;
+		if (dist + radius < 0)
+			return false;
+	}
+	return true;
+}
+
+TEST(FrustumCullerPlanes)
+{
+	Frustum frustum = MakeFrustum();
+	CHECK(frustum.PlaneCount == 6);
+
+	struct Box { XMFLOAT3 Center; XMFLOAT3 Extents; bool Visible; };
+	const Box boxes[] =
+	{
+		{ XMFLOAT3(0, 0, 10), XMFLOAT3(1, 1, 1), true },			// Inside
+		{ XMFLOAT3(0, 0, -10), XMFLOAT3(1, 1, 1), false },			// Behind
+		{ XMFLOAT3(0, 0, 200), XMFLOAT3(1, 1, 1), false },			// Past the far plane
+		{ XMFLOAT3(-100, 0, 10), XMFLOAT3(1, 1, 1), false },		// Left
+		{ XMFLOAT3(0, 20, 10), XMFLOAT3(1, 1, 1), false },			// Above
+		{ XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1), true },				// Straddling the near plane
+		{ XMFLOAT3(-9, 0, 10), XMFLOAT3(1, 1, 1), true },			// Straddling the left plane
+		{ XMFLOAT3(-10, 0, 10), XMFLOAT3(0.5f, 0.5f, 0.5f), false },	// Just past it
+		{ XMFLOAT3(0, 0, 100), XMFLOAT3(1, 1, 1), true },			// Straddling the far plane
+	};
+	const unsigned int boxCount = sizeof(boxes) / sizeof(boxes[0]);
+
+	// Not a multiple of 4, and one item never given bounds
+	FrustumCuller culler;
+	for (unsigned int i = 0; i < boxCount; i++)
+		culler.SetWorldBounds(culler.Add(), boxes[i].Center, boxes[i].Extents);
+	unsigned int unset = culler.Add();
+
+	CullResult result;
+	culler.Cull(frustum, result);
+	bool matches = true;
+	for (unsigned int i = 0; i < boxCount; i++)
+		matches = matches && result.IsVisible(i) == boxes[i].Visible;
+	CHECK(matches);
+	CHECK(!result.IsVisible(unset));
+	CHECK(result.Flags.size() == boxCount + 1);
+
+	// The visible list is the visible items, in order
+	std::vector<unsigned int> expected;
+	for (unsigned int i = 0; i < boxCount; i++)
+		if (boxes[i].Visible) expected.push_back(i);
+	CHECK(result.Visible == expected);
+
+	// An extra clip plane keeps only what's above y = 0
+	frustum.AddPlane(XMFLOAT4(0, 1, 0, 0));
+	culler.SetWorldBounds(0, XMFLOAT3(0, -5, 10), XMFLOAT3(1, 1, 1));
+	culler.SetWorldBounds(5, XMFLOAT3(0, -0.5f, 10), XMFLOAT3(1, 1, 1));
+	culler.Cull(frustum, result);
+	CHECK(!result.IsVisible(0));
+	CHECK(result.IsVisible(5));
+}
+
+TEST(FrustumCullerMatchesScalar)
+{
+	Frustum frustum = MakeFrustum();
+	std::mt19937 random(4);
+	std::uniform_real_distribution<float> spread(-1, 1);
+
+	FrustumCuller culler;
+	std::vector<XMFLOAT3> centers, extents;
+	for (unsigned int i = 0; i < 4097; i++)
+	{
+		float x = spread(random) * 60;
+		float y = spread(random) * 30;
+		float z = spread(random) * 120;
+		float size = (spread(random) + 1) * 3;
+		centers.push_back(XMFLOAT3(x, y, z));
+		extents.push_back(XMFLOAT3(size, size * 0.5f, size));
+		culler.SetWorldBounds(culler.Add(), centers.back(), extents.back());
+	}
+
+	CullResult result;
+	culler.Cull(frustum, result);
+	bool matches = true;
+	unsigned int visible = 0;
+	for (unsigned int i = 0; i < centers.size(); i++)
+	{
+		bool inside = IsInside(frustum, centers[i], extents[i]);
+		matches = matches && result.IsVisible(i) == inside;
+		visible += inside ? 1 : 0;
+	}
+	CHECK(matches);
+	CHECK(result.Visible.size() == visible);
+	CHECK(visible > 0 && visible < centers.size());
+}
+
+TEST(FrustumCullerTransformBounds)
+{
+	// A unit box turned 45 degrees around y and moved
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixTranspose(XMMatrixRotationY(XM_PIDIV4) * XMMatrixTranslation(3, 4, 5)));
+
+	XMFLOAT3 center, extents;
+	FrustumCuller::TransformBounds(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1), world, center, extents);
+	CHECK(fabsf(center.x - 3) < 1e-5f && fabsf(center.y - 4) < 1e-5f && fabsf(center.z - 5) < 1e-5f);
+	CHECK(fabsf(extents.x - sqrtf(2)) < 1e-5f && fabsf(extents.y - 1) < 1e-5f && fabsf(extents.z - sqrtf(2)) < 1e-5f);
+
+	FrustumCuller culler;
+	unsigned int item = culler.Add();
+	CHECK(!culler.GetWorldBounds(item, center, extents));
+	culler.SetBounds(item, XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1), world);
+	CHECK(culler.GetWorldBounds(item, center, extents));
+	CHECK(fabsf(extents.x - sqrtf(2)) < 1e-5f);
+}
+
+// --------------------------------------------------------
+// Culls a field of random boxes around the camera, with the
+// SIMD culler and then one box at a time, and reports how
+// many objects each gets through per microsecond.
+// --------------------------------------------------------
+BENCHMARK(frustum, "[boxes = 100000] [passes = 200]")
+{
+	unsigned int boxCount = argc > 0 ? strtoul(argv[0], 0, 10) : 100000;
+	unsigned int passes = argc > 1 ? strtoul(argv[1], 0, 10) : 200;
+	if (boxCount == 0 || passes == 0)
+		return 1;
+
+	Frustum frustum = MakeFrustum();
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> spread(-1, 1);
+
+	FrustumCuller culler;
+	std::vector<XMFLOAT3> centers, extents;
+	for (unsigned int i = 0; i < boxCount; i++)
+	{
+		float x = spread(random) * 150;
+		float y = spread(random) * 20;
+		float z = spread(random) * 150;
+		centers.push_back(XMFLOAT3(x, y, z));
+		extents.push_back(XMFLOAT3(1, 1, 1));
+		culler.SetWorldBounds(culler.Add(), centers.back(), extents.back());
+	}
+
+	CullResult result;
+	double start = GetMilliseconds();
+	for (unsigned int p = 0; p < passes; p++)
+		culler.Cull(frustum, result);
+	double simdMilliseconds = (GetMilliseconds() - start) / passes;
+
+	std::vector<unsigned int> visible;
+	start = GetMilliseconds();
+	for (unsigned int p = 0; p < passes; p++)
+	{
+		visible.clear();
+		for (unsigned int i = 0; i < boxCount; i++)
+			if (IsInside(frustum, centers[i], extents[i]))
+				visible.push_back(i);
+	}
+	double scalarMilliseconds = (GetMilliseconds() - start) / passes;
+
+	printf("Boxes:                 %u (%u visible)\n", boxCount, (unsigned int)result.Visible.size());
+	printf("SIMD:                  %.3f ms per pass, %.0f objects per us\n", simdMilliseconds, boxCount / (simdMilliseconds * 1000));
+	printf("One at a time:         %.3f ms per pass, %.0f objects per us\n", scalarMilliseconds, boxCount / (scalarMilliseconds * 1000));
+	return visible.size() == result.Visible.size() ? 0 : 1;
+}
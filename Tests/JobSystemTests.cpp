@@ -0,0 +1,173 @@
+#include "Test.h"
+#include "../JobSystem.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+TEST(JobSystemInline)
+{
+	// No workers - everything runs on this thread, in order
+	JobSystem jobs(0);
+	CHECK(jobs.GetWorkerCount() == 0);
+
+	std::vector<int> order;
+	JobCounter counter;
+	for (int i = 0; i < 10; i++)
+		jobs.Run([&order, i]() { order.push_back(i); }, &counter);
+	CHECK(counter.IsDone());
+
+	jobs.RunAfter(&counter, [&order]() { order.push_back(10); });
+	jobs.ParallelFor(5, 2, [&order](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			order.push_back(11 + i);
+	});
+
+	bool inOrder = order.size() == 16;
+	for (size_t i = 0; inOrder && i < order.size(); i++)
+		inOrder = order[i] == (int)i;
+	CHECK(inOrder);
+}
+
+TEST(JobSystemParallelFor)
+{
+	JobSystem jobs(3);
+	const unsigned int count = 100000;
+	std::vector<std::atomic<int>> hits(count);
+
+	// Every index exactly once, however the batches are split
+	bool once = true;
+	for (unsigned int round = 0; round < 20; round++)
+	{
+		for (auto& h : hits) h = 0;
+		jobs.ParallelFor(count, 1 + round * 13, [&hits](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+				hits[i]++;
+		});
+
+		for (auto& h : hits)
+			once = once && h.load() == 1;
+	}
+	CHECK(once);
+
+	// Nested, so workers wait on work they started themselves
+	std::atomic<unsigned int> inner(0);
+	jobs.ParallelFor(64, 1, [&jobs, &inner](unsigned int, unsigned int)
+	{
+		jobs.ParallelFor(100, 10, [&inner](unsigned int begin, unsigned int end) { inner += end - begin; });
+	});
+	CHECK(inner.load() == 64 * 100);
+}
+
+// Each job splits in two until "depth" runs out, and waits
+// for its halves, so workers are always stealing from each other
+static void SpawnTree(JobSystem* jobs, unsigned int depth, std::atomic<unsigned int>* leaves)
+{
+	if (depth == 0)
+	{
+		(*leaves)++;
+		return;
+	}
+
+	JobCounter halves;
+	jobs->Run([=]() { SpawnTree(jobs, depth - 1, leaves); }, &halves);
+	jobs->Run([=]() { SpawnTree(jobs, depth - 1, leaves); }, &halves);
+	jobs->Wait(&halves);
+}
+
+TEST(JobSystemStealing)
+{
+	JobSystem jobs(3);
+
+	// Both jobs go on this thread's deque.  Waiting pops the newest
+	// one, which only finishes once another thread has stolen and
+	// run the oldest (or after a couple of seconds, and a failure).
+	std::atomic<bool> firstRan(false);
+	std::thread::id firstThread;
+	bool stolen = false;
+	JobCounter counter;
+	jobs.Run([&]() { firstThread = std::this_thread::get_id(); firstRan = true; }, &counter);
+	jobs.Run([&]()
+	{
+		double start = GetMilliseconds();
+		while (!firstRan.load() && GetMilliseconds() - start < 2000)
+			std::this_thread::yield();
+		stolen = firstRan.load();
+	}, &counter);
+	jobs.Wait(&counter);
+	CHECK(stolen);
+	CHECK(firstThread != std::this_thread::get_id());
+
+	std::atomic<unsigned int> leaves(0);
+	JobCounter tree;
+	jobs.Run([&]() { SpawnTree(&jobs, 12, &leaves); }, &tree);
+	jobs.Wait(&tree);
+	CHECK(leaves.load() == 1u << 12);
+
+	// Held back until everything it depends on is done
+	std::atomic<unsigned int> done(0);
+	unsigned int doneAtContinuation = 0;
+	JobCounter first;
+	JobCounter second;
+	for (int i = 0; i < 100; i++)
+		jobs.Run([&done]() { done++; }, &first);
+	jobs.RunAfter(&first, [&]() { doneAtContinuation = done.load(); }, &second);
+	jobs.Wait(&second);
+	CHECK(doneAtContinuation == 100);
+}
+
+// --------------------------------------------------------
+// Times starting and finishing empty jobs, then a parallel
+// loop of real math, for every worker count up to the given
+// one.  Speedup is against running the loop on one thread.
+// --------------------------------------------------------
+BENCHMARK(jobs, "[jobs = 100000] [max workers = hardware threads - 1]")
+{
+	unsigned int jobCount = argc > 0 ? strtoul(argv[0], 0, 10) : 100000;
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	unsigned int maxWorkers = argc > 1 ? strtoul(argv[1], 0, 10) : (hardwareThreads > 1 ? hardwareThreads - 1 : 0);
+	if (jobCount == 0)
+		return 1;
+
+	std::vector<float> data(1 << 22);
+	auto work = [&data](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			data[i] = sqrtf((float)i) * sinf((float)i);
+	};
+
+	double serialMilliseconds = 0;
+	for (unsigned int workers = 0; workers <= maxWorkers; workers++)
+	{
+		JobSystem jobs(workers);
+
+		// Spawn cost - empty jobs, so it's all scheduling
+		JobCounter counter;
+		double start = GetMilliseconds();
+		for (unsigned int i = 0; i < jobCount; i++)
+			jobs.Run([]() {}, &counter);
+		jobs.Wait(&counter);
+		double spawnNanoseconds = (GetMilliseconds() - start) * 1000000.0 / jobCount;
+
+		// Scaling - best of a few runs, batches of 4096
+		double loopMilliseconds = 0;
+		for (int run = 0; run < 5; run++)
+		{
+			start = GetMilliseconds();
+			jobs.ParallelFor((unsigned int)data.size(), 4096, work);
+			double elapsed = GetMilliseconds() - start;
+			if (run == 0 || elapsed < loopMilliseconds)
+				loopMilliseconds = elapsed;
+		}
+		if (workers == 0)
+			serialMilliseconds = loopMilliseconds;
+
+		printf("%2u workers:  %.0f ns per job, loop %.2f ms (%.2fx)\n",
+			workers, spawnNanoseconds, loopMilliseconds, serialMilliseconds / loopMilliseconds);
+	}
+	return 0;
+}
@@ -0,0 +1,219 @@
+#include "Test.h"
+#include "../Mesh.h"
+#include "../RenderBackend.h"
+
+#include <Windows.h>
+#include <psapi.h>
+#include <cstdio>
+#include <string>
+
+#pragma comment(lib, "psapi.lib")
+
+static std::string GetTempFile(const char* name)
+{
+	char folder[MAX_PATH] = {};
+	GetTempPathA(MAX_PATH, folder);
+	return std::string(folder) + name;
+}
+
+// --------------------------------------------------------
+// Writes a flat grid of quads, "columns" by "rows" points,
+// then "extraPoints" positions no face uses (the stray points
+// of a scan).  Every face shares one uv and one normal, which
+// keeps lines well under the importer's 100 characters.
+// Returns the size of the file, or 0 if it couldn't be written.
+// --------------------------------------------------------
+static unsigned long long WriteGridObj(const std::string& file, unsigned int columns, unsigned int rows, unsigned long long extraPoints)
+{
+	FILE* obj = 0;
+	if (fopen_s(&obj, file.c_str(), "w") != 0 || !obj)
+		return 0;
+	setvbuf(obj, 0, _IOFBF, 1 << 20);
+
+	for (unsigned int y = 0; y < rows; y++)
+		for (unsigned int x = 0; x < columns; x++)
+			fprintf(obj, "v %u.5 0.25 %u.5\n", x, y);
+	fprintf(obj, "vt 0.5 0.5\nvn 0 1 0\n");
+
+	for (unsigned int y = 0; y + 1 < rows; y++)
+	{
+		for (unsigned int x = 0; x + 1 < columns; x++)
+		{
+			unsigned int i = y * columns + x + 1;	// OBJ counts from 1
+			fprintf(obj, "f %u/1/1 %u/1/1 %u/1/1 %u/1/1\n", i, i + columns, i + columns + 1, i + 1);
+		}
+	}
+
+	for (unsigned long long p = 0; p < extraPoints; p++)
+		fprintf(obj, "v %llu.125 -3.5 %llu.875\n", p % 65536, p / 65536);
+
+	long long size = _ftelli64(obj);
+	bool written = ferror(obj) == 0;
+	fclose(obj);
+	return written && size > 0 ? (unsigned long long)size : 0;
+}
+
+TEST(MeshBufferSizes)
+{
+	size_t vertexBytes = 0;
+	size_t indexBytes = 0;
+	CHECK(Mesh::GetBufferSizes(6, vertexBytes, indexBytes));
+	CHECK(vertexBytes == 6 * sizeof(Vertex));
+	CHECK(indexBytes == 6 * sizeof(unsigned int));
+
+	// 2 GB is as big as a D3D11 buffer gets
+	const size_t maxBytes = (size_t)2048 * 1024 * 1024;
+	size_t mostVertices = maxBytes / sizeof(Vertex);
+	CHECK(Mesh::GetBufferSizes(mostVertices, vertexBytes, indexBytes));
+	CHECK(vertexBytes <= maxBytes);
+	CHECK(!Mesh::GetBufferSizes(mostVertices + 1, vertexBytes, indexBytes));
+
+	// About 97M vertices is where 32-bit byte widths would wrap
+	CHECK(!Mesh::GetBufferSizes(100000000, vertexBytes, indexBytes));
+	CHECK(!Mesh::GetBufferSizes((size_t)-1, vertexBytes, indexBytes));
+}
+
+TEST(MeshStreamingImport)
+{
+	ID3D11Device* device = 0;
+	ID3D11DeviceContext* context = 0;
+	CHECK(CreateTestDevice(&device, &context));
+	if (!device)
+		return;
+
+	// Counts the uploads without sending them anywhere
+	RecordingRenderBackend* recorder = new RecordingRenderBackend();
+	RenderBackend::Set(context, recorder);
+
+	std::string file = GetTempFile("MeshStreamingImport.obj");
+	CHECK(WriteGridObj(file, 33, 17, 100) > 0);
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	CHECK(Mesh::LoadObj(file.c_str(), verts, indices));
+	CHECK(verts.size() == 32 * 16 * 6);
+
+	// Small enough that the import takes many blocks
+	const size_t ceiling = 16 * 1024;
+	Mesh* mesh = new Mesh(file.c_str(), device, context, ceiling);
+	CHECK(mesh->GetIndexCount() == (int)verts.size());
+	CHECK(mesh->GetImportPeakBytes() > 0);
+	CHECK(mesh->GetImportPeakBytes() <= ceiling);
+	CHECK(recorder->GetStats().BytesUploaded == verts.size() * (sizeof(Vertex) + sizeof(unsigned int)));
+	delete mesh;
+
+	// Too small to hold even the attributes - nothing is made
+	mesh = new Mesh(file.c_str(), device, context, 1024);
+	CHECK(mesh->GetIndexCount() == 0);
+	CHECK(mesh->GetVertexBuffer() == 0);
+	delete mesh;
+
+	DeleteFileA(file.c_str());
+	RenderBackend::Release(context);
+	context->Release();
+	device->Release();
+}
+
+TEST(MeshStreamingFaceCount)
+{
+	ID3D11Device* device = 0;
+	ID3D11DeviceContext* context = 0;
+	CHECK(CreateTestDevice(&device, &context));
+	if (!device)
+		return;
+	RenderBackend::Set(context, new RecordingRenderBackend());
+
+	// Windows line endings and trailing spaces on the triangles,
+	// which mustn't be counted as a 4th group
+	std::string file = GetTempFile("MeshStreamingFaceCount.obj");
+	FILE* obj = 0;
+	CHECK(fopen_s(&obj, file.c_str(), "wb") == 0 && obj);
+	if (!obj)
+		return;
+	fprintf(obj, "v 0 0 0\r\nv 1 0 0\r\nv 1 0 1\r\nv 0 0 1\r\nvt 0 0\r\nvn 0 1 0\r\n");
+	for (int i = 0; i < 10; i++)
+		fprintf(obj, "f 1/1/1 2/1/1 3/1/1 \r\n");
+	fprintf(obj, "f 1/1/1\t2/1/1 3/1/1  4/1/1 \r\n");
+	fclose(obj);
+
+	Mesh* mesh = new Mesh(file.c_str(), device, context, 16 * 1024);
+	CHECK(mesh->GetIndexCount() == 10 * 3 + 6);
+	D3D11_BUFFER_DESC desc = {};
+	if (mesh->GetVertexBuffer())
+		mesh->GetVertexBuffer()->GetDesc(&desc);
+	CHECK(desc.ByteWidth == (10 * 3 + 6) * sizeof(Vertex));
+	delete mesh;
+
+	DeleteFileA(file.c_str());
+	RenderBackend::Release(context);
+	context->Release();
+	device->Release();
+}
+
+// --------------------------------------------------------
+// Streams a generated OBJ of the given size and reports the
+// importer's peak memory.  The grid is capped at what one
+// D3D11 buffer holds, and the rest of the file is unused
+// points, which the importer still has to keep.
+// --------------------------------------------------------
+BENCHMARK(mesh_peak, "[file megabytes = 2048] [ceiling megabytes = 1024]")
+{
+	unsigned long long fileBytes = (argc > 0 ? _strtoui64(argv[0], 0, 10) : 2048) * 1024 * 1024;
+	size_t ceiling = (size_t)(argc > 1 ? strtoul(argv[1], 0, 10) : 1024) * 1024 * 1024;
+
+	ID3D11Device* device = 0;
+	ID3D11DeviceContext* context = 0;
+	if (!CreateTestDevice(&device, &context))
+		return 1;
+
+	// The buffers are made but never written, so they stay out
+	// of the working set
+	RecordingRenderBackend* recorder = new RecordingRenderBackend();
+	RenderBackend::Set(context, recorder);
+
+	// Roughly 80 bytes of file per quad (its point and its face)
+	const unsigned int columns = 4096;
+	size_t maxQuads = (size_t)2048 * 1024 * 1024 / (6 * sizeof(Vertex)) - columns;
+	unsigned long long quads = fileBytes / 80;
+	if (quads > maxQuads)
+		quads = maxQuads;
+	unsigned int rows = (unsigned int)(quads / (columns - 1)) + 1;
+	if (rows < 2)
+		rows = 2;
+
+	unsigned long long gridBytes = (unsigned long long)columns * rows * 80;
+	unsigned long long extraPoints = fileBytes > gridBytes ? (fileBytes - gridBytes) / 24 : 0;
+
+	std::string file = GetTempFile("mesh_peak.obj");
+	printf("Writing %s...\n", file.c_str());
+	unsigned long long written = WriteGridObj(file, columns, rows, extraPoints);
+	if (written == 0)
+		return 1;
+
+	PROCESS_MEMORY_COUNTERS before = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &before, sizeof(before));
+
+	double start = GetMilliseconds();
+	Mesh* mesh = new Mesh(file.c_str(), device, context, ceiling);
+	double milliseconds = GetMilliseconds() - start;
+
+	PROCESS_MEMORY_COUNTERS after = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &after, sizeof(after));
+
+	const double megabyte = 1024.0 * 1024.0;
+	printf("File:                  %.0f MB, %u x %u grid, %llu unused points\n", written / megabyte, columns, rows, extraPoints);
+	printf("Ceiling:               %.0f MB\n", ceiling / megabyte);
+	printf("Vertices:              %d\n", mesh->GetIndexCount());
+	printf("Import time:           %.0f ms\n", milliseconds);
+	printf("Importer peak:         %.1f MB\n", mesh->GetImportPeakBytes() / megabyte);
+	printf("Peak working set:      %.1f MB (%.1f MB before the import)\n", after.PeakWorkingSetSize / megabyte, before.PeakWorkingSetSize / megabyte);
+	printf("Uploaded:              %.1f MB\n", recorder->GetStats().BytesUploaded / megabyte);
+	int result = mesh->GetIndexCount() > 0 ? 0 : 1;
+
+	delete mesh;
+	DeleteFileA(file.c_str());
+	RenderBackend::Release(context);
+	context->Release();
+	device->Release();
+	return result;
+}
@@ -0,0 +1,177 @@
+#include "Test.h"
+#include "../OcclusionCuller.h"
+#include "../JobSystem.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace DirectX;
+
+// The culler takes row-major, transposed matrices like the shaders
+static XMFLOAT4X4 Store(FXMMATRIX m)
+{
+	XMFLOAT4X4 stored;
+	XMStoreFloat4x4(&stored, XMMatrixTranspose(m));
+	return stored;
+}
+
+// Camera at the origin looking down +Z
+static void BeginFrame(OcclusionCuller& culler)
+{
+	culler.Begin(
+		Store(XMMatrixIdentity()),
+		Store(XMMatrixPerspectiveFovLH(0.25f * XM_PI, 2.0f, 0.1f, 100.0f)));
+}
+
+// Each way a unit cube can face the camera
+static const XMMATRIX* GetCubeTurns(unsigned int& count)
+{
+	static const XMMATRIX turns[] =
+	{
+		XMMatrixIdentity(),
+		XMMatrixRotationY(XM_PI),
+		XMMatrixRotationY(XM_PIDIV2),
+		XMMatrixRotationY(-XM_PIDIV2),
+		XMMatrixRotationX(XM_PIDIV2),
+		XMMatrixRotationX(-XM_PIDIV2),
+	};
+	count = sizeof(turns) / sizeof(turns[0]);
+	return turns;
+}
+
+TEST(OcclusionFaceHidesBox)
+{
+	JobSystem jobs;
+	OcclusionCuller culler(&jobs);
+
+	// Whichever face is toward the camera, the back faces are
+	// dropped and the front one hides what is behind it
+	unsigned int turnCount;
+	const XMMATRIX* turns = GetCubeTurns(turnCount);
+	for (unsigned int i = 0; i < turnCount; i++)
+	{
+		BeginFrame(culler);
+		culler.AddOccluderBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1), Store(turns[i] * XMMatrixTranslation(0, 0, 5)));
+		culler.Rasterize();
+
+		CHECK(culler.GetStats().Triangles == 2);
+		CHECK(!culler.IsVisible(XMFLOAT3(0, 0, 5), XMFLOAT3(0.3f, 0.3f, 0.3f)));
+		CHECK(!culler.IsVisible(XMFLOAT3(0, 0, 20), XMFLOAT3(1, 1, 1)));
+		CHECK(culler.IsVisible(XMFLOAT3(0, 0, 3.5f), XMFLOAT3(0.3f, 0.3f, 0.3f)));
+		CHECK(culler.IsVisible(XMFLOAT3(3, 0, 20), XMFLOAT3(1, 1, 1)));
+	}
+}
+
+TEST(OcclusionEdgePeekVisible)
+{
+	JobSystem jobs;
+	OcclusionCuller culler(&jobs);
+
+	// A box mostly behind the cube but sticking out past its edge
+	unsigned int turnCount;
+	const XMMATRIX* turns = GetCubeTurns(turnCount);
+	for (unsigned int i = 0; i < turnCount; i++)
+	{
+		BeginFrame(culler);
+		culler.AddOccluderBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1), Store(turns[i] * XMMatrixTranslation(0, 0, 5)));
+		culler.Rasterize();
+
+		CHECK(culler.IsVisible(XMFLOAT3(1.2f, 0, 6), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		CHECK(culler.IsVisible(XMFLOAT3(0, -1.2f, 6), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+	}
+}
+
+TEST(OcclusionNearPlaneWall)
+{
+	JobSystem jobs;
+	OcclusionCuller culler(&jobs);
+
+	// A long wall turned so it crosses the near plane still hides
+	// what is behind it once clipped, and a box crossing the near
+	// plane is always visible
+	BeginFrame(culler);
+	culler.AddOccluderBox(XMFLOAT3(0, 0, 0), XMFLOAT3(20, 5, 0.1f), Store(XMMatrixRotationY(1.2f) * XMMatrixTranslation(0, 0, 3)));
+	culler.Rasterize();
+
+	CHECK(culler.GetStats().Triangles > 0);
+	CHECK(!culler.IsVisible(XMFLOAT3(0, 0, 10), XMFLOAT3(1, 1, 1)));
+	CHECK(culler.IsVisible(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)));
+}
+
+TEST(OcclusionNoOccluders)
+{
+	JobSystem jobs;
+	OcclusionCuller culler(&jobs);
+
+	BeginFrame(culler);
+	culler.Rasterize();
+
+	CHECK(culler.GetStats().Triangles == 0);
+	CHECK(culler.IsVisible(XMFLOAT3(0, 0, 50), XMFLOAT3(0.1f, 0.1f, 0.1f)));
+}
+
+// --------------------------------------------------------
+// A row of walls in front of a field of boxes, a bit like
+// the bath seen from inside.  Reports the fraction of boxes
+// rejected and what the rasterizing and testing cost.
+// --------------------------------------------------------
+BENCHMARK(occlusion, "[frames = 200] [boxes = 20000]")
+{
+	unsigned int frames = argc > 0 ? strtoul(argv[0], 0, 10) : 200;
+	unsigned int boxCount = argc > 1 ? strtoul(argv[1], 0, 10) : 20000;
+	if (frames == 0)
+		return 1;
+
+	JobSystem jobs;
+	OcclusionCuller culler(&jobs);
+
+	// Fixed seed, so every run sees the same scene
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> spread(-1, 1);
+
+	std::vector<XMFLOAT4X4> walls;
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		// One random number per statement, as argument order isn't defined
+		float yaw = spread(random) * 0.5f;
+		float x = spread(random) * 12;
+		float y = spread(random) * 2;
+		float z = 8 + (spread(random) + 1) * 6;
+		walls.push_back(Store(XMMatrixScaling(3, 2, 0.2f) * XMMatrixRotationY(yaw) * XMMatrixTranslation(x, y, z)));
+	}
+
+	std::vector<XMFLOAT3> boxCenters;
+	for (unsigned int i = 0; i < boxCount; i++)
+	{
+		float x = spread(random) * 40;
+		float y = spread(random) * 10;
+		float z = 25 + (spread(random) + 1) * 35;
+		boxCenters.push_back(XMFLOAT3(x, y, z));
+	}
+	const XMFLOAT3 boxExtents(0.5f, 0.5f, 0.5f);
+
+	double rasterMilliseconds = 0;
+	double testMilliseconds = 0;
+	for (unsigned int f = 0; f < frames; f++)
+	{
+		BeginFrame(culler);
+		for (auto& wall : walls)
+			culler.AddOccluderBox(XMFLOAT3(0, 0, 0), XMFLOAT3(0.5f, 0.5f, 0.5f), wall);
+		culler.Rasterize();
+
+		double start = GetMilliseconds();
+		for (auto& center : boxCenters)
+			culler.IsVisible(center, boxExtents);
+		testMilliseconds += GetMilliseconds() - start;
+		rasterMilliseconds += culler.GetStats().RasterMilliseconds;
+	}
+
+	const OcclusionStats& stats = culler.GetStats();
+	printf("Workers:               %u\n", jobs.GetWorkerCount());
+	printf("Occluders:             %u (%u triangles)\n", stats.Occluders, stats.Triangles);
+	printf("Raster:                %.3f ms per frame\n", rasterMilliseconds / frames);
+	printf("Tests:                 %u boxes in %.3f ms per frame\n", stats.Tested, testMilliseconds / frames);
+	printf("Rejected:              %.1f%%\n", stats.Tested ? 100.0 * stats.Rejected / stats.Tested : 0.0);
+	return 0;
+}
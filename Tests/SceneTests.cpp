@@ -0,0 +1,227 @@
+#include "Test.h"
+#include "../Scene.h"
+#include "../TransformStore.h"
+
+#include <Windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+static std::string GetTempFile(const char* name)
+{
+	char folder[MAX_PATH] = {};
+	GetTempPathA(MAX_PATH, folder);
+	return std::string(folder) + name;
+}
+
+static bool ReadBytes(const std::string& file, std::vector<unsigned char>& bytes)
+{
+	FILE* in = 0;
+	if (fopen_s(&in, file.c_str(), "rb") != 0 || !in)
+		return false;
+	fseek(in, 0, SEEK_END);
+	bytes.resize(ftell(in));
+	fseek(in, 0, SEEK_SET);
+	bool read = fread(bytes.data(), 1, bytes.size(), in) == bytes.size();
+	fclose(in);
+	return read;
+}
+
+static bool WriteBytes(const std::string& file, const std::vector<unsigned char>& bytes)
+{
+	FILE* out = 0;
+	if (fopen_s(&out, file.c_str(), "wb") != 0 || !out)
+		return false;
+	bool written = fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+	fclose(out);
+	return written;
+}
+
+// --------------------------------------------------------
+// Writes a text scene of "entityCount" entities over a few
+// meshes and textures.  Every fourth entity is a child of the
+// one before it, and the first is the water.
+// Returns false if the file couldn't be written.
+// --------------------------------------------------------
+static bool WriteTextScene(const std::string& file, unsigned int entityCount)
+{
+	FILE* text = 0;
+	if (fopen_s(&text, file.c_str(), "w") != 0 || !text)
+		return false;
+	setvbuf(text, 0, _IOFBF, 1 << 20);
+
+	fprintf(text, "# Generated by the scene tests\n");
+	fprintf(text, "mesh cube Assets/Models/cube.obj\nmesh sphere Assets/Models/sphere.obj\n");
+	fprintf(text, "texture rock Assets/Textures/rock.png\ntexture rockNormals Assets/Textures/rockNormals.png\n");
+	fprintf(text, "sky cube rock\n");
+	for (unsigned int e = 0; e < entityCount; e++)
+	{
+		char parent[16] = "-";
+		if (e % 4 == 3)
+			sprintf_s(parent, "e%u", e - 1);
+		fprintf(text, "entity e%u %s rock %s %s %u 0.5 %u   0 %u 0   1 1 1\n",
+			e, e % 2 ? "sphere" : "cube", e % 3 ? "rockNormals" : "-", parent, e % 1000, e / 1000, e % 360);
+	}
+	if (entityCount > 0)
+		fprintf(text, "water e0 rockNormals -2.5 40\n");
+
+	fclose(text);
+	return true;
+}
+
+TEST(SceneRoundTrip)
+{
+	std::string text = GetTempFile("SceneRoundTrip.scene");
+	std::string binary = GetTempFile("SceneRoundTrip.scenebin");
+	CHECK(WriteTextScene(text, 10));
+	CHECK(Scene::Compile(text.c_str(), binary.c_str()));
+
+	Scene scene;
+	CHECK(scene.Load(binary.c_str()));
+	CHECK(scene.GetEntityCount() == 10);
+	CHECK(scene.GetMeshCount() == 2 && scene.GetTextureCount() == 2);
+	CHECK(strcmp(scene.GetMeshPath(1), "Assets/Models/sphere.obj") == 0);
+	CHECK(strcmp(scene.GetEntityName(7), "e7") == 0);
+	CHECK(scene.FindEntity("e9") == 9);
+	CHECK(scene.FindEntity("nobody") == SceneNone);
+	CHECK(scene.GetEntityMesh(3) == 1 && scene.GetEntityTexture(3) == 0);
+	CHECK(scene.GetEntityNormalMap(3) == SceneNone && scene.GetEntityNormalMap(4) == 1);
+	CHECK(scene.GetSkyMesh() == 0 && scene.GetSkyTexture() == 0);
+	CHECK(scene.GetWaterEntity() == 0 && scene.GetWaterNormalMap() == 1);
+	CHECK(scene.GetWaterHeight() == -2.5f && scene.GetWaterRadius() == 40);
+
+	// Transforms come out parented as written
+	TransformStore transforms;
+	transforms.Create();
+	unsigned int first = scene.CreateTransforms(&transforms);
+	CHECK(first == 1);
+	CHECK(transforms.GetParent(first + 3) == first + 2);
+	CHECK(transforms.GetParent(first + 2) == TransformStore::NoTransform);
+	XMFLOAT3 p = transforms.GetPosition(first + 5);
+	CHECK(p.x == 5 && p.y == 0.5f && p.z == 0);
+
+	scene.Unload();
+	DeleteFileA(text.c_str());
+	DeleteFileA(binary.c_str());
+}
+
+TEST(SceneRejectsBadFiles)
+{
+	std::string text = GetTempFile("SceneRejectsBadFiles.scene");
+	std::string binary = GetTempFile("SceneRejectsBadFiles.scenebin");
+	CHECK(WriteTextScene(text, 64));
+	CHECK(Scene::Compile(text.c_str(), binary.c_str()));
+
+	std::vector<unsigned char> good;
+	CHECK(ReadBytes(binary, good));
+	if (good.size() < sizeof(SceneHeader))
+		return;
+
+	Scene scene;
+	CHECK(scene.Load(binary.c_str()));
+	scene.Unload();
+
+	// Every section starts 16-byte aligned
+	SceneHeader header;
+	memcpy(&header, good.data(), sizeof(header));
+	const unsigned int offsets[] = { header.MeshPaths, header.TexturePaths, header.Names, header.Positions, header.Rotations,
+		header.Scales, header.Parents, header.Meshes, header.Textures, header.NormalMaps, header.Strings };
+	bool aligned = true;
+	for (unsigned int offset : offsets)
+		aligned = aligned && offset % 16 == 0;
+	CHECK(aligned);
+
+	// Still inside the file, but only 4-byte aligned
+	std::vector<unsigned char> bad = good;
+	((SceneHeader*)bad.data())->Positions += 4;
+	CHECK(WriteBytes(binary, bad));
+	CHECK(!scene.Load(binary.c_str()));
+
+	// A parent that comes after its child
+	bad = good;
+	((unsigned int*)(bad.data() + header.Parents))[3] = 10;
+	CHECK(WriteBytes(binary, bad));
+	CHECK(!scene.Load(binary.c_str()));
+
+	// Cut short
+	bad = good;
+	bad.resize(bad.size() - 16);
+	CHECK(WriteBytes(binary, bad));
+	CHECK(!scene.Load(binary.c_str()));
+
+	// And a reference to a missing name doesn't compile
+	FILE* broken = 0;
+	CHECK(fopen_s(&broken, text.c_str(), "w") == 0 && broken);
+	if (broken)
+	{
+		fprintf(broken, "entity a missing - - - 0 0 0 0 0 0 1 1 1\n");
+		fclose(broken);
+	}
+	CHECK(!Scene::Compile(text.c_str(), binary.c_str()));
+
+	DeleteFileA(text.c_str());
+	DeleteFileA(binary.c_str());
+}
+
+// --------------------------------------------------------
+// Compiles a generated text scene of 100k entities, then
+// times loading the binary and building its transforms, the
+// way Game does at startup.
+// --------------------------------------------------------
+BENCHMARK(scene, "[entities = 100000] [loads = 20]")
+{
+	unsigned int entityCount = argc > 0 ? strtoul(argv[0], 0, 10) : 100000;
+	unsigned int loads = argc > 1 ? strtoul(argv[1], 0, 10) : 20;
+	if (loads == 0)
+		return 1;
+
+	std::string text = GetTempFile("SceneBenchmark.scene");
+	std::string binary = GetTempFile("SceneBenchmark.scenebin");
+	if (!WriteTextScene(text, entityCount))
+		return 1;
+
+	double start = GetMilliseconds();
+	bool compiled = Scene::Compile(text.c_str(), binary.c_str());
+	double compileMilliseconds = GetMilliseconds() - start;
+	if (!compiled)
+		return 1;
+
+	std::vector<unsigned char> bytes;
+	ReadBytes(binary, bytes);
+
+	// Load maps and validates; the transforms are the only copy
+	Scene scene;
+	double loadMilliseconds = 0;
+	double transformMilliseconds = 0;
+	bool loaded = true;
+	for (unsigned int l = 0; l < loads && loaded; l++)
+	{
+		start = GetMilliseconds();
+		loaded = scene.Load(binary.c_str());
+		loadMilliseconds += GetMilliseconds() - start;
+		if (!loaded)
+			break;
+
+		TransformStore transforms;
+		start = GetMilliseconds();
+		scene.CreateTransforms(&transforms);
+		transforms.UpdateWorldMatrices();
+		transformMilliseconds += GetMilliseconds() - start;
+		scene.Unload();
+	}
+
+	DeleteFileA(text.c_str());
+	DeleteFileA(binary.c_str());
+	if (!loaded)
+		return 1;
+
+	printf("Entities:              %u (%.1f MB compiled)\n", entityCount, bytes.size() / (1024.0 * 1024.0));
+	printf("Compile:               %.1f ms\n", compileMilliseconds);
+	printf("Load:                  %.3f ms\n", loadMilliseconds / loads);
+	printf("Transforms:            %.3f ms, with world matrices\n", transformMilliseconds / loads);
+	return 0;
+}
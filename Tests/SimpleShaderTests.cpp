@@ -0,0 +1,191 @@
+#include "Test.h"
+#include "../SimpleShader.h"
+#include "../RenderBackend.h"
+#include "../StateCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace DirectX;
+
+// Two buffers, laid out like the game's: a matrix and a float3
+// that change per object, and per-frame values the setters
+// never touch
+static const char SetterShaderSource[] =
+	"cbuffer perObject : register(b0) { matrix world; float3 tint; };\n"
+	"cbuffer perFrame : register(b1) { matrix view; matrix projection; float3 lightPosition; };\n"
+	"float4 main(float3 position : POSITION) : SV_POSITION\n"
+	"{\n"
+	"	float4 p = mul(mul(mul(float4(position, 1), world), view), projection);\n"
+	"	return p + float4(tint + lightPosition, 0);\n"
+	"}\n";
+
+// Compiled here rather than loaded, so the tests don't depend
+// on the game's shaders or where they were built to
+static SimpleVertexShader* CreateSetterShader(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	ID3DBlob* blob = 0;
+	ID3DBlob* errors = 0;
+	HRESULT hr = D3DCompile(SetterShaderSource, sizeof(SetterShaderSource) - 1, "SetterShader", 0, 0, "main", "vs_5_0", 0, 0, &blob, &errors);
+	if (errors)
+	{
+		printf("%s", (const char*)errors->GetBufferPointer());
+		errors->Release();
+	}
+	if (FAILED(hr))
+		return 0;
+
+	SimpleVertexShader* shader = new SimpleVertexShader(device, context);
+	bool loaded = shader->LoadShaderBlob(blob);
+	blob->Release();
+	if (!loaded)
+	{
+		delete shader;
+		return 0;
+	}
+	return shader;
+}
+
+static void ReleaseTestDevice(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	StateCache::Release(context);
+	RenderBackend::Release(context);
+	context->Release();
+	device->Release();
+}
+
+// The bytes a variable holds in the shader's local copy of its buffer
+static const void* GetLocalData(SimpleVertexShader* shader, const char* name)
+{
+	const SimpleShaderVariable* var = shader->GetVariableInfo(name);
+	const SimpleConstantBuffer* cb = var ? shader->GetBufferInfo(var->ConstantBufferIndex) : 0;
+	return cb ? cb->LocalDataBuffer + var->ByteOffset : 0;
+}
+
+TEST(SimpleShaderSetters)
+{
+	ID3D11Device* device = 0;
+	ID3D11DeviceContext* context = 0;
+	CHECK(CreateTestDevice(&device, &context));
+	if (!device)
+		return;
+
+	SimpleVertexShader* shader = CreateSetterShader(device, context);
+	CHECK(shader != 0);
+	if (!shader)
+	{
+		ReleaseTestDevice(device, context);
+		return;
+	}
+
+	// Handles and keys find the same variable the name does
+	SimpleShaderHandle world = shader->GetVariableHandle("world");
+	SimpleShaderHandle tint = shader->GetVariableHandle(SHADER_KEY("tint"));
+	const SimpleShaderVariable* worldInfo = shader->GetVariableInfo("world");
+	CHECK(world.IsValid() && tint.IsValid() && worldInfo);
+	CHECK(worldInfo && world.ByteOffset == worldInfo->ByteOffset && world.ConstantBufferIndex == worldInfo->ConstantBufferIndex);
+	CHECK(world.Size == sizeof(XMFLOAT4X4) && tint.Size == sizeof(XMFLOAT3));
+
+	// Each way of setting writes the same bytes
+	XMFLOAT4X4 byName, byKey, byHandle;
+	XMStoreFloat4x4(&byName, XMMatrixTranslation(1, 2, 3));
+	XMStoreFloat4x4(&byKey, XMMatrixScaling(4, 5, 6));
+	XMStoreFloat4x4(&byHandle, XMMatrixRotationY(0.5f));
+	CHECK(shader->SetMatrix4x4("world", byName));
+	CHECK(memcmp(GetLocalData(shader, "world"), &byName, sizeof(byName)) == 0);
+	CHECK(shader->SetMatrix4x4(SHADER_KEY("world"), byKey));
+	CHECK(memcmp(GetLocalData(shader, "world"), &byKey, sizeof(byKey)) == 0);
+	CHECK(shader->SetMatrix4x4(world, byHandle));
+	CHECK(memcmp(GetLocalData(shader, "world"), &byHandle, sizeof(byHandle)) == 0);
+
+	XMFLOAT3 color(0.25f, 0.5f, 0.75f);
+	CHECK(shader->SetFloat3(tint, color));
+	CHECK(memcmp(GetLocalData(shader, "tint"), &color, sizeof(color)) == 0);
+
+	// Missing variables and the wrong size are refused
+	SimpleShaderHandle missing = shader->GetVariableHandle("missing");
+	CHECK(!missing.IsValid());
+	CHECK(!shader->SetFloat3(missing, color));
+	CHECK(!shader->SetFloat3(SHADER_KEY("missing"), color));
+	CHECK(!shader->SetFloat3(world, color));
+	CHECK(memcmp(GetLocalData(shader, "world"), &byHandle, sizeof(byHandle)) == 0);
+
+	delete shader;
+	ReleaseTestDevice(device, context);
+}
+
+// --------------------------------------------------------
+// Sets a matrix and a float3 per "object" the three ways the
+// shader allows - by name, by SHADER_KEY and by handle - and
+// reports the cost of each set.  Buffers are never uploaded,
+// so this is only the lookup and the copy.
+// --------------------------------------------------------
+BENCHMARK(setters, "[objects = 1000000]")
+{
+	unsigned int objects = argc > 0 ? strtoul(argv[0], 0, 10) : 1000000;
+	if (objects == 0)
+		return 1;
+
+	ID3D11Device* device = 0;
+	ID3D11DeviceContext* context = 0;
+	if (!CreateTestDevice(&device, &context))
+		return 1;
+
+	SimpleVertexShader* shader = CreateSetterShader(device, context);
+	if (!shader)
+	{
+		ReleaseTestDevice(device, context);
+		return 1;
+	}
+
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	XMFLOAT3 tint(1, 1, 1);
+
+	// Every set has to work, which also keeps them from being
+	// optimized away
+	unsigned int failed = 0;
+
+	double start = GetMilliseconds();
+	for (unsigned int i = 0; i < objects; i++)
+	{
+		world._14 = (float)i;
+		failed += shader->SetMatrix4x4("world", world) ? 0 : 1;
+		failed += shader->SetFloat3("tint", tint) ? 0 : 1;
+	}
+	double nameMilliseconds = GetMilliseconds() - start;
+
+	start = GetMilliseconds();
+	for (unsigned int i = 0; i < objects; i++)
+	{
+		world._14 = (float)i;
+		failed += shader->SetMatrix4x4(SHADER_KEY("world"), world) ? 0 : 1;
+		failed += shader->SetFloat3(SHADER_KEY("tint"), tint) ? 0 : 1;
+	}
+	double keyMilliseconds = GetMilliseconds() - start;
+
+	SimpleShaderHandle worldHandle = shader->GetVariableHandle("world");
+	SimpleShaderHandle tintHandle = shader->GetVariableHandle("tint");
+	start = GetMilliseconds();
+	for (unsigned int i = 0; i < objects; i++)
+	{
+		world._14 = (float)i;
+		failed += shader->SetMatrix4x4(worldHandle, world) ? 0 : 1;
+		failed += shader->SetFloat3(tintHandle, tint) ? 0 : 1;
+	}
+	double handleMilliseconds = GetMilliseconds() - start;
+
+	delete shader;
+	ReleaseTestDevice(device, context);
+	if (failed > 0)
+		return 1;
+
+	// Two sets per object
+	double sets = objects * 2.0;
+	printf("Objects:               %u\n", objects);
+	printf("By name:               %.1f ns per set\n", nameMilliseconds * 1000000 / sets);
+	printf("By SHADER_KEY:         %.1f ns per set (%.1fx)\n", keyMilliseconds * 1000000 / sets, nameMilliseconds / keyMilliseconds);
+	printf("By handle:             %.1f ns per set (%.1fx)\n", handleMilliseconds * 1000000 / sets, nameMilliseconds / handleMilliseconds);
+	return 0;
+}
@@ -0,0 +1,257 @@
+#include "Test.h"
+#include "../StateCache.h"
+#include "../RenderBackend.h"
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// The cache talks to a RecordingRenderBackend, so what got
+// through is read back from the recorded commands.  Nothing
+// is ever dereferenced, so made-up pointers stand in for the
+// D3D objects.
+// --------------------------------------------------------
+template<typename T> static T* Fake(size_t id)
+{
+	return (T*)(id * 16);
+}
+
+static const RenderCommand* GetLast(const RecordingRenderBackend& recorder)
+{
+	const RenderCommand* last = 0;
+	for (const RenderCommand* c = recorder.GetFirst(); c != recorder.GetEnd(); c = c->GetNext())
+		last = c;
+	return last;
+}
+
+// Pointers are recorded as two words, low half first
+static const void* ReadPointer(const unsigned int* words)
+{
+	return (const void*)(size_t)(words[0] | ((unsigned long long)words[1] << 32));
+}
+
+// Checks the last command was a stage range bind of exactly
+// these slots: [stage, slot, count, pointers...]
+static bool WasRangeBind(const RecordingRenderBackend& recorder, RenderCommandType type, ShaderStage stage, unsigned int slot, unsigned int count, const void* const* items)
+{
+	const RenderCommand* last = GetLast(recorder);
+	if (!last || last->Type != type || last->Words != 3 + count * 2)
+		return false;
+
+	const unsigned int* args = last->GetArgs();
+	if (args[0] != (unsigned int)stage || args[1] != slot || args[2] != count)
+		return false;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (ReadPointer(args + 3 + i * 2) != items[i])
+			return false;
+	}
+	return true;
+}
+
+TEST(StateCacheFiltersEachKind)
+{
+	RecordingRenderBackend recorder;
+	StateCache cache(&recorder);
+
+	// Each kind of bind goes through once, then is filtered
+	// until it changes.  "commands" is what should be recorded.
+	unsigned int commands = 0;
+
+	cache.SetShader(Fake<ID3D11VertexShader>(1));
+	cache.SetShader(Fake<ID3D11VertexShader>(1));
+	CHECK(recorder.GetCommandCount() == ++commands);
+	cache.SetShader(Fake<ID3D11PixelShader>(1));		// Stages are tracked apart
+	CHECK(recorder.GetCommandCount() == ++commands);
+	cache.SetShader(Fake<ID3D11VertexShader>(2));
+	CHECK(recorder.GetCommandCount() == ++commands);
+	cache.SetShader((ID3D11GeometryShader*)0);			// Null is a real binding
+	cache.SetShader((ID3D11GeometryShader*)0);
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	ID3D11Buffer* buffers[] = { Fake<ID3D11Buffer>(10), Fake<ID3D11Buffer>(11) };
+	cache.SetConstantBuffers(SHADER_STAGE_VERTEX, 0, 2, buffers);
+	cache.SetConstantBuffers(SHADER_STAGE_VERTEX, 0, 2, buffers);
+	CHECK(recorder.GetCommandCount() == ++commands);
+	cache.SetConstantBuffers(SHADER_STAGE_PIXEL, 0, 2, buffers);
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	ID3D11ShaderResourceView* views[] = { Fake<ID3D11ShaderResourceView>(20) };
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, 3, 1, views);
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, 3, 1, views);
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	ID3D11SamplerState* samplers[] = { Fake<ID3D11SamplerState>(30) };
+	cache.SetSamplers(SHADER_STAGE_PIXEL, 0, 1, samplers);
+	cache.SetSamplers(SHADER_STAGE_PIXEL, 0, 1, samplers);
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	cache.SetInputLayout(Fake<ID3D11InputLayout>(40));
+	cache.SetInputLayout(Fake<ID3D11InputLayout>(40));
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	// A vertex buffer matches only with the same stride and offset
+	ID3D11Buffer* vertexBuffer = Fake<ID3D11Buffer>(50);
+	UINT stride = 44;
+	UINT offset = 0;
+	cache.SetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	cache.SetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	CHECK(recorder.GetCommandCount() == ++commands);
+	stride = 32;
+	cache.SetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	CHECK(recorder.GetCommandCount() == ++commands);
+	offset = 64;
+	cache.SetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	cache.SetIndexBuffer(Fake<ID3D11Buffer>(60), DXGI_FORMAT_R32_UINT, 0);
+	cache.SetIndexBuffer(Fake<ID3D11Buffer>(60), DXGI_FORMAT_R32_UINT, 0);
+	CHECK(recorder.GetCommandCount() == ++commands);
+	cache.SetIndexBuffer(Fake<ID3D11Buffer>(60), DXGI_FORMAT_R16_UINT, 0);
+	CHECK(recorder.GetCommandCount() == ++commands);
+	cache.SetIndexBuffer(Fake<ID3D11Buffer>(60), DXGI_FORMAT_R16_UINT, 12);
+	CHECK(recorder.GetCommandCount() == ++commands);
+
+	CHECK(recorder.GetStats().Binds == commands);
+	CHECK(cache.GetStats().Filtered == cache.GetStats().Calls - commands);
+	CHECK(cache.GetStats().Filtered == 9);
+}
+
+TEST(StateCacheTrimsRanges)
+{
+	RecordingRenderBackend recorder;
+	StateCache cache(&recorder);
+
+	ID3D11Buffer* a = Fake<ID3D11Buffer>(1);
+	ID3D11Buffer* b = Fake<ID3D11Buffer>(2);
+	ID3D11Buffer* c = Fake<ID3D11Buffer>(3);
+	ID3D11Buffer* d = Fake<ID3D11Buffer>(4);
+	ID3D11Buffer* x = Fake<ID3D11Buffer>(5);
+
+	ID3D11Buffer* first[] = { a, b, c, d };
+	cache.SetConstantBuffers(SHADER_STAGE_PIXEL, 2, 4, first);
+	CHECK(WasRangeBind(recorder, RENDER_COMMAND_SET_CONSTANT_BUFFERS, SHADER_STAGE_PIXEL, 2, 4, (const void* const*)first));
+
+	// Only the changed middle goes through
+	ID3D11Buffer* middle[] = { a, x, x, d };
+	cache.SetConstantBuffers(SHADER_STAGE_PIXEL, 2, 4, middle);
+	CHECK(WasRangeBind(recorder, RENDER_COMMAND_SET_CONSTANT_BUFFERS, SHADER_STAGE_PIXEL, 3, 2, (const void* const*)(middle + 1)));
+
+	// Only the last slot differs
+	ID3D11Buffer* ends[] = { a, x, x, c };
+	cache.SetConstantBuffers(SHADER_STAGE_PIXEL, 2, 4, ends);
+	CHECK(WasRangeBind(recorder, RENDER_COMMAND_SET_CONSTANT_BUFFERS, SHADER_STAGE_PIXEL, 5, 1, (const void* const*)(ends + 3)));
+
+	// Gaps inside the range are sent along, as it's one call
+	ID3D11ShaderResourceView* views[] = { Fake<ID3D11ShaderResourceView>(1), Fake<ID3D11ShaderResourceView>(2), Fake<ID3D11ShaderResourceView>(3) };
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, 0, 3, views);
+	ID3D11ShaderResourceView* outer[] = { Fake<ID3D11ShaderResourceView>(7), views[1], Fake<ID3D11ShaderResourceView>(8) };
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, 0, 3, outer);
+	CHECK(WasRangeBind(recorder, RENDER_COMMAND_SET_SHADER_RESOURCES, SHADER_STAGE_PIXEL, 0, 3, (const void* const*)outer));
+
+	// Vertex buffers trim on all three of buffer, stride and offset
+	ID3D11Buffer* vertexBuffers[] = { a, b, c };
+	UINT strides[] = { 44, 44, 44 };
+	UINT offsets[] = { 0, 0, 0 };
+	cache.SetVertexBuffers(0, 3, vertexBuffers, strides, offsets);
+	offsets[1] = 128;
+	cache.SetVertexBuffers(0, 3, vertexBuffers, strides, offsets);
+	const RenderCommand* last = GetLast(recorder);
+	CHECK(last && last->Type == RENDER_COMMAND_SET_VERTEX_BUFFERS);
+	CHECK(last && last->GetArgs()[0] == 1 && last->GetArgs()[1] == 1);
+	CHECK(last && ReadPointer(last->GetArgs() + 2) == b);
+}
+
+TEST(StateCacheUntrackedSlots)
+{
+	RecordingRenderBackend recorder;
+	StateCache cache(&recorder);
+
+	// Past the tracked slots, every bind goes through
+	ID3D11ShaderResourceView* high[] = { Fake<ID3D11ShaderResourceView>(1) };
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, StateCache::MaxResources, 1, high);
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, StateCache::MaxResources, 1, high);
+	CHECK(recorder.GetCommandCount() == 2);
+
+	ID3D11SamplerState* highSampler[] = { Fake<ID3D11SamplerState>(1) };
+	cache.SetSamplers(SHADER_STAGE_PIXEL, StateCache::MaxSamplers, 1, highSampler);
+	cache.SetSamplers(SHADER_STAGE_PIXEL, StateCache::MaxSamplers, 1, highSampler);
+	CHECK(recorder.GetCommandCount() == 4);
+
+	ID3D11Buffer* vertexBuffer = Fake<ID3D11Buffer>(1);
+	UINT stride = 44;
+	UINT offset = 0;
+	cache.SetVertexBuffers(StateCache::MaxVertexBuffers, 1, &vertexBuffer, &stride, &offset);
+	cache.SetVertexBuffers(StateCache::MaxVertexBuffers, 1, &vertexBuffer, &stride, &offset);
+	CHECK(recorder.GetCommandCount() == 6);
+
+	// A range running past the end goes through whole, every
+	// time, but the slots that fit are remembered
+	ID3D11ShaderResourceView* straddle[] = { Fake<ID3D11ShaderResourceView>(2), Fake<ID3D11ShaderResourceView>(3), Fake<ID3D11ShaderResourceView>(4) };
+	unsigned int slot = StateCache::MaxResources - 2;
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, slot, 3, straddle);
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, slot, 3, straddle);
+	CHECK(WasRangeBind(recorder, RENDER_COMMAND_SET_SHADER_RESOURCES, SHADER_STAGE_PIXEL, slot, 3, (const void* const*)straddle));
+	CHECK(recorder.GetCommandCount() == 8);
+	cache.SetShaderResources(SHADER_STAGE_PIXEL, slot, 2, straddle);
+	CHECK(recorder.GetCommandCount() == 8);
+
+	// Offset constant buffer binds leave their slot unknown
+	ID3D11Buffer* ring = Fake<ID3D11Buffer>(2);
+	cache.SetConstantBuffers(SHADER_STAGE_VERTEX, 1, 1, &ring);
+	CHECK(cache.SetConstantBufferRange(SHADER_STAGE_VERTEX, 1, ring, 16, 16));
+	CHECK(recorder.GetCommandCount() == 10);
+	cache.SetConstantBuffers(SHADER_STAGE_VERTEX, 1, 1, &ring);
+	CHECK(recorder.GetCommandCount() == 11);
+	CHECK(cache.GetStats().Filtered == 1);
+}
+
+TEST(StateCacheInvalidate)
+{
+	RecordingRenderBackend recorder;
+	StateCache cache(&recorder);
+
+	ID3D11Buffer* buffer = Fake<ID3D11Buffer>(1);
+	ID3D11ShaderResourceView* view = Fake<ID3D11ShaderResourceView>(2);
+	ID3D11SamplerState* sampler = Fake<ID3D11SamplerState>(3);
+	UINT stride = 44;
+	UINT offset = 0;
+
+	// Binds one of everything, the same each time
+	auto bindAll = [&]()
+	{
+		cache.SetShader(Fake<ID3D11VertexShader>(4));
+		cache.SetShader(Fake<ID3D11PixelShader>(5));
+		cache.SetConstantBuffers(SHADER_STAGE_VERTEX, 0, 1, &buffer);
+		cache.SetShaderResources(SHADER_STAGE_PIXEL, 0, 1, &view);
+		cache.SetSamplers(SHADER_STAGE_PIXEL, 0, 1, &sampler);
+		cache.SetInputLayout(Fake<ID3D11InputLayout>(6));
+		cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		cache.SetVertexBuffers(0, 1, &buffer, &stride, &offset);
+		cache.SetIndexBuffer(buffer, DXGI_FORMAT_R32_UINT, 0);
+	};
+
+	bindAll();
+	CHECK(recorder.GetCommandCount() == 9);
+	bindAll();
+	CHECK(recorder.GetCommandCount() == 9);
+
+	// After Invalidate() nothing is assumed, so all of it
+	// goes through again
+	cache.Invalidate();
+	bindAll();
+	CHECK(recorder.GetCommandCount() == 18);
+	bindAll();
+	CHECK(recorder.GetCommandCount() == 18);
+
+	// Null is bound after invalidating too, as it could be
+	// anything on the context
+	cache.Invalidate();
+	cache.SetShader((ID3D11PixelShader*)0);
+	cache.SetInputLayout(0);
+	CHECK(recorder.GetCommandCount() == 20);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A small test runner, built as its own console project
+//
+//    Tests.exe                        Every TEST()
+//    Tests.exe <prefix>               TEST()s whose names start with it
+//    Tests.exe -bench <name> [args]   One BENCHMARK()
+//
+// The project's post-build step runs every TEST(), so a
+// failing one fails the build.  Benchmarks only run when
+// asked for, since some take minutes.
+// --------------------------------------------------------
+typedef void (*TestFunction)();
+typedef int (*BenchmarkFunction)(int argc, char** argv);
+
+struct TestCase
+{
+	const char* Name;
+	TestFunction Run;
+};
+
+struct BenchmarkCase
+{
+	const char* Name;
+	const char* Usage;		// Its arguments, for the help text
+	BenchmarkFunction Run;
+};
+
+std::vector<TestCase>& GetTests();
+std::vector<BenchmarkCase>& GetBenchmarks();
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunction run) { GetTests().push_back({ name, run }); }
+};
+
+struct BenchmarkRegistration
+{
+	BenchmarkRegistration(const char* name, const char* usage, BenchmarkFunction run) { GetBenchmarks().push_back({ name, usage, run }); }
+};
+
+// Counts a failed CHECK() against the running test
+void ReportFailure(const char* file, int line, const char* expression);
+
+// Milliseconds on a steady clock, for timing benchmarks
+double GetMilliseconds();
+
+// A WARP (software) device, so tests that need one run on
+// machines without a GPU.  False if it couldn't be made.
+bool CreateTestDevice(ID3D11Device** device, ID3D11DeviceContext** context);
+
+#define TEST(name) \
+	static void Test_##name(); \
+	static TestRegistration testRegistration_##name(#name, Test_##name); \
+	static void Test_##name()
+
+// argc/argv are the arguments after the benchmark's name
+#define BENCHMARK(name, usage) \
+	static int Benchmark_##name(int argc, char** argv); \
+	static BenchmarkRegistration benchmarkRegistration_##name(#name, usage, Benchmark_##name); \
+	static int Benchmark_##name(int argc, char** argv)
+
+#define CHECK(expression) \
+	do { if (!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while (0)
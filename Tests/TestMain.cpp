@@ -0,0 +1,91 @@
+#include "Test.h"
+
+#include <Windows.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#pragma comment(lib, "d3d11.lib")
+
+namespace
+{
+	unsigned int failures;
+}
+
+std::vector<TestCase>& GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+std::vector<BenchmarkCase>& GetBenchmarks()
+{
+	static std::vector<BenchmarkCase> benchmarks;
+	return benchmarks;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("    %s(%d): CHECK(%s) failed\n", file, line, expression);
+	failures++;
+}
+
+double GetMilliseconds()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CreateTestDevice(ID3D11Device** device, ID3D11DeviceContext** context)
+{
+	D3D_FEATURE_LEVEL featureLevel;
+	return SUCCEEDED(D3D11CreateDevice(
+		0,
+		D3D_DRIVER_TYPE_WARP,
+		0,
+		0,
+		0,
+		0,
+		D3D11_SDK_VERSION,
+		device,
+		&featureLevel,
+		context));
+}
+
+static int RunBenchmark(int argc, char** argv)
+{
+	for (auto& benchmark : GetBenchmarks())
+	{
+		if (argc > 0 && strcmp(argv[0], benchmark.Name) == 0)
+			return benchmark.Run(argc - 1, argv + 1);
+	}
+
+	printf("Benchmarks:\n");
+	for (auto& benchmark : GetBenchmarks())
+		printf("    -bench %s %s\n", benchmark.Name, benchmark.Usage);
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "-bench") == 0)
+		return RunBenchmark(argc - 2, argv + 2);
+
+	const char* prefix = argc > 1 ? argv[1] : "";
+	unsigned int run = 0;
+	unsigned int failed = 0;
+	for (auto& test : GetTests())
+	{
+		if (strncmp(test.Name, prefix, strlen(prefix)) != 0)
+			continue;
+
+		printf("%s\n", test.Name);
+		unsigned int before = failures;
+		test.Run();
+		run++;
+		if (failures != before)
+			failed++;
+	}
+
+	printf("%u of %u tests passed\n", run - failed, run);
+	return failed > 0 ? 1 : 0;
+}
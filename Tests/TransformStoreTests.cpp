@@ -0,0 +1,279 @@
+#include "Test.h"
+#include "../TransformStore.h"
+#include "../JobSystem.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace DirectX;
+
+// What the old per-entity code built: scale, then the rotations
+// Z, Y and X, then translation, stored transposed
+static XMFLOAT4X4 BuildReference(const XMFLOAT3& position, const XMFLOAT3& rotation, const XMFLOAT3& scale)
+{
+	XMMATRIX world =
+		XMMatrixScaling(scale.x, scale.y, scale.z) *
+		XMMatrixRotationZ(rotation.z) *
+		XMMatrixRotationY(rotation.y) *
+		XMMatrixRotationX(rotation.x) *
+		XMMatrixTranslation(position.x, position.y, position.z);
+
+	XMFLOAT4X4 stored;
+	XMStoreFloat4x4(&stored, XMMatrixTranspose(world));
+	return stored;
+}
+
+// Both are stored transposed, so this is local * parent as
+// row vectors, the same as the store does
+static XMFLOAT4X4 Combine(const XMFLOAT4X4& parentWorld, const XMFLOAT4X4& local)
+{
+	XMFLOAT4X4 combined;
+	XMStoreFloat4x4(&combined, XMMatrixMultiply(XMLoadFloat4x4(&parentWorld), XMLoadFloat4x4(&local)));
+	return combined;
+}
+
+static bool NearlyEqual(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+{
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			if (fabsf(a.m[r][c] - b.m[r][c]) > 1e-4f)
+				return false;
+	return true;
+}
+
+TEST(TransformStoreMatchesReference)
+{
+	TransformStore store;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> spread(-3, 3);
+
+	// Not a multiple of 4, so the padding slots are exercised too
+	const unsigned int count = 1027;
+	std::vector<XMFLOAT3> positions(count), rotations(count), scales(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int t = store.Create();
+		CHECK(t == i);
+
+		float px = spread(random);
+		float py = spread(random);
+		float pz = spread(random);
+		float rx = spread(random);
+		float ry = spread(random);
+		float rz = spread(random);
+		positions[i] = XMFLOAT3(px, py, pz);
+		rotations[i] = XMFLOAT3(rx, ry, rz);
+		scales[i] = XMFLOAT3(0.5f + i % 3, 1.0f, 2.0f - (i % 2));
+
+		store.SetPosition(t, positions[i].x, positions[i].y, positions[i].z);
+		store.SetRotation(t, rotations[i].x, rotations[i].y, rotations[i].z);
+		store.SetScale(t, scales[i].x, scales[i].y, scales[i].z);
+	}
+
+	JobSystem jobs(2);
+	store.UpdateWorldMatrices(&jobs);
+
+	bool matches = true;
+	bool changed = true;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		matches = matches && NearlyEqual(*store.GetWorldMatrix(i), BuildReference(positions[i], rotations[i], scales[i]));
+		changed = changed && store.WasChanged(i) && !store.IsDirty(i);
+	}
+	CHECK(matches);
+	CHECK(changed);
+
+	// Only what moved is rebuilt next time
+	store.Move(5, 1, 0, 0);
+	positions[5].x += 1;
+	store.UpdateWorldMatrices();
+	CHECK(store.WasChanged(5));
+	CHECK(!store.WasChanged(4) && !store.WasChanged(6) && !store.WasChanged(1000));
+	CHECK(NearlyEqual(*store.GetWorldMatrix(5), BuildReference(positions[5], rotations[5], scales[5])));
+}
+
+TEST(TransformStoreHierarchy)
+{
+	TransformStore store;
+
+	// Created children first, so parenting has to move them
+	// behind their parents
+	unsigned int grandchild = store.Create();
+	unsigned int child = store.Create();
+	unsigned int root = store.Create();
+	unsigned int bystander = store.Create();
+	CHECK(store.SetParent(grandchild, child));
+	CHECK(store.SetParent(child, root));
+	CHECK(store.GetParent(child) == root);
+
+	// No cycles, and a refusal changes nothing
+	CHECK(!store.SetParent(root, grandchild));
+	CHECK(!store.SetParent(root, root));
+	CHECK(store.GetParent(root) == TransformStore::NoTransform);
+
+	store.SetPosition(root, 10, 0, 0);
+	store.SetRotation(root, 0, XM_PIDIV2, 0);
+	store.SetPosition(child, 0, 0, 5);
+	store.SetScale(child, 2, 2, 2);
+	store.SetPosition(grandchild, 1, 1, 1);
+	store.UpdateWorldMatrices();
+
+	XMFLOAT3 zero(0, 0, 0);
+	XMFLOAT3 one(1, 1, 1);
+	XMFLOAT4X4 rootWorld = BuildReference(XMFLOAT3(10, 0, 0), XMFLOAT3(0, XM_PIDIV2, 0), one);
+	XMFLOAT4X4 childWorld = Combine(rootWorld, BuildReference(XMFLOAT3(0, 0, 5), zero, XMFLOAT3(2, 2, 2)));
+	XMFLOAT4X4 grandchildWorld = Combine(childWorld, BuildReference(XMFLOAT3(1, 1, 1), zero, one));
+	CHECK(NearlyEqual(*store.GetWorldMatrix(root), rootWorld));
+	CHECK(NearlyEqual(*store.GetWorldMatrix(child), childWorld));
+	CHECK(NearlyEqual(*store.GetWorldMatrix(grandchild), grandchildWorld));
+
+	// The child's world origin is the root's, turned, plus 5 along z
+	XMFLOAT4X4* childMatrix = store.GetWorldMatrix(child);
+	CHECK(fabsf(childMatrix->_14 - 15) < 1e-4f && fabsf(childMatrix->_34) < 1e-4f);
+
+	// Moving the root carries the whole subtree, and nothing else
+	store.Move(root, 0, 3, 0);
+	store.UpdateWorldMatrices();
+	CHECK(store.WasChanged(root) && store.WasChanged(child) && store.WasChanged(grandchild));
+	CHECK(!store.WasChanged(bystander));
+	CHECK(fabsf(store.GetWorldMatrix(grandchild)->_24 - (3 + 2)) < 1e-4f);
+
+	// Moving a leaf leaves its parents alone
+	store.Move(grandchild, 1, 0, 0);
+	store.UpdateWorldMatrices();
+	CHECK(store.WasChanged(grandchild));
+	CHECK(!store.WasChanged(root) && !store.WasChanged(child));
+
+	// Detached, the local transform is the world one again
+	CHECK(store.SetParent(child, TransformStore::NoTransform));
+	store.UpdateWorldMatrices();
+	CHECK(NearlyEqual(*store.GetWorldMatrix(child), BuildReference(XMFLOAT3(0, 0, 5), zero, XMFLOAT3(2, 2, 2))));
+	CHECK(store.WasChanged(grandchild));
+
+	// Lots of re-parenting, enough to compact, keeps every
+	// world matrix right
+	for (int i = 0; i < 50; i++)
+	{
+		if (i % 2)
+		{
+			CHECK(store.SetParent(child, root));
+			CHECK(store.SetParent(bystander, grandchild));
+		}
+		else
+		{
+			CHECK(store.SetParent(bystander, root));
+			CHECK(store.SetParent(child, bystander));
+		}
+	}
+	store.UpdateWorldMatrices();
+	std::vector<XMFLOAT4X4> worlds;
+	store.CopyWorldMatrices(worlds);
+	CHECK(worlds.size() == 4);
+	bool consistent = true;
+	for (unsigned int t = 0; t < 4; t++)
+	{
+		XMFLOAT3 p = store.GetPosition(t);
+		XMFLOAT3 s = store.GetScale(t);
+		XMFLOAT4 q = store.GetRotation(t);
+		XMFLOAT4X4 local;
+		XMStoreFloat4x4(&local, XMMatrixTranspose(
+			XMMatrixScaling(s.x, s.y, s.z) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&q)) *
+			XMMatrixTranslation(p.x, p.y, p.z)));
+
+		unsigned int parent = store.GetParent(t);
+		XMFLOAT4X4 expected = parent == TransformStore::NoTransform ? local : Combine(worlds[parent], local);
+		consistent = consistent && NearlyEqual(worlds[t], expected);
+	}
+	CHECK(consistent);
+}
+
+// --------------------------------------------------------
+// Moves a fraction of the transforms each frame and times
+// rebuilding the world matrices: the old way (five matrices
+// per entity, every entity, every frame), then through the
+// store, without and with the job system.  Runs 10k, 100k and
+// 1M transforms, unless given a count.
+// --------------------------------------------------------
+BENCHMARK(transforms, "[frames = 100] [moving percent = 10] [count = 10k, 100k and 1M]")
+{
+	unsigned int frames = argc > 0 ? strtoul(argv[0], 0, 10) : 100;
+	unsigned int movingPercent = argc > 1 ? strtoul(argv[1], 0, 10) : 10;
+	unsigned int onlyCount = argc > 2 ? strtoul(argv[2], 0, 10) : 0;
+	if (frames == 0 || movingPercent > 100)
+		return 1;
+
+	const unsigned int defaultCounts[] = { 10000, 100000, 1000000 };
+	std::vector<unsigned int> counts;
+	if (onlyCount > 0) counts.push_back(onlyCount);
+	else counts.assign(defaultCounts, defaultCounts + 3);
+
+	JobSystem jobs;
+	printf("Workers:               %u\n", jobs.GetWorkerCount());
+
+	for (unsigned int count : counts)
+	{
+		struct OldEntity
+		{
+			XMFLOAT4X4 World;
+			XMFLOAT3 Position;
+			XMFLOAT3 Rotation;
+			XMFLOAT3 Scale;
+		};
+		std::vector<OldEntity> old(count);
+		for (auto& e : old)
+		{
+			e.Position = XMFLOAT3(0, 0, 0);
+			e.Rotation = XMFLOAT3(0, 0, 0);
+			e.Scale = XMFLOAT3(1, 1, 1);
+		}
+
+		TransformStore store;
+		store.Reserve(count);
+		for (unsigned int i = 0; i < count; i++)
+			store.Create();
+		store.UpdateWorldMatrices();
+
+		// The same transforms move in each version
+		unsigned int moving = (unsigned int)((unsigned long long)count * movingPercent / 100);
+		unsigned int stride = moving > 0 ? count / moving : count;
+
+		double start = GetMilliseconds();
+		for (unsigned int f = 0; f < frames; f++)
+		{
+			for (unsigned int i = 0; i < moving; i++)
+				old[i * stride].Position.x += 0.01f;
+
+			for (auto& e : old)
+			{
+				XMMATRIX world =
+					XMMatrixScaling(e.Scale.x, e.Scale.y, e.Scale.z) *
+					XMMatrixRotationZ(e.Rotation.z) *
+					XMMatrixRotationY(e.Rotation.y) *
+					XMMatrixRotationX(e.Rotation.x) *
+					XMMatrixTranslation(e.Position.x, e.Position.y, e.Position.z);
+				XMStoreFloat4x4(&e.World, XMMatrixTranspose(world));
+			}
+		}
+		double oldMilliseconds = (GetMilliseconds() - start) / frames;
+
+		double storeMilliseconds[2];
+		for (int useJobs = 0; useJobs < 2; useJobs++)
+		{
+			start = GetMilliseconds();
+			for (unsigned int f = 0; f < frames; f++)
+			{
+				for (unsigned int i = 0; i < moving; i++)
+					store.Move(i * stride, 0.01f, 0, 0);
+				store.UpdateWorldMatrices(useJobs ? &jobs : 0);
+			}
+			storeMilliseconds[useJobs] = (GetMilliseconds() - start) / frames;
+		}
+
+		printf("%8u transforms:  old %.3f ms, store %.3f ms, store with jobs %.3f ms per frame (%u moving)\n",
+			count, oldMilliseconds, storeMilliseconds[0], storeMilliseconds[1], moving);
+	}
+	return 0;
+}
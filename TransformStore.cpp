@@ -0,0 +1,571 @@
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include <xmmintrin.h>
+#include <cstring>
+
+using namespace DirectX;
+
+const unsigned int TransformStore::NoTransform;
+
+TransformStore::TransformStore()
+{
+	slotCount = 0;
+	freeSlotCount = 0;
+}
+
+TransformStore::~TransformStore()
+{
+}
+
+// --------------------------------------------------------
+// Makes room for at least "count" transforms up front, to
+// avoid re-allocating while entities are being created
+// --------------------------------------------------------
+void TransformStore::Reserve(unsigned int count)
+{
+	unsigned int padded = (count + 3) & ~3u;
+	handleToSlot.reserve(count);
+	parentHandles.reserve(count);
+	firstChildren.reserve(count);
+	nextSiblings.reserve(count);
+
+	slotToHandle.reserve(padded);
+	parentSlots.reserve(padded);
+	positions.reserve(padded);
+	rotations.reserve(padded);
+	scales.reserve(padded);
+	localMatrices.reserve(padded);
+	worldMatrices.reserve(padded);
+	dirtyBits.reserve((padded + 63) / 64);
+	changedBits.reserve((padded + 63) / 64);
+	parentedBits.reserve((padded + 63) / 64);
+}
+
+// --------------------------------------------------------
+// Adds a new identity transform and returns its handle
+// --------------------------------------------------------
+unsigned int TransformStore::Create()
+{
+	unsigned int t = (unsigned int)handleToSlot.size();
+	unsigned int s = AddSlot();
+
+	handleToSlot.push_back(s);
+	parentHandles.push_back(NoTransform);
+	firstChildren.push_back(NoTransform);
+	nextSiblings.push_back(NoTransform);
+
+	slotToHandle[s] = t;
+	MarkDirty(s);
+	return t;
+}
+
+// --------------------------------------------------------
+// Bulk version of Create() for loading whole scenes.  The new
+// slots go on the end, and each parent comes before its
+// children in the range, so the arrays stay parents-first.
+// --------------------------------------------------------
+unsigned int TransformStore::CreateRange(unsigned int count, const XMFLOAT3* newPositions, const XMFLOAT4* newRotations, const XMFLOAT3* newScales, const unsigned int* parents)
+{
+	unsigned int first = (unsigned int)handleToSlot.size();
+	unsigned int firstSlot = slotCount;
+	if (count == 0)
+		return first;
+
+	// Grow every per-slot array in one go, keeping whole groups of 4
+	unsigned int padded = (slotCount + count + 3) & ~3u;
+	if (padded > positions.size())
+	{
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+		slotToHandle.resize(padded, NoTransform);
+		parentSlots.resize(padded, NoTransform);
+		positions.resize(padded, XMFLOAT3(0, 0, 0));
+		rotations.resize(padded, XMFLOAT4(0, 0, 0, 1));
+		scales.resize(padded, XMFLOAT3(1, 1, 1));
+		localMatrices.resize(padded, identity);
+		worldMatrices.resize(padded, identity);
+
+		unsigned int words = (padded + 63) / 64;
+		dirtyBits.resize(words, 0);
+		changedBits.resize(words, 0);
+		parentedBits.resize(words, 0);
+	}
+	slotCount += count;
+
+	memcpy(&positions[firstSlot], newPositions, count * sizeof(XMFLOAT3));
+	memcpy(&rotations[firstSlot], newRotations, count * sizeof(XMFLOAT4));
+	memcpy(&scales[firstSlot], newScales, count * sizeof(XMFLOAT3));
+
+	handleToSlot.resize(first + count);
+	parentHandles.resize(first + count);
+	firstChildren.resize(first + count, NoTransform);
+	nextSiblings.resize(first + count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int t = first + i;
+		unsigned int s = firstSlot + i;
+		unsigned int parent = parents[i] < i ? first + parents[i] : NoTransform;
+
+		handleToSlot[t] = s;
+		slotToHandle[s] = t;
+		parentHandles[t] = parent;
+		nextSiblings[t] = NoTransform;
+		if (parent != NoTransform)
+		{
+			nextSiblings[t] = firstChildren[parent];
+			firstChildren[parent] = t;
+		}
+
+		SetParentSlot(s, parent == NoTransform ? NoTransform : handleToSlot[parent]);
+		MarkDirty(s);
+	}
+
+	return first;
+}
+
+// --------------------------------------------------------
+// Appends an identity slot to the end of the arrays,
+// growing them by a whole group of 4 when needed
+// --------------------------------------------------------
+unsigned int TransformStore::AddSlot()
+{
+	unsigned int s = slotCount++;
+	if (s < positions.size())
+		return s;
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	for (int i = 0; i < 4; i++)
+	{
+		slotToHandle.push_back(NoTransform);
+		parentSlots.push_back(NoTransform);
+		positions.push_back(XMFLOAT3(0, 0, 0));
+		rotations.push_back(XMFLOAT4(0, 0, 0, 1));
+		scales.push_back(XMFLOAT3(1, 1, 1));
+		localMatrices.push_back(identity);
+		worldMatrices.push_back(identity);
+	}
+
+	if (positions.size() > dirtyBits.size() * 64)
+	{
+		dirtyBits.push_back(0);
+		changedBits.push_back(0);
+		parentedBits.push_back(0);
+	}
+
+	return s;
+}
+
+void TransformStore::CopySlot(unsigned int from, unsigned int to)
+{
+	positions[to] = positions[from];
+	rotations[to] = rotations[from];
+	scales[to] = scales[from];
+	localMatrices[to] = localMatrices[from];
+	worldMatrices[to] = worldMatrices[from];
+}
+
+// --------------------------------------------------------
+// Leaves a hole where a slot used to be.  The update
+// skips it because it is never dirty and has no parent.
+// --------------------------------------------------------
+void TransformStore::FreeSlot(unsigned int s)
+{
+	slotToHandle[s] = NoTransform;
+	SetParentSlot(s, NoTransform);
+	ClearBit(dirtyBits, s);
+	ClearBit(changedBits, s);
+	freeSlotCount++;
+}
+
+void TransformStore::SetParentSlot(unsigned int s, unsigned int parentSlot)
+{
+	parentSlots[s] = parentSlot;
+	if (parentSlot == NoTransform) ClearBit(parentedBits, s);
+	else SetBit(parentedBits, s);
+}
+
+// --------------------------------------------------------
+// Attaches a transform (and everything under it) to a new
+// parent, or detaches it when parent is NoTransform.  The
+// child's position, rotation and scale are kept as they are,
+// and are now relative to the parent.
+//
+// If the parent already comes first in the arrays this is just
+// a few index updates, otherwise the child's subtree is moved
+// to the end, so the cost is O(subtree) either way.
+// --------------------------------------------------------
+bool TransformStore::SetParent(unsigned int t, unsigned int parent)
+{
+	// No parenting to yourself or your own descendants
+	for (unsigned int p = parent; p != NoTransform; p = parentHandles[p])
+	{
+		if (p == t) return false;
+	}
+
+	// Unhook from the old parent's child list
+	unsigned int oldParent = parentHandles[t];
+	if (oldParent != NoTransform)
+	{
+		unsigned int* link = &firstChildren[oldParent];
+		while (*link != t) link = &nextSiblings[*link];
+		*link = nextSiblings[t];
+		nextSiblings[t] = NoTransform;
+	}
+
+	// Hook into the new one
+	parentHandles[t] = parent;
+	if (parent != NoTransform)
+	{
+		nextSiblings[t] = firstChildren[parent];
+		firstChildren[parent] = t;
+	}
+
+	// Keep parents ahead of their children
+	unsigned int s = handleToSlot[t];
+	if (parent != NoTransform && handleToSlot[parent] > s)
+	{
+		MoveSubtreeToEnd(t);
+	}
+	else
+	{
+		SetParentSlot(s, parent == NoTransform ? NoTransform : handleToSlot[parent]);
+		MarkDirty(s);
+	}
+
+	// Don't let holes pile up
+	if (freeSlotCount > slotCount / 2)
+		Compact();
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Moves a transform and all of its descendants to the end
+// of the arrays, parents first
+// --------------------------------------------------------
+void TransformStore::MoveSubtreeToEnd(unsigned int t)
+{
+	std::vector<unsigned int> stack;
+	stack.push_back(t);
+
+	while (!stack.empty())
+	{
+		unsigned int h = stack.back();
+		stack.pop_back();
+
+		unsigned int from = handleToSlot[h];
+		unsigned int to = AddSlot();
+		CopySlot(from, to);
+		FreeSlot(from);
+
+		// The parent is either outside the subtree (and already
+		// ahead of us) or was moved just before us
+		slotToHandle[to] = h;
+		handleToSlot[h] = to;
+		SetParentSlot(to, parentHandles[h] == NoTransform ? NoTransform : handleToSlot[parentHandles[h]]);
+		MarkDirty(to);
+
+		for (unsigned int c = firstChildren[h]; c != NoTransform; c = nextSiblings[c])
+			stack.push_back(c);
+	}
+}
+
+// --------------------------------------------------------
+// Squeezes out the holes left by re-parenting, keeping the
+// order (and so the parents-first rule) intact.  Everything
+// is marked dirty afterwards, which is fine since this only
+// runs once half of the slots are holes.
+// --------------------------------------------------------
+void TransformStore::Compact()
+{
+	unsigned int live = 0;
+	for (unsigned int s = 0; s < slotCount; s++)
+	{
+		unsigned int h = slotToHandle[s];
+		if (h == NoTransform)
+			continue;
+
+		if (live != s) CopySlot(s, live);
+		slotToHandle[live] = h;
+		handleToSlot[h] = live;
+		live++;
+	}
+
+	slotCount = live;
+	freeSlotCount = 0;
+
+	// Trim back down to whole groups of 4, resetting the padding
+	unsigned int padded = (slotCount + 3) & ~3u;
+	unsigned int words = (padded + 63) / 64;
+	slotToHandle.resize(padded);
+	parentSlots.resize(padded);
+	positions.resize(padded);
+	rotations.resize(padded);
+	scales.resize(padded);
+	localMatrices.resize(padded);
+	worldMatrices.resize(padded);
+	dirtyBits.assign(words, 0);
+	changedBits.assign(words, 0);
+	parentedBits.assign(words, 0);
+
+	for (unsigned int s = slotCount; s < padded; s++)
+	{
+		slotToHandle[s] = NoTransform;
+		positions[s] = XMFLOAT3(0, 0, 0);
+		rotations[s] = XMFLOAT4(0, 0, 0, 1);
+		scales[s] = XMFLOAT3(1, 1, 1);
+	}
+
+	// Parents were compacted before their children, so
+	// their new slots are already known
+	for (unsigned int s = 0; s < padded; s++)
+	{
+		unsigned int h = slotToHandle[s];
+		unsigned int p = h == NoTransform ? NoTransform : parentHandles[h];
+		SetParentSlot(s, p == NoTransform ? NoTransform : handleToSlot[p]);
+		if (h != NoTransform) MarkDirty(s);
+	}
+}
+
+void TransformStore::Move(unsigned int t, float x, float y, float z)
+{
+	unsigned int s = handleToSlot[t];
+	positions[s].x += x;
+	positions[s].y += y;
+	positions[s].z += z;
+	MarkDirty(s);
+}
+
+void TransformStore::Rotate(unsigned int t, float x, float y, float z)
+{
+	// Apply the extra rotation after the current one
+	unsigned int s = handleToSlot[t];
+	XMVECTOR rot = XMQuaternionMultiply(XMLoadFloat4(&rotations[s]), EulerToQuaternion(x, y, z));
+	XMStoreFloat4(&rotations[s], XMQuaternionNormalize(rot));
+	MarkDirty(s);
+}
+
+void TransformStore::SetPosition(unsigned int t, float x, float y, float z)
+{
+	unsigned int s = handleToSlot[t];
+	positions[s] = XMFLOAT3(x, y, z);
+	MarkDirty(s);
+}
+
+void TransformStore::SetRotation(unsigned int t, float x, float y, float z)
+{
+	unsigned int s = handleToSlot[t];
+	XMStoreFloat4(&rotations[s], EulerToQuaternion(x, y, z));
+	MarkDirty(s);
+}
+
+void TransformStore::SetRotation(unsigned int t, const XMFLOAT4& quaternion)
+{
+	unsigned int s = handleToSlot[t];
+	XMStoreFloat4(&rotations[s], XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	MarkDirty(s);
+}
+
+void TransformStore::SetScale(unsigned int t, float x, float y, float z)
+{
+	unsigned int s = handleToSlot[t];
+	scales[s] = XMFLOAT3(x, y, z);
+	MarkDirty(s);
+}
+
+// --------------------------------------------------------
+// Builds a quaternion that matches rotZ * rotY * rotX
+// --------------------------------------------------------
+XMVECTOR TransformStore::EulerToQuaternion(float x, float y, float z)
+{
+	XMVECTOR qx = XMQuaternionRotationNormal(XMVectorSet(1, 0, 0, 0), x);
+	XMVECTOR qy = XMQuaternionRotationNormal(XMVectorSet(0, 1, 0, 0), y);
+	XMVECTOR qz = XMQuaternionRotationNormal(XMVectorSet(0, 0, 1, 0), z);
+
+	// XMQuaternionMultiply(a, b) applies a first, then b
+	return XMQuaternionMultiply(XMQuaternionMultiply(qz, qy), qx);
+}
+
+// --------------------------------------------------------
+// Rebuilds every world matrix that needs it, in two passes:
+//
+// 1. Local matrices for dirty slots.  Clean 64-slot blocks
+//    cost a single compare, and dirty ones are handled in
+//    groups of 4 so the math runs across SSE lanes.
+// 2. World matrices, walking the slots in order.  A slot
+//    changes if it is dirty or its parent changed, and since
+//    parents come first that is already known when we get
+//    to it.  Blocks with nothing dirty are skipped when no
+//    parent could have changed either.
+// --------------------------------------------------------
+void TransformStore::UpdateWorldMatrices(JobSystem* jobs)
+{
+	// Local matrices don't depend on each other, so big stores
+	// are split into jobs of 16 words (1024 transforms)
+	unsigned int wordCount = (unsigned int)dirtyBits.size();
+	if (jobs && wordCount > 16)
+		jobs->ParallelFor(wordCount, 16, [this](unsigned int begin, unsigned int end) { UpdateLocalMatrices(begin, end); });
+	else
+		UpdateLocalMatrices(0, wordCount);
+
+	bool anyChanged = false;
+	for (unsigned int w = 0; w < wordCount; w++)
+	{
+		unsigned long long dirty = dirtyBits[w];
+		unsigned long long parented = parentedBits[w];
+		changedBits[w] = 0;
+
+		// Nothing dirty here, and no parent that could have changed
+		if (dirty == 0 && (!anyChanged || parented == 0))
+			continue;
+
+		unsigned int end = slotCount < (w + 1) * 64 ? slotCount : (w + 1) * 64;
+		for (unsigned int s = w * 64; s < end; s++)
+		{
+			unsigned long long bit = 1ull << (s & 63);
+			unsigned int p = parentSlots[s];
+
+			bool changed = (dirty & bit) != 0;
+			if (!changed && (parented & bit))
+				changed = TestBit(changedBits, p);
+			if (!changed)
+				continue;
+
+			// Stored matrices are transposed, so parent * local
+			// here is local * parent in row-vector terms
+			if (p == NoTransform)
+				worldMatrices[s] = localMatrices[s];
+			else
+				XMStoreFloat4x4(&worldMatrices[s], XMMatrixMultiply(
+					XMLoadFloat4x4(&worldMatrices[p]),
+					XMLoadFloat4x4(&localMatrices[s])));
+
+			changedBits[w] |= bit;
+		}
+
+		anyChanged = anyChanged || changedBits[w] != 0;
+		dirtyBits[w] = 0;
+	}
+}
+
+void TransformStore::CopyWorldMatrices(std::vector<XMFLOAT4X4>& out)
+{
+	unsigned int count = (unsigned int)handleToSlot.size();
+	out.resize(count);
+	for (unsigned int t = 0; t < count; t++)
+		out[t] = worldMatrices[handleToSlot[t]];
+}
+
+// --------------------------------------------------------
+// Rebuilds local matrices for the dirty slots in a range of
+// dirty bit words
+// --------------------------------------------------------
+void TransformStore::UpdateLocalMatrices(unsigned int firstWord, unsigned int endWord)
+{
+	for (unsigned int w = firstWord; w < endWord; w++)
+	{
+		unsigned long long bits = dirtyBits[w];
+		if (bits == 0)
+			continue;
+
+		// Any dirty transform in a group means the whole group is
+		// rebuilt - clean ones just get the same matrix again
+		for (unsigned int g = 0; g < 16; g++)
+		{
+			if ((bits >> (g * 4)) & 0xF)
+				UpdateGroup(w * 64 + g * 4);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Builds the local scale * rotation * translation matrix
+// for 4 consecutive slots at once, with each SSE lane holding one of them
+//
+// first - Index of the first transform in the group
+// --------------------------------------------------------
+void TransformStore::UpdateGroup(unsigned int first)
+{
+	// Rotations are already 4 floats each, so a transpose
+	// turns them into x, y, z and w registers
+	__m128 qx = _mm_loadu_ps(&rotations[first + 0].x);
+	__m128 qy = _mm_loadu_ps(&rotations[first + 1].x);
+	__m128 qz = _mm_loadu_ps(&rotations[first + 2].x);
+	__m128 qw = _mm_loadu_ps(&rotations[first + 3].x);
+	_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+	// Positions and scales are 3 floats, so gather them
+	const XMFLOAT3* p = &positions[first];
+	const XMFLOAT3* s = &scales[first];
+	__m128 tx = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+	__m128 ty = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+	__m128 tz = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+	__m128 sx = _mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x);
+	__m128 sy = _mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y);
+	__m128 sz = _mm_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z);
+
+	// Quaternion to rotation matrix (same layout as XMMatrixRotationQuaternion)
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+	__m128 x2 = _mm_mul_ps(qx, two);
+	__m128 y2 = _mm_mul_ps(qy, two);
+	__m128 z2 = _mm_mul_ps(qz, two);
+	__m128 xx = _mm_mul_ps(qx, x2);
+	__m128 yy = _mm_mul_ps(qy, y2);
+	__m128 zz = _mm_mul_ps(qz, z2);
+	__m128 xy = _mm_mul_ps(qx, y2);
+	__m128 xz = _mm_mul_ps(qx, z2);
+	__m128 yz = _mm_mul_ps(qy, z2);
+	__m128 wx = _mm_mul_ps(qw, x2);
+	__m128 wy = _mm_mul_ps(qw, y2);
+	__m128 wz = _mm_mul_ps(qw, z2);
+
+	__m128 r00 = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+	__m128 r01 = _mm_add_ps(xy, wz);
+	__m128 r02 = _mm_sub_ps(xz, wy);
+	__m128 r10 = _mm_sub_ps(xy, wz);
+	__m128 r11 = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+	__m128 r12 = _mm_add_ps(yz, wx);
+	__m128 r20 = _mm_add_ps(xz, wy);
+	__m128 r21 = _mm_sub_ps(yz, wx);
+	__m128 r22 = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+
+	// World = S * R * T, so each rotation row picks up its scale.
+	// The stored matrix is transposed, so column j of the world
+	// matrix becomes row j of what we store.
+	__m128 row0 = _mm_mul_ps(r00, sx);
+	__m128 row1 = _mm_mul_ps(r10, sy);
+	__m128 row2 = _mm_mul_ps(r20, sz);
+	__m128 row3 = tx;
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+	__m128 col0 = _mm_mul_ps(r01, sx);
+	__m128 col1 = _mm_mul_ps(r11, sy);
+	__m128 col2 = _mm_mul_ps(r21, sz);
+	__m128 col3 = ty;
+	_MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+
+	__m128 dep0 = _mm_mul_ps(r02, sx);
+	__m128 dep1 = _mm_mul_ps(r12, sy);
+	__m128 dep2 = _mm_mul_ps(r22, sz);
+	__m128 dep3 = tz;
+	_MM_TRANSPOSE4_PS(dep0, dep1, dep2, dep3);
+
+	// After the transposes, register k holds row 0, 1 or 2 of transform k
+	__m128 lastRow = _mm_setr_ps(0, 0, 0, 1);
+	__m128 firstRows[4] = { row0, row1, row2, row3 };
+	__m128 secondRows[4] = { col0, col1, col2, col3 };
+	__m128 thirdRows[4] = { dep0, dep1, dep2, dep3 };
+	for (int k = 0; k < 4; k++)
+	{
+		XMFLOAT4X4* m = &localMatrices[first + k];
+		_mm_storeu_ps(&m->_11, firstRows[k]);
+		_mm_storeu_ps(&m->_21, secondRows[k]);
+		_mm_storeu_ps(&m->_31, thirdRows[k]);
+		_mm_storeu_ps(&m->_41, lastRow);
+	}
+}
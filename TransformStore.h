@@ -0,0 +1,116 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Structure-of-arrays storage for every entity transform
+//
+// Positions, rotations (quaternions) and scales live in their
+// own tightly packed arrays, with one dirty bit per transform.
+// UpdateWorldMatrices() rebuilds only the dirty world matrices,
+// four at a time with SSE.  World matrices are stored transposed,
+// ready to be copied straight into a constant buffer.
+//
+// Transforms can have a parent.  The arrays are kept sorted so
+// every parent comes before its children, which lets world
+// matrices be built in one linear pass.  Handles stay the same
+// while the data underneath them moves around.
+// --------------------------------------------------------
+class TransformStore
+{
+public:
+	TransformStore();
+	~TransformStore();
+
+	static const unsigned int NoTransform = 0xFFFFFFFF;
+
+	// Adds an identity transform and returns its handle
+	unsigned int Create();
+
+	// Adds "count" transforms at once, copying the arrays straight in,
+	// and returns the first handle.  parents[i] is NoTransform or the
+	// index of an earlier transform in the same range.
+	unsigned int CreateRange(unsigned int count, const DirectX::XMFLOAT3* positions, const DirectX::XMFLOAT4* rotations, const DirectX::XMFLOAT3* scales, const unsigned int* parents);
+	void Reserve(unsigned int count);
+	unsigned int GetCount() { return (unsigned int)handleToSlot.size(); }
+
+	// Hierarchy - a child's transform is relative to its parent.
+	// Fails (and changes nothing) if it would create a cycle.
+	bool SetParent(unsigned int t, unsigned int parent);
+	unsigned int GetParent(unsigned int t) { return parentHandles[t]; }
+
+	// Transformations (rotations are Euler angles in radians,
+	// applied Z, then Y, then X like the old per-entity matrices)
+	void Move(unsigned int t, float x, float y, float z);
+	void Rotate(unsigned int t, float x, float y, float z);
+	void SetPosition(unsigned int t, float x, float y, float z);
+	void SetRotation(unsigned int t, float x, float y, float z);
+	void SetRotation(unsigned int t, const DirectX::XMFLOAT4& quaternion);
+	void SetScale(unsigned int t, float x, float y, float z);
+
+	// Getters
+	DirectX::XMFLOAT3 GetPosition(unsigned int t) { return positions[handleToSlot[t]]; }
+	DirectX::XMFLOAT4 GetRotation(unsigned int t) { return rotations[handleToSlot[t]]; }
+	DirectX::XMFLOAT3 GetScale(unsigned int t) { return scales[handleToSlot[t]]; }
+	DirectX::XMFLOAT4X4* GetWorldMatrix(unsigned int t) { return &worldMatrices[handleToSlot[t]]; }
+	bool IsDirty(unsigned int t) { return TestBit(dirtyBits, handleToSlot[t]); }
+
+	// Did the world matrix change during the last UpdateWorldMatrices()?
+	bool WasChanged(unsigned int t) { return TestBit(changedBits, handleToSlot[t]); }
+
+	// Rebuilds the world matrix of every transform that changed, or
+	// whose parent changed, since the last call.  Local matrices are
+	// built in parallel when a job system is given.
+	void UpdateWorldMatrices(JobSystem* jobs = 0);
+
+	// Copies every world matrix out, indexed by handle
+	void CopyWorldMatrices(std::vector<DirectX::XMFLOAT4X4>& out);
+
+	// Builds a quaternion that matches the Euler angle setters
+	static DirectX::XMVECTOR EulerToQuaternion(float x, float y, float z);
+
+private:
+	// Per handle - these never move
+	std::vector<unsigned int> handleToSlot;
+	std::vector<unsigned int> parentHandles;
+	std::vector<unsigned int> firstChildren;
+	std::vector<unsigned int> nextSiblings;
+
+	// Per slot, sorted parents first.  Slots are always padded
+	// to a multiple of 4 so the SIMD update never has to handle
+	// a partial group.  Re-parenting can leave unused slots
+	// (slotToHandle is NoTransform) until the next Compact().
+	unsigned int slotCount;
+	unsigned int freeSlotCount;
+	std::vector<unsigned int> slotToHandle;
+	std::vector<unsigned int> parentSlots;
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT4> rotations;
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<DirectX::XMFLOAT4X4> localMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+
+	// One bit per slot
+	std::vector<unsigned long long> dirtyBits;		// Local transform changed
+	std::vector<unsigned long long> changedBits;	// World matrix changed last update
+	std::vector<unsigned long long> parentedBits;	// Slot has a parent
+
+	static bool TestBit(const std::vector<unsigned long long>& bits, unsigned int s) { return (bits[s >> 6] & (1ull << (s & 63))) != 0; }
+	static void SetBit(std::vector<unsigned long long>& bits, unsigned int s) { bits[s >> 6] |= 1ull << (s & 63); }
+	static void ClearBit(std::vector<unsigned long long>& bits, unsigned int s) { bits[s >> 6] &= ~(1ull << (s & 63)); }
+	void MarkDirty(unsigned int s) { SetBit(dirtyBits, s); }
+
+	unsigned int AddSlot();
+	void CopySlot(unsigned int from, unsigned int to);
+	void FreeSlot(unsigned int s);
+	void SetParentSlot(unsigned int s, unsigned int parentSlot);
+	void MoveSubtreeToEnd(unsigned int t);
+	void Compact();
+
+	void UpdateLocalMatrices(unsigned int firstWord, unsigned int endWord);
+	void UpdateGroup(unsigned int first);
+};
+
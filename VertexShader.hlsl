@@ -1,52 +1,89 @@
-
-// Constant Buffer for external (C++) data
-cbuffer externalData : register(b0)
-{
-	matrix world;
-	matrix view;
-	matrix projection;
-};
-
-// Struct representing a single vertex worth of data
-struct VertexShaderInput
-{ 
-	float3 position		: POSITION;
-	float2 uv			: TEXCOORD;
-	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
-};
-
-// Out of the vertex shader (and eventually input to the PS)
-struct VertexToPixel
-{
-	float4 position		: SV_POSITION;
-	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
-	float3 worldPos		: POSITION;
-	float2 uv			: TEXCOORD;
-};
-
-// --------------------------------------------------------
-// The entry point (main method) for our vertex shader
-// --------------------------------------------------------
-VertexToPixel main( VertexShaderInput input )
-{
-	// Set up output
-	VertexToPixel output;
-
-	// Calculate output position
-	matrix worldViewProj = mul(mul(world, view), projection);
-	output.position = mul(float4(input.position, 1.0f), worldViewProj);
-
-	// Get the normal to the pixel shader
-	output.normal = mul(input.normal, (float3x3)world); // ASSUMING UNIFORM SCALE HERE!!!  If not, use inverse transpose of world matrix
-	output.tangent = mul(input.tangent, (float3x3)world); // Needed for normal mapping
-
-	// Get world position of vertex
-	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
-
-	// Pass through the uv
-	output.uv = input.uv;
-
-	return output;
-}
\ No newline at end of file
+
+// One source for every lit vertex shader, compiled in several
+// variants - see ShaderPermutations.  Each feature is a #define:
+//  - CLIP_PLANE: clips against "clipPlane" (the refraction pass)
+//  - INSTANCED: the world matrix comes from the instance buffer
+
+// Constant Buffers for external (C++) data, split by how
+// often they change - see SimpleBufferFrequency
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+#ifdef CLIP_PLANE
+	float4 clipPlane;
+#endif
+};
+
+#ifndef INSTANCED
+cbuffer perObject : register(b1)
+{
+	matrix world;
+};
+#endif
+
+// Struct representing a single vertex worth of data
+struct VertexShaderInput
+{ 
+	float3 position		: POSITION;
+	float2 uv			: TEXCOORD;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+#ifdef INSTANCED
+	// Plus the instance's world matrix.  The "_PER_INSTANCE"
+	// semantic tells SimpleShader to read it from input slot 1,
+	// once per instance.  The matrix arrives transposed (as it
+	// is for constant buffers), so each element is one column.
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+#endif
+};
+
+// Out of the vertex shader (and eventually input to the PS)
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	float3 worldPos		: POSITION;
+	float2 uv			: TEXCOORD;
+#ifdef CLIP_PLANE
+	float clip			: SV_ClipDistance0;
+#endif
+};
+
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input )
+{
+	// Set up output
+	VertexToPixel output;
+
+#ifdef INSTANCED
+	// Rows in, so transpose back to the usual world matrix
+	matrix world = transpose(matrix(input.world0, input.world1, input.world2, input.world3));
+#endif
+
+	// Calculate output position
+	matrix worldViewProj = mul(mul(world, view), projection);
+	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+
+	// Get the normal to the pixel shader
+	output.normal = mul(input.normal, (float3x3)world); // ASSUMING UNIFORM SCALE HERE!!!  If not, use inverse transpose of world matrix
+	output.tangent = mul(input.tangent, (float3x3)world); // Needed for normal mapping
+
+	// Get world position of vertex
+	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
+
+	// Pass through the uv
+	output.uv = input.uv;
+
+#ifdef CLIP_PLANE
+	output.clip = dot(mul(float4(input.position, 1.0f), world), clipPlane);
+#endif
+
+	return output;
+}